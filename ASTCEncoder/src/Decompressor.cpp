@@ -874,11 +874,12 @@ namespace ASTCC {
     // Read color data...
     uint32 colorDataBits = remainingBits;
     while(remainingBits > 0) {
-      uint32 nb = std::min(remainingBits, 8);
+      uint32 nb = std::min(remainingBits, 32);
       uint32 b = strm.ReadBits(nb);
       colorEndpointStream.WriteBits(b, nb);
-      remainingBits -= 8;
+      remainingBits -= 32;
     }
+    colorEndpointStream.Flush();
 
     // Read the plane selection bits
     planeIdx = strm.ReadBits(planeSelectorBits);
@@ -933,29 +934,13 @@ namespace ASTCC {
                        colorValuesPtr, colorEndpointMode[i]);
     }
 
-    // Read the texel weight data..
-    uint8 texelWeightData[16];
-    memcpy(texelWeightData, inBuf, sizeof(texelWeightData));
-    
-    // Reverse everything
-    for(uint32 i = 0; i < 8; i++) {
-      // Taken from http://graphics.stanford.edu/~seander/bithacks.html#ReverseByteWith64Bits
-      #define REVERSE_BYTE(b) (((b) * 0x80200802ULL) & 0x0884422110ULL) * 0x0101010101ULL >> 32
-      unsigned char a = static_cast<unsigned char>(REVERSE_BYTE(texelWeightData[i]));
-      unsigned char b = static_cast<unsigned char>(REVERSE_BYTE(texelWeightData[15 - i]));
-      #undef REVERSE_BYTE
-
-      texelWeightData[i] = b;
-      texelWeightData[15-i] = a;
-    }
-
-    // Make sure that higher non-texel bits are set to zero
-    const uint32 clearByteStart = (weightParams.GetPackedBitSize() >> 3) + 1;
-    texelWeightData[clearByteStart - 1] &= (1 << (weightParams.GetPackedBitSize() % 8)) - 1;
-    memset(texelWeightData + clearByteStart, 0, 16 - clearByteStart);
+    // Read the texel weight data. It is stored in reverse starting from the
+    // most significant bit of the block, and any bits past the weights are
+    // read back as zero.
+    FasTC::BitStreamReadOnly weightStream (inBuf + 16, nWeightBits,
+                                           BitStreamReadOnly::eReverseOrder);
 
     std::vector<IntegerEncodedValue> texelWeightValues;
-    FasTC::BitStreamReadOnly weightStream (texelWeightData);
 
     IntegerEncodedValue::
       DecodeIntegerSequence(texelWeightValues, weightStream,
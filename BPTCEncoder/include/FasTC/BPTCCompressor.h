@@ -41,12 +41,12 @@
 #ifndef BPTCENCODER_INCLUDE_BPTCCOMPRESSOR_H_
 #define BPTCENCODER_INCLUDE_BPTCCOMPRESSOR_H_
 
+#include "FasTC/BlockStats.h"
 #include "FasTC/CompressionJob.h"
 #include "FasTC/Pixel.h"
 
 #include "FasTC/BPTCConfig.h"
 
-#include <iosfwd>
 #include <vector>
 
 namespace BPTCC {
@@ -169,8 +169,9 @@ namespace BPTCC {
   // Perform a compression while recording all of the choices the compressor
   // made into a list of statistics. We can use this to see whether or not
   // certain heuristics are working, such as whether or not certain modes are
-  // being chosen more often than others, etc.
-  void CompressWithStats(const FasTC::CompressionJob &, std::ostream *logStream,
+  // being chosen more often than others, etc. One record is added to stats
+  // for each block. If stats is NULL, this is the same as Compress.
+  void CompressWithStats(const FasTC::CompressionJob &, FasTC::BlockStatList *stats,
                          CompressionSettings settings = CompressionSettings());
 
 #ifdef HAS_SSE_41
@@ -194,7 +195,7 @@ namespace BPTCC {
   // but they use the NVTT compressor if it was supplied to CMake.
   void CompressNVTT(const FasTC::CompressionJob &);
   void CompressNVTTWithStats(const FasTC::CompressionJob &,
-                             std::ostream *logStream);
+                             FasTC::BlockStatList *stats);
 #endif
 
   // A logical BPTC block. Each block has a mode, up to three
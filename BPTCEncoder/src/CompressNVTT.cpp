@@ -20,10 +20,9 @@
 #include "CompressionMode.h"
 #undef DBL_MAX
 #include "FasTC/BitStream.h"
+#include "FasTC/BlockStats.h"
 #include "FasTC/TexCompTypes.h"
 
-#include <iostream>
-#include <sstream>
 #include <cstring>
 
 #include "avpcl.h"
@@ -41,32 +40,6 @@ namespace BPTCC {
     }
   }
 
-  class BlockLogger {
-   public:
-    BlockLogger(uint64 blockIdx, std::ostream &os)
-      : m_BlockIdx(blockIdx), m_Stream(os) { }
-
-    template<typename T>
-    friend std::ostream &operator<<(const BlockLogger &bl, const T &v);
-
-    uint64 m_BlockIdx;
-    std::ostream &m_Stream;
-  };
-
-  template<typename T>
-  std::ostream &operator<<(const BlockLogger &bl, const T &v) {
-    std::stringstream ss;
-    ss << bl.m_BlockIdx << ": " << v;
-    return bl.m_Stream << ss.str();
-  }
-
-  template<typename T>
-  static void PrintStat(const BlockLogger &lgr, const char *stat, const T &v) {
-    std::stringstream ss;
-    ss << stat << " -- " << v << std::endl;
-    lgr << ss.str();
-  }
-
   // Compress an image using BC7 compression. Use the inBuf parameter to point
   // to an image in 4-byte RGBA format. The width and height parameters specify
   // the size of the image in pixels. The buffer pointed to by outBuf should be
@@ -105,11 +78,10 @@ namespace BPTCC {
     AVPCL::compress_mode7
   };
 
-  double CompressMode(uint32 mode, const Tile &t, char *out, BlockLogger &log) {
-    std::stringstream ss;
-    ss << "Mode_" << mode << "_error";
+  // Compresses the tile with a single mode and returns its error, along with
+  // the shape that was chosen, or BlockStat::kNone if the mode has no shapes.
+  double CompressMode(uint32 mode, const Tile &t, char *out, uint8 &shape) {
     double mse = kModeFuncs[mode](t, out);
-    PrintStat(log, ss.str().c_str(), mse);
 
     FasTC::BitStreamReadOnly strm(reinterpret_cast<uint8 *>(out));
     while(!strm.ReadBit());
@@ -118,21 +90,15 @@ namespace BPTCC {
       CompressionMode::GetAttributesForMode(mode);
     const uint32 nSubsets = attrs->numSubsets;
 
-    ss.str("");
-    ss << "Mode_" << mode << "_shape";
-
-    uint32 shapeIdx = 0;
+    shape = FasTC::BlockStat::kNone;
     if ( nSubsets > 1 ) {
-      shapeIdx = strm.ReadBits(mode == 0? 4 : 6);
-      PrintStat(log, ss.str().c_str(), shapeIdx);
-    } else {
-      PrintStat(log, ss.str().c_str(), -1);
+      shape = static_cast<uint8>(strm.ReadBits(mode == 0? 4 : 6));
     }
 
     return mse;
   }
 
-  void CompressNVTTWithStats(const FasTC::CompressionJob &cj, std::ostream *logStream) {
+  void CompressNVTTWithStats(const FasTC::CompressionJob &cj, FasTC::BlockStatList *stats) {
     const uint32 *inPixels = reinterpret_cast<const uint32 *>(cj.InBuf());
     const uint32 kBlockSz = GetBlockSize(FasTC::eCompressionFormat_BPTC);
     uint8 *outBuf = cj.OutBuf() + cj.CoordsToBlockIdx(cj.XStart(), cj.YStart()) * kBlockSz;
@@ -146,18 +112,25 @@ namespace BPTCC {
         Tile block(4, 4);
         GetBlock(i, j, cj.Width(), inPixels, block);
 
-        if(logStream) {
-          BlockLogger logger(cj.CoordsToBlockIdx(i, j), *logStream);
+        if(stats) {
+          FasTC::BlockStat stat(FasTC::eCompressionFormat_BPTC, cj.CoordsToBlockIdx(i, j));
 
           char tempblock[16];
           double msebest = 1e30;
           for(uint32 mode = 0; mode < 8; mode++) {
-            double mse_mode = CompressMode(mode, block, tempblock, logger);
+            uint8 shape;
+            double mse_mode = CompressMode(mode, block, tempblock, shape);
+            stat.m_ModeError[mode] = static_cast<float>(mse_mode);
             if(mse_mode < msebest) {
               msebest = mse_mode;
+              stat.m_Mode = mode;
+              stat.m_Shape = shape;
+              stat.m_Error = static_cast<float>(mse_mode);
               memcpy(outBuf, tempblock, AVPCL::BLOCKSIZE);
             }
           }
+
+          stats->Add(stat);
         } else {
           AVPCL::compress(block, reinterpret_cast<char *>(outBuf), NULL);          
         }
@@ -77,6 +77,7 @@ class CompressionMode {
     , m_ErrorMetric(settings.m_ErrorMetric)
     , m_RotateMode(0)
     , m_IndexMode(0)
+    , m_NumAnnealingSteps(0)
   { }
   ~CompressionMode() { }
 
@@ -147,6 +148,10 @@ class CompressionMode {
     return &kModeAttributes[mode];
   }
 
+  // The number of simulated annealing steps taken by every call to Compress
+  // so far.
+  uint32 GetNumAnnealingSteps() const { return m_NumAnnealingSteps; }
+
  private:
 
   const double m_IsOpaque;
@@ -156,6 +161,7 @@ class CompressionMode {
   ErrorMetric m_ErrorMetric;
   int m_RotateMode;
   int m_IndexMode;
+  mutable uint32 m_NumAnnealingSteps;
 
   void SetIndexMode(int mode) { m_IndexMode = mode; }
   void SetRotationMode(int mode) { m_RotateMode = mode; }
@@ -42,6 +42,7 @@
 
 #include "FasTC/TexCompTypes.h"
 #include "FasTC/BitStream.h"
+#include "FasTC/Trace.h"
 
 using FasTC::BitStream;
 using FasTC::BitStreamReadOnly;
@@ -60,6 +61,9 @@ using FasTC::BitStreamReadOnly;
 #ifdef _MSC_VER
 #  undef min
 #  undef max
+#  define FASTC_THREAD_LOCAL __declspec(thread)
+#else
+#  define FASTC_THREAD_LOCAL __thread
 #endif  // _MSC_VER
 
 #include <algorithm>
@@ -68,68 +72,11 @@ using FasTC::BitStreamReadOnly;
 #include <cstring>
 #include <cassert>
 #include <cfloat>
-#include <ctime>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <limits>
 
-enum EBlockStats {
-  eBlockStat_Path,
-  eBlockStat_Mode,
-
-  eBlockStat_SingleShapeEstimate,
-  eBlockStat_TwoShapeEstimate,
-  eBlockStat_ThreeShapeEstimate,
-
-  eBlockStat_ModeZeroEstimate,
-  eBlockStat_ModeOneEstimate,
-  eBlockStat_ModeTwoEstimate,
-  eBlockStat_ModeThreeEstimate,
-  eBlockStat_ModeFourEstimate,
-  eBlockStat_ModeFiveEstimate,
-  eBlockStat_ModeSixEstimate,
-  eBlockStat_ModeSevenEstimate,
-
-  eBlockStat_ModeZeroError,
-  eBlockStat_ModeOneError,
-  eBlockStat_ModeTwoError,
-  eBlockStat_ModeThreeError,
-  eBlockStat_ModeFourError,
-  eBlockStat_ModeFiveError,
-  eBlockStat_ModeSixError,
-  eBlockStat_ModeSevenError,
-
-  kNumBlockStats
-};
-
-static const char *kBlockStatString[kNumBlockStats] = {
-  "BlockStat_Path",
-  "BlockStat_Mode",
-
-  "BlockStat_SingleShapeEstimate",
-  "BlockStat_TwoShapeEstimate",
-  "BlockStat_ThreeShapeEstimate",
-
-  "BlockStat_ModeZeroEstimate",
-  "BlockStat_ModeOneEstimate",
-  "BlockStat_ModeTwoEstimate",
-  "BlockStat_ModeThreeEstimate",
-  "BlockStat_ModeFourEstimate",
-  "BlockStat_ModeFiveEstimate",
-  "BlockStat_ModeSixEstimate",
-  "BlockStat_ModeSevenEstimate",
-
-  "BlockStat_ModeZeroError",
-  "BlockStat_ModeOneError",
-  "BlockStat_ModeTwoError",
-  "BlockStat_ModeThreeError",
-  "BlockStat_ModeFourError",
-  "BlockStat_ModeFiveError",
-  "BlockStat_ModeSixError",
-  "BlockStat_ModeSevenError",
-};
-
 namespace BPTCC {
 
 static const uint32 kWMValues[] = {
@@ -355,12 +302,26 @@ double CompressionMode::CompressSingleColor(
 // Fast random number generator. See more information at
 // http://software.intel.com/en-us/articles/fast-random-number-
 // generator-on-the-intel-pentiumr-4-processor/
-static uint32 g_seed = static_cast<uint32>(time(NULL));
+//
+// Each thread has its own seed, which SeedRandom resets from the pixels of
+// every block before it is compressed. This way a block always compresses
+// to the same bits, no matter which thread compresses it or what was
+// compressed before it, so results can be compared and cached.
+static FASTC_THREAD_LOCAL uint32 g_seed = 0;
 static inline uint32 fastrand() {
   g_seed = (214013 * g_seed + 2531011);
   return (g_seed>>16) & RAND_MAX;
 }
 
+static void SeedRandom(const uint32 block[16]) {
+  // FNV-1a over the pixels
+  uint32 seed = 2166136261U;
+  for(uint32 i = 0; i < 16; i++) {
+    seed = (seed ^ block[i]) * 16777619U;
+  }
+  g_seed = seed;
+}
+
 static void ChangePointForDirWithoutPbitChange(
   RGBAVector &v, uint32 dir, const float step[kNumColorChannels]
 ) {
@@ -581,6 +542,7 @@ double CompressionMode::OptimizeEndpointsForCluster(
   const int maxEnergy = this->m_SASteps;
 
   for(int energy = 0; bestError > 0 && energy < maxEnergy; energy++) {
+    m_NumAnnealingSteps++;
 
     float temp = static_cast<float>(energy) / static_cast<float>(maxEnergy-1);
 
@@ -1370,25 +1332,6 @@ double CompressionMode::Compress(
   return totalErr;
 }
 
-class BlockLogger {
-  public:
-  BlockLogger(uint64 blockIdx, std::ostream &os)
-    : m_BlockIdx(blockIdx), m_Stream(os) { }
-
-  template<typename T>
-  friend std::ostream &operator<<(const BlockLogger &bl, const T &v);
-
-  uint64 m_BlockIdx;
-  std::ostream &m_Stream;
-};
-
-template<typename T>
-std::ostream &operator<<(const BlockLogger &bl, const T &v) {
-  std::stringstream ss;
-  ss << bl.m_BlockIdx << ": " << v;
-  return bl.m_Stream << ss.str();
-}
-
 // Function prototypes
 static void CompressBC7Block(
   const uint32 x, const uint32 y,
@@ -1397,7 +1340,7 @@ static void CompressBC7Block(
 );
 static void CompressBC7Block(
   const uint32 x, const uint32 y,
-  const uint32 block[16], uint8 *outBuf, const BlockLogger &logStream,
+  const uint32 block[16], uint8 *outBuf, FasTC::BlockStat &stat,
   const CompressionSettings = CompressionSettings()
 );
 
@@ -1471,6 +1414,8 @@ void GetBlock(const uint32 x, const uint32 y, const uint32 pixelsWide,
 // large enough to store the compressed image. This implementation has an 4:1
 // compression ratio.
 void Compress(const FasTC::CompressionJob &cj, CompressionSettings settings) {
+  FASTC_TRACE_ZONE("BPTC Compress");
+
   const uint32 *inPixels = reinterpret_cast<const uint32 *>(cj.InBuf());
   const uint32 kBlockSz = GetBlockSize(FasTC::eCompressionFormat_BPTC);
   uint8 *outBuf = cj.OutBuf() + cj.CoordsToBlockIdx(cj.XStart(), cj.YStart()) * kBlockSz;
@@ -1574,23 +1519,27 @@ void CompressAtomic(FasTC::CompressionJobList &cjl) {
 }
 #endif  // HAS_ATOMICS
 
-  void CompressWithStats(const FasTC::CompressionJob &cj, std::ostream *logStream,
+  void CompressWithStats(const FasTC::CompressionJob &cj, FasTC::BlockStatList *stats,
                          CompressionSettings settings) {
+  FASTC_TRACE_ZONE("BPTC Compress");
+
   const uint32 *inPixels = reinterpret_cast<const uint32 *>(cj.InBuf());
   const uint32 kBlockSz = GetBlockSize(FasTC::eCompressionFormat_BPTC);
   uint8 *outBuf = cj.OutBuf() + cj.CoordsToBlockIdx(cj.XStart(), cj.YStart()) * kBlockSz;
 
+  const uint32 endY = std::min(cj.YEnd(), cj.Height() - 4);
   uint32 startX = cj.XStart();
-  for(uint32 j = cj.YStart(); j <= cj.YEnd(); j += 4) {
+  for(uint32 j = cj.YStart(); j <= endY; j += 4) {
     const uint32 endX = j == cj.YEnd()? cj.XEnd() : cj.Width();
     for(uint32 i = startX; i < endX; i += 4) {
 
       uint32 block[16];
       GetBlock(i, j, cj.Width(), inPixels, block);
 
-      if(logStream) {
-        uint64 blockIdx = cj.CoordsToBlockIdx(i, j);
-        CompressBC7Block(i, j, block, outBuf, BlockLogger(blockIdx, *logStream), settings);
+      if(stats) {
+        FasTC::BlockStat stat(FasTC::eCompressionFormat_BPTC, cj.CoordsToBlockIdx(i, j));
+        CompressBC7Block(i, j, block, outBuf, stat, settings);
+        stats->Add(stat);
       } else {
         CompressBC7Block(i, j, block, outBuf, settings);
       }
@@ -1749,15 +1698,20 @@ static ShapeSelection BoxSelection(
   return result;
 }
 
+// Tries every selected mode and shape, and writes out the block with the least
+// error. If stat is not NULL, it receives the error of each mode, the chosen
+// mode and shape, and the number of annealing steps taken.
 static void CompressClusters(const ShapeSelection &selection, const uint32 pixels[16],
                              const CompressionSettings &settings, uint8 *outBuf,
-                             double *errors, int *modeChosen) {
+                             FasTC::BlockStat *stat) {
   RGBACluster cluster(pixels);
   double bestError = std::numeric_limits<double>::max();
   uint32 modes[8] = {0, 2, 1, 3, 7, 4, 5, 6};
   uint32 bestMode = 8;
   CompressionMode::Params bestParams;
 
+  FASTC_TRACE_ZONE("BPTC Endpoint Search");
+
   uint32 selectedModes = selection.m_SelectedModes;
   uint32 numShapeIndices = std::min<uint32>(5, selection.m_NumShapesToSearch);
 
@@ -1795,10 +1749,16 @@ static void CompressClusters(const ShapeSelection &selection, const uint32 pixel
       cluster.SetShapeIndex(idx, nParts);
 
       CompressionMode::Params params;
-      double error = CompressionMode(mode, settings).Compress(params, idx, cluster);
+      CompressionMode cmpMode(mode, settings);
+      double error = cmpMode.Compress(params, idx, cluster);
 
-      if(errors)
-        errors[mode] = std::min(error, errors[mode]);
+      if(stat) {
+        const float fError = static_cast<float>(error);
+        if(stat->m_ModeError[mode] < 0.0f || fError < stat->m_ModeError[mode]) {
+          stat->m_ModeError[mode] = fError;
+        }
+        stat->m_AnnealingSteps += cmpMode.GetNumAnnealingSteps();
+      }
 
       if(error < bestError) {
         bestError = error;
@@ -1810,15 +1770,24 @@ static void CompressClusters(const ShapeSelection &selection, const uint32 pixel
 
   assert(bestMode < 8);
 
+  FASTC_TRACE_ZONE("BPTC Pack");
   BitStream stream(outBuf, 128, 0);
   CompressionMode(bestMode, settings).Pack(bestParams, stream);
-  if(modeChosen)
-    *modeChosen = bestMode;
+  if(stat) {
+    stat->m_Mode = static_cast<uint8>(bestMode);
+    stat->m_Error = static_cast<float>(bestError);
+    if(CompressionMode::GetAttributesForMode(bestMode)->numSubsets > 1) {
+      stat->m_Shape = static_cast<uint8>(bestParams.m_ShapeIdx);
+    }
+  }
 }
 
 static void CompressBC7Block(const uint32 x, const uint32 y,
                              const uint32 block[16], uint8 *outBuf,
                              const CompressionSettings settings) {
+  FASTC_TRACE_ZONE("BPTC Block");
+  SeedRandom(block);
+
   // All a single color?
   if(AllOneColor(block)) {
     BitStream bStrm(outBuf, 128, 0);
@@ -1852,11 +1821,14 @@ static void CompressBC7Block(const uint32 x, const uint32 y,
   }
   assert(selectionFn);
 
-  ShapeSelection selection =
-    selectionFn(x, y, block, userData);
+  ShapeSelection selection;
+  {
+    FASTC_TRACE_ZONE("BPTC Shape Selection");
+    selection = selectionFn(x, y, block, userData);
+  }
   selection.m_SelectedModes &= settings.m_BlockModes;
   assert(selection.m_SelectedModes);
-  CompressClusters(selection, block, settings, outBuf, NULL, NULL);
+  CompressClusters(selection, block, settings, outBuf, NULL);
 }
 
 static double EstimateTwoClusterErrorStats(
@@ -1934,87 +1906,32 @@ static double EstimateThreeClusterErrorStats(
   return error;
 }
 
-static void UpdateErrorEstimate(double *estimates, uint32 mode, double est) {
+static void UpdateErrorEstimate(float *estimates, uint32 mode, double est) {
   assert(estimates);
   assert(mode >= 0);
   assert(mode < CompressionMode::kNumModes);
-  if(estimates[mode] == -1.0 || est < estimates[mode]) {
-    estimates[mode] = est;
+  const float fEst = static_cast<float>(est);
+  if(estimates[mode] < 0.0f || fEst < estimates[mode]) {
+    estimates[mode] = fEst;
   }
 }
 
-template<typename T>
-static void PrintStat(const BlockLogger &lgr, const char *stat, const T &v) {
-  std::stringstream ss;
-  ss << stat << " -- " << v << std::endl;
-  lgr << ss.str();
-}
-
 // Compress a single block but collect statistics as well...
 static void CompressBC7Block(
   const uint32 x, const uint32 y,
-  const uint32 block[16], uint8 *outBuf, const BlockLogger &logStream,
+  const uint32 block[16], uint8 *outBuf, FasTC::BlockStat &stat,
   const CompressionSettings settings
 ) {
-
-  class RAIIStatSaver {
-  private:
-    const BlockLogger &m_Logger;
-
-    int *m_ModePtr;
-    double *m_Estimates;
-    double *m_Errors;
-
-  public:
-    RAIIStatSaver(const BlockLogger &logger)
-      : m_Logger(logger)
-      , m_ModePtr(NULL), m_Estimates(NULL), m_Errors(NULL) { }
-    void SetMode(int *modePtr) { m_ModePtr = modePtr; }
-    void SetEstimates(double *estimates) { m_Estimates = estimates; }
-    void SetErrors(double *errors) { m_Errors = errors; }
-
-    ~RAIIStatSaver() {
-
-      assert(m_ModePtr);
-      assert(m_Estimates);
-      assert(m_Errors);
-
-      PrintStat(m_Logger, kBlockStatString[eBlockStat_Mode], *m_ModePtr);
-
-      for(uint32 i = 0; i < CompressionMode::kNumModes; i++) {
-
-        PrintStat(m_Logger,
-                  kBlockStatString[eBlockStat_ModeZeroEstimate + i],
-                  m_Estimates[i]);
-        PrintStat(m_Logger,
-                  kBlockStatString[eBlockStat_ModeZeroError + i],
-                  m_Errors[i]);
-      }
-    }
-  };
-
-  int bestMode = 0;
-  double modeEstimate[CompressionMode::kNumModes];
-  double modeError[CompressionMode::kNumModes];
-
-  // reset global variables...
-  bestMode = 0;
-  for(uint32 i = 0; i < CompressionMode::kNumModes; i++) {
-    modeError[i] = modeEstimate[i] = -1.0;
-  }
-
-  RAIIStatSaver __statsaver__(logStream);
-  __statsaver__.SetMode(&bestMode);
-  __statsaver__.SetEstimates(modeEstimate);
-  __statsaver__.SetErrors(modeError);
+  float *modeEstimate = stat.m_ModeEstimate;
+  SeedRandom(block);
 
   // All a single color?
   if(AllOneColor(block)) {
     BitStream bStrm(outBuf, 128, 0);
     CompressOptimalColorBC7(*block, bStrm);
-    bestMode = 5;
-
-    PrintStat(logStream, kBlockStatString[eBlockStat_Path], 0);
+    stat.m_Mode = 5;
+    stat.m_Error = 0.0f;
+    stat.m_Path = 0;
     return;
   }
 
@@ -2037,9 +1954,9 @@ static void CompressBC7Block(
   if(transparent) {
     BitStream bStrm(outBuf, 128, 0);
     WriteTransparentBlock(bStrm);
-    bestMode = 6;
-
-    PrintStat(logStream, kBlockStatString[eBlockStat_Path], 1);
+    stat.m_Mode = 6;
+    stat.m_Error = 0.0f;
+    stat.m_Path = 1;
     return;
   }
 
@@ -2098,12 +2015,6 @@ static void CompressBC7Block(
       UpdateErrorEstimate(modeEstimate, 3, errEstimate[1]);
     }
 
-    if(err < bestError[0]) {
-      PrintStat(logStream, 
-        kBlockStatString[eBlockStat_TwoShapeEstimate], err
-      );
-    }
-
     if(err < bestError[0]) {
       bestError[0] = err;
       selection.m_Shapes[0].m_Index = i;
@@ -2152,12 +2063,6 @@ static void CompressBC7Block(
         UpdateErrorEstimate(modeEstimate, 2, errEstimate[1]);
       }
 
-      if(err < bestError[1]) {
-        PrintStat(logStream, 
-          kBlockStatString[eBlockStat_ThreeShapeEstimate], err
-        );
-      }
-
       if(err < bestError[1]) {
         bestError[1] = err;
         selection.m_Shapes[1].m_Index = i;
@@ -2177,9 +2082,8 @@ static void CompressBC7Block(
 
   selection.m_SelectedModes &= settings.m_BlockModes;
   assert(selection.m_SelectedModes);
-  CompressClusters(selection, block, settings, outBuf, modeError, &bestMode);
-
-  PrintStat(logStream, kBlockStatString[eBlockStat_Path], path);
+  CompressClusters(selection, block, settings, outBuf, &stat);
+  stat.m_Path = static_cast<uint8>(path);
 }
 
 }  // namespace BPTCC
@@ -41,99 +41,228 @@
 #ifndef __BASE_INCLUDE_BITSTREAM_H__
 #define __BASE_INCLUDE_BITSTREAM_H__
 
+#include "TexCompTypes.h"
+
 namespace FasTC {
 
+// Writes bits into a buffer starting with the least significant bit of each
+// byte. Bits are gathered in a 64-bit accumulator and stored to memory a
+// 32-bit word at a time, so each call to WriteBits costs a shift and an or
+// regardless of how many bits it writes. Any bits in the buffer that are not
+// written are left untouched.
 class BitStream {
  public:
   BitStream(unsigned char *ptr, int nBits, int start_offset) :
     m_BitsWritten(0),
     m_NumBits(nBits),
-    m_CurByte(ptr),
-    m_NextBit(start_offset % 8),
-    done(false)
-  { }
+    m_CurByte(ptr + start_offset / 8),
+    m_Accum(0),
+    m_AccumBits(start_offset % 8)
+  {
+    // Keep the bits in the first byte that come before start_offset.
+    if(m_AccumBits > 0) {
+      m_Accum = *m_CurByte & ((1 << m_AccumBits) - 1);
+    }
+  }
 
   int GetBitsWritten() const { return m_BitsWritten; }
 
-  ~BitStream() { }
+  ~BitStream() { Flush(); }
+
+  // Writes the nBits low bits of val, most significant bit first.
   void WriteBitsR(unsigned int val, unsigned int nBits) {
+    unsigned int reversed = 0;
     for(unsigned int i = 0; i < nBits; i++) {
-      WriteBit((val >> (nBits - i - 1)) & 1);
+      reversed = (reversed << 1) | ((val >> i) & 1);
     }
+    WriteBits(reversed, nBits);
   }
 
+  // Writes the nBits low bits of val, least significant bit first. Writes of
+  // more than 32 bits pad val with zeros.
   void WriteBits(unsigned int val, unsigned int nBits) {
-    for(unsigned int i = 0; i < nBits; i++) {
-      WriteBit((val >> i) & 1);
+    while(nBits > 32) {
+      WriteWord(val, 32);
+      val = 0;
+      nBits -= 32;
     }
+    WriteWord(val, nBits);
   }
-  
+
+  // Stores any bits still held in the accumulator to memory. This happens
+  // automatically once nBits bits have been written and when the stream is
+  // destroyed, so it only needs to be called to look at a partially written
+  // buffer while the stream is still alive.
+  void Flush() {
+    while(m_AccumBits >= 8) {
+      *m_CurByte++ = static_cast<unsigned char>(m_Accum);
+      m_Accum >>= 8;
+      m_AccumBits -= 8;
+    }
+
+    // The last partial byte is merged with what is already in memory, but
+    // its bits stay in the accumulator so that later writes can finish it.
+    if(m_AccumBits > 0) {
+      const unsigned char mask =
+        static_cast<unsigned char>((1 << m_AccumBits) - 1);
+      *m_CurByte = static_cast<unsigned char>(
+        (*m_CurByte & ~mask) | (m_Accum & mask));
+    }
+  }
+
  private:
-  void WriteBit(int b) {
-    
-    if(done) return;
-    
-    const unsigned int mask = 1 << m_NextBit++;
-    
-    // clear the bit
-    *m_CurByte &= ~mask;
-    
-    // Write the bit, if necessary
-    if(b) *m_CurByte |= mask;
-    
-    // Next byte?
-    if(m_NextBit >= 8) {
-      m_CurByte += 1;
-      m_NextBit = 0;
+  void WriteWord(unsigned int val, unsigned int nBits) {
+    const int bitsLeft = m_NumBits - m_BitsWritten;
+    if(static_cast<int>(nBits) >= bitsLeft) {
+      if(bitsLeft <= 0) {
+        return;
+      }
+      nBits = bitsLeft;
+    }
+
+    const uint64 mask = (static_cast<uint64>(1) << nBits) - 1;
+    m_Accum |= (static_cast<uint64>(val) & mask) << m_AccumBits;
+    m_AccumBits += nBits;
+    m_BitsWritten += nBits;
+
+    if(m_AccumBits >= 32) {
+      m_CurByte[0] = static_cast<unsigned char>(m_Accum);
+      m_CurByte[1] = static_cast<unsigned char>(m_Accum >> 8);
+      m_CurByte[2] = static_cast<unsigned char>(m_Accum >> 16);
+      m_CurByte[3] = static_cast<unsigned char>(m_Accum >> 24);
+      m_CurByte += 4;
+      m_Accum >>= 32;
+      m_AccumBits -= 32;
+    }
+
+    if(m_BitsWritten == m_NumBits) {
+      Flush();
     }
-    
-    done = done || ++m_BitsWritten >= m_NumBits;
   }
-  
+
   int m_BitsWritten;
   const int m_NumBits;
   unsigned char *m_CurByte;
-  int m_NextBit;
-  
-  bool done;
+
+  uint64 m_Accum;
+  uint32 m_AccumBits;
 };
 
+// Reads bits from a buffer that holds nBits bits, least significant bit of
+// each byte first. Bits are loaded into a 64-bit accumulator a 32-bit word at
+// a time, and reading past the end of the buffer yields zeros.
 class BitStreamReadOnly {
  public:
-  BitStreamReadOnly(const unsigned char *ptr) :
+  BitStreamReadOnly(const unsigned char *ptr, int nBits = 128) :
     m_BitsRead(0),
     m_CurByte(ptr),
-    m_NextBit(0)
+    m_BitsLeft(nBits),
+    m_bReverse(false),
+    m_Accum(0),
+    m_AccumBits(0)
+  { }
+
+  // ASTC stores its texel weights starting from the most significant bit of
+  // the block and working backwards. This constructor reads the nBits bits
+  // that end at end, starting with the most significant bit of end[-1] and
+  // moving towards lower addresses and less significant bits.
+  enum EReverseOrder { eReverseOrder };
+  BitStreamReadOnly(const unsigned char *end, int nBits, EReverseOrder) :
+    m_BitsRead(0),
+    m_CurByte(end),
+    m_BitsLeft(nBits),
+    m_bReverse(true),
+    m_Accum(0),
+    m_AccumBits(0)
   { }
 
   int GetBitsRead() const { return m_BitsRead; }
-  
+
   ~BitStreamReadOnly() { }
-  
+
   int ReadBit() {
-    
-    int bit = *m_CurByte >> m_NextBit++;
-    while(m_NextBit >= 8) {
-      m_NextBit -= 8;
-      m_CurByte++;
-    }
-    
-    m_BitsRead++;
-    return bit & 1;
+    return static_cast<int>(ReadBits(1));
   }
-  
+
+  // Reads nBits bits, at most 32, into the low bits of the result. The first
+  // bit read ends up in the least significant bit.
   unsigned int ReadBits(unsigned int nBits) {
-    unsigned int ret = 0;
-    for(unsigned int i = 0; i < nBits; i++) {
-      ret |= (ReadBit() & 1) << i;
+    if(m_AccumBits < nBits) {
+      Refill();
     }
+
+    const uint64 mask = (static_cast<uint64>(1) << nBits) - 1;
+    const unsigned int ret = static_cast<unsigned int>(m_Accum & mask);
+    m_Accum >>= nBits;
+    m_AccumBits = (m_AccumBits > nBits)? m_AccumBits - nBits : 0;
+    m_BitsRead += nBits;
     return ret;
   }
-  
+
  private:
+  static unsigned char ReverseByte(unsigned char b) {
+    // Taken from http://graphics.stanford.edu/~seander/bithacks.html#ReverseByteWith64Bits
+    return static_cast<unsigned char>(
+      (((b * 0x80200802ULL) & 0x0884422110ULL) * 0x0101010101ULL) >> 32);
+  }
+
+  unsigned char NextByte() {
+    unsigned char b;
+    if(m_bReverse) {
+      b = ReverseByte(*--m_CurByte);
+    } else {
+      b = *m_CurByte++;
+    }
+
+    // Clear the bits past the end of the stream in the last byte.
+    if(m_BitsLeft < 8) {
+      b &= (1 << m_BitsLeft) - 1;
+      m_BitsLeft = 0;
+    } else {
+      m_BitsLeft -= 8;
+    }
+    return b;
+  }
+
+  // Tops up the accumulator with at least 32 bits, or with everything that
+  // is left in the buffer.
+  void Refill() {
+    uint32 word = 0;
+    uint32 nBits = 0;
+    if(m_BitsLeft >= 32) {
+      if(m_bReverse) {
+        word = static_cast<uint32>(ReverseByte(m_CurByte[-1])) |
+          (static_cast<uint32>(ReverseByte(m_CurByte[-2])) << 8) |
+          (static_cast<uint32>(ReverseByte(m_CurByte[-3])) << 16) |
+          (static_cast<uint32>(ReverseByte(m_CurByte[-4])) << 24);
+        m_CurByte -= 4;
+      } else {
+        word = static_cast<uint32>(m_CurByte[0]) |
+          (static_cast<uint32>(m_CurByte[1]) << 8) |
+          (static_cast<uint32>(m_CurByte[2]) << 16) |
+          (static_cast<uint32>(m_CurByte[3]) << 24);
+        m_CurByte += 4;
+      }
+      m_BitsLeft -= 32;
+      nBits = 32;
+    } else {
+      while(m_BitsLeft > 0) {
+        word |= static_cast<uint32>(NextByte()) << nBits;
+        nBits += 8;
+      }
+    }
+
+    m_Accum |= static_cast<uint64>(word) << m_AccumBits;
+    m_AccumBits += nBits;
+  }
+
   int m_BitsRead;
   const unsigned char *m_CurByte;
-  int m_NextBit;
+  int m_BitsLeft;
+  const bool m_bReverse;
+
+  uint64 m_Accum;
+  uint32 m_AccumBits;
 };
 
 }  // namespace FasTC
@@ -0,0 +1,108 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef BASE_INCLUDE_BLOCKSTATS_H_
+#define BASE_INCLUDE_BLOCKSTATS_H_
+
+#include "FasTC/TexCompTypes.h"
+#include "FasTC/CompressionFormat.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace FasTC {
+
+  // The choices that a compressor made for a single block, and how well they
+  // worked out. Every record has the same size and layout so that a list of
+  // them can be written out and read back as is. Values that don't apply to
+  // a format are kNone for the integer fields and negative for the errors.
+  struct BlockStat {
+    static const uint32 kMaxNumModes = 8;
+    static const uint8 kNone = 0xFF;
+
+    // The index of the block in row major order over the whole image.
+    uint32 m_BlockIdx;
+
+    // The ECompressionFormat that the block was compressed into.
+    uint8 m_Format;
+
+    // How the compressor handled the block. This is format specific:
+    // BPTC uses 0 for blocks of a single color, 1 for transparent blocks, 2
+    // for blocks where a shape matched exactly and 3 for everything else.
+    uint8 m_Path;
+
+    // The mode that was written and, for formats that partition the block,
+    // the index of the shape within that mode. For DXT the mode is 0 for
+    // four-color and 1 for three-color blocks, and for ETC1 it is the diff
+    // bit and the shape is the flip bit. For PVRTC, the mode is the
+    // modulation mode bit.
+    uint8 m_Mode;
+    uint8 m_Shape;
+
+    // The number of simulated annealing steps taken across every mode and
+    // shape that was tried.
+    uint32 m_AnnealingSteps;
+
+    // The error of the block that was written, in the compressor's metric.
+    float m_Error;
+
+    // For each mode that was considered, the error that the compressor
+    // estimated before compressing the block and the error that it actually
+    // reached with the mode.
+    float m_ModeEstimate[kMaxNumModes];
+    float m_ModeError[kMaxNumModes];
+
+    BlockStat(ECompressionFormat fmt, uint32 blockIdx);
+
+    // The sum of the squared differences between the channels of two 4x4
+    // blocks of RGBA8 pixels. Alpha is skipped for formats that drop it.
+    static float SquaredError(const uint32 *original, const uint32 *decoded,
+                              bool bIncludeAlpha);
+  };
+
+  // A list of block statistics that belongs to a single thread, so that
+  // adding to it never needs a lock. The lists of each thread are merged
+  // once they are done.
+  class BlockStatList {
+   public:
+    void Add(const BlockStat &s) { m_Stats.push_back(s); }
+    void Clear() { m_Stats.clear(); }
+
+    size_t Size() const { return m_Stats.size(); }
+    const BlockStat &operator[](size_t idx) const { return m_Stats[idx]; }
+    BlockStat &operator[](size_t idx) { return m_Stats[idx]; }
+
+    // Moves the records of other to the end of this list and clears other.
+    void Merge(BlockStatList &other);
+
+    // Orders the records from index first onwards by block index. Records of
+    // the same block, such as those from repeated compressions, keep the
+    // order they were added in.
+    void SortByBlock(size_t first = 0);
+
+    // Writes the records to a binary file in the byte order of this machine,
+    // or reads them back. Both return false with a message on failure.
+    bool Write(const char *filename) const;
+    bool Read(const char *filename);
+
+   private:
+    std::vector<BlockStat> m_Stats;
+  };
+
+}  // namespace FasTC
+
+#endif  // BASE_INCLUDE_BLOCKSTATS_H_
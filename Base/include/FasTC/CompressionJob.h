@@ -30,6 +30,14 @@
 
 namespace FasTC {
 
+  // The compressors and decompressors address the pixels and blocks of a job
+  // with 32 bit offsets, so the pixels of a single job must not take up more
+  // than this many bytes. Larger images are split into bands of block rows.
+  static const uint64 kMaxJobPixelBytes = 1ULL << 31;
+
+  // The quality that compressions run at unless they are told otherwise.
+  static const uint32 kDefaultQuality = 50;
+
   // This structure defines a compression job. Here, width and height are the dimensions
   // of the image in pixels. inBuf contains the R8G8B8A8 data that is to be compressed, and
   // outBuf will contain the compressed BPTC data.
@@ -46,6 +54,7 @@ namespace FasTC {
     uint32 m_Height;
     uint32 m_XStart, m_XEnd;
     uint32 m_YStart, m_YEnd;
+    uint32 m_Quality;
 
    public:
     ECompressionFormat Format() const { return m_Format; }
@@ -58,6 +67,12 @@ namespace FasTC {
     uint32 YStart() const { return m_YStart; }
     uint32 YEnd() const { return m_YEnd; }
 
+    // How hard the compressor should try, for the formats that can trade
+    // speed for quality. Each job carries its own, so that compressions with
+    // different settings can run at the same time.
+    uint32 Quality() const { return m_Quality; }
+    void SetQuality(uint32 quality) { m_Quality = quality; }
+
     CompressionJob(
       ECompressionFormat _fmt,
       const uint8 *_inBuf,
@@ -71,6 +86,7 @@ namespace FasTC {
       , m_Height(_height)
       , m_XStart(0), m_XEnd(_width)
       , m_YStart(0), m_YEnd(_height)
+      , m_Quality(kDefaultQuality)
     { }
 
     CompressionJob(
@@ -88,6 +104,7 @@ namespace FasTC {
       , m_Height(_height)
       , m_XStart(_xOffset), m_XEnd(_width)
       , m_YStart(_yOffset), m_YEnd(_height)
+      , m_Quality(kDefaultQuality)
     { }
 
     CompressionJob(
@@ -107,6 +124,7 @@ namespace FasTC {
       , m_Height(_height)
       , m_XStart(_xOffset), m_XEnd(_xEndpoint)
       , m_YStart(_yOffset), m_YEnd(_yEndpoint)
+      , m_Quality(kDefaultQuality)
     { }
 
     // Returns the x and y coordinates of the pixels that corresponds to the block
@@ -0,0 +1,113 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef BASE_INCLUDE_FLOATIMAGE_H_
+#define BASE_INCLUDE_FLOATIMAGE_H_
+
+#include "TexCompTypes.h"
+
+#include <cstddef>
+
+namespace FasTC {
+
+  // A single channel image of floats. Every row starts on a 16 byte boundary
+  // and is padded with zeros to a multiple of four floats, so that rows can
+  // be processed four pixels at a time with aligned SIMD loads and stores.
+  class FloatImage {
+   public:
+    FloatImage()
+      : m_Width(0), m_Height(0), m_RowStride(0)
+      , m_Data(NULL), m_Allocation(NULL) { }
+
+    // Allocates a width x height image with every pixel set to zero.
+    FloatImage(uint32 width, uint32 height);
+
+    FloatImage(const FloatImage &);
+    FloatImage &operator=(const FloatImage &);
+    ~FloatImage();
+
+    // Exchanges the contents of the two images without copying any pixels.
+    void Swap(FloatImage &other);
+
+    uint32 GetWidth() const { return m_Width; }
+    uint32 GetHeight() const { return m_Height; }
+
+    // The distance, in floats, between the starts of consecutive rows.
+    uint32 GetRowStride() const { return m_RowStride; }
+
+    float *GetRow(uint32 j) { return m_Data + j * m_RowStride; }
+    const float *GetRow(uint32 j) const { return m_Data + j * m_RowStride; }
+
+    float &operator()(uint32 i, uint32 j) { return GetRow(j)[i]; }
+    const float &operator()(uint32 i, uint32 j) const { return GetRow(j)[i]; }
+
+   private:
+    uint32 m_Width;
+    uint32 m_Height;
+    uint32 m_RowStride;
+
+    // m_Data points into m_Allocation at the first 16 byte aligned float.
+    float *m_Data;
+    float *m_Allocation;
+
+    void Allocate(uint32 width, uint32 height);
+  };
+
+  // Fills kernel with size samples of a normalized one dimensional Gaussian.
+  // The outer product of this kernel with itself is the normalized version
+  // of the kernel produced by GenerateGaussianKernel.
+  extern void GenerateGaussianKernel1D(float *kernel, uint32 size, float sigma);
+
+  // Convolves img with the separable kernel kernelX (x) kernelY, where
+  // kernelX is applied along rows and kernelY along columns. Both kernels must
+  // have an odd number of taps. Each output row is computed by SIMD passes
+  // over whole rows, and bands of output rows are distributed across
+  // numThreads threads. If numThreads is zero, every hardware thread is used.
+  // The output does not depend on the number of threads.
+
+  // Only keeps the region where the kernel lies entirely inside of img, like
+  // MATLAB's filter2(..., 'valid'). out is resized to
+  // (w - sizeX + 1) x (h - sizeY + 1), which must not be empty.
+  extern void FilterSeparableValid(const FloatImage &img,
+                                   const float *kernelX, uint32 sizeX,
+                                   const float *kernelY, uint32 sizeY,
+                                   FloatImage *out, uint32 numThreads = 0);
+
+  // Produces an image the same size as img, treating every pixel outside of
+  // img as a copy of the closest pixel on its edge.
+  extern void FilterSeparableClamped(const FloatImage &img,
+                                     const float *kernelX, uint32 sizeX,
+                                     const float *kernelY, uint32 sizeY,
+                                     FloatImage *out, uint32 numThreads = 0);
+
+  // Replaces every blockSize x blockSize block of img, in place, with its
+  // orthonormal two dimensional DCT-II. Blocks that hang off of the right or
+  // bottom edge are padded by repeating the last row or column, and only the
+  // coefficients that fall inside of img are kept. 8x8 blocks use the
+  // Arai-Agui-Nakajima factorization, and other sizes use a precomputed
+  // cosine table. Rows of blocks are distributed across numThreads threads,
+  // or across every hardware thread if numThreads is zero.
+  extern void DiscreteCosineXForm(FloatImage *img, uint32 blockSize,
+                                  uint32 numThreads = 0);
+
+  // The inverse of DiscreteCosineXForm.
+  extern void InvDiscreteCosineXForm(FloatImage *img, uint32 blockSize,
+                                     uint32 numThreads = 0);
+
+}  // namespace FasTC
+
+#endif  // BASE_INCLUDE_FLOATIMAGE_H_
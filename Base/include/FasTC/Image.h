@@ -28,6 +28,31 @@ namespace FasTC {
   template<typename U, typename V>
   extern double ComputePSNR(Image<U> *img1, Image<V> *img2);
 
+  // The set of error metrics that can be gathered when comparing two images.
+  // All of them are computed from a single pass over the pixels of both
+  // images (see Image::ComputeMetrics).
+  struct ImageMetrics {
+    // Peak signal to noise ratio of the premultiplied RGB channels. This
+    // is the same value that is returned from Image::ComputePSNR.
+    double m_PSNR;
+
+    // Mean structural similarity of the intensity of both images. This is
+    // -1 if it was not requested or the images are too small to filter.
+    double m_SSIM;
+
+    // The mean squared error and the maximum absolute error of each
+    // channel, in R, G, B, A order, measured on eight bit values.
+    double m_ChannelMSE[4];
+    uint32 m_ChannelMaxError[4];
+
+    ImageMetrics() : m_PSNR(-1.0), m_SSIM(-1.0) {
+      for(uint32 i = 0; i < 4; i++) {
+        m_ChannelMSE[i] = 0.0;
+        m_ChannelMaxError[i] = 0;
+      }
+    }
+  };
+
   // Forward declare
   template<typename PixelType>
   class Image {
@@ -71,6 +96,13 @@ namespace FasTC {
     double ComputePSNR(Image<PixelType> *other);
     double ComputeSSIM(Image<PixelType> *other);
 
+    // Computes every metric in ImageMetrics between this image and other.
+    // Both images are only decoded once (see ComputePixels), so this should
+    // be preferred over calling ComputePSNR and ComputeSSIM separately.
+    // Returns false if the images cannot be compared.
+    bool ComputeMetrics(Image<PixelType> *other, ImageMetrics *out,
+                        bool bComputeSSIM = true);
+
     Image<PixelType> Diff(Image<PixelType> *other, float mult);
 
     double ComputeEntropy();
@@ -96,6 +128,8 @@ namespace FasTC {
 
    protected:
 
+    // Takes ownership of data, which must have been allocated with
+    // TCMemory::NewArray under TCMemory::eCategory_Image.
     void SetImageData(uint32 width, uint32 height, PixelType *data);
   };
 
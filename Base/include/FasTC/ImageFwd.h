@@ -23,6 +23,10 @@
 namespace FasTC {
   class Pixel;
   template<typename PixelType = Pixel> class Image;
+
+  template<typename ChannelType> class RGBAImage;
+  typedef RGBAImage<uint8> RGBA8Image;
+  typedef RGBAImage<uint16> RGBA16FImage;
 }
 
 #endif  // FASTC_BASE_INCLUDE_IMAGEFWD_H_
@@ -0,0 +1,161 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef __TEX_COMP_MEMORY_H__
+#define __TEX_COMP_MEMORY_H__
+
+#include "FasTC/TexCompTypes.h"
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Memory accounting
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// The counters of a TCMemory::Scope, which live for as long as the scope or
+// any thread started inside of it.
+struct TCMemoryScopeState;
+
+// Keeps count of the large buffers that FasTC allocates, such as image pixels,
+// compressed blocks and file contents, so that the memory needed by a job can
+// be budgeted. Small and short lived allocations aren't counted.
+//
+// GetStats covers the whole process: every thread adds to the same counters,
+// so while other work runs at the same time, such as CompressImageAsync jobs,
+// the daemon's connections or the images of a batch, they include that work
+// too. To measure a single job, count it in a Scope instead.
+class TCMemory {
+ public:
+  // The parts of FasTC that allocate counted memory.
+  enum ECategory {
+    eCategory_Image,           // The pixels of Image, RGBAImage and FloatImage
+    eCategory_CompressedData,  // Compressed blocks
+    eCategory_ImageLoading,    // Files read into memory and decoded pixel data
+    eCategory_ImageWriting,    // Encoded files before they are written
+    eCategory_Compressor,      // Working memory of the compressors
+
+    kNumCategories
+  };
+
+  static const char *GetCategoryName(ECategory category);
+
+  struct Stats {
+    // The number of allocations and the bytes allocated since the last
+    // call to ResetStats.
+    uint64 m_NumAllocations[kNumCategories];
+    uint64 m_BytesAllocated[kNumCategories];
+
+    // The bytes that are allocated right now.
+    uint64 m_LiveBytes[kNumCategories];
+    uint64 m_TotalLiveBytes;
+
+    // The largest that m_TotalLiveBytes has been since the last call to
+    // ResetStats.
+    uint64 m_PeakLiveBytes;
+  };
+
+  static void RecordAllocation(ECategory category, uint64 bytes);
+  static void RecordFree(ECategory category, uint64 bytes);
+
+  static Stats GetStats();
+
+  // Starts a new measurement for the whole process: the allocation counts
+  // are cleared, and the peak starts over from the bytes that are live right
+  // now, whichever job they belong to.
+  static void ResetStats();
+
+  // Counts the memory used by one job, separately from anything else that
+  // runs at the same time. While a scope exists, it counts the allocations
+  // and frees made on the thread that created it and on every TCThread
+  // started from that thread, so the worker threads of the job count too.
+  // Scopes nest: the allocations of an inner scope also count toward the
+  // scopes around it. A scope must be destroyed on the thread that created
+  // it, in the reverse order of creation.
+  //
+  // Memory that the job frees but didn't allocate, such as an input image,
+  // isn't subtracted below zero, so the live bytes of a scope only ever
+  // cover what was allocated inside of it.
+  class Scope {
+   public:
+    Scope();
+    ~Scope();
+
+    // The counts of the scope so far. The stats are the same as those of
+    // the process, but only cover the scope: the peak is the most that the
+    // job had allocated at once, and the live bytes are what it still holds,
+    // such as the image that it returns.
+    Stats GetStats() const;
+
+   private:
+    TCMemoryScopeState *m_State;
+    TCMemoryScopeState *m_Previous;
+
+    // Not copyable
+    Scope(const Scope &);
+    Scope &operator=(const Scope &);
+  };
+
+  // Carries the scope of one thread over to another. TCThread creates one on
+  // the thread that starts it, and enters it on the new thread for as long
+  // as the thread runs. The counters of the scope stay valid until every
+  // ThreadScope that refers to them is gone.
+  class ThreadScope {
+   public:
+    // Refers to the current scope of the calling thread, if there is one.
+    ThreadScope();
+    ~ThreadScope();
+
+    // Makes the scope current on the calling thread, until Leave is called
+    // on the same thread.
+    void Enter();
+    void Leave();
+
+   private:
+    TCMemoryScopeState *m_State;
+    TCMemoryScopeState *m_Previous;
+
+    // Not copyable
+    ThreadScope(const ThreadScope &);
+    ThreadScope &operator=(const ThreadScope &);
+  };
+
+  // The peak resident set size of the process in bytes, as reported by the
+  // operating system, or zero if it isn't available. This includes memory
+  // that isn't counted above, such as the program itself.
+  static uint64 GetPeakResidentBytes();
+
+  // Allocates and frees arrays with new [] and delete [] and counts them.
+  // The number of elements passed to DeleteArray must match NewArray.
+  template<typename T>
+  static T *NewArray(ECategory category, size_t n) {
+    T *ptr = new T[n];
+    RecordAllocation(category, static_cast<uint64>(n) * sizeof(T));
+    return ptr;
+  }
+
+  template<typename T>
+  static void DeleteArray(ECategory category, T *ptr, size_t n) {
+    if(ptr) {
+      RecordFree(category, static_cast<uint64>(n) * sizeof(T));
+      delete [] ptr;
+    }
+  }
+};
+
+#endif  // __TEX_COMP_MEMORY_H__
@@ -0,0 +1,116 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef BASE_INCLUDE_RGBAIMAGE_H_
+#define BASE_INCLUDE_RGBAIMAGE_H_
+
+#include "TexCompTypes.h"
+
+#include <cstddef>
+
+namespace FasTC {
+
+  // The alignment, in bytes, of the pixel storage of every RGBAImage.
+  static const uint32 kRGBAImageAlignment = 16;
+
+  // An image whose pixels are stored as four interleaved channels of type
+  // ChannelType in RGBA order, with no padding between rows. This is the
+  // exact layout that the compressors read through a CompressionJob, so
+  // unlike Image<Pixel> it can be handed to them without any conversion.
+  template<typename ChannelType>
+  class RGBAImage {
+   public:
+    static const uint32 kNumChannels = 4;
+
+    RGBAImage() : m_Width(0), m_Height(0), m_Data(NULL), m_Allocation(NULL) { }
+
+    // Allocates storage for a width x height image. The contents of the
+    // image are undefined until they are written. If the pixels can't be
+    // addressed on this platform, the image is left empty.
+    RGBAImage(uint32 width, uint32 height);
+
+    // Allocates storage for a width x height image and copies the pixels
+    // from data, which is expected to be laid out in the same way.
+    RGBAImage(uint32 width, uint32 height, const ChannelType *data);
+
+    RGBAImage(const RGBAImage<ChannelType> &);
+    RGBAImage &operator=(const RGBAImage<ChannelType> &);
+    ~RGBAImage();
+
+    // Exchanges the contents of the two images without copying any pixels.
+    void Swap(RGBAImage<ChannelType> &other);
+
+    uint32 GetWidth() const { return m_Width; }
+    uint32 GetHeight() const { return m_Height; }
+    uint64 GetNumPixels() const {
+      return static_cast<uint64>(GetWidth()) * GetHeight();
+    }
+
+    // The size of a single row and of the whole image, in bytes. These are
+    // 64 bits wide because an image with 2^30 or more pixels has more than
+    // 4GB of them.
+    uint64 GetRowSize() const {
+      return static_cast<uint64>(GetWidth()) * kNumChannels * sizeof(ChannelType);
+    }
+    uint64 GetDataSize() const { return GetRowSize() * GetHeight(); }
+
+    ChannelType *GetData() { return m_Data; }
+    const ChannelType *GetData() const { return m_Data; }
+
+    ChannelType *GetRow(uint32 j) {
+      return m_Data + static_cast<size_t>(j) * GetWidth() * kNumChannels;
+    }
+    const ChannelType *GetRow(uint32 j) const {
+      return m_Data + static_cast<size_t>(j) * GetWidth() * kNumChannels;
+    }
+
+    ChannelType *operator()(uint32 i, uint32 j) {
+      return GetRow(j) + i * kNumChannels;
+    }
+    const ChannelType *operator()(uint32 i, uint32 j) const {
+      return GetRow(j) + i * kNumChannels;
+    }
+
+   private:
+    uint32 m_Width;
+    uint32 m_Height;
+
+    // m_Data points into m_Allocation at the first properly aligned byte.
+    ChannelType *m_Data;
+    uint8 *m_Allocation;
+
+    void Allocate(uint32 width, uint32 height);
+  };
+
+  // Eight bits per channel, unsigned normalized. Each pixel has the same
+  // memory layout as a packed Pixel (see Pixel::Pack).
+  typedef RGBAImage<uint8> RGBA8Image;
+
+  // Sixteen bits per channel, each holding an IEEE 754 half precision float.
+  typedef RGBAImage<uint16> RGBA16FImage;
+
+  extern uint16 FloatToHalf(float f);
+  extern float HalfToFloat(uint16 h);
+
+  // Converts between the two image types. Values are clamped to [0, 1]
+  // when converting to RGBA8.
+  extern void ConvertToRGBA8(const RGBA16FImage &in, RGBA8Image *out);
+  extern void ConvertToRGBA16F(const RGBA8Image &in, RGBA16FImage *out);
+
+}  // namespace FasTC
+
+#endif  // BASE_INCLUDE_RGBAIMAGE_H_
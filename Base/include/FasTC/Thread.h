@@ -20,6 +20,8 @@
 
 #include "FasTC/TexCompTypes.h"
 
+#include <deque>
+
 //!HACK! Apparently MSVC has issues with Yield()...????
 #ifdef _MSC_VER
 #undef Yield
@@ -94,6 +96,10 @@ class TCThread : public TCThreadBase {
   static void Yield();
   static uint64 ThreadID();
   void Join();
+
+  // Returns the number of threads that the hardware can run concurrently.
+  // This is always at least one.
+  static uint32 NumHardwareThreads();
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -146,4 +152,93 @@ class TCBarrier : public TCThreadBase {
   void Wait();
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Parallel loops
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// The body of a parallel loop. It is called with disjoint ranges [begin, end)
+// that together cover the whole loop, possibly from different threads.
+class TCRangeCallable {
+ protected:
+  TCRangeCallable() { }
+ public:
+  virtual ~TCRangeCallable() { }
+  virtual void operator()(uint32 begin, uint32 end) = 0;
+};
+
+// Splits [0, count) into at most numThreads contiguous ranges of roughly equal
+// size and runs body on each of them concurrently. The calling thread processes
+// the first range itself, and the function returns once every range is done.
+// If numThreads is zero, one thread per hardware thread is used.
+extern void TCParallelFor(uint32 count, uint32 numThreads, TCRangeCallable &body);
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Bounded queue
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// A first in, first out queue that holds at most a fixed number of items, for
+// connecting the stages of a pipeline. Push blocks while the queue is full and
+// Pop blocks while it is empty, so a slow stage holds back the stages that
+// feed it instead of letting work pile up in memory. Once the queue is
+// closed, Push fails and Pop drains the items that are left and then fails.
+template<typename T>
+class TCBoundedQueue {
+ public:
+  explicit TCBoundedQueue(uint32 capacity)
+    : m_Capacity(capacity > 0? capacity : 1)
+    , m_bClosed(false)
+  { }
+
+  bool Push(const T &item) {
+    TCLock lock(m_Mutex);
+    while(!m_bClosed && m_Items.size() >= m_Capacity) {
+      m_NotFull.Wait(lock);
+    }
+
+    if(m_bClosed) {
+      return false;
+    }
+
+    m_Items.push_back(item);
+    m_NotEmpty.NotifyOne();
+    return true;
+  }
+
+  bool Pop(T &item) {
+    TCLock lock(m_Mutex);
+    while(!m_bClosed && m_Items.empty()) {
+      m_NotEmpty.Wait(lock);
+    }
+
+    if(m_Items.empty()) {
+      return false;
+    }
+
+    item = m_Items.front();
+    m_Items.pop_front();
+    m_NotFull.NotifyOne();
+    return true;
+  }
+
+  void Close() {
+    TCLock lock(m_Mutex);
+    m_bClosed = true;
+    m_NotEmpty.NotifyAll();
+    m_NotFull.NotifyAll();
+  }
+
+ private:
+  const uint32 m_Capacity;
+  bool m_bClosed;
+  std::deque<T> m_Items;
+
+  TCMutex m_Mutex;
+  TCConditionVariable m_NotEmpty;
+  TCConditionVariable m_NotFull;
+};
+
 #endif //__TEX_COMP_THREAD_H__
@@ -0,0 +1,110 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef __TEX_COMP_TRACE_H__
+#define __TEX_COMP_TRACE_H__
+
+#include "FasTC/BaseConfig.h"
+#include "FasTC/TexCompTypes.h"
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Tracing
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// A lightweight profiler that records named, timed zones into a buffer owned
+// by each thread, so recording a zone never takes a lock. The zones can be
+// written out as a Chrome trace event file, which can be viewed in
+// chrome://tracing or https://ui.perfetto.dev.
+//
+// Recording is off until Start is called, and a zone costs a single branch
+// while it is off. If FasTC is configured with FASTC_ENABLE_TRACING turned
+// off, the zones are compiled out completely and Start fails.
+//
+// Start, Stop and WriteChromeTrace must not be called while other threads
+// are recording zones, e.g. while an image is being compressed.
+class TCTrace {
+ public:
+  // The number of zones that each thread keeps by default. Once a thread has
+  // recorded this many, its oldest zones are overwritten.
+  static const uint32 kDefaultEventsPerThread = 1 << 20;
+
+  // Discards every recorded zone and starts recording. Returns false if
+  // tracing is compiled out.
+  static bool Start(uint32 maxEventsPerThread = kDefaultEventsPerThread);
+  static void Stop();
+
+  static bool IsRecording() { return s_bRecording; }
+
+  // Names the calling thread in the trace. Does nothing unless recording.
+  static void SetThreadName(const char *name);
+
+  // Writes every recorded zone to filename in the Chrome trace event JSON
+  // format. Returns false if the file could not be written.
+  static bool WriteChromeTrace(const char *filename);
+
+  // The number of zones that were overwritten because a buffer was full.
+  static uint64 NumDroppedEvents();
+
+  // Nanoseconds on a monotonic clock.
+  static uint64 Now();
+
+  // Records a zone on the calling thread. The name must outlive the trace,
+  // which is the case for string literals.
+  static void Record(const char *name, uint64 startNS, uint64 endNS);
+
+ private:
+  static volatile bool s_bRecording;
+};
+
+// Records the time from its construction to its destruction as a zone.
+class TCTraceZone {
+ public:
+  explicit TCTraceZone(const char *name)
+    : m_Name(TCTrace::IsRecording()? name : NULL)
+    , m_StartNS(m_Name? TCTrace::Now() : 0)
+  { }
+
+  ~TCTraceZone() {
+    if(m_Name) {
+      TCTrace::Record(m_Name, m_StartNS, TCTrace::Now());
+    }
+  }
+
+ private:
+  const char *const m_Name;
+  const uint64 m_StartNS;
+
+  TCTraceZone(const TCTraceZone &);
+  TCTraceZone &operator=(const TCTraceZone &);
+};
+
+// Records the rest of the enclosing scope as a zone. The name must be a
+// string literal.
+#ifdef FASTC_ENABLE_TRACING
+#  define FASTC_TRACE_CONCAT_IMPL(a, b) a##b
+#  define FASTC_TRACE_CONCAT(a, b) FASTC_TRACE_CONCAT_IMPL(a, b)
+#  define FASTC_TRACE_ZONE(name) \
+     TCTraceZone FASTC_TRACE_CONCAT(_traceZone, __LINE__)(name)
+#else
+#  define FASTC_TRACE_ZONE(name) do { } while(0)
+#endif
+
+#endif //__TEX_COMP_TRACE_H__
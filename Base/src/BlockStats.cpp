@@ -0,0 +1,191 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/BlockStats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+
+namespace {
+
+// The file starts with this header, followed by the records. The byte order
+// marker tells apart files written on a machine with a different byte order.
+struct BlockStatFileHeader {
+  char m_Magic[4];
+  uint32 m_Version;
+  uint32 m_RecordSize;
+  uint32 m_ByteOrder;
+  uint64 m_NumRecords;
+};
+
+const char kMagic[4] = { 'F', 'T', 'C', 'S' };
+const uint32 kVersion = 1;
+const uint32 kByteOrder = 0x01020304;
+
+bool GetFileSize(const char *filename, uint64 *size) {
+#ifdef _WIN32
+  struct _stat64 st;
+  if(_stat64(filename, &st) != 0) {
+    return false;
+  }
+#else
+  struct stat st;
+  if(stat(filename, &st) != 0) {
+    return false;
+  }
+#endif
+  *size = static_cast<uint64>(st.st_size);
+  return true;
+}
+
+bool CompareBlockIdx(const FasTC::BlockStat &a, const FasTC::BlockStat &b) {
+  return a.m_BlockIdx < b.m_BlockIdx;
+}
+
+}  // namespace
+
+namespace FasTC {
+
+const uint32 BlockStat::kMaxNumModes;
+const uint8 BlockStat::kNone;
+
+BlockStat::BlockStat(ECompressionFormat fmt, uint32 blockIdx)
+  : m_BlockIdx(blockIdx)
+  , m_Format(static_cast<uint8>(fmt))
+  , m_Path(kNone)
+  , m_Mode(kNone)
+  , m_Shape(kNone)
+  , m_AnnealingSteps(0)
+  , m_Error(-1.0f)
+{
+  for(uint32 i = 0; i < kMaxNumModes; i++) {
+    m_ModeEstimate[i] = m_ModeError[i] = -1.0f;
+  }
+}
+
+float BlockStat::SquaredError(const uint32 *original, const uint32 *decoded,
+                              bool bIncludeAlpha) {
+  const uint32 numChannels = bIncludeAlpha? 4 : 3;
+  float err = 0.0f;
+  for(uint32 i = 0; i < 16; i++) {
+    for(uint32 c = 0; c < numChannels; c++) {
+      const int a = (original[i] >> (c * 8)) & 0xFF;
+      const int b = (decoded[i] >> (c * 8)) & 0xFF;
+      err += static_cast<float>((a - b) * (a - b));
+    }
+  }
+  return err;
+}
+
+void BlockStatList::Merge(BlockStatList &other) {
+  if(m_Stats.empty()) {
+    m_Stats.swap(other.m_Stats);
+    return;
+  }
+
+  m_Stats.insert(m_Stats.end(), other.m_Stats.begin(), other.m_Stats.end());
+  other.m_Stats.clear();
+}
+
+void BlockStatList::SortByBlock(size_t first) {
+  if(first >= m_Stats.size()) {
+    return;
+  }
+  std::stable_sort(m_Stats.begin() + first, m_Stats.end(), CompareBlockIdx);
+}
+
+bool BlockStatList::Write(const char *filename) const {
+  FILE *f = fopen(filename, "wb");
+  if(!f) {
+    fprintf(stderr, "Unable to open %s for writing block statistics.\n", filename);
+    return false;
+  }
+
+  BlockStatFileHeader hdr;
+  memcpy(hdr.m_Magic, kMagic, sizeof(kMagic));
+  hdr.m_Version = kVersion;
+  hdr.m_RecordSize = sizeof(BlockStat);
+  hdr.m_ByteOrder = kByteOrder;
+  hdr.m_NumRecords = m_Stats.size();
+
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+  if(ok && !m_Stats.empty()) {
+    ok = fwrite(&m_Stats[0], sizeof(BlockStat), m_Stats.size(), f) == m_Stats.size();
+  }
+
+  if(fclose(f) != 0) {
+    ok = false;
+  }
+
+  if(!ok) {
+    fprintf(stderr, "Error writing block statistics to %s.\n", filename);
+  }
+  return ok;
+}
+
+bool BlockStatList::Read(const char *filename) {
+  FILE *f = fopen(filename, "rb");
+  if(!f) {
+    fprintf(stderr, "Unable to open %s for reading block statistics.\n", filename);
+    return false;
+  }
+
+  BlockStatFileHeader hdr;
+  if(fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+     memcmp(hdr.m_Magic, kMagic, sizeof(kMagic)) != 0) {
+    fprintf(stderr, "%s is not a block statistics file.\n", filename);
+    fclose(f);
+    return false;
+  }
+
+  if(hdr.m_ByteOrder != kByteOrder || hdr.m_Version != kVersion ||
+     hdr.m_RecordSize != sizeof(BlockStat)) {
+    fprintf(stderr, "%s was written by an incompatible version of FasTC "
+                    "or on a machine with a different byte order.\n", filename);
+    fclose(f);
+    return false;
+  }
+
+  // Don't trust the header with the size of the allocation until the file
+  // turns out to be big enough to hold every record.
+  uint64 fileSz;
+  if(!GetFileSize(filename, &fileSz) || fileSz < sizeof(hdr) ||
+     hdr.m_NumRecords > (fileSz - sizeof(hdr)) / sizeof(BlockStat)) {
+    fprintf(stderr, "%s is truncated.\n", filename);
+    fclose(f);
+    return false;
+  }
+
+  std::vector<BlockStat> stats(static_cast<size_t>(hdr.m_NumRecords),
+                               BlockStat(kNumCompressionFormats, 0));
+  const bool ok = stats.empty() ||
+    fread(&stats[0], sizeof(BlockStat), stats.size(), f) == stats.size();
+  fclose(f);
+
+  if(!ok) {
+    fprintf(stderr, "%s is truncated.\n", filename);
+    return false;
+  }
+
+  m_Stats.swap(stats);
+  return true;
+}
+
+}  // namespace FasTC
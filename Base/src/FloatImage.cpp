@@ -0,0 +1,613 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/FloatImage.h"
+#include "FasTC/Memory.h"
+#include "FasTC/Thread.h"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#  define FASTC_FLOAT_IMAGE_SSE
+#  include <xmmintrin.h>
+#endif
+
+namespace FasTC {
+
+// The SIMD width, in floats, that rows are padded to.
+static const uint32 kFloatsPerVector = 4;
+
+// Don't bother giving a thread fewer output rows than this.
+static const uint32 kMinRowsPerBand = 16;
+
+FloatImage::FloatImage(uint32 width, uint32 height)
+  : m_Width(0), m_Height(0), m_RowStride(0)
+  , m_Data(NULL), m_Allocation(NULL)
+{
+  Allocate(width, height);
+}
+
+FloatImage::FloatImage(const FloatImage &other)
+  : m_Width(0), m_Height(0), m_RowStride(0)
+  , m_Data(NULL), m_Allocation(NULL)
+{
+  Allocate(other.GetWidth(), other.GetHeight());
+  if(m_Data) {
+    memcpy(m_Data, other.m_Data, m_RowStride * m_Height * sizeof(float));
+  }
+}
+
+FloatImage &FloatImage::operator=(const FloatImage &other) {
+  FloatImage copy(other);
+  Swap(copy);
+  return *this;
+}
+
+FloatImage::~FloatImage() {
+  TCMemory::DeleteArray(TCMemory::eCategory_Image, m_Allocation,
+                        m_RowStride * m_Height + kFloatsPerVector - 1);
+}
+
+void FloatImage::Swap(FloatImage &other) {
+  std::swap(m_Width, other.m_Width);
+  std::swap(m_Height, other.m_Height);
+  std::swap(m_RowStride, other.m_RowStride);
+  std::swap(m_Data, other.m_Data);
+  std::swap(m_Allocation, other.m_Allocation);
+}
+
+void FloatImage::Allocate(uint32 width, uint32 height) {
+  assert(!m_Allocation);
+
+  m_Width = width;
+  m_Height = height;
+  m_RowStride = ((width + kFloatsPerVector - 1) / kFloatsPerVector) * kFloatsPerVector;
+
+  const uint32 nFloats = m_RowStride * m_Height;
+  if(0 == nFloats) {
+    return;
+  }
+
+  // The allocation is at least float aligned, so we need at most three
+  // extra floats to find a 16 byte boundary.
+  m_Allocation = TCMemory::NewArray<float>(TCMemory::eCategory_Image,
+                                           nFloats + kFloatsPerVector - 1);
+  memset(m_Allocation, 0, (nFloats + kFloatsPerVector - 1) * sizeof(float));
+
+  const size_t addr = reinterpret_cast<size_t>(m_Allocation);
+  const size_t mask = static_cast<size_t>(kFloatsPerVector * sizeof(float) - 1);
+  const size_t aligned = (addr + mask) & ~mask;
+  m_Data = reinterpret_cast<float *>(aligned);
+}
+
+void GenerateGaussianKernel1D(float *kernel, uint32 size, float sigma) {
+  assert(size % 2);
+
+  const int32 halfSz = static_cast<int32>(size) / 2;
+  double sum = 0.0;
+  for(int32 i = -halfSz; i <= halfSz; i++) {
+    double v = exp(-(i*i) / (2.0 * sigma * sigma));
+    kernel[i + halfSz] = static_cast<float>(v);
+    sum += v;
+  }
+
+  for(uint32 i = 0; i < size; i++) {
+    kernel[i] = static_cast<float>(kernel[i] / sum);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Separable filtering
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// dst[i] = sum_t kernel[t] * src[i + t] for i in [0, n)
+static void ConvolveRow(const float *src, const float *kernel, uint32 size,
+                        float *dst, uint32 n) {
+  uint32 i = 0;
+
+#ifdef FASTC_FLOAT_IMAGE_SSE
+  for(; i + kFloatsPerVector <= n; i += kFloatsPerVector) {
+    __m128 acc = _mm_setzero_ps();
+    for(uint32 t = 0; t < size; t++) {
+      __m128 k = _mm_set1_ps(kernel[t]);
+      acc = _mm_add_ps(acc, _mm_mul_ps(k, _mm_loadu_ps(src + i + t)));
+    }
+    _mm_storeu_ps(dst + i, acc);
+  }
+#endif
+
+  for(; i < n; i++) {
+    float acc = 0.0f;
+    for(uint32 t = 0; t < size; t++) {
+      acc += kernel[t] * src[i + t];
+    }
+    dst[i] = acc;
+  }
+}
+
+// dst[i] = sum_t kernel[t] * rows[t][i] for i in [0, n). Every row, and
+// dst, must be 16 byte aligned and padded to a multiple of four floats.
+static void ConvolveColumns(const float *const *rows, const float *kernel,
+                            uint32 size, float *dst, uint32 n) {
+  const uint32 paddedN = ((n + kFloatsPerVector - 1) / kFloatsPerVector) * kFloatsPerVector;
+
+#ifdef FASTC_FLOAT_IMAGE_SSE
+  for(uint32 i = 0; i < paddedN; i += kFloatsPerVector) {
+    __m128 acc = _mm_setzero_ps();
+    for(uint32 t = 0; t < size; t++) {
+      __m128 k = _mm_set1_ps(kernel[t]);
+      acc = _mm_add_ps(acc, _mm_mul_ps(k, _mm_load_ps(rows[t] + i)));
+    }
+    _mm_store_ps(dst + i, acc);
+  }
+#else
+  for(uint32 i = 0; i < paddedN; i++) {
+    float acc = 0.0f;
+    for(uint32 t = 0; t < size; t++) {
+      acc += kernel[t] * rows[t][i];
+    }
+    dst[i] = acc;
+  }
+#endif
+}
+
+class SeparableFilterJob : public TCRangeCallable {
+ private:
+  const FloatImage &m_In;
+  FloatImage &m_Out;
+  const float *m_KernelX;
+  const uint32 m_SizeX;
+  const float *m_KernelY;
+  const uint32 m_SizeY;
+  const bool m_bClamp;
+
+  static int32 ClampIdx(int32 x, uint32 sz) {
+    return std::max(0, std::min(x, static_cast<int32>(sz) - 1));
+  }
+
+ public:
+  SeparableFilterJob(const FloatImage &in, FloatImage &out,
+                     const float *kernelX, uint32 sizeX,
+                     const float *kernelY, uint32 sizeY, bool bClamp)
+    : TCRangeCallable()
+    , m_In(in), m_Out(out)
+    , m_KernelX(kernelX), m_SizeX(sizeX)
+    , m_KernelY(kernelY), m_SizeY(sizeY)
+    , m_bClamp(bClamp)
+  { }
+
+  virtual ~SeparableFilterJob() { }
+
+  // Filters the output rows [begin, end). Each input row that is needed is
+  // filtered horizontally exactly once into a ring buffer of m_SizeY rows,
+  // and the vertical pass combines the rows in the ring.
+  virtual void operator()(uint32 begin, uint32 end) {
+    const uint32 outW = m_Out.GetWidth();
+    const int32 inW = static_cast<int32>(m_In.GetWidth());
+    const int32 xOffset = m_bClamp? -static_cast<int32>(m_SizeX / 2) : 0;
+    const int32 yOffset = m_bClamp? -static_cast<int32>(m_SizeY / 2) : 0;
+
+    FloatImage ring(outW, m_SizeY);
+
+    // When clamping, each input row is first extended at both ends so that
+    // the horizontal pass doesn't need to check any bounds.
+    const uint32 extendedW = outW + m_SizeX - 1;
+    FloatImage extended(m_bClamp? extendedW : 0, m_bClamp? 1 : 0);
+
+    const float **rows = new const float *[m_SizeY];
+
+    int32 nextRow = static_cast<int32>(begin) + yOffset;
+    for(uint32 j = begin; j < end; j++) {
+      const int32 firstRow = static_cast<int32>(j) + yOffset;
+      const int32 lastRow = firstRow + static_cast<int32>(m_SizeY);
+
+      for(int32 y = std::max(nextRow, firstRow); y < lastRow; y++) {
+        float *dst = ring.GetRow((y - yOffset) % m_SizeY);
+        if(m_bClamp) {
+          const float *src = m_In.GetRow(ClampIdx(y, m_In.GetHeight()));
+          float *ext = extended.GetRow(0);
+          for(uint32 i = 0; i < extendedW; i++) {
+            ext[i] = src[ClampIdx(static_cast<int32>(i) + xOffset, inW)];
+          }
+          ConvolveRow(ext, m_KernelX, m_SizeX, dst, outW);
+        } else {
+          ConvolveRow(m_In.GetRow(y), m_KernelX, m_SizeX, dst, outW);
+        }
+      }
+      nextRow = lastRow;
+
+      for(uint32 t = 0; t < m_SizeY; t++) {
+        rows[t] = ring.GetRow((firstRow + static_cast<int32>(t) - yOffset) % m_SizeY);
+      }
+      ConvolveColumns(rows, m_KernelY, m_SizeY, m_Out.GetRow(j), outW);
+    }
+
+    delete [] rows;
+  }
+};
+
+static void FilterSeparable(const FloatImage &img,
+                            const float *kernelX, uint32 sizeX,
+                            const float *kernelY, uint32 sizeY,
+                            FloatImage *out, uint32 numThreads,
+                            bool bClamp) {
+  assert(sizeX % 2);
+  assert(sizeY % 2);
+
+  uint32 outW = img.GetWidth();
+  uint32 outH = img.GetHeight();
+  if(!bClamp) {
+    assert(outW >= sizeX);
+    assert(outH >= sizeY);
+    outW -= sizeX - 1;
+    outH -= sizeY - 1;
+  }
+
+  FloatImage result(outW, outH);
+  if(0 == numThreads) {
+    numThreads = TCThread::NumHardwareThreads();
+  }
+  numThreads = std::min(numThreads, std::max(1U, outH / kMinRowsPerBand));
+
+  SeparableFilterJob job(img, result, kernelX, sizeX, kernelY, sizeY, bClamp);
+  TCParallelFor(outH, numThreads, job);
+
+  out->Swap(result);
+}
+
+void FilterSeparableValid(const FloatImage &img,
+                          const float *kernelX, uint32 sizeX,
+                          const float *kernelY, uint32 sizeY,
+                          FloatImage *out, uint32 numThreads) {
+  FilterSeparable(img, kernelX, sizeX, kernelY, sizeY, out, numThreads, false);
+}
+
+void FilterSeparableClamped(const FloatImage &img,
+                            const float *kernelX, uint32 sizeX,
+                            const float *kernelY, uint32 sizeY,
+                            FloatImage *out, uint32 numThreads) {
+  FilterSeparable(img, kernelX, sizeX, kernelY, sizeY, out, numThreads, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Discrete cosine transform
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Don't bother giving a thread fewer blocks than this.
+static const uint32 kMinBlocksPerThread = 64;
+
+// One dimensional 8 point DCT-II from Arai, Agui and Nakajima. The outputs
+// are scaled and must be multiplied by kAANOutputScale to be orthonormal.
+static void FDCT8(float *d, uint32 stride) {
+  const float tmp0 = d[0*stride] + d[7*stride];
+  const float tmp7 = d[0*stride] - d[7*stride];
+  const float tmp1 = d[1*stride] + d[6*stride];
+  const float tmp6 = d[1*stride] - d[6*stride];
+  const float tmp2 = d[2*stride] + d[5*stride];
+  const float tmp5 = d[2*stride] - d[5*stride];
+  const float tmp3 = d[3*stride] + d[4*stride];
+  const float tmp4 = d[3*stride] - d[4*stride];
+
+  // Even part
+  float tmp10 = tmp0 + tmp3;
+  const float tmp13 = tmp0 - tmp3;
+  float tmp11 = tmp1 + tmp2;
+  float tmp12 = tmp1 - tmp2;
+
+  d[0*stride] = tmp10 + tmp11;
+  d[4*stride] = tmp10 - tmp11;
+
+  const float z1 = (tmp12 + tmp13) * 0.707106781f;
+  d[2*stride] = tmp13 + z1;
+  d[6*stride] = tmp13 - z1;
+
+  // Odd part
+  tmp10 = tmp4 + tmp5;
+  tmp11 = tmp5 + tmp6;
+  tmp12 = tmp6 + tmp7;
+
+  const float z5 = (tmp10 - tmp12) * 0.382683433f;
+  const float z2 = 0.541196100f * tmp10 + z5;
+  const float z4 = 1.306562965f * tmp12 + z5;
+  const float z3 = tmp11 * 0.707106781f;
+
+  const float z11 = tmp7 + z3;
+  const float z13 = tmp7 - z3;
+
+  d[5*stride] = z13 + z2;
+  d[3*stride] = z13 - z2;
+  d[1*stride] = z11 + z4;
+  d[7*stride] = z11 - z4;
+}
+
+// One dimensional 8 point DCT-III from Arai, Agui and Nakajima. The inputs
+// must have been multiplied by kAANInputScale for the output to be the
+// inverse of the orthonormal DCT-II.
+static void IDCT8(float *d, uint32 stride) {
+  // Even part
+  float tmp0 = d[0*stride];
+  float tmp1 = d[2*stride];
+  float tmp2 = d[4*stride];
+  float tmp3 = d[6*stride];
+
+  float tmp10 = tmp0 + tmp2;
+  float tmp11 = tmp0 - tmp2;
+  const float tmp13 = tmp1 + tmp3;
+  float tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+
+  tmp0 = tmp10 + tmp13;
+  tmp3 = tmp10 - tmp13;
+  tmp1 = tmp11 + tmp12;
+  tmp2 = tmp11 - tmp12;
+
+  // Odd part
+  const float z13 = d[5*stride] + d[3*stride];
+  const float z10 = d[5*stride] - d[3*stride];
+  const float z11 = d[1*stride] + d[7*stride];
+  const float z12 = d[1*stride] - d[7*stride];
+
+  const float tmp7 = z11 + z13;
+  tmp11 = (z11 - z13) * 1.414213562f;
+
+  const float z5 = (z10 + z12) * 1.847759065f;
+  tmp10 = 1.082392200f * z12 - z5;
+  tmp12 = -2.613125930f * z10 + z5;
+
+  const float tmp6 = tmp12 - tmp7;
+  const float tmp5 = tmp11 - tmp6;
+  const float tmp4 = tmp10 + tmp5;
+
+  d[0*stride] = tmp0 + tmp7;
+  d[7*stride] = tmp0 - tmp7;
+  d[1*stride] = tmp1 + tmp6;
+  d[6*stride] = tmp1 - tmp6;
+  d[2*stride] = tmp2 + tmp5;
+  d[5*stride] = tmp2 - tmp5;
+  d[4*stride] = tmp3 + tmp4;
+  d[3*stride] = tmp3 - tmp4;
+}
+
+// Precomputed tables for transforming blocks of a given size.
+class DCTTables {
+ public:
+  explicit DCTTables(uint32 n) : m_N(n), m_Cos(new float[n * n]) {
+    // m_Cos[k*n + i] is the weight of sample i in the orthonormal
+    // coefficient k.
+    for(uint32 k = 0; k < n; k++) {
+      const double ck = sqrt(((k == 0)? 1.0 : 2.0) / static_cast<double>(n));
+      for(uint32 i = 0; i < n; i++) {
+        const double angle = ((2.0 * i + 1.0) * k * M_PI) / (2.0 * n);
+        m_Cos[k * n + i] = static_cast<float>(ck * cos(angle));
+      }
+    }
+
+    // The AAN transforms are missing a factor of aan[k] / (2 * sqrt(2)) per
+    // coefficient, where aan[0] = 1 and aan[k] = sqrt(2) * cos(k * pi / 16).
+    if(8 == n) {
+      for(uint32 k = 0; k < 8; k++) {
+        const double aan = (k == 0)? 1.0 : M_SQRT2 * cos(k * M_PI / 16.0);
+        const double s = aan / (2.0 * M_SQRT2);
+        m_AANOutputScale[k] = static_cast<float>(1.0 / (s * 8.0));
+        m_AANInputScale[k] = static_cast<float>(s);
+      }
+    }
+  }
+
+  ~DCTTables() { delete [] m_Cos; }
+
+  // Forward transform of n samples spaced stride floats apart. For even
+  // sizes we use the symmetry of the cosines around the center of the block
+  // to halve the number of multiplications.
+  void Forward(float *d, uint32 stride, float *scratch) const {
+    const uint32 n = m_N;
+    if(8 == n) {
+      FDCT8(d, stride);
+      for(uint32 k = 0; k < 8; k++) {
+        d[k * stride] *= m_AANOutputScale[k];
+      }
+      return;
+    }
+
+    if(n % 2) {
+      for(uint32 i = 0; i < n; i++) {
+        scratch[i] = d[i * stride];
+      }
+
+      for(uint32 k = 0; k < n; k++) {
+        const float *c = m_Cos + k * n;
+        float acc = 0.0f;
+        for(uint32 i = 0; i < n; i++) {
+          acc += c[i] * scratch[i];
+        }
+        d[k * stride] = acc;
+      }
+      return;
+    }
+
+    const uint32 half = n / 2;
+    float *sum = scratch;
+    float *diff = scratch + half;
+    for(uint32 i = 0; i < half; i++) {
+      const float a = d[i * stride];
+      const float b = d[(n - 1 - i) * stride];
+      sum[i] = a + b;
+      diff[i] = a - b;
+    }
+
+    for(uint32 k = 0; k < n; k++) {
+      const float *c = m_Cos + k * n;
+      const float *v = (k % 2)? diff : sum;
+      float acc = 0.0f;
+      for(uint32 i = 0; i < half; i++) {
+        acc += c[i] * v[i];
+      }
+      d[k * stride] = acc;
+    }
+  }
+
+  void Inverse(float *d, uint32 stride, float *scratch) const {
+    const uint32 n = m_N;
+    if(8 == n) {
+      for(uint32 k = 0; k < 8; k++) {
+        d[k * stride] *= m_AANInputScale[k];
+      }
+      IDCT8(d, stride);
+      return;
+    }
+
+    for(uint32 k = 0; k < n; k++) {
+      scratch[k] = d[k * stride];
+    }
+
+    if(n % 2) {
+      for(uint32 i = 0; i < n; i++) {
+        float acc = 0.0f;
+        for(uint32 k = 0; k < n; k++) {
+          acc += m_Cos[k * n + i] * scratch[k];
+        }
+        d[i * stride] = acc;
+      }
+      return;
+    }
+
+    // Sample i and sample n - 1 - i share the same even coefficient weights
+    // and opposite odd coefficient weights.
+    const uint32 half = n / 2;
+    for(uint32 i = 0; i < half; i++) {
+      float even = 0.0f, odd = 0.0f;
+      for(uint32 k = 0; k < n; k += 2) {
+        even += m_Cos[k * n + i] * scratch[k];
+        odd += m_Cos[(k + 1) * n + i] * scratch[k + 1];
+      }
+      d[i * stride] = even + odd;
+      d[(n - 1 - i) * stride] = even - odd;
+    }
+  }
+
+ private:
+  const uint32 m_N;
+  float *m_Cos;
+  float m_AANOutputScale[8];
+  float m_AANInputScale[8];
+
+  // Not copyable
+  DCTTables(const DCTTables &);
+  DCTTables &operator=(const DCTTables &);
+};
+
+class BlockDCTJob : public TCRangeCallable {
+ private:
+  FloatImage &m_Img;
+  const DCTTables &m_Tables;
+  const uint32 m_BlockSize;
+  const bool m_bInverse;
+
+ public:
+  BlockDCTJob(FloatImage &img, const DCTTables &tables,
+              uint32 blockSize, bool bInverse)
+    : TCRangeCallable()
+    , m_Img(img), m_Tables(tables)
+    , m_BlockSize(blockSize), m_bInverse(bInverse)
+  { }
+
+  virtual ~BlockDCTJob() { }
+
+  // Transforms every block in the rows of blocks [begin, end).
+  virtual void operator()(uint32 begin, uint32 end) {
+    const uint32 n = m_BlockSize;
+    const uint32 w = m_Img.GetWidth();
+    const uint32 h = m_Img.GetHeight();
+
+    float *block = new float[n * n];
+    float *scratch = new float[n];
+
+    for(uint32 by = begin; by < end; by++) {
+      const uint32 y0 = by * n;
+      for(uint32 x0 = 0; x0 < w; x0 += n) {
+        for(uint32 y = 0; y < n; y++) {
+          const float *src = m_Img.GetRow(std::min(h - 1, y0 + y));
+          for(uint32 x = 0; x < n; x++) {
+            block[y * n + x] = src[std::min(w - 1, x0 + x)];
+          }
+        }
+
+        if(m_bInverse) {
+          for(uint32 x = 0; x < n; x++) {
+            m_Tables.Inverse(block + x, n, scratch);
+          }
+          for(uint32 y = 0; y < n; y++) {
+            m_Tables.Inverse(block + y * n, 1, scratch);
+          }
+        } else {
+          for(uint32 y = 0; y < n; y++) {
+            m_Tables.Forward(block + y * n, 1, scratch);
+          }
+          for(uint32 x = 0; x < n; x++) {
+            m_Tables.Forward(block + x, n, scratch);
+          }
+        }
+
+        const uint32 rows = std::min(n, h - y0);
+        const uint32 cols = std::min(n, w - x0);
+        for(uint32 y = 0; y < rows; y++) {
+          memcpy(m_Img.GetRow(y0 + y) + x0, block + y * n, cols * sizeof(float));
+        }
+      }
+    }
+
+    delete [] scratch;
+    delete [] block;
+  }
+};
+
+static void RunBlockDCT(FloatImage *img, uint32 blockSize,
+                        uint32 numThreads, bool bInverse) {
+  assert(img);
+  assert(blockSize > 0);
+
+  const uint32 blocksWide = (img->GetWidth() + blockSize - 1) / blockSize;
+  const uint32 blocksHigh = (img->GetHeight() + blockSize - 1) / blockSize;
+
+  if(0 == numThreads) {
+    numThreads = TCThread::NumHardwareThreads();
+  }
+  const uint32 numBlocks = blocksWide * blocksHigh;
+  numThreads = std::min(numThreads, std::max(1U, numBlocks / kMinBlocksPerThread));
+
+  DCTTables tables(blockSize);
+  BlockDCTJob job(*img, tables, blockSize, bInverse);
+  TCParallelFor(blocksHigh, numThreads, job);
+}
+
+void DiscreteCosineXForm(FloatImage *img, uint32 blockSize, uint32 numThreads) {
+  RunBlockDCT(img, blockSize, numThreads, false);
+}
+
+void InvDiscreteCosineXForm(FloatImage *img, uint32 blockSize, uint32 numThreads) {
+  RunBlockDCT(img, blockSize, numThreads, true);
+}
+
+}  // namespace FasTC
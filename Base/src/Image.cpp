@@ -28,8 +28,11 @@
 #include <iostream>
 
 #include "FasTC/Color.h"
+#include "FasTC/FloatImage.h"
 #include "FasTC/Pixel.h"
 #include "FasTC/IPixel.h"
+#include "FasTC/Memory.h"
+#include "FasTC/Trace.h"
 
 template <typename T>
 static inline T sad( const T &a, const T &b ) {
@@ -75,7 +78,7 @@ template<typename PixelType>
 Image<PixelType>::Image(uint32 width, uint32 height)
   : m_Width(width)
   , m_Height(height)
-  , m_Pixels(new PixelType[GetNumPixels()])
+  , m_Pixels(TCMemory::NewArray<PixelType>(TCMemory::eCategory_Image, GetNumPixels()))
 { }
 
 template<typename PixelType>
@@ -85,7 +88,7 @@ Image<PixelType>::Image(uint32 width, uint32 height,
   , m_Height(height)
 {
   if(pixels) {
-    m_Pixels = new PixelType[GetNumPixels()];
+    m_Pixels = TCMemory::NewArray<PixelType>(TCMemory::eCategory_Image, GetNumPixels());
     memcpy(m_Pixels, pixels, GetNumPixels() * sizeof(PixelType));
   } else {
     m_Pixels = 0;
@@ -96,9 +99,12 @@ template<typename PixelType>
 Image<PixelType>::Image(const Image<PixelType> &other)
   : m_Width(other.m_Width)
   , m_Height(other.m_Height)
-  , m_Pixels(new PixelType[GetNumPixels()])
+  , m_Pixels(NULL)
 {
+  // Images without pixels (such as compressed images that haven't been
+  // decoded yet) stay that way so that copying them is cheap.
   if(other.m_Pixels) {
+    m_Pixels = TCMemory::NewArray<PixelType>(TCMemory::eCategory_Image, GetNumPixels());
     memcpy(m_Pixels, other.m_Pixels, GetNumPixels() * sizeof(PixelType));
   }
 }
@@ -120,7 +126,7 @@ Image<PixelType>::Image(uint32 width, uint32 height, const uint32 *pixels)
   , m_Height(height)
 {
   if(pixels) {
-    m_Pixels = new PixelType[GetNumPixels()];
+    m_Pixels = TCMemory::NewArray<PixelType>(TCMemory::eCategory_Image, GetNumPixels());
     ReadPixels(pixels);
   } else {
     m_Pixels = NULL;
@@ -129,24 +135,24 @@ Image<PixelType>::Image(uint32 width, uint32 height, const uint32 *pixels)
 
 template<typename PixelType>
 Image<PixelType>::~Image() {
-  if(m_Pixels) {
-    delete [] m_Pixels;
-    m_Pixels = 0;
-  }
+  TCMemory::DeleteArray(TCMemory::eCategory_Image, m_Pixels, GetNumPixels());
+  m_Pixels = 0;
 }
 
 template<typename PixelType>
 Image<PixelType> &Image<PixelType>::operator=(const Image &other) {
-  
+  if(this == &other) {
+    return *this;
+  }
+
+  // Free the pixels while we still know how many there are.
+  TCMemory::DeleteArray(TCMemory::eCategory_Image, m_Pixels, GetNumPixels());
+
   m_Width = other.m_Width;
   m_Height = other.m_Height;
   
-  if(m_Pixels) {
-    delete [] m_Pixels;
-  }
-  
   if(other.m_Pixels) {
-    m_Pixels = new PixelType[GetNumPixels()];
+    m_Pixels = TCMemory::NewArray<PixelType>(TCMemory::eCategory_Image, GetNumPixels());
     if(m_Pixels)
       memcpy(m_Pixels, other.m_Pixels, GetNumPixels() * sizeof(PixelType));
     else
@@ -202,129 +208,18 @@ Image<PixelType> Image<PixelType>::Diff(Image<PixelType> *other, float mult) {
   return result;
 }
 
-template<typename PixelType>
-double Image<PixelType>::ComputePSNR(Image<PixelType> *other) {
-  if(!other)
-    return -1.0;
+static const uint32 kSSIMFilterSz = 11;
+static const double kSSIMFilterSigma = 1.5;
 
-  if(GetWidth() != other->GetWidth() ||
-     GetHeight() != other->GetHeight()) {
-    return -1.0;
-  }
-
-  // Compute raw 8-bit RGBA data...
-  ComputePixels();
-  other->ComputePixels();
-
-  const PixelType *ourPixels = GetPixels();
-  const PixelType *otherPixels = other->GetPixels();
-
-  //  const double w[3] = { 0.2126, 0.7152, 0.0722 };
-  const double w[3] = { 1.0, 1.0, 1.0 };
-    
-  double mse = 0.0;
-  const uint32 imageSz = GetNumPixels();
-  for(uint32 i = 0; i < imageSz; i++) {
+// Computes the mean SSIM between two intensity images whose values are
+// in the range [0, 255].
+static double ComputeMeanSSIM(const FloatImage &img1,
+                              const FloatImage &img2) {
+  assert(img1.GetWidth() == img2.GetWidth());
+  assert(img1.GetHeight() == img2.GetHeight());
 
-    uint32 ourPixel = ourPixels[i].Pack();
-    uint32 otherPixel = otherPixels[i].Pack();
-
-    double r[4], u[4];
-    for(uint32 c = 0; c < 4; c++) {
-      uint32 shift = c * 8;
-      if(c == 3) {
-        r[c] = static_cast<double>((ourPixel >> shift) & 0xFF) / 255.0;
-        u[c] = static_cast<double>((otherPixel >> shift) & 0xFF) / 255.0;
-      } else {
-        r[c] = static_cast<double>((ourPixel >> shift) & 0xFF) * w[c];
-        u[c] = static_cast<double>((otherPixel >> shift) & 0xFF) * w[c];
-      }
-    }
-
-    for(uint32 c = 0; c < 3; c++) {
-      double diff = (r[3] * r[c] - u[3] * u[c]);
-      mse += diff * diff;
-    }
-  }
-
-  mse /= GetWidth() * GetHeight();
-
-  const double C = 255.0 * 255.0;
-  double maxi = (w[0]*w[0] + w[1]*w[1] + w[2]*w[2]) * C;
-  return 10 * log10(maxi/mse);
-}
-
-static Image<IPixel> FilterValid(const Image<IPixel> &img, uint32 size, double sigma) {
-  assert(size % 2);
-  Image<IPixel> gaussian(size, size);
-  GenerateGaussianKernel(gaussian, size, static_cast<float>(sigma));
-
-  double sum = 0.0;
-  for(uint32 j = 0; j < size; j++) {
-    for(uint32 i = 0; i < size; i++) {
-      sum += static_cast<float>(gaussian(i, j));
-    }
-  }
-
-  for(uint32 j = 0; j < size; j++) {
-    for(uint32 i = 0; i < size; i++) {
-      double v = static_cast<float>(gaussian(i, j));
-      gaussian(i, j) = static_cast<float>(v / sum);
-    }
-  }      
-
-  int32 h = static_cast<int32>(img.GetHeight());
-  int32 w = static_cast<int32>(img.GetWidth());
-
-  Image<IPixel> out(img.GetWidth() - size + 1, img.GetHeight() - size + 1);
-  int32 halfSz = static_cast<int32>(size) >> 1;
-  for(int32 j = halfSz; j < h-halfSz; j++) {
-    for(int32 i = halfSz; i < w-halfSz; i++) {
-      int32 xoffset = -halfSz;
-      int32 yoffset = -halfSz;
-
-      double result = 0;
-      for(int32 y = 0; y < static_cast<int32>(size); y++)
-      for(int32 x = 0; x < static_cast<int32>(size); x++) {
-        double s = static_cast<float>(gaussian(x, y));
-        result += s * static_cast<float>(img(i+xoffset+x, j+yoffset+y));
-      }
-      out(i+xoffset, j+yoffset) = static_cast<float>(result);
-    }
-  }
-
-  return out;
-}
-
-template<typename PixelType>
-double Image<PixelType>::ComputeSSIM(Image<PixelType> *other) {
-  if(!other) {
-    return -1.0;
-  }
-
-  if(GetWidth() != other->GetWidth() ||
-     GetHeight() != other->GetHeight()) {
-    return -1.0;
-  }
-
-  ComputePixels();
-  other->ComputePixels();
-
-  double C1 = (0.01 * 255.0 * 0.01 * 255.0);
-  double C2 = (0.03 * 255.0 * 0.03 * 255.0);
-
-  Image<IPixel> img1(GetWidth(), GetHeight());
-  Image<IPixel> img2(GetWidth(), GetHeight());
-
-  ConvertTo(img1);
-  other->ConvertTo(img2);
-
-  for(uint32 j = 0; j < GetHeight(); j++) {
-    for(uint32 i = 0; i < GetWidth(); i++) {
-      img1(i, j) = 255.0f * static_cast<float>(img1(i, j));
-      img2(i, j) = 255.0f * static_cast<float>(img2(i, j));
-    }
-  }
+  const double C1 = (0.01 * 255.0 * 0.01 * 255.0);
+  const double C2 = (0.03 * 255.0 * 0.03 * 255.0);
 
   /* Matlab code taken from 
      http://www.cns.nyu.edu/lcv/ssim/ssim_index.m
@@ -348,103 +243,189 @@ double Image<PixelType>::ComputeSSIM(Image<PixelType> *other) {
                 ((mu1_sq + mu2_sq + C1).*(sigma1_sq + sigma2_sq + C2));
   */
 
-  const uint32 filterSz = 11;
-  const double filterSigma = 1.5;
-
-  if(img1.GetWidth() < filterSz || img1.GetHeight() < filterSz ||
-     img2.GetWidth() < filterSz || img2.GetHeight() < filterSz) {
+  const uint32 filterSz = kSSIMFilterSz;
+  if(img1.GetWidth() < filterSz || img1.GetHeight() < filterSz) {
     return -1.0;
   }
 
-  Image<IPixel> mu1 = FilterValid(img1, filterSz, filterSigma);
-  Image<IPixel> mu2 = FilterValid(img2, filterSz, filterSigma);
-
-  assert(mu1.GetHeight() == mu2.GetHeight());
-  assert(mu1.GetWidth() == mu2.GetWidth());
+  // The Gaussian window is separable, so filter with its one dimensional
+  // factor along the rows and then along the columns.
+  float window[kSSIMFilterSz];
+  GenerateGaussianKernel1D(window, filterSz, static_cast<float>(kSSIMFilterSigma));
 
-  Image<IPixel> mu1_sq(mu1);
-  Image<IPixel> mu2_sq(mu2);
-  Image<IPixel> mu1_mu2(mu1);
-  Image<IPixel> sigma1_sq(img1);
-  Image<IPixel> sigma2_sq(img2);
-  Image<IPixel> sigma12(img1);
+  uint32 w = img1.GetWidth();
+  uint32 h = img1.GetHeight();
 
-  uint32 w = ::std::max(img1.GetWidth(), mu1.GetWidth());
-  uint32 h = ::std::max(img1.GetHeight(), mu1.GetHeight());
+  FloatImage img1_sq(w, h);
+  FloatImage img2_sq(w, h);
+  FloatImage img1_img2(w, h);
   for(uint32 j = 0; j < h; j++) {
+    const float *i1 = img1.GetRow(j);
+    const float *i2 = img2.GetRow(j);
+    float *i1sq = img1_sq.GetRow(j);
+    float *i2sq = img2_sq.GetRow(j);
+    float *i1i2 = img1_img2.GetRow(j);
     for(uint32 i = 0; i < w; i++) {
-      if(i < mu1.GetWidth() && j < mu1.GetHeight()) {
-        double m1 = static_cast<float>(mu1(i, j));
-        double m2 = static_cast<float>(mu2(i, j));
+      i1sq[i] = i1[i] * i1[i];
+      i2sq[i] = i2[i] * i2[i];
+      i1i2[i] = i1[i] * i2[i];
+    }
+  }
 
-        mu1_sq(i, j) = static_cast<float>(m1 * m1);
-        mu2_sq(i, j) = static_cast<float>(m2 * m2);
-        mu1_mu2(i, j) = static_cast<float>(m1 * m2);
-      }
+  FloatImage mu1, mu2, sigma1_sq, sigma2_sq, sigma12;
+  FilterSeparableValid(img1, window, filterSz, window, filterSz, &mu1);
+  FilterSeparableValid(img2, window, filterSz, window, filterSz, &mu2);
+  FilterSeparableValid(img1_sq, window, filterSz, window, filterSz, &sigma1_sq);
+  FilterSeparableValid(img2_sq, window, filterSz, window, filterSz, &sigma2_sq);
+  FilterSeparableValid(img1_img2, window, filterSz, window, filterSz, &sigma12);
 
-      if(i < img1.GetWidth() && j < img1.GetHeight()) {
-        double i1 = static_cast<float>(img1(i, j));
-        double i2 = static_cast<float>(img2(i, j));
+  w = mu1.GetWidth();
+  h = mu1.GetHeight();
 
-        sigma1_sq(i, j) = static_cast<float>(i1 * i1);
-        sigma2_sq(i, j) = static_cast<float>(i2 * i2);
-        sigma12(i, j) = static_cast<float>(i1 * i2);
-      }
+  double mssim = 0.0;
+  for(uint32 j = 0; j < h; j++) {
+    const float *m1 = mu1.GetRow(j);
+    const float *m2 = mu2.GetRow(j);
+    const float *s1sq = sigma1_sq.GetRow(j);
+    const float *s2sq = sigma2_sq.GetRow(j);
+    const float *s12 = sigma12.GetRow(j);
+
+    double rowSum = 0.0;
+    for(uint32 i = 0; i < w; i++) {
+      double m1sq = static_cast<double>(m1[i]) * m1[i];
+      double m2sq = static_cast<double>(m2[i]) * m2[i];
+      double m1m2 = static_cast<double>(m1[i]) * m2[i];
+
+      double s1 = s1sq[i] - m1sq;
+      double s2 = s2sq[i] - m2sq;
+      double s1s2 = s12[i] - m1m2;
+
+      rowSum +=
+        ((2.0 * m1m2 + C1) * (2.0 * s1s2 + C2)) /
+        ((m1sq + m2sq + C1) * (s1 + s2 + C2));
     }
+    mssim += rowSum;
   }
 
-  sigma1_sq = FilterValid(sigma1_sq, filterSz, filterSigma);
-  sigma2_sq = FilterValid(sigma2_sq, filterSz, filterSigma);
-  sigma12 = FilterValid(sigma12, filterSz, filterSigma);
+  return mssim / (static_cast<double>(w) * static_cast<double>(h));
+}
 
-  assert(sigma1_sq.GetWidth() == mu1.GetWidth());
-  assert(sigma1_sq.GetHeight() == mu1.GetHeight());
+template<typename PixelType>
+double Image<PixelType>::ComputePSNR(Image<PixelType> *other) {
+  ImageMetrics metrics;
+  if(!ComputeMetrics(other, &metrics, false)) {
+    return -1.0;
+  }
 
-  assert(sigma2_sq.GetWidth() == mu1.GetWidth());
-  assert(sigma2_sq.GetHeight() == mu1.GetHeight());
+  return metrics.m_PSNR;
+}
 
-  assert(sigma12.GetWidth() == mu1.GetWidth());
-  assert(sigma12.GetHeight() == mu1.GetHeight());
+template<typename PixelType>
+double Image<PixelType>::ComputeSSIM(Image<PixelType> *other) {
+  ImageMetrics metrics;
+  if(!ComputeMetrics(other, &metrics, true)) {
+    return -1.0;
+  }
 
-  w = mu1_sq.GetWidth();
-  h = mu2_sq.GetHeight();
+  return metrics.m_SSIM;
+}
 
-  for(uint32 j = 0; j < h; j++) {
-    for(uint32 i = 0; i < w; i++) {
-      double m1sq = static_cast<float>(mu1_sq(i, j));
-      double m2sq = static_cast<float>(mu2_sq(i, j));
-      double m1m2 = static_cast<float>(mu1_mu2(i, j));
+template<typename PixelType>
+bool Image<PixelType>::ComputeMetrics(Image<PixelType> *other,
+                                      ImageMetrics *out,
+                                      bool bComputeSSIM) {
+  FASTC_TRACE_ZONE("Compute Metrics");
 
-      double s1sq = static_cast<float>(sigma1_sq(i, j));
-      double s2sq = static_cast<float>(sigma2_sq(i, j));
-      double s1s2 = static_cast<float>(sigma12(i, j));
+  if(!other || !out) {
+    return false;
+  }
 
-      sigma1_sq(i, j) = static_cast<float>(s1sq - m1sq);
-      sigma2_sq(i, j) = static_cast<float>(s2sq - m2sq);
-      sigma12(i, j) = static_cast<float>(s1s2 - m1m2);
-    }
+  if(GetWidth() != other->GetWidth() ||
+     GetHeight() != other->GetHeight()) {
+    return false;
   }
 
-  double mssim = 0.0;
+  // Compute raw 8-bit RGBA data. For images that hold onto their decoded
+  // pixels this is a no-op after the first time.
+  ComputePixels();
+  other->ComputePixels();
+
+  const PixelType *ourPixels = GetPixels();
+  const PixelType *otherPixels = other->GetPixels();
+  if(!ourPixels || !otherPixels) {
+    return false;
+  }
+
+  const uint32 w = GetWidth();
+  const uint32 h = GetHeight();
+
+  // We only need the intensity images if we're going to compute SSIM.
+  const bool bSSIM = bComputeSSIM && w >= kSSIMFilterSz && h >= kSSIMFilterSz;
+  FloatImage intensity1(bSSIM? w : 0, bSSIM? h : 0);
+  FloatImage intensity2(bSSIM? w : 0, bSSIM? h : 0);
+
+  //  const double w[3] = { 0.2126, 0.7152, 0.0722 };
+  const double wt[3] = { 1.0, 1.0, 1.0 };
+
+  double mse = 0.0;
+  double channelSE[4] = { 0.0, 0.0, 0.0, 0.0 };
+  uint32 channelMax[4] = { 0, 0, 0, 0 };
+
   for(uint32 j = 0; j < h; j++) {
     for(uint32 i = 0; i < w; i++) {
-      double m1sq = static_cast<float>(mu1_sq(i, j));
-      double m2sq = static_cast<float>(mu2_sq(i, j));
-      double m1m2 = static_cast<float>(mu1_mu2(i, j));
-
-      double s1sq = static_cast<float>(sigma1_sq(i, j));
-      double s2sq = static_cast<float>(sigma2_sq(i, j));
-      double s1s2 = static_cast<float>(sigma12(i, j));
+      const uint32 idx = j * w + i;
+      uint32 ourPixel = ourPixels[idx].Pack();
+      uint32 otherPixel = otherPixels[idx].Pack();
+
+      double r[4], u[4];
+      for(uint32 c = 0; c < 4; c++) {
+        uint32 shift = c * 8;
+        uint32 rc = (ourPixel >> shift) & 0xFF;
+        uint32 uc = (otherPixel >> shift) & 0xFF;
+
+        uint32 err = sad(rc, uc);
+        channelSE[c] += static_cast<double>(err * err);
+        channelMax[c] = ::std::max(channelMax[c], err);
+
+        if(c == 3) {
+          r[c] = static_cast<double>(rc) / 255.0;
+          u[c] = static_cast<double>(uc) / 255.0;
+        } else {
+          r[c] = static_cast<double>(rc) * wt[c];
+          u[c] = static_cast<double>(uc) * wt[c];
+        }
+      }
 
-      double ssim =
-        ((2.0 * m1m2 + C1) * (2.0 * s1s2 + C2)) /
-        ((m1sq + m2sq + C1) * (s1sq + s2sq + C2));
+      for(uint32 c = 0; c < 3; c++) {
+        double diff = (r[3] * r[c] - u[3] * u[c]);
+        mse += diff * diff;
+      }
 
-      mssim += ssim;
+      if(bSSIM) {
+        IPixel p1, p2;
+        p1.Unpack(ourPixel);
+        p2.Unpack(otherPixel);
+        intensity1(i, j) = 255.0f * static_cast<float>(p1);
+        intensity2(i, j) = 255.0f * static_cast<float>(p2);
+      }
     }
   }
 
-  return mssim / static_cast<double>(w * h);
+  const double numPixels = static_cast<double>(w) * static_cast<double>(h);
+  mse /= numPixels;
+
+  const double C = 255.0 * 255.0;
+  double maxi = (wt[0]*wt[0] + wt[1]*wt[1] + wt[2]*wt[2]) * C;
+  out->m_PSNR = 10 * log10(maxi/mse);
+
+  // The channels are stored as R, G, B, A in the packed pixel.
+  for(uint32 c = 0; c < 4; c++) {
+    out->m_ChannelMSE[c] = channelSE[c] / numPixels;
+    out->m_ChannelMaxError[c] = channelMax[c];
+  }
+
+  out->m_SSIM = bSSIM? ComputeMeanSSIM(intensity1, intensity2) : -1.0;
+  return true;
 }
 
 template<typename PixelType>
@@ -505,9 +486,7 @@ double Image<PixelType>::ComputeEntropy() {
 
 template<typename PixelType>
 void Image<PixelType>::SetImageData(uint32 width, uint32 height, PixelType *data) {
-  if(m_Pixels) {
-    delete [] m_Pixels;
-  }
+  TCMemory::DeleteArray(TCMemory::eCategory_Image, m_Pixels, GetNumPixels());
 
   if(!data) {
     width = 0;
@@ -520,6 +499,53 @@ void Image<PixelType>::SetImageData(uint32 width, uint32 height, PixelType *data
   }
 }
 
+// If kernel is the outer product of a row and a column vector, stores them in
+// kernelX and kernelY and returns true.
+static bool SeparateKernel(const Image<IPixel> &kernel,
+                           float *kernelX, float *kernelY) {
+  const uint32 kw = kernel.GetWidth();
+  const uint32 kh = kernel.GetHeight();
+
+  // Pivot around the largest entry so that we never divide by something tiny.
+  uint32 px = 0, py = 0;
+  float maxVal = 0.0f;
+  for(uint32 j = 0; j < kh; j++) {
+    for(uint32 i = 0; i < kw; i++) {
+      float v = fabs(static_cast<float>(kernel(i, j)));
+      if(v > maxVal) {
+        maxVal = v;
+        px = i;
+        py = j;
+      }
+    }
+  }
+
+  if(maxVal == 0.0f) {
+    return false;
+  }
+
+  const float pivot = static_cast<float>(kernel(px, py));
+  for(uint32 i = 0; i < kw; i++) {
+    kernelX[i] = static_cast<float>(kernel(i, py));
+  }
+
+  for(uint32 j = 0; j < kh; j++) {
+    kernelY[j] = static_cast<float>(kernel(px, j)) / pivot;
+  }
+
+  const float tolerance = 1e-5f * maxVal;
+  for(uint32 j = 0; j < kh; j++) {
+    for(uint32 i = 0; i < kw; i++) {
+      float v = static_cast<float>(kernel(i, j));
+      if(fabs(v - kernelX[i] * kernelY[j]) > tolerance) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
 template<typename PixelType>
 void Image<PixelType>::Filter(const Image<IPixel> &kernel) {
   Image<IPixel> k(kernel);
@@ -549,6 +575,49 @@ void Image<PixelType>::Filter(const Image<IPixel> &kernel) {
 
   Image<PixelType> filtered(iw, ih);
 
+  // Most kernels that we use (e.g. Gaussians) are separable, in which case
+  // we can filter each channel along rows and columns independently.
+  float *kernelX = new float[kw];
+  float *kernelY = new float[kh];
+  if(SeparateKernel(k, kernelX, kernelY)) {
+    FloatImage channels[4];
+    for(uint32 c = 0; c < 4; c++) {
+      channels[c] = FloatImage(iw, ih);
+    }
+
+    for(int32 j = 0; j < ih; j++) {
+      for(int32 i = 0; i < iw; i++) {
+        Color p; p.Unpack((*this)(i, j).Pack());
+        for(uint32 c = 0; c < 4; c++) {
+          channels[c](i, j) = p.Component(c);
+        }
+      }
+    }
+
+    for(uint32 c = 0; c < 4; c++) {
+      FilterSeparableClamped(channels[c], kernelX, kw, kernelY, kh, &(channels[c]));
+    }
+
+    for(int32 j = 0; j < ih; j++) {
+      for(int32 i = 0; i < iw; i++) {
+        Color newPixel;
+        for(uint32 c = 0; c < 4; c++) {
+          newPixel.Component(c) = channels[c](i, j);
+        }
+        filtered(i, j).Unpack(newPixel.Pack());
+      }
+    }
+
+    delete [] kernelX;
+    delete [] kernelY;
+
+    *this = filtered;
+    return;
+  }
+
+  delete [] kernelX;
+  delete [] kernelY;
+
   for(int32 j = 0; j < ih; j++) {
     for(int32 i = 0; i < iw; i++) {
       int32 yoffset = j - (k.GetHeight() / 2);
@@ -649,130 +718,40 @@ void SplitChannels<Pixel>(const Image<Pixel> &in,
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-typedef void (*DCTBlockFn)(Image<IPixel> *);
-  
-static void DCT(Image<IPixel> *img) {
-  Image<IPixel> new_img = *img;
-
-  float N = static_cast<float>(img->GetWidth());
-  float M = static_cast<float>(img->GetHeight());
-
-  for (unsigned int v = 0; v < img->GetHeight(); ++v) {
-    for (unsigned int u = 0; u < img->GetWidth(); ++u) {
-      new_img(u, v) = 0.0f;
-      float fu = static_cast<float>(u);
-      float fv = static_cast<float>(v);
-      for (unsigned int y = 0; y < img->GetHeight(); ++y) {
-        for (unsigned int x = 0; x < img->GetWidth(); ++x) {
-          float fx = static_cast<float>(x);
-          float fy = static_cast<float>(y);
-          new_img(u, v) += (*img)(x, y)
-            * cos(((2*fx + 1) * fu * M_PI) / (2 * N))
-            * cos(((2*fy + 1) * fv * M_PI) / (2 * M));
-        }
-      }
-      
-      if (u == 0 && v == 0) {
-        new_img(u, v) /= N;
-      } else if (u == 0 || v == 0) {
-        new_img(u, v) *= sqrt(2) / N;
-      } else {
-        new_img(u, v) *= 2 / N;
-      }
-    }
-  }
-
-  *img = new_img;
-}
-
-static void IDCT(Image<IPixel> *img) {
-  Image<IPixel> new_img = *img;
-
-  float N = static_cast<float>(img->GetWidth());
-  float M = static_cast<float>(img->GetHeight());
-
-  assert (N == M);
-
-  for (unsigned int y = 0; y < img->GetHeight(); ++y) {
-    for (unsigned int x = 0; x < img->GetWidth(); ++x) {
-      new_img(x, y) = 0.0f;
-      float fx = static_cast<float>(x);
-      float fy = static_cast<float>(y);          
-
-      for (unsigned int v = 0; v < img->GetHeight(); ++v) {
-        for (unsigned int u = 0; u < img->GetWidth(); ++u) {
-          float fu = static_cast<float>(u);
-          float fv = static_cast<float>(v);
-
-          float idct = (*img)(u, v)
-            * cos(((2*fx + 1) * fu * M_PI) / (2 * N))
-            * cos(((2*fy + 1) * fv * M_PI) / (2 * M));
-
-          if (u == 0 && v == 0) {
-            idct /= N;
-          } else if (u == 0 || v == 0) {
-            idct *= sqrtf(2) / N;
-          } else {
-            idct *= 2 / N;
-          }
-
-          new_img(x, y) += FasTC::IPixel(idct);
-        }
-      }
+// The transforms themselves work on float planes (see FloatImage.h), so
+// copy the intensities into one and back.
+static void ToFloatImage(const Image<IPixel> &img, FloatImage *out) {
+  FloatImage result(img.GetWidth(), img.GetHeight());
+  for(uint32 j = 0; j < img.GetHeight(); j++) {
+    float *row = result.GetRow(j);
+    for(uint32 i = 0; i < img.GetWidth(); i++) {
+      row[i] = static_cast<float>(img(i, j));
     }
   }
-
-  *img = new_img;
+  out->Swap(result);
 }
 
-static void RunDCTBlockFn(Image<IPixel> *img, uint32 blockSize, DCTBlockFn fn) {
-  assert (NULL != fn);
-  assert (0 < blockSize);
-  assert (blockSize < img->GetWidth());
-  assert (blockSize < img->GetHeight());
-  
-  Image<IPixel> block(blockSize, blockSize);
-  for (uint32 j = 0; j < img->GetHeight(); j += blockSize) {
-    for (uint32 i = 0; i < img->GetWidth(); i += blockSize) {
-      // Populate block
-      for (uint32 y = 0; y < blockSize; ++y) {
-        for (uint32 x = 0; x < blockSize; ++x) {
-          uint32 xx = std::min(img->GetWidth() - 1, i + x);
-          uint32 yy = std::min(img->GetHeight() - 1, j + y);
-          block(x, y) = (*img)(xx, yy);
-        }
-      }
-
-      // Run the function
-      fn(&block);
-
-      // Put it back in the original image
-      for (uint32 y = 0; y < blockSize; ++y) {
-        for (uint32 x = 0; x < blockSize; ++x) {
-          if (i + x >= img->GetWidth()) {
-            continue;
-          }
-
-          if (j + y >= img->GetHeight()) {
-            continue;
-          }
-
-          assert (i + x <= img->GetWidth());
-          assert (j + y <= img->GetHeight());
-
-          (*img)(i + x, j + y) = block(x, y);
-        }
-      }
+static void FromFloatImage(const FloatImage &img, Image<IPixel> *out) {
+  for(uint32 j = 0; j < img.GetHeight(); j++) {
+    const float *row = img.GetRow(j);
+    for(uint32 i = 0; i < img.GetWidth(); i++) {
+      (*out)(i, j) = row[i];
     }
   }
 }
 
 void DiscreteCosineXForm(Image<IPixel> *img, uint32 blockSize) {
-  RunDCTBlockFn(img, blockSize, DCT);
+  FloatImage plane;
+  ToFloatImage(*img, &plane);
+  DiscreteCosineXForm(&plane, blockSize);
+  FromFloatImage(plane, img);
 }
 
 void InvDiscreteCosineXForm(Image<IPixel> *img, uint32 blockSize) {
-  RunDCTBlockFn(img, blockSize, IDCT);
+  FloatImage plane;
+  ToFloatImage(*img, &plane);
+  InvDiscreteCosineXForm(&plane, blockSize);
+  FromFloatImage(plane, img);
 }
 
 }  // namespace FasTC
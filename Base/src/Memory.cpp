@@ -0,0 +1,285 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/Memory.h"
+
+#include <cassert>
+
+#ifdef _MSC_VER
+#  define WIN32_LEAN_AND_MEAN
+#  include <Windows.h>
+#  include <Psapi.h>
+#  pragma comment(lib, "psapi.lib")
+#  define FASTC_THREAD_LOCAL __declspec(thread)
+#else
+#  include <sys/resource.h>
+#  define FASTC_THREAD_LOCAL __thread
+#endif
+
+namespace {
+
+// The counters are only ever touched with atomic operations, so that they
+// work from any thread without a lock and even before static constructors
+// have run.
+typedef volatile uint64 Counter;
+
+Counter gNumAllocations[TCMemory::kNumCategories];
+Counter gBytesAllocated[TCMemory::kNumCategories];
+Counter gLiveBytes[TCMemory::kNumCategories];
+Counter gTotalLiveBytes;
+Counter gPeakLiveBytes;
+
+uint64 AtomicAdd(Counter *x, uint64 v) {
+#ifdef _MSC_VER
+  return static_cast<uint64>(InterlockedExchangeAdd64(
+    reinterpret_cast<volatile LONG64 *>(x), static_cast<LONG64>(v))) + v;
+#else
+  return __sync_add_and_fetch(x, v);
+#endif
+}
+
+uint64 AtomicSub(Counter *x, uint64 v) {
+  return AtomicAdd(x, ~v + 1);
+}
+
+uint64 AtomicRead(Counter *x) {
+  return AtomicAdd(x, 0);
+}
+
+// Sets x to v if it's larger than x.
+void AtomicMax(Counter *x, uint64 v) {
+  uint64 cur = AtomicRead(x);
+  while(v > cur) {
+#ifdef _MSC_VER
+    const uint64 prev = static_cast<uint64>(InterlockedCompareExchange64(
+      reinterpret_cast<volatile LONG64 *>(x),
+      static_cast<LONG64>(v), static_cast<LONG64>(cur)));
+#else
+    const uint64 prev = __sync_val_compare_and_swap(x, cur, v);
+#endif
+    if(prev == cur) {
+      break;
+    }
+    cur = prev;
+  }
+}
+
+// Subtracts v from x, stopping at zero. Returns how much was subtracted.
+uint64 AtomicSubClamped(Counter *x, uint64 v) {
+  uint64 cur = AtomicRead(x);
+  for(;;) {
+    const uint64 next = (cur > v)? cur - v : 0;
+#ifdef _MSC_VER
+    const uint64 prev = static_cast<uint64>(InterlockedCompareExchange64(
+      reinterpret_cast<volatile LONG64 *>(x),
+      static_cast<LONG64>(next), static_cast<LONG64>(cur)));
+#else
+    const uint64 prev = __sync_val_compare_and_swap(x, cur, next);
+#endif
+    if(prev == cur) {
+      return cur - next;
+    }
+    cur = prev;
+  }
+}
+
+void AtomicWrite(Counter *x, uint64 v) {
+  uint64 cur = AtomicRead(x);
+  for(;;) {
+#ifdef _MSC_VER
+    const uint64 prev = static_cast<uint64>(InterlockedCompareExchange64(
+      reinterpret_cast<volatile LONG64 *>(x),
+      static_cast<LONG64>(v), static_cast<LONG64>(cur)));
+#else
+    const uint64 prev = __sync_val_compare_and_swap(x, cur, v);
+#endif
+    if(prev == cur) {
+      break;
+    }
+    cur = prev;
+  }
+}
+
+}  // namespace
+
+struct TCMemoryScopeState {
+  Counter m_NumAllocations[TCMemory::kNumCategories];
+  Counter m_BytesAllocated[TCMemory::kNumCategories];
+  Counter m_LiveBytes[TCMemory::kNumCategories];
+  Counter m_TotalLiveBytes;
+  Counter m_PeakLiveBytes;
+
+  // Held by the Scope and by every ThreadScope that refers to it, and by
+  // the scopes nested inside of it.
+  Counter m_NumReferences;
+  TCMemoryScopeState *m_Parent;
+};
+
+namespace {
+
+// The innermost scope of each thread. Threads that aren't inside of a scope
+// only add to the counters of the process.
+FASTC_THREAD_LOCAL TCMemoryScopeState *gCurrentScope = NULL;
+
+void AddReference(TCMemoryScopeState *state) {
+  if(state) {
+    AtomicAdd(&state->m_NumReferences, 1);
+  }
+}
+
+void ReleaseReference(TCMemoryScopeState *state) {
+  while(state && AtomicSub(&state->m_NumReferences, 1) == 0) {
+    TCMemoryScopeState *parent = state->m_Parent;
+    delete state;
+    state = parent;
+  }
+}
+
+}  // namespace
+
+const char *TCMemory::GetCategoryName(ECategory category) {
+  switch(category) {
+    case eCategory_Image: return "Image";
+    case eCategory_CompressedData: return "Compressed Data";
+    case eCategory_ImageLoading: return "Image Loading";
+    case eCategory_ImageWriting: return "Image Writing";
+    case eCategory_Compressor: return "Compressor";
+    default: return "Unknown";
+  }
+}
+
+void TCMemory::RecordAllocation(ECategory category, uint64 bytes) {
+  assert(category < kNumCategories);
+  AtomicAdd(gNumAllocations + category, 1);
+  AtomicAdd(gBytesAllocated + category, bytes);
+  AtomicAdd(gLiveBytes + category, bytes);
+  AtomicMax(&gPeakLiveBytes, AtomicAdd(&gTotalLiveBytes, bytes));
+
+  for(TCMemoryScopeState *s = gCurrentScope; s; s = s->m_Parent) {
+    AtomicAdd(s->m_NumAllocations + category, 1);
+    AtomicAdd(s->m_BytesAllocated + category, bytes);
+    AtomicAdd(s->m_LiveBytes + category, bytes);
+    AtomicMax(&s->m_PeakLiveBytes, AtomicAdd(&s->m_TotalLiveBytes, bytes));
+  }
+}
+
+void TCMemory::RecordFree(ECategory category, uint64 bytes) {
+  assert(category < kNumCategories);
+  assert(AtomicRead(gLiveBytes + category) >= bytes);
+  AtomicSub(gLiveBytes + category, bytes);
+  AtomicSub(&gTotalLiveBytes, bytes);
+
+  for(TCMemoryScopeState *s = gCurrentScope; s; s = s->m_Parent) {
+    // Only what the category actually gave back comes off the total, so
+    // freeing memory from outside the scope leaves its other bytes alone.
+    const uint64 freed = AtomicSubClamped(s->m_LiveBytes + category, bytes);
+    AtomicSubClamped(&s->m_TotalLiveBytes, freed);
+  }
+}
+
+TCMemory::Stats TCMemory::GetStats() {
+  Stats stats;
+  for(uint32 i = 0; i < kNumCategories; i++) {
+    stats.m_NumAllocations[i] = AtomicRead(gNumAllocations + i);
+    stats.m_BytesAllocated[i] = AtomicRead(gBytesAllocated + i);
+    stats.m_LiveBytes[i] = AtomicRead(gLiveBytes + i);
+  }
+  stats.m_TotalLiveBytes = AtomicRead(&gTotalLiveBytes);
+  stats.m_PeakLiveBytes = AtomicRead(&gPeakLiveBytes);
+  return stats;
+}
+
+void TCMemory::ResetStats() {
+  for(uint32 i = 0; i < kNumCategories; i++) {
+    AtomicWrite(gNumAllocations + i, 0);
+    AtomicWrite(gBytesAllocated + i, 0);
+  }
+  AtomicWrite(&gPeakLiveBytes, AtomicRead(&gTotalLiveBytes));
+}
+
+TCMemory::Scope::Scope()
+  : m_State(new TCMemoryScopeState())
+  , m_Previous(gCurrentScope)
+{
+  m_State->m_NumReferences = 1;
+  m_State->m_Parent = m_Previous;
+  AddReference(m_Previous);
+  gCurrentScope = m_State;
+}
+
+TCMemory::Scope::~Scope() {
+  assert(gCurrentScope == m_State);
+  gCurrentScope = m_Previous;
+  ReleaseReference(m_State);
+}
+
+TCMemory::Stats TCMemory::Scope::GetStats() const {
+  Stats stats;
+  for(uint32 i = 0; i < kNumCategories; i++) {
+    stats.m_NumAllocations[i] = AtomicRead(m_State->m_NumAllocations + i);
+    stats.m_BytesAllocated[i] = AtomicRead(m_State->m_BytesAllocated + i);
+    stats.m_LiveBytes[i] = AtomicRead(m_State->m_LiveBytes + i);
+  }
+  stats.m_TotalLiveBytes = AtomicRead(&m_State->m_TotalLiveBytes);
+  stats.m_PeakLiveBytes = AtomicRead(&m_State->m_PeakLiveBytes);
+  return stats;
+}
+
+TCMemory::ThreadScope::ThreadScope()
+  : m_State(gCurrentScope)
+  , m_Previous(NULL)
+{
+  AddReference(m_State);
+}
+
+TCMemory::ThreadScope::~ThreadScope() {
+  ReleaseReference(m_State);
+}
+
+void TCMemory::ThreadScope::Enter() {
+  m_Previous = gCurrentScope;
+  gCurrentScope = m_State;
+}
+
+void TCMemory::ThreadScope::Leave() {
+  assert(gCurrentScope == m_State);
+  gCurrentScope = m_Previous;
+  m_Previous = NULL;
+}
+
+uint64 TCMemory::GetPeakResidentBytes() {
+#ifdef _MSC_VER
+  PROCESS_MEMORY_COUNTERS counters;
+  if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return static_cast<uint64>(counters.PeakWorkingSetSize);
+#else
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+
+#  ifdef __APPLE__
+  // Reported in bytes on OS X...
+  return static_cast<uint64>(usage.ru_maxrss);
+#  else
+  // ... and in kilobytes everywhere else.
+  return static_cast<uint64>(usage.ru_maxrss) * 1024;
+#  endif
+#endif
+}
@@ -62,7 +62,9 @@ namespace FasTC {
       channel = 0;
       if(0 == depth) {
         channel = 0xFF;
-      } else if(depth + bitIdx < 8) {
+      } else if(depth + bitIdx <= 8) {
+        // A channel that ends on a byte boundary must not touch the next
+        // byte, which is past the end of the data for the last channel.
         bitIdx += depth;
         channel = (bits[byteIdx] >> (8 - bitIdx)) & ((1 << depth) - 1);
       } else {
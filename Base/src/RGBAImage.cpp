@@ -0,0 +1,226 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/RGBAImage.h"
+#include "FasTC/Memory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+namespace FasTC {
+
+template<typename ChannelType>
+RGBAImage<ChannelType>::RGBAImage(uint32 width, uint32 height)
+  : m_Width(0), m_Height(0), m_Data(NULL), m_Allocation(NULL)
+{
+  Allocate(width, height);
+}
+
+template<typename ChannelType>
+RGBAImage<ChannelType>::RGBAImage(uint32 width, uint32 height,
+                                  const ChannelType *data)
+  : m_Width(0), m_Height(0), m_Data(NULL), m_Allocation(NULL)
+{
+  Allocate(width, height);
+  if(data && m_Data) {
+    memcpy(m_Data, data, static_cast<size_t>(GetDataSize()));
+  }
+}
+
+template<typename ChannelType>
+RGBAImage<ChannelType>::RGBAImage(const RGBAImage<ChannelType> &other)
+  : m_Width(0), m_Height(0), m_Data(NULL), m_Allocation(NULL)
+{
+  Allocate(other.GetWidth(), other.GetHeight());
+  if(other.m_Data) {
+    memcpy(m_Data, other.m_Data, static_cast<size_t>(GetDataSize()));
+  }
+}
+
+template<typename ChannelType>
+RGBAImage<ChannelType> &
+RGBAImage<ChannelType>::operator=(const RGBAImage<ChannelType> &other) {
+  RGBAImage<ChannelType> copy(other);
+  Swap(copy);
+  return *this;
+}
+
+template<typename ChannelType>
+RGBAImage<ChannelType>::~RGBAImage() {
+  TCMemory::DeleteArray(TCMemory::eCategory_Image, m_Allocation,
+                        static_cast<size_t>(GetDataSize() + kRGBAImageAlignment - 1));
+}
+
+template<typename ChannelType>
+void RGBAImage<ChannelType>::Swap(RGBAImage<ChannelType> &other) {
+  std::swap(m_Width, other.m_Width);
+  std::swap(m_Height, other.m_Height);
+  std::swap(m_Data, other.m_Data);
+  std::swap(m_Allocation, other.m_Allocation);
+}
+
+template<typename ChannelType>
+void RGBAImage<ChannelType>::Allocate(uint32 width, uint32 height) {
+  assert(!m_Allocation);
+
+  m_Width = width;
+  m_Height = height;
+
+  const uint64 dataSz = GetDataSize();
+  if(0 == dataSz) {
+    return;
+  }
+
+  // On 32 bit platforms the largest images don't fit in the address space.
+  const uint64 maxSz = static_cast<uint64>(static_cast<size_t>(-1));
+  if(dataSz > maxSz - kRGBAImageAlignment) {
+    fprintf(stderr, "RGBAImage -- %ux%u image is too large for this platform\n",
+            width, height);
+    m_Width = m_Height = 0;
+    return;
+  }
+
+  // Over-allocate so that we can always find an aligned address inside
+  // the buffer to start the pixel data at.
+  m_Allocation = TCMemory::NewArray<uint8>(
+    TCMemory::eCategory_Image, static_cast<size_t>(dataSz + kRGBAImageAlignment - 1));
+
+  const size_t addr = reinterpret_cast<size_t>(m_Allocation);
+  const size_t mask = static_cast<size_t>(kRGBAImageAlignment - 1);
+  const size_t aligned = (addr + mask) & ~mask;
+  m_Data = reinterpret_cast<ChannelType *>(aligned);
+}
+
+template class RGBAImage<uint8>;
+template class RGBAImage<uint16>;
+
+uint16 FloatToHalf(float f) {
+  uint32 bits;
+  memcpy(&bits, &f, sizeof(bits));
+
+  const uint16 sign = static_cast<uint16>((bits >> 16) & 0x8000);
+  const int32 exp = static_cast<int32>((bits >> 23) & 0xFF);
+  uint32 mantissa = bits & 0x7FFFFF;
+
+  // NaN and infinity
+  if(0xFF == exp) {
+    return sign | 0x7C00 | (mantissa? 0x200 : 0);
+  }
+
+  const int32 halfExp = exp - 127 + 15;
+
+  // Overflow goes to infinity
+  if(halfExp >= 0x1F) {
+    return sign | 0x7C00;
+  }
+
+  // Results that are denormal in half precision, or that flush to zero.
+  if(halfExp <= 0) {
+    if(halfExp < -10) {
+      return sign;
+    }
+
+    mantissa |= 0x800000;
+    const uint32 shift = static_cast<uint32>(14 - halfExp);
+    uint32 half = mantissa >> shift;
+
+    // Round to nearest even
+    const uint32 rem = mantissa & ((1U << shift) - 1);
+    const uint32 halfway = 1U << (shift - 1);
+    if(rem > halfway || (rem == halfway && (half & 1))) {
+      half++;
+    }
+    return sign | static_cast<uint16>(half);
+  }
+
+  uint32 half = (static_cast<uint32>(halfExp) << 10) | (mantissa >> 13);
+
+  // Round to nearest even. A carry out of the mantissa correctly bumps the
+  // exponent, and rounds up to infinity if necessary.
+  const uint32 rem = mantissa & 0x1FFF;
+  if(rem > 0x1000 || (rem == 0x1000 && (half & 1))) {
+    half++;
+  }
+  return sign | static_cast<uint16>(half);
+}
+
+float HalfToFloat(uint16 h) {
+  const uint32 sign = static_cast<uint32>(h & 0x8000) << 16;
+  uint32 exp = (h >> 10) & 0x1F;
+  uint32 mantissa = h & 0x3FF;
+
+  uint32 bits;
+  if(0x1F == exp) {
+    bits = sign | 0x7F800000 | (mantissa << 13);
+  } else if(0 == exp) {
+    if(0 == mantissa) {
+      bits = sign;
+    } else {
+      // Renormalize the denormal
+      exp = 127 - 15 + 1;
+      while(0 == (mantissa & 0x400)) {
+        mantissa <<= 1;
+        exp--;
+      }
+      mantissa &= 0x3FF;
+      bits = sign | (exp << 23) | (mantissa << 13);
+    }
+  } else {
+    bits = sign | ((exp + 127 - 15) << 23) | (mantissa << 13);
+  }
+
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+void ConvertToRGBA8(const RGBA16FImage &in, RGBA8Image *out) {
+  RGBA8Image result(in.GetWidth(), in.GetHeight());
+
+  const uint64 nValues = in.GetNumPixels() * RGBA16FImage::kNumChannels;
+  const uint16 *src = in.GetData();
+  uint8 *dst = result.GetData();
+  for(uint64 i = 0; i < nValues; i++) {
+    const float v = std::max(0.0f, std::min(1.0f, HalfToFloat(src[i])));
+    dst[i] = static_cast<uint8>(v * 255.0f + 0.5f);
+  }
+
+  out->Swap(result);
+}
+
+void ConvertToRGBA16F(const RGBA8Image &in, RGBA16FImage *out) {
+  // There are only 256 possible inputs, so convert each one once.
+  uint16 table[256];
+  for(uint32 i = 0; i < 256; i++) {
+    table[i] = FloatToHalf(static_cast<float>(i) / 255.0f);
+  }
+
+  RGBA16FImage result(in.GetWidth(), in.GetHeight());
+
+  const uint64 nValues = in.GetNumPixels() * RGBA8Image::kNumChannels;
+  const uint8 *src = in.GetData();
+  uint16 *dst = result.GetData();
+  for(uint64 i = 0; i < nValues; i++) {
+    dst[i] = table[src[i]];
+  }
+
+  out->Swap(result);
+}
+
+}  // namespace FasTC
@@ -15,9 +15,11 @@
 // Please send all BUG REPORTS to <pavel@cs.unc.edu>.
 // <http://gamma.cs.unc.edu/FasTC/>
 
-#include "Thread.h"
+#include "FasTC/Thread.h"
+#include "FasTC/Trace.h"
 
 #include <assert.h>
+#include <stddef.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -136,3 +138,74 @@ TCBarrier::TCBarrier(int threads)
 void TCBarrier::Wait() {
   ((TCBarrierImpl *)m_Impl)->Wait();
 }
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Parallel loop Implementation
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class TCRangeThreadCallable : public TCCallable {
+ private:
+  TCRangeCallable *m_Body;
+  uint32 m_Begin;
+  uint32 m_End;
+
+ public:
+  TCRangeThreadCallable() : TCCallable(), m_Body(NULL), m_Begin(0), m_End(0) { }
+  virtual ~TCRangeThreadCallable() { }
+
+  void SetRange(TCRangeCallable *body, uint32 begin, uint32 end) {
+    m_Body = body;
+    m_Begin = begin;
+    m_End = end;
+  }
+
+  virtual void operator()() {
+    FASTC_TRACE_ZONE("ParallelFor Range");
+    (*m_Body)(m_Begin, m_End);
+  }
+};
+
+void TCParallelFor(uint32 count, uint32 numThreads, TCRangeCallable &body) {
+  if(0 == count) {
+    return;
+  }
+
+  if(0 == numThreads) {
+    numThreads = TCThread::NumHardwareThreads();
+  }
+
+  if(numThreads > count) {
+    numThreads = count;
+  }
+
+  if(numThreads <= 1) {
+    body(0, count);
+    return;
+  }
+
+  TCRangeThreadCallable *callables = new TCRangeThreadCallable[numThreads];
+  for(uint32 i = 0; i < numThreads; i++) {
+    uint32 begin = static_cast<uint32>((static_cast<uint64>(count) * i) / numThreads);
+    uint32 end = static_cast<uint32>((static_cast<uint64>(count) * (i + 1)) / numThreads);
+    callables[i].SetRange(&body, begin, end);
+  }
+
+  FASTC_TRACE_ZONE("ParallelFor");
+
+  TCThread **threads = new TCThread *[numThreads - 1];
+  for(uint32 i = 1; i < numThreads; i++) {
+    threads[i - 1] = new TCThread(callables[i]);
+  }
+
+  callables[0]();
+
+  for(uint32 i = 0; i < numThreads - 1; i++) {
+    threads[i]->Join();
+    delete threads[i];
+  }
+
+  delete [] threads;
+  delete [] callables;
+}
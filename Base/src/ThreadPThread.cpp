@@ -15,7 +15,8 @@
 // Please send all BUG REPORTS to <pavel@cs.unc.edu>.
 // <http://gamma.cs.unc.edu/FasTC/>
 
-#include "Thread.h"
+#include "FasTC/Thread.h"
+#include "FasTC/Memory.h"
 
 #include <assert.h>
 
@@ -25,6 +26,7 @@
 #include <pthread.h>
 #include <errno.h>
 #include <sched.h>
+#include <unistd.h>
 
 static void ReportErrorAndExit(int err, const char *msg) {
   char errMsg[1024];
@@ -46,14 +48,18 @@ private:
 
   static void *RunThread(void *arg) {
     TCThreadImpl *impl = (TCThreadImpl *)arg;
-    
+
+    // Count the memory of the thread toward the job that started it.
+    impl->m_MemoryScope.Enter();
     impl->m_Callable();
+    impl->m_MemoryScope.Leave();
 
     return NULL;
   }
 
   pthread_t m_ThreadID;
   TCCallable &m_Callable;
+  TCMemory::ThreadScope m_MemoryScope;
 
 public:
   TCThreadImpl(TCCallable &callable) :
@@ -104,6 +110,16 @@ void TCThread::Yield() {
   }
 }
 
+uint32 TCThread::NumHardwareThreads() {
+#ifdef _SC_NPROCESSORS_ONLN
+  long numProcs = sysconf(_SC_NPROCESSORS_ONLN);
+  if(numProcs > 0) {
+    return static_cast<uint32>(numProcs);
+  }
+#endif
+  return 1;
+}
+
 uint64 TCThread::ThreadID() {
 #ifdef __MINGW32__
   return static_cast<uint64>(pthread_self().x);
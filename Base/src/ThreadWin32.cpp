@@ -15,44 +15,45 @@
 // Please send all BUG REPORTS to <pavel@cs.unc.edu>.
 // <http://gamma.cs.unc.edu/FasTC/>
 
-#include "Thread.h"
+#include "FasTC/Thread.h"
+#include "FasTC/Memory.h"
 
 #include <assert.h>
 
 #define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-#include <tchar.h>
+#include <Windows.h>
+#include <tchar.h>
 #include <strsafe.h>
 
-void ErrorHandler(LPTSTR lpszFunction) 
-{ 
-  // Retrieve the system error message for the last-error code.
-  LPVOID lpMsgBuf;
-  LPVOID lpDisplayBuf;
-  DWORD dw = GetLastError(); 
-
-  FormatMessage(
-    FORMAT_MESSAGE_ALLOCATE_BUFFER | 
-    FORMAT_MESSAGE_FROM_SYSTEM |
-    FORMAT_MESSAGE_IGNORE_INSERTS,
-    NULL,
-    dw,
-    MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-    (LPTSTR) &lpMsgBuf,
-    0, NULL );
-
-  // Display the error message.
-  lpDisplayBuf = (LPVOID)LocalAlloc(LMEM_ZEROINIT, 
-  (lstrlen((LPCTSTR) lpMsgBuf) + lstrlen((LPCTSTR) lpszFunction) + 40) * sizeof(TCHAR)); 
-  StringCchPrintf((LPTSTR)lpDisplayBuf, 
-    LocalSize(lpDisplayBuf) / sizeof(TCHAR),
-    TEXT("%s failed with error %d: %s"), 
-    lpszFunction, dw, lpMsgBuf); 
-  MessageBox(NULL, (LPCTSTR) lpDisplayBuf, TEXT("Error"), MB_OK); 
-
-  // Free error-handling buffer allocations.
-  LocalFree(lpMsgBuf);
-  LocalFree(lpDisplayBuf);
+void ErrorHandler(LPTSTR lpszFunction) 
+{ 
+  // Retrieve the system error message for the last-error code.
+  LPVOID lpMsgBuf;
+  LPVOID lpDisplayBuf;
+  DWORD dw = GetLastError(); 
+
+  FormatMessage(
+    FORMAT_MESSAGE_ALLOCATE_BUFFER | 
+    FORMAT_MESSAGE_FROM_SYSTEM |
+    FORMAT_MESSAGE_IGNORE_INSERTS,
+    NULL,
+    dw,
+    MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+    (LPTSTR) &lpMsgBuf,
+    0, NULL );
+
+  // Display the error message.
+  lpDisplayBuf = (LPVOID)LocalAlloc(LMEM_ZEROINIT, 
+  (lstrlen((LPCTSTR) lpMsgBuf) + lstrlen((LPCTSTR) lpszFunction) + 40) * sizeof(TCHAR)); 
+  StringCchPrintf((LPTSTR)lpDisplayBuf, 
+    LocalSize(lpDisplayBuf) / sizeof(TCHAR),
+    TEXT("%s failed with error %d: %s"), 
+    lpszFunction, dw, lpMsgBuf); 
+  MessageBox(NULL, (LPCTSTR) lpDisplayBuf, TEXT("Error"), MB_OK); 
+
+  // Free error-handling buffer allocations.
+  LocalFree(lpMsgBuf);
+  LocalFree(lpDisplayBuf);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -65,12 +66,17 @@ class TCThreadImpl : public TCThreadBaseImpl {
 private:
   static DWORD WINAPI RunThread(LPVOID arg) {
     TCThreadImpl *impl = (TCThreadImpl *)arg;
+
+    // Count the memory of the thread toward the job that started it.
+    impl->m_MemoryScope.Enter();
     impl->m_Callable();
+    impl->m_MemoryScope.Leave();
     return 0;
   }
 
   HANDLE m_ThreadID;
   TCCallable &m_Callable;
+  TCMemory::ThreadScope m_MemoryScope;
 
 public:
   TCThreadImpl(TCCallable &callable) :
@@ -118,6 +124,15 @@ void TCThread::Yield() {
   }
 }
 
+uint32 TCThread::NumHardwareThreads() {
+  SYSTEM_INFO sysInfo;
+  GetSystemInfo(&sysInfo);
+  if(sysInfo.dwNumberOfProcessors > 0) {
+    return static_cast<uint32>(sysInfo.dwNumberOfProcessors);
+  }
+  return 1;
+}
+
 uint64 TCThread::ThreadID() {
   return static_cast<uint64>(GetCurrentThreadId());
 }
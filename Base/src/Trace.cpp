@@ -0,0 +1,275 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/Trace.h"
+#include "FasTC/Thread.h"
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#  define WIN32_LEAN_AND_MEAN
+#  include <Windows.h>
+#  define FASTC_THREAD_LOCAL __declspec(thread)
+#elif defined __APPLE__
+#  include <mach/mach_time.h>
+#  define FASTC_THREAD_LOCAL __thread
+#else
+#  include <time.h>
+#  define FASTC_THREAD_LOCAL __thread
+#endif
+
+volatile bool TCTrace::s_bRecording = false;
+
+uint64 TCTrace::Now() {
+#ifdef _MSC_VER
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return static_cast<uint64>(
+    static_cast<double>(count.QuadPart) * 1e9 / static_cast<double>(freq.QuadPart));
+#elif defined __APPLE__
+  static mach_timebase_info_data_t timebase;
+  if(timebase.denom == 0) {
+    mach_timebase_info(&timebase);
+  }
+  return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64>(ts.tv_sec) * 1000000000ULL + static_cast<uint64>(ts.tv_nsec);
+#endif
+}
+
+#ifdef FASTC_ENABLE_TRACING
+
+namespace {
+
+struct TraceEvent {
+  const char *name;
+  uint64 startNS;
+  uint64 endNS;
+};
+
+// The zones of a single thread. Only the owning thread adds to it, so it isn't
+// locked. It grows as needed up to its capacity, after which it acts as a ring
+// buffer that replaces its oldest zone.
+class TraceBuffer {
+ public:
+  explicit TraceBuffer(uint32 id) : m_ID(id), m_Capacity(1), m_Next(0), m_NumDropped(0) { }
+
+  void Reset(uint32 capacity) {
+    m_Events.clear();
+    m_Capacity = capacity > 0? capacity : 1;
+    m_Next = 0;
+    m_NumDropped = 0;
+  }
+
+  void Add(const TraceEvent &e) {
+    if(m_Events.size() < m_Capacity) {
+      m_Events.push_back(e);
+      return;
+    }
+
+    m_Events[m_Next] = e;
+    m_Next = (m_Next + 1) % m_Capacity;
+    m_NumDropped++;
+  }
+
+  uint32 GetID() const { return m_ID; }
+  const std::vector<TraceEvent> &GetEvents() const { return m_Events; }
+  uint64 GetNumDropped() const { return m_NumDropped; }
+
+  const std::string &GetName() const { return m_Name; }
+  void SetName(const char *name) { m_Name = name; }
+
+ private:
+  const uint32 m_ID;
+  uint32 m_Capacity;
+  uint32 m_Next;
+  uint64 m_NumDropped;
+  std::vector<TraceEvent> m_Events;
+  std::string m_Name;
+};
+
+// Every buffer that has been created. Buffers are never freed, since the
+// thread that owns one may still hold on to it, and are never shared between
+// threads so that each thread shows up separately in the trace.
+TCMutex *gBufferMutex = NULL;
+std::vector<TraceBuffer *> gBuffers;
+uint32 gEventsPerThread = TCTrace::kDefaultEventsPerThread;
+uint64 gStartNS = 0;
+
+FASTC_THREAD_LOCAL TraceBuffer *gThreadBuffer = NULL;
+
+TCMutex &GetBufferMutex() {
+  // Created by Start before any other thread can record a zone.
+  if(!gBufferMutex) {
+    gBufferMutex = new TCMutex;
+  }
+  return *gBufferMutex;
+}
+
+TraceBuffer &GetThreadBuffer() {
+  if(!gThreadBuffer) {
+    TCLock lock(GetBufferMutex());
+    gThreadBuffer = new TraceBuffer(static_cast<uint32>(gBuffers.size()));
+    gThreadBuffer->Reset(gEventsPerThread);
+    gBuffers.push_back(gThreadBuffer);
+  }
+  return *gThreadBuffer;
+}
+
+void WriteEscaped(FILE *f, const char *str) {
+  for(const char *c = str; *c; c++) {
+    if(*c == '"' || *c == '\\') {
+      fputc('\\', f);
+      fputc(*c, f);
+    } else if(static_cast<unsigned char>(*c) < 0x20) {
+      fprintf(f, "\\u%04x", static_cast<unsigned char>(*c));
+    } else {
+      fputc(*c, f);
+    }
+  }
+}
+
+}  // namespace
+
+bool TCTrace::Start(uint32 maxEventsPerThread) {
+  s_bRecording = false;
+
+  TCLock lock(GetBufferMutex());
+  gEventsPerThread = maxEventsPerThread;
+  for(size_t i = 0; i < gBuffers.size(); i++) {
+    gBuffers[i]->Reset(maxEventsPerThread);
+  }
+
+  gStartNS = Now();
+  s_bRecording = true;
+  return true;
+}
+
+void TCTrace::Stop() {
+  s_bRecording = false;
+}
+
+void TCTrace::SetThreadName(const char *name) {
+  if(IsRecording()) {
+    GetThreadBuffer().SetName(name);
+  }
+}
+
+void TCTrace::Record(const char *name, uint64 startNS, uint64 endNS) {
+  if(!IsRecording()) {
+    return;
+  }
+
+  TraceEvent e;
+  e.name = name;
+  e.startNS = startNS;
+  e.endNS = endNS;
+  GetThreadBuffer().Add(e);
+}
+
+uint64 TCTrace::NumDroppedEvents() {
+  TCLock lock(GetBufferMutex());
+
+  uint64 numDropped = 0;
+  for(size_t i = 0; i < gBuffers.size(); i++) {
+    numDropped += gBuffers[i]->GetNumDropped();
+  }
+  return numDropped;
+}
+
+bool TCTrace::WriteChromeTrace(const char *filename) {
+  FILE *f = fopen(filename, "w");
+  if(!f) {
+    fprintf(stderr, "Unable to open %s for writing the trace.\n", filename);
+    return false;
+  }
+
+  TCLock lock(GetBufferMutex());
+
+  // Chrome expects times in microseconds, relative to any origin.
+  fprintf(f, "{\"traceEvents\":[");
+  bool first = true;
+  uint64 numDropped = 0;
+  for(size_t i = 0; i < gBuffers.size(); i++) {
+    const TraceBuffer &buf = *gBuffers[i];
+    numDropped += buf.GetNumDropped();
+
+    if(!buf.GetName().empty()) {
+      fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+              "\"args\":{\"name\":\"", first? "" : ",", buf.GetID());
+      WriteEscaped(f, buf.GetName().c_str());
+      fprintf(f, "\"}}");
+      first = false;
+    }
+
+    const std::vector<TraceEvent> &events = buf.GetEvents();
+    for(size_t j = 0; j < events.size(); j++) {
+      const TraceEvent &e = events[j];
+      if(e.startNS < gStartNS) {
+        continue;
+      }
+
+      fprintf(f, "%s\n{\"name\":\"", first? "" : ",");
+      WriteEscaped(f, e.name);
+      fprintf(f, "\",\"cat\":\"FasTC\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+              "\"pid\":1,\"tid\":%u}",
+              static_cast<double>(e.startNS - gStartNS) * 1e-3,
+              static_cast<double>(e.endNS - e.startNS) * 1e-3,
+              buf.GetID());
+      first = false;
+    }
+  }
+
+  fprintf(f, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%llu}}\n",
+          static_cast<unsigned long long>(numDropped));
+
+  bool ok = !ferror(f);
+  if(fclose(f) != 0) {
+    ok = false;
+  }
+
+  if(!ok) {
+    fprintf(stderr, "Error writing the trace to %s.\n", filename);
+  }
+  return ok;
+}
+
+#else  // FASTC_ENABLE_TRACING
+
+bool TCTrace::Start(uint32) {
+  fprintf(stderr, "FasTC was built without tracing. "
+                  "Reconfigure with -DFASTC_ENABLE_TRACING=ON to use it.\n");
+  return false;
+}
+
+void TCTrace::Stop() { }
+void TCTrace::SetThreadName(const char *) { }
+void TCTrace::Record(const char *, uint64, uint64) { }
+uint64 TCTrace::NumDroppedEvents() { return 0; }
+
+bool TCTrace::WriteChromeTrace(const char *filename) {
+  fprintf(stderr, "FasTC was built without tracing, not writing %s.\n", filename);
+  return false;
+}
+
+#endif  // FASTC_ENABLE_TRACING
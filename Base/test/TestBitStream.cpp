@@ -0,0 +1,254 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "gtest/gtest.h"
+#include "FasTC/BitStream.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// The bit-at-a-time writer and reader that BitStream used to be. They are
+// the reference that the word oriented versions are checked against.
+class ReferenceWriter {
+ public:
+  explicit ReferenceWriter(unsigned char *ptr) : m_Ptr(ptr), m_Bit(0) { }
+  void WriteBits(unsigned int val, unsigned int nBits) {
+    for(unsigned int i = 0; i < nBits; i++) {
+      const unsigned char mask = static_cast<unsigned char>(1 << (m_Bit % 8));
+      unsigned char &b = m_Ptr[m_Bit / 8];
+      b &= ~mask;
+      if(i < 32 && ((val >> i) & 1)) {
+        b |= mask;
+      }
+      m_Bit++;
+    }
+  }
+ private:
+  unsigned char *m_Ptr;
+  uint32 m_Bit;
+};
+
+class ReferenceReader {
+ public:
+  explicit ReferenceReader(const unsigned char *ptr) : m_Ptr(ptr), m_Bit(0) { }
+  unsigned int ReadBits(unsigned int nBits) {
+    unsigned int ret = 0;
+    for(unsigned int i = 0; i < nBits; i++) {
+      ret |= ((m_Ptr[m_Bit / 8] >> (m_Bit % 8)) & 1) << i;
+      m_Bit++;
+    }
+    return ret;
+  }
+ private:
+  const unsigned char *m_Ptr;
+  uint32 m_Bit;
+};
+
+static unsigned int RandomBits(unsigned int nBits) {
+  unsigned int v = (static_cast<unsigned int>(rand()) << 16) ^ rand();
+  return (nBits < 32)? v & ((1U << nBits) - 1) : v;
+}
+
+// Fills sizes with random field widths in [0, 32] that add up to total.
+static void RandomFieldSizes(std::vector<unsigned int> &sizes, uint32 total) {
+  sizes.clear();
+  while(total > 0) {
+    unsigned int n = rand() % 33;
+    if(n > total) {
+      n = total;
+    }
+    sizes.push_back(n);
+    total -= n;
+  }
+}
+
+TEST(BitStream, WritesMatchReference) {
+  srand(0xBEEF);
+  for(int trial = 0; trial < 1000; trial++) {
+    std::vector<unsigned int> sizes;
+    RandomFieldSizes(sizes, 128);
+
+    unsigned char expected[16], actual[16];
+    memset(expected, 0xA5, sizeof(expected));
+    memset(actual, 0x5A, sizeof(actual));
+
+    ReferenceWriter ref(expected);
+    FasTC::BitStream strm(actual, 128, 0);
+    for(size_t i = 0; i < sizes.size(); i++) {
+      const unsigned int v = RandomBits(32);
+      ref.WriteBits(v, sizes[i]);
+      strm.WriteBits(v, sizes[i]);
+    }
+
+    // The stream flushes itself as soon as the last bit is written.
+    EXPECT_EQ(strm.GetBitsWritten(), 128);
+    EXPECT_EQ(memcmp(expected, actual, sizeof(expected)), 0);
+  }
+}
+
+TEST(BitStream, WritesAreCappedAndPreserveTheRest) {
+  unsigned char buf[8];
+  memset(buf, 0xFF, sizeof(buf));
+  {
+    // Start three bits in and stop after 20 bits...
+    FasTC::BitStream strm(buf, 20, 3);
+    strm.WriteBits(0, 16);
+    strm.WriteBits(0, 16);
+    EXPECT_EQ(strm.GetBitsWritten(), 20);
+  }
+
+  // ... which clears bits 3 through 22 only.
+  EXPECT_EQ(buf[0], 0x07);
+  EXPECT_EQ(buf[1], 0x00);
+  EXPECT_EQ(buf[2], 0x80);
+  for(int i = 3; i < 8; i++) {
+    EXPECT_EQ(buf[i], 0xFF);
+  }
+}
+
+TEST(BitStream, FlushExposesPartialWrites) {
+  unsigned char buf[16];
+  memset(buf, 0, sizeof(buf));
+
+  FasTC::BitStream strm(buf, 128, 0);
+  strm.WriteBits(0x1FF, 9);
+  strm.Flush();
+  EXPECT_EQ(buf[0], 0xFF);
+  EXPECT_EQ(buf[1], 0x01);
+
+  // Writing more after a flush picks up in the middle of the byte.
+  strm.WriteBits(0x7F, 7);
+  strm.Flush();
+  EXPECT_EQ(buf[1], 0xFF);
+  EXPECT_EQ(buf[2], 0x00);
+}
+
+TEST(BitStream, WideWritesArePaddedWithZeros) {
+  unsigned char buf[16];
+  memset(buf, 0xFF, sizeof(buf));
+
+  FasTC::BitStream strm(buf, 128, 0);
+  strm.WriteBits(0xFF, 8);
+  strm.WriteBits(0xFFFFFFFF, 40);
+  strm.WriteBits(0, 80);
+  EXPECT_EQ(buf[0], 0xFF);
+  for(int i = 1; i < 5; i++) {
+    EXPECT_EQ(buf[i], 0xFF);
+  }
+  for(int i = 5; i < 16; i++) {
+    EXPECT_EQ(buf[i], 0x00);
+  }
+}
+
+TEST(BitStreamReadOnly, ReadsMatchReference) {
+  srand(0xCAFE);
+  for(int trial = 0; trial < 1000; trial++) {
+    unsigned char buf[16];
+    for(int i = 0; i < 16; i++) {
+      buf[i] = static_cast<unsigned char>(rand());
+    }
+
+    std::vector<unsigned int> sizes;
+    RandomFieldSizes(sizes, 128);
+
+    ReferenceReader ref(buf);
+    FasTC::BitStreamReadOnly strm(buf);
+    uint32 nBitsRead = 0;
+    for(size_t i = 0; i < sizes.size(); i++) {
+      EXPECT_EQ(strm.ReadBits(sizes[i]), ref.ReadBits(sizes[i]));
+      nBitsRead += sizes[i];
+      EXPECT_EQ(strm.GetBitsRead(), static_cast<int>(nBitsRead));
+    }
+  }
+}
+
+TEST(BitStreamReadOnly, ReadsPastTheEndAreZero) {
+  unsigned char buf[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+  FasTC::BitStreamReadOnly strm(buf, 13);
+  EXPECT_EQ(strm.ReadBits(10), 0x3FFU);
+  EXPECT_EQ(strm.ReadBits(8), 0x07U);
+  EXPECT_EQ(strm.ReadBits(32), 0U);
+  EXPECT_EQ(strm.ReadBit(), 0);
+}
+
+TEST(BitStreamReadOnly, ReverseOrder) {
+  srand(0xF00D);
+  for(int trial = 0; trial < 1000; trial++) {
+    unsigned char buf[16];
+    for(int i = 0; i < 16; i++) {
+      buf[i] = static_cast<unsigned char>(rand());
+    }
+
+    const uint32 nBits = rand() % 129;
+    std::vector<unsigned int> sizes;
+    RandomFieldSizes(sizes, 128);
+
+    FasTC::BitStreamReadOnly strm(buf + 16, nBits,
+                                  FasTC::BitStreamReadOnly::eReverseOrder);
+    uint32 bit = 0;
+    for(size_t i = 0; i < sizes.size(); i++) {
+      unsigned int expected = 0;
+      for(unsigned int j = 0; j < sizes[i]; j++, bit++) {
+        if(bit < nBits) {
+          const uint32 src = 127 - bit;
+          expected |= ((buf[src / 8] >> (src % 8)) & 1) << j;
+        }
+      }
+      EXPECT_EQ(strm.ReadBits(sizes[i]), expected);
+    }
+  }
+}
+
+// Packs and unpacks blocks shaped like BC7 mode 1: a handful of short header
+// fields followed by lots of three and four bit fields.
+static const unsigned int kBlockFields[] = {
+  2, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 1, 1,
+  2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2
+};
+static const uint32 kNumBlockFields =
+  sizeof(kBlockFields) / sizeof(kBlockFields[0]);
+
+TEST(BitStream, PackAndUnpackBlocksMatchReference) {
+  const uint32 kNumBlocks = 256;
+
+  uint32 totalBits = 0;
+  for(uint32 i = 0; i < kNumBlockFields; i++) {
+    totalBits += kBlockFields[i];
+  }
+  ASSERT_EQ(totalBits, 128U);
+
+  std::vector<unsigned char> ref(kNumBlocks * 16), word(kNumBlocks * 16);
+  for(uint32 b = 0; b < kNumBlocks; b++) {
+    ReferenceWriter refStrm(&ref[b * 16]);
+    FasTC::BitStream wordStrm(&word[b * 16], 128, 0);
+    for(uint32 i = 0; i < kNumBlockFields; i++) {
+      refStrm.WriteBits(b * 2654435761U + i, kBlockFields[i]);
+      wordStrm.WriteBits(b * 2654435761U + i, kBlockFields[i]);
+    }
+  }
+
+  EXPECT_TRUE(ref == word);
+
+  for(uint32 b = 0; b < kNumBlocks; b++) {
+    ReferenceReader refStrm(&ref[b * 16]);
+    FasTC::BitStreamReadOnly wordStrm(&word[b * 16]);
+    for(uint32 i = 0; i < kNumBlockFields; i++) {
+      EXPECT_EQ(refStrm.ReadBits(kBlockFields[i]), wordStrm.ReadBits(kBlockFields[i]));
+    }
+  }
+}
@@ -0,0 +1,166 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "gtest/gtest.h"
+#include "FasTC/BlockStats.h"
+
+#include <cstdio>
+
+static const char *kStatsFile = "TestBlockStats.stats";
+
+static FasTC::BlockStat MakeStat(uint32 blockIdx, uint8 mode, float error) {
+  FasTC::BlockStat s(FasTC::eCompressionFormat_BPTC, blockIdx);
+  s.m_Path = 3;
+  s.m_Mode = mode;
+  s.m_Shape = 17;
+  s.m_AnnealingSteps = 100;
+  s.m_Error = error;
+  s.m_ModeEstimate[mode] = error * 0.5f;
+  s.m_ModeError[mode] = error;
+  return s;
+}
+
+TEST(BlockStats, Defaults) {
+  FasTC::BlockStat s(FasTC::eCompressionFormat_DXT1, 7);
+  EXPECT_EQ(s.m_BlockIdx, 7U);
+  EXPECT_EQ(s.m_Format, FasTC::eCompressionFormat_DXT1);
+  EXPECT_EQ(s.m_Path, FasTC::BlockStat::kNone);
+  EXPECT_EQ(s.m_Mode, FasTC::BlockStat::kNone);
+  EXPECT_EQ(s.m_Shape, FasTC::BlockStat::kNone);
+  EXPECT_EQ(s.m_AnnealingSteps, 0U);
+  EXPECT_LT(s.m_Error, 0.0f);
+  for(uint32 i = 0; i < FasTC::BlockStat::kMaxNumModes; i++) {
+    EXPECT_LT(s.m_ModeEstimate[i], 0.0f);
+    EXPECT_LT(s.m_ModeError[i], 0.0f);
+  }
+}
+
+TEST(BlockStats, SquaredError) {
+  uint32 a[16], b[16];
+  for(uint32 i = 0; i < 16; i++) {
+    a[i] = 0xFF102030;
+    b[i] = 0x00112233;
+  }
+
+  // Each pixel is off by 1, 2 and 3 in red, green and blue.
+  EXPECT_EQ(FasTC::BlockStat::SquaredError(a, b, false), 16.0f * 14.0f);
+  EXPECT_EQ(FasTC::BlockStat::SquaredError(a, b, true), 16.0f * (14.0f + 255.0f * 255.0f));
+  EXPECT_EQ(FasTC::BlockStat::SquaredError(a, a, true), 0.0f);
+}
+
+TEST(BlockStats, MergeAndSort) {
+  FasTC::BlockStatList first, second;
+  first.Add(MakeStat(2, 0, 1.0f));
+  first.Add(MakeStat(0, 1, 2.0f));
+  second.Add(MakeStat(1, 2, 3.0f));
+  second.Add(MakeStat(0, 3, 4.0f));
+
+  first.Merge(second);
+  EXPECT_EQ(second.Size(), 0U);
+  ASSERT_EQ(first.Size(), 4U);
+
+  // Records of the same block keep the order they were added in.
+  first.SortByBlock();
+  EXPECT_EQ(first[0].m_BlockIdx, 0U);
+  EXPECT_EQ(first[0].m_Mode, 1);
+  EXPECT_EQ(first[1].m_BlockIdx, 0U);
+  EXPECT_EQ(first[1].m_Mode, 3);
+  EXPECT_EQ(first[2].m_BlockIdx, 1U);
+  EXPECT_EQ(first[3].m_BlockIdx, 2U);
+}
+
+TEST(BlockStats, SortFromIndex) {
+  FasTC::BlockStatList stats;
+  stats.Add(MakeStat(5, 0, 1.0f));
+  stats.Add(MakeStat(3, 0, 1.0f));
+  stats.Add(MakeStat(1, 0, 1.0f));
+
+  stats.SortByBlock(1);
+  EXPECT_EQ(stats[0].m_BlockIdx, 5U);
+  EXPECT_EQ(stats[1].m_BlockIdx, 1U);
+  EXPECT_EQ(stats[2].m_BlockIdx, 3U);
+
+  // Sorting past the end does nothing.
+  stats.SortByBlock(10);
+  EXPECT_EQ(stats[0].m_BlockIdx, 5U);
+}
+
+TEST(BlockStats, WriteAndRead) {
+  FasTC::BlockStatList stats;
+  for(uint32 i = 0; i < 100; i++) {
+    stats.Add(MakeStat(i, static_cast<uint8>(i % 8), static_cast<float>(i)));
+  }
+  ASSERT_TRUE(stats.Write(kStatsFile));
+
+  FasTC::BlockStatList read;
+  ASSERT_TRUE(read.Read(kStatsFile));
+  remove(kStatsFile);
+
+  ASSERT_EQ(read.Size(), stats.Size());
+  for(uint32 i = 0; i < read.Size(); i++) {
+    EXPECT_EQ(read[i].m_BlockIdx, stats[i].m_BlockIdx);
+    EXPECT_EQ(read[i].m_Format, stats[i].m_Format);
+    EXPECT_EQ(read[i].m_Path, stats[i].m_Path);
+    EXPECT_EQ(read[i].m_Mode, stats[i].m_Mode);
+    EXPECT_EQ(read[i].m_Shape, stats[i].m_Shape);
+    EXPECT_EQ(read[i].m_AnnealingSteps, stats[i].m_AnnealingSteps);
+    EXPECT_EQ(read[i].m_Error, stats[i].m_Error);
+    for(uint32 m = 0; m < FasTC::BlockStat::kMaxNumModes; m++) {
+      EXPECT_EQ(read[i].m_ModeEstimate[m], stats[i].m_ModeEstimate[m]);
+      EXPECT_EQ(read[i].m_ModeError[m], stats[i].m_ModeError[m]);
+    }
+  }
+}
+
+TEST(BlockStats, ReadRejectsOtherFiles) {
+  FILE *f = fopen(kStatsFile, "wb");
+  ASSERT_TRUE(f != NULL);
+  fputs("This is not a block statistics file", f);
+  fclose(f);
+
+  FasTC::BlockStatList stats;
+  stats.Add(MakeStat(0, 0, 1.0f));
+  EXPECT_FALSE(stats.Read(kStatsFile));
+  remove(kStatsFile);
+
+  // A failed read leaves the list alone.
+  EXPECT_EQ(stats.Size(), 1U);
+}
+
+TEST(BlockStats, ReadRejectsTruncatedFiles) {
+  FasTC::BlockStatList written;
+  for(uint32 i = 0; i < 10; i++) {
+    written.Add(MakeStat(i, 0, 1.0f));
+  }
+  ASSERT_TRUE(written.Write(kStatsFile));
+
+  // Claim more records than the file holds, up to an amount that can't
+  // be allocated. The count follows the four 32-bit header fields.
+  const uint64 kNumRecords[] = { 11, 1ULL << 40, ~0ULL };
+  for(size_t i = 0; i < sizeof(kNumRecords) / sizeof(kNumRecords[0]); i++) {
+    FILE *f = fopen(kStatsFile, "r+b");
+    ASSERT_TRUE(f != NULL);
+    ASSERT_EQ(0, fseek(f, 16, SEEK_SET));
+    ASSERT_EQ(1U, fwrite(&kNumRecords[i], sizeof(kNumRecords[i]), 1, f));
+    fclose(f);
+
+    FasTC::BlockStatList stats;
+    EXPECT_FALSE(stats.Read(kStatsFile));
+    EXPECT_EQ(stats.Size(), 0U);
+  }
+  remove(kStatsFile);
+}
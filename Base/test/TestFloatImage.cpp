@@ -0,0 +1,374 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+#include "gtest/gtest.h"
+#include "FasTC/FloatImage.h"
+#include "FasTC/Image.h"
+#include "FasTC/IPixel.h"
+#include "FasTC/Color.h"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include <algorithm>
+#include <cstdlib>
+
+static void FillRandom(FasTC::FloatImage *img) {
+  for(uint32 j = 0; j < img->GetHeight(); j++) {
+    for(uint32 i = 0; i < img->GetWidth(); i++) {
+      (*img)(i, j) = static_cast<float>(rand() % 256);
+    }
+  }
+}
+
+// Straightforward 2D convolution with the outer product of the two kernels.
+static void ReferenceFilter(const FasTC::FloatImage &img,
+                            const float *kx, uint32 sx,
+                            const float *ky, uint32 sy,
+                            bool bClamp, FasTC::FloatImage *out) {
+  const int32 w = static_cast<int32>(img.GetWidth());
+  const int32 h = static_cast<int32>(img.GetHeight());
+  const int32 ow = bClamp? w : w - static_cast<int32>(sx) + 1;
+  const int32 oh = bClamp? h : h - static_cast<int32>(sy) + 1;
+  const int32 xoff = bClamp? -static_cast<int32>(sx / 2) : 0;
+  const int32 yoff = bClamp? -static_cast<int32>(sy / 2) : 0;
+
+  *out = FasTC::FloatImage(ow, oh);
+  for(int32 j = 0; j < oh; j++) {
+    for(int32 i = 0; i < ow; i++) {
+      double result = 0.0;
+      for(int32 y = 0; y < static_cast<int32>(sy); y++) {
+        for(int32 x = 0; x < static_cast<int32>(sx); x++) {
+          int32 px = std::max(0, std::min(w - 1, i + x + xoff));
+          int32 py = std::max(0, std::min(h - 1, j + y + yoff));
+          result += kx[x] * ky[y] * img(px, py);
+        }
+      }
+      (*out)(i, j) = static_cast<float>(result);
+    }
+  }
+}
+
+// The 'valid' filter that SSIM used before the separable path, kept here
+// to benchmark against.
+static FasTC::Image<FasTC::IPixel> DirectFilterValid(
+  const FasTC::Image<FasTC::IPixel> &img, uint32 size, double sigma) {
+  FasTC::Image<FasTC::IPixel> gaussian(size, size);
+  FasTC::GenerateGaussianKernel(gaussian, size, static_cast<float>(sigma));
+
+  double sum = 0.0;
+  for(uint32 j = 0; j < size; j++) {
+    for(uint32 i = 0; i < size; i++) {
+      sum += static_cast<float>(gaussian(i, j));
+    }
+  }
+
+  for(uint32 j = 0; j < size; j++) {
+    for(uint32 i = 0; i < size; i++) {
+      double v = static_cast<float>(gaussian(i, j));
+      gaussian(i, j) = static_cast<float>(v / sum);
+    }
+  }
+
+  int32 h = static_cast<int32>(img.GetHeight());
+  int32 w = static_cast<int32>(img.GetWidth());
+
+  FasTC::Image<FasTC::IPixel> out(img.GetWidth() - size + 1, img.GetHeight() - size + 1);
+  int32 halfSz = static_cast<int32>(size) >> 1;
+  for(int32 j = halfSz; j < h-halfSz; j++) {
+    for(int32 i = halfSz; i < w-halfSz; i++) {
+      double result = 0;
+      for(int32 y = 0; y < static_cast<int32>(size); y++)
+      for(int32 x = 0; x < static_cast<int32>(size); x++) {
+        double s = static_cast<float>(gaussian(x, y));
+        result += s * static_cast<float>(img(i-halfSz+x, j-halfSz+y));
+      }
+      out(i-halfSz, j-halfSz) = static_cast<float>(result);
+    }
+  }
+
+  return out;
+}
+
+TEST(FloatImage, Layout) {
+  for(uint32 w = 1; w < 10; w++) {
+    FasTC::FloatImage img(w, 3);
+    EXPECT_EQ(img.GetWidth(), w);
+    EXPECT_EQ(img.GetHeight(), 3U);
+    EXPECT_EQ(img.GetRowStride() % 4, 0U);
+    EXPECT_GE(img.GetRowStride(), w);
+    for(uint32 j = 0; j < 3; j++) {
+      EXPECT_EQ(reinterpret_cast<size_t>(img.GetRow(j)) % 16, 0U);
+      for(uint32 i = 0; i < img.GetRowStride(); i++) {
+        EXPECT_EQ(img.GetRow(j)[i], 0.0f);
+      }
+    }
+  }
+
+  FasTC::FloatImage a(5, 5);
+  a(3, 4) = 2.0f;
+  FasTC::FloatImage b(a);
+  EXPECT_EQ(b(3, 4), 2.0f);
+  b(3, 4) = 1.0f;
+  EXPECT_EQ(a(3, 4), 2.0f);
+}
+
+TEST(FloatImage, GaussianKernel) {
+  const uint32 size = 11;
+  float k[size];
+  FasTC::GenerateGaussianKernel1D(k, size, 1.5f);
+
+  FasTC::Image<FasTC::IPixel> k2d;
+  FasTC::GenerateGaussianKernel(k2d, size, 1.5f);
+  double sum2d = 0.0;
+  for(uint32 j = 0; j < size; j++) {
+    for(uint32 i = 0; i < size; i++) {
+      sum2d += static_cast<float>(k2d(i, j));
+    }
+  }
+
+  double sum = 0.0;
+  for(uint32 i = 0; i < size; i++) {
+    sum += k[i];
+    EXPECT_FLOAT_EQ(k[i], k[size - 1 - i]);
+    for(uint32 j = 0; j < size; j++) {
+      EXPECT_NEAR(k[i] * k[j], static_cast<float>(k2d(i, j)) / sum2d, 1e-6);
+    }
+  }
+  EXPECT_NEAR(sum, 1.0, 1e-6);
+}
+
+TEST(FloatImage, FilterSeparableValid) {
+  const float kx[5] = { 0.1f, 0.2f, 0.4f, 0.2f, 0.1f };
+  const float ky[3] = { 0.25f, 0.5f, 0.25f };
+
+  const uint32 widths[] = { 5, 6, 13, 37 };
+  for(uint32 w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+    FasTC::FloatImage img(widths[w], 41);
+    FillRandom(&img);
+
+    FasTC::FloatImage ref, out;
+    ReferenceFilter(img, kx, 5, ky, 3, false, &ref);
+    FasTC::FilterSeparableValid(img, kx, 5, ky, 3, &out, 1);
+
+    ASSERT_EQ(out.GetWidth(), widths[w] - 4);
+    ASSERT_EQ(out.GetHeight(), 39U);
+    for(uint32 j = 0; j < out.GetHeight(); j++) {
+      for(uint32 i = 0; i < out.GetWidth(); i++) {
+        EXPECT_NEAR(out(i, j), ref(i, j), 1e-3);
+      }
+    }
+  }
+}
+
+TEST(FloatImage, FilterSeparableClamped) {
+  float k[7];
+  FasTC::GenerateGaussianKernel1D(k, 7, 2.0f);
+
+  FasTC::FloatImage img(19, 23);
+  FillRandom(&img);
+
+  FasTC::FloatImage ref, out;
+  ReferenceFilter(img, k, 7, k, 7, true, &ref);
+  FasTC::FilterSeparableClamped(img, k, 7, k, 7, &out, 1);
+
+  ASSERT_EQ(out.GetWidth(), 19U);
+  ASSERT_EQ(out.GetHeight(), 23U);
+  for(uint32 j = 0; j < out.GetHeight(); j++) {
+    for(uint32 i = 0; i < out.GetWidth(); i++) {
+      EXPECT_NEAR(out(i, j), ref(i, j), 1e-3);
+    }
+  }
+
+  // Filtering in place should work too.
+  FasTC::FilterSeparableClamped(img, k, 7, k, 7, &img, 1);
+  for(uint32 j = 0; j < out.GetHeight(); j++) {
+    for(uint32 i = 0; i < out.GetWidth(); i++) {
+      EXPECT_EQ(img(i, j), out(i, j));
+    }
+  }
+}
+
+TEST(FloatImage, FilterIndependentOfThreads) {
+  float k[11];
+  FasTC::GenerateGaussianKernel1D(k, 11, 1.5f);
+
+  FasTC::FloatImage img(97, 203);
+  FillRandom(&img);
+
+  FasTC::FloatImage single, multi;
+  FasTC::FilterSeparableValid(img, k, 11, k, 11, &single, 1);
+  FasTC::FilterSeparableValid(img, k, 11, k, 11, &multi, 5);
+
+  ASSERT_EQ(single.GetWidth(), multi.GetWidth());
+  ASSERT_EQ(single.GetHeight(), multi.GetHeight());
+  for(uint32 j = 0; j < single.GetHeight(); j++) {
+    for(uint32 i = 0; i < single.GetWidth(); i++) {
+      EXPECT_EQ(single(i, j), multi(i, j));
+    }
+  }
+}
+
+TEST(FloatImage, SeparableImageFilter) {
+  // A Gaussian kernel takes the separable path of Image::Filter, which
+  // should agree with filtering each channel directly.
+  FasTC::Image<FasTC::IPixel> kernel;
+  FasTC::GenerateGaussianKernel(kernel, 5, 1.0f);
+
+  const uint32 w = 17, h = 9;
+  FasTC::Image<FasTC::Color> img(w, h);
+  FasTC::FloatImage red(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      float v = static_cast<float>((i * 7 + j * 13) % 256) / 255.0f;
+      img(i, j) = FasTC::Color(v, 0.5f, 1.0f - v, 1.0f);
+      red(i, j) = v;
+    }
+  }
+
+  float k[5];
+  FasTC::GenerateGaussianKernel1D(k, 5, 1.0f);
+  FasTC::FloatImage ref;
+  ReferenceFilter(red, k, 5, k, 5, true, &ref);
+
+  img.Filter(kernel);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      EXPECT_NEAR(img(i, j).R(), ref(i, j), 1.0 / 255.0);
+      EXPECT_NEAR(img(i, j).G(), 0.5f, 1.0 / 255.0);
+      EXPECT_NEAR(img(i, j).A(), 1.0f, 1.0 / 255.0);
+    }
+  }
+}
+
+TEST(FloatImage, SeparableValidMatchesDirect) {
+  const uint32 w = 128, h = 96;
+  const uint32 size = 11;
+  const double sigma = 1.5;
+
+  FasTC::FloatImage img(w, h);
+  FillRandom(&img);
+
+  FasTC::Image<FasTC::IPixel> ipImg(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      ipImg(i, j) = img(i, j);
+    }
+  }
+
+  float k[size];
+  FasTC::GenerateGaussianKernel1D(k, size, static_cast<float>(sigma));
+
+  FasTC::Image<FasTC::IPixel> direct = DirectFilterValid(ipImg, size, sigma);
+
+  // The result must not depend on how many threads share the work.
+  FasTC::FloatImage single;
+  FasTC::FilterSeparableValid(img, k, size, k, size, &single, 1);
+
+  FasTC::FloatImage multi;
+  FasTC::FilterSeparableValid(img, k, size, k, size, &multi, 4);
+
+  ASSERT_EQ(single.GetWidth(), direct.GetWidth());
+  ASSERT_EQ(single.GetHeight(), direct.GetHeight());
+  for(uint32 j = 0; j < single.GetHeight(); j++) {
+    for(uint32 i = 0; i < single.GetWidth(); i++) {
+      EXPECT_NEAR(single(i, j), static_cast<float>(direct(i, j)), 1e-2);
+      EXPECT_EQ(single(i, j), multi(i, j));
+    }
+  }
+}
+
+// The textbook orthonormal DCT-II of every block, padding partial blocks by
+// repeating the edge like DiscreteCosineXForm does.
+static void ReferenceDCT(const FasTC::FloatImage &img, uint32 n,
+                         FasTC::FloatImage *out) {
+  const uint32 w = img.GetWidth();
+  const uint32 h = img.GetHeight();
+  *out = FasTC::FloatImage(w, h);
+  for(uint32 v = 0; v < h; v++) {
+    for(uint32 u = 0; u < w; u++) {
+      const uint32 x0 = (u / n) * n, y0 = (v / n) * n;
+      const uint32 ku = u % n, kv = v % n;
+      double acc = 0.0;
+      for(uint32 y = 0; y < n; y++) {
+        for(uint32 x = 0; x < n; x++) {
+          double s = img(std::min(w - 1, x0 + x), std::min(h - 1, y0 + y));
+          acc += s
+            * cos(((2.0 * x + 1.0) * ku * M_PI) / (2.0 * n))
+            * cos(((2.0 * y + 1.0) * kv * M_PI) / (2.0 * n));
+        }
+      }
+      double cu = sqrt(((ku == 0)? 1.0 : 2.0) / n);
+      double cv = sqrt(((kv == 0)? 1.0 : 2.0) / n);
+      (*out)(u, v) = static_cast<float>(cu * cv * acc);
+    }
+  }
+}
+
+TEST(FloatImage, DCTMatchesReference) {
+  const uint32 sizes[] = { 2, 3, 4, 5, 8, 16 };
+  for(uint32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    const uint32 n = sizes[s];
+
+    // Use an image that doesn't evenly divide into blocks.
+    FasTC::FloatImage img(3 * n + 1, 2 * n + n / 2 + 1);
+    FillRandom(&img);
+
+    FasTC::FloatImage ref;
+    ReferenceDCT(img, n, &ref);
+    FasTC::DiscreteCosineXForm(&img, n, 1);
+
+    for(uint32 j = 0; j < img.GetHeight(); j++) {
+      for(uint32 i = 0; i < img.GetWidth(); i++) {
+        EXPECT_NEAR(img(i, j), ref(i, j), 1e-2) << "Block size: " << n;
+      }
+    }
+  }
+}
+
+TEST(FloatImage, DCTRoundTrip) {
+  const uint32 sizes[] = { 4, 7, 8, 16 };
+  for(uint32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    const uint32 n = sizes[s];
+    FasTC::FloatImage img(4 * n, 3 * n);
+    FillRandom(&img);
+
+    FasTC::FloatImage orig(img);
+    FasTC::DiscreteCosineXForm(&img, n, 1);
+    FasTC::InvDiscreteCosineXForm(&img, n, 1);
+
+    for(uint32 j = 0; j < img.GetHeight(); j++) {
+      for(uint32 i = 0; i < img.GetWidth(); i++) {
+        EXPECT_NEAR(img(i, j), orig(i, j), 1e-2) << "Block size: " << n;
+      }
+    }
+  }
+}
+
+TEST(FloatImage, DCTIndependentOfThreads) {
+  FasTC::FloatImage img(256, 200);
+  FillRandom(&img);
+
+  FasTC::FloatImage single(img), multi(img);
+  FasTC::DiscreteCosineXForm(&single, 8, 1);
+  FasTC::DiscreteCosineXForm(&multi, 8, 3);
+
+  for(uint32 j = 0; j < img.GetHeight(); j++) {
+    for(uint32 i = 0; i < img.GetWidth(); i++) {
+      EXPECT_EQ(single(i, j), multi(i, j));
+    }
+  }
+}
@@ -242,3 +242,48 @@ TEST(Image, IDCT) {
     }
   }
 }
+
+TEST(Image, ComputeMetrics) {
+  const uint32 w = 16;
+  const uint32 h = 16;
+
+  FasTC::Image<FasTC::Pixel> img1(w, h);
+  FasTC::Image<FasTC::Pixel> img2(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      img1(i, j) = FasTC::Pixel(255, i * 8, j * 8, 128);
+
+      // Offset the red channel of every other pixel by four.
+      img2(i, j) = img1(i, j);
+      if((i ^ j) & 1) {
+        img2(i, j).R() += 4;
+      }
+    }
+  }
+
+  FasTC::ImageMetrics metrics;
+  EXPECT_TRUE(img1.ComputeMetrics(&img2, &metrics));
+
+  EXPECT_NEAR(metrics.m_ChannelMSE[0], 8.0, 1e-9);
+  EXPECT_EQ(metrics.m_ChannelMSE[1], 0.0);
+  EXPECT_EQ(metrics.m_ChannelMSE[2], 0.0);
+  EXPECT_EQ(metrics.m_ChannelMSE[3], 0.0);
+
+  EXPECT_EQ(metrics.m_ChannelMaxError[0], 4U);
+  EXPECT_EQ(metrics.m_ChannelMaxError[1], 0U);
+
+  // The metrics should agree with the individual functions.
+  EXPECT_DOUBLE_EQ(metrics.m_PSNR, img1.ComputePSNR(&img2));
+  EXPECT_DOUBLE_EQ(metrics.m_SSIM, img1.ComputeSSIM(&img2));
+  EXPECT_GT(metrics.m_SSIM, 0.0);
+  EXPECT_LT(metrics.m_SSIM, 1.0);
+
+  // Images that are too small to filter don't have an SSIM.
+  FasTC::Image<FasTC::Pixel> small1(4, 4);
+  FasTC::Image<FasTC::Pixel> small2(4, 4);
+  EXPECT_TRUE(small1.ComputeMetrics(&small2, &metrics));
+  EXPECT_EQ(metrics.m_SSIM, -1.0);
+
+  // ... and images of different sizes cannot be compared.
+  EXPECT_FALSE(img1.ComputeMetrics(&small1, &metrics));
+}
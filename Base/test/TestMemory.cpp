@@ -0,0 +1,262 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "gtest/gtest.h"
+#include "FasTC/Memory.h"
+#include "FasTC/Image.h"
+#include "FasTC/Pixel.h"
+#include "FasTC/Thread.h"
+
+TEST(Memory, CountsArrays) {
+  TCMemory::ResetStats();
+  const TCMemory::Stats before = TCMemory::GetStats();
+
+  uint32 *arr = TCMemory::NewArray<uint32>(TCMemory::eCategory_Compressor, 100);
+  ASSERT_TRUE(arr != NULL);
+
+  TCMemory::Stats stats = TCMemory::GetStats();
+  EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_Compressor], 1U);
+  EXPECT_EQ(stats.m_BytesAllocated[TCMemory::eCategory_Compressor], 400U);
+  EXPECT_EQ(stats.m_LiveBytes[TCMemory::eCategory_Compressor],
+            before.m_LiveBytes[TCMemory::eCategory_Compressor] + 400U);
+  EXPECT_EQ(stats.m_TotalLiveBytes, before.m_TotalLiveBytes + 400U);
+  EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_Image], 0U);
+
+  TCMemory::DeleteArray(TCMemory::eCategory_Compressor, arr, 100);
+
+  // Freeing memory doesn't change how much was allocated...
+  stats = TCMemory::GetStats();
+  EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_Compressor], 1U);
+  EXPECT_EQ(stats.m_BytesAllocated[TCMemory::eCategory_Compressor], 400U);
+
+  // ... but it's no longer live.
+  EXPECT_EQ(stats.m_TotalLiveBytes, before.m_TotalLiveBytes);
+
+  // Freeing NULL is a no-op just like delete [].
+  TCMemory::DeleteArray<uint32>(TCMemory::eCategory_Compressor, NULL, 100);
+  EXPECT_EQ(TCMemory::GetStats().m_TotalLiveBytes, before.m_TotalLiveBytes);
+}
+
+TEST(Memory, TracksPeak) {
+  TCMemory::ResetStats();
+  const uint64 live = TCMemory::GetStats().m_TotalLiveBytes;
+  EXPECT_EQ(TCMemory::GetStats().m_PeakLiveBytes, live);
+
+  uint8 *a = TCMemory::NewArray<uint8>(TCMemory::eCategory_Image, 1000);
+  uint8 *b = TCMemory::NewArray<uint8>(TCMemory::eCategory_CompressedData, 500);
+  TCMemory::DeleteArray(TCMemory::eCategory_Image, a, 1000);
+  uint8 *c = TCMemory::NewArray<uint8>(TCMemory::eCategory_Image, 200);
+
+  TCMemory::Stats stats = TCMemory::GetStats();
+  EXPECT_EQ(stats.m_PeakLiveBytes, live + 1500U);
+  EXPECT_EQ(stats.m_TotalLiveBytes, live + 700U);
+
+  // Resetting starts the peak over from what is live right now.
+  TCMemory::ResetStats();
+  stats = TCMemory::GetStats();
+  EXPECT_EQ(stats.m_PeakLiveBytes, live + 700U);
+  EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_Image], 0U);
+  EXPECT_EQ(stats.m_BytesAllocated[TCMemory::eCategory_Image], 0U);
+
+  TCMemory::DeleteArray(TCMemory::eCategory_CompressedData, b, 500);
+  TCMemory::DeleteArray(TCMemory::eCategory_Image, c, 200);
+  EXPECT_EQ(TCMemory::GetStats().m_TotalLiveBytes, live);
+}
+
+TEST(Memory, CountsImages) {
+  const uint64 live = TCMemory::GetStats().m_LiveBytes[TCMemory::eCategory_Image];
+  TCMemory::ResetStats();
+  {
+    FasTC::Image<FasTC::Pixel> img(16, 8);
+    FasTC::Image<FasTC::Pixel> copy(img);
+
+    const TCMemory::Stats stats = TCMemory::GetStats();
+    EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_Image], 2U);
+    EXPECT_EQ(stats.m_LiveBytes[TCMemory::eCategory_Image],
+              live + 2 * 16 * 8 * sizeof(FasTC::Pixel));
+
+    // Assigning frees the old pixels before allocating new ones.
+    FasTC::Image<FasTC::Pixel> small(4, 4);
+    copy = small;
+    EXPECT_EQ(TCMemory::GetStats().m_LiveBytes[TCMemory::eCategory_Image],
+              live + (16 * 8 + 2 * 4 * 4) * sizeof(FasTC::Pixel));
+  }
+  EXPECT_EQ(TCMemory::GetStats().m_LiveBytes[TCMemory::eCategory_Image], live);
+}
+
+class AllocatingThread : public TCCallable {
+ public:
+  virtual void operator()() {
+    for(uint32 i = 0; i < kNumAllocations; i++) {
+      uint8 *buf = TCMemory::NewArray<uint8>(TCMemory::eCategory_Compressor, 16);
+      TCMemory::DeleteArray(TCMemory::eCategory_Compressor, buf, 16);
+    }
+  }
+
+  static const uint32 kNumAllocations = 10000;
+};
+
+TEST(Memory, CountsAcrossThreads) {
+  TCMemory::ResetStats();
+  const uint64 live = TCMemory::GetStats().m_TotalLiveBytes;
+
+  const uint32 kNumThreads = 4;
+  AllocatingThread body;
+  TCThread *threads[kNumThreads];
+  for(uint32 i = 0; i < kNumThreads; i++) {
+    threads[i] = new TCThread(body);
+  }
+
+  for(uint32 i = 0; i < kNumThreads; i++) {
+    threads[i]->Join();
+    delete threads[i];
+  }
+
+  const uint64 numAllocations = kNumThreads * AllocatingThread::kNumAllocations;
+  const TCMemory::Stats stats = TCMemory::GetStats();
+  EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_Compressor], numAllocations);
+  EXPECT_EQ(stats.m_BytesAllocated[TCMemory::eCategory_Compressor], numAllocations * 16);
+  EXPECT_EQ(stats.m_TotalLiveBytes, live);
+  EXPECT_LE(stats.m_PeakLiveBytes, live + kNumThreads * 16);
+}
+
+TEST(Memory, ScopeCountsOnlyItsOwnAllocations) {
+  uint8 *outside = TCMemory::NewArray<uint8>(TCMemory::eCategory_Image, 1000);
+
+  TCMemory::Stats stats;
+  {
+    TCMemory::Scope scope;
+    uint8 *a = TCMemory::NewArray<uint8>(TCMemory::eCategory_CompressedData, 300);
+    uint8 *b = TCMemory::NewArray<uint8>(TCMemory::eCategory_Compressor, 200);
+    TCMemory::DeleteArray(TCMemory::eCategory_Compressor, b, 200);
+
+    // Freeing memory from before the scope doesn't take the scope below
+    // what it allocated itself.
+    TCMemory::DeleteArray(TCMemory::eCategory_Image, outside, 1000);
+
+    stats = scope.GetStats();
+    TCMemory::DeleteArray(TCMemory::eCategory_CompressedData, a, 300);
+  }
+
+  EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_CompressedData], 1U);
+  EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_Compressor], 1U);
+  EXPECT_EQ(stats.m_NumAllocations[TCMemory::eCategory_Image], 0U);
+  EXPECT_EQ(stats.m_BytesAllocated[TCMemory::eCategory_CompressedData], 300U);
+  EXPECT_EQ(stats.m_BytesAllocated[TCMemory::eCategory_Compressor], 200U);
+  EXPECT_EQ(stats.m_LiveBytes[TCMemory::eCategory_CompressedData], 300U);
+  EXPECT_EQ(stats.m_LiveBytes[TCMemory::eCategory_Image], 0U);
+  EXPECT_EQ(stats.m_TotalLiveBytes, 300U);
+  EXPECT_EQ(stats.m_PeakLiveBytes, 500U);
+}
+
+TEST(Memory, NestedScopesCountTowardTheOuterScope) {
+  TCMemory::Scope outer;
+  uint8 *a = TCMemory::NewArray<uint8>(TCMemory::eCategory_Image, 100);
+
+  TCMemory::Stats innerStats;
+  {
+    TCMemory::Scope inner;
+    uint8 *b = TCMemory::NewArray<uint8>(TCMemory::eCategory_Image, 50);
+    TCMemory::DeleteArray(TCMemory::eCategory_Image, b, 50);
+    innerStats = inner.GetStats();
+  }
+
+  EXPECT_EQ(innerStats.m_BytesAllocated[TCMemory::eCategory_Image], 50U);
+  EXPECT_EQ(innerStats.m_PeakLiveBytes, 50U);
+
+  const TCMemory::Stats outerStats = outer.GetStats();
+  EXPECT_EQ(outerStats.m_BytesAllocated[TCMemory::eCategory_Image], 150U);
+  EXPECT_EQ(outerStats.m_PeakLiveBytes, 150U);
+  EXPECT_EQ(outerStats.m_TotalLiveBytes, 100U);
+
+  TCMemory::DeleteArray(TCMemory::eCategory_Image, a, 100);
+}
+
+// Counts its allocations in a scope of its own, starting worker threads
+// that allocate on its behalf.
+class ScopedJobThread : public TCCallable {
+ public:
+  explicit ScopedJobThread(uint32 allocationSz) : m_AllocationSz(allocationSz) { }
+
+  virtual void operator()() {
+    TCMemory::Scope scope;
+
+    const uint32 kNumWorkers = 2;
+    AllocatingWorker worker(m_AllocationSz);
+    TCThread *workers[kNumWorkers];
+    for(uint32 i = 0; i < kNumWorkers; i++) {
+      workers[i] = new TCThread(worker);
+    }
+    for(uint32 i = 0; i < kNumWorkers; i++) {
+      workers[i]->Join();
+      delete workers[i];
+    }
+
+    m_Stats = scope.GetStats();
+  }
+
+  const TCMemory::Stats &GetStats() const { return m_Stats; }
+
+  static const uint32 kNumAllocations = 2000;
+
+ private:
+  class AllocatingWorker : public TCCallable {
+   public:
+    explicit AllocatingWorker(uint32 sz) : m_Sz(sz) { }
+
+    virtual void operator()() {
+      for(uint32 i = 0; i < kNumAllocations; i++) {
+        uint8 *buf = TCMemory::NewArray<uint8>(TCMemory::eCategory_Compressor, m_Sz);
+        TCMemory::DeleteArray(TCMemory::eCategory_Compressor, buf, m_Sz);
+      }
+    }
+
+   private:
+    const uint32 m_Sz;
+  };
+
+  const uint32 m_AllocationSz;
+  TCMemory::Stats m_Stats;
+};
+
+TEST(Memory, ConcurrentScopesAreCountedSeparately) {
+  ScopedJobThread small(16);
+  ScopedJobThread large(1024);
+  TCThread smallThread(small);
+  TCThread largeThread(large);
+  smallThread.Join();
+  largeThread.Join();
+
+  // Each job sees the allocations of its own workers, and none of the other
+  // job's, no matter how the threads were interleaved.
+  const uint64 numAllocations = 2 * ScopedJobThread::kNumAllocations;
+  EXPECT_EQ(small.GetStats().m_NumAllocations[TCMemory::eCategory_Compressor], numAllocations);
+  EXPECT_EQ(small.GetStats().m_BytesAllocated[TCMemory::eCategory_Compressor], numAllocations * 16);
+  EXPECT_LE(small.GetStats().m_PeakLiveBytes, 2U * 16U);
+  EXPECT_EQ(small.GetStats().m_TotalLiveBytes, 0U);
+
+  EXPECT_EQ(large.GetStats().m_NumAllocations[TCMemory::eCategory_Compressor], numAllocations);
+  EXPECT_EQ(large.GetStats().m_BytesAllocated[TCMemory::eCategory_Compressor], numAllocations * 1024);
+  EXPECT_LE(large.GetStats().m_PeakLiveBytes, 2U * 1024U);
+  EXPECT_GE(large.GetStats().m_PeakLiveBytes, 1024U);
+}
+
+TEST(Memory, PeakResidentBytes) {
+#if defined(_MSC_VER) || defined(__unix__) || defined(__APPLE__)
+  EXPECT_GT(TCMemory::GetPeakResidentBytes(), 0U);
+#endif
+}
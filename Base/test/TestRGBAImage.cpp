@@ -0,0 +1,112 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+#include "gtest/gtest.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/Pixel.h"
+
+#include <cstring>
+
+TEST(RGBAImage, DefaultConstructor) {
+  FasTC::RGBA8Image img;
+  EXPECT_EQ(img.GetWidth(), 0U);
+  EXPECT_EQ(img.GetHeight(), 0U);
+  EXPECT_TRUE(img.GetData() == NULL);
+}
+
+TEST(RGBAImage, Alignment) {
+  for(uint32 w = 1; w < 9; w++) {
+    FasTC::RGBA8Image img8(w, 3);
+    FasTC::RGBA16FImage img16(w, 3);
+    size_t addr8 = reinterpret_cast<size_t>(img8.GetData());
+    size_t addr16 = reinterpret_cast<size_t>(img16.GetData());
+    EXPECT_EQ(addr8 % FasTC::kRGBAImageAlignment, 0U);
+    EXPECT_EQ(addr16 % FasTC::kRGBAImageAlignment, 0U);
+    EXPECT_EQ(img8.GetDataSize(), w * 3 * 4);
+    EXPECT_EQ(img16.GetDataSize(), w * 3 * 8);
+  }
+}
+
+TEST(RGBAImage, PackedLayout) {
+  FasTC::Pixel p;
+  p.R() = 10; p.G() = 20; p.B() = 30; p.A() = 40;
+  uint32 pixels[6];
+  for(uint32 i = 0; i < 6; i++) {
+    pixels[i] = p.Pack();
+  }
+
+  FasTC::RGBA8Image img(3, 2, reinterpret_cast<const uint8 *>(pixels));
+  const uint8 *px = img(2, 1);
+  EXPECT_EQ(px[0], 10);
+  EXPECT_EQ(px[1], 20);
+  EXPECT_EQ(px[2], 30);
+  EXPECT_EQ(px[3], 40);
+  EXPECT_EQ(img.GetRow(1) + 8, px);
+}
+
+TEST(RGBAImage, CopyAndSwap) {
+  FasTC::RGBA8Image a(2, 2);
+  memset(a.GetData(), 0x7F, a.GetDataSize());
+
+  FasTC::RGBA8Image b(a);
+  EXPECT_NE(a.GetData(), b.GetData());
+  EXPECT_EQ(memcmp(a.GetData(), b.GetData(), a.GetDataSize()), 0);
+
+  FasTC::RGBA8Image c(5, 1);
+  const uint8 *cData = c.GetData();
+  c.Swap(b);
+  EXPECT_EQ(c.GetWidth(), 2U);
+  EXPECT_EQ(b.GetWidth(), 5U);
+  EXPECT_EQ(b.GetData(), cData);
+
+  b = a;
+  EXPECT_EQ(b.GetWidth(), 2U);
+  EXPECT_EQ(b.GetHeight(), 2U);
+  EXPECT_EQ(memcmp(a.GetData(), b.GetData(), a.GetDataSize()), 0);
+}
+
+TEST(RGBAImage, HalfConversion) {
+  EXPECT_EQ(FasTC::FloatToHalf(0.0f), 0x0000);
+  EXPECT_EQ(FasTC::FloatToHalf(-0.0f), 0x8000);
+  EXPECT_EQ(FasTC::FloatToHalf(1.0f), 0x3C00);
+  EXPECT_EQ(FasTC::FloatToHalf(-2.0f), 0xC000);
+  EXPECT_EQ(FasTC::FloatToHalf(65504.0f), 0x7BFF);
+  EXPECT_EQ(FasTC::FloatToHalf(1e6f), 0x7C00);
+  EXPECT_EQ(FasTC::FloatToHalf(5.9604645e-8f), 0x0001);
+
+  for(uint32 h = 0; h < 0x7C00; h++) {
+    uint16 half = static_cast<uint16>(h);
+    EXPECT_EQ(FasTC::FloatToHalf(FasTC::HalfToFloat(half)), half);
+  }
+}
+
+TEST(RGBAImage, ConvertRoundTrip) {
+  FasTC::RGBA8Image img(16, 16);
+  uint8 *data = img.GetData();
+  for(uint32 i = 0; i < img.GetDataSize(); i++) {
+    data[i] = static_cast<uint8>(i);
+  }
+
+  FasTC::RGBA16FImage hdr;
+  FasTC::ConvertToRGBA16F(img, &hdr);
+  EXPECT_EQ(hdr.GetWidth(), 16U);
+  EXPECT_EQ(hdr.GetHeight(), 16U);
+  EXPECT_EQ(hdr.GetData()[4 * 3 + 3], FasTC::FloatToHalf(15.0f / 255.0f));
+
+  FasTC::RGBA8Image ldr;
+  FasTC::ConvertToRGBA8(hdr, &ldr);
+  EXPECT_EQ(memcmp(img.GetData(), ldr.GetData(), img.GetDataSize()), 0);
+}
@@ -0,0 +1,142 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+#include "gtest/gtest.h"
+#include "FasTC/Thread.h"
+
+#include <vector>
+
+class CountingBody : public TCRangeCallable {
+ public:
+  std::vector<uint32> m_Counts;
+  TCMutex m_Mutex;
+  uint32 m_NumCalls;
+
+  explicit CountingBody(uint32 count) : m_Counts(count, 0), m_NumCalls(0) { }
+
+  virtual void operator()(uint32 begin, uint32 end) {
+    EXPECT_LT(begin, end);
+    for(uint32 i = begin; i < end; i++) {
+      m_Counts[i]++;
+    }
+
+    TCLock lock(m_Mutex);
+    m_NumCalls++;
+  }
+};
+
+TEST(Thread, NumHardwareThreads) {
+  EXPECT_GE(TCThread::NumHardwareThreads(), 1U);
+}
+
+TEST(Thread, ParallelForCoversRange) {
+  const uint32 counts[] = { 1, 2, 7, 100, 1023 };
+  const uint32 threads[] = { 0, 1, 3, 8 };
+  for(uint32 c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    for(uint32 t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+      CountingBody body(counts[c]);
+      TCParallelFor(counts[c], threads[t], body);
+      for(uint32 i = 0; i < counts[c]; i++) {
+        EXPECT_EQ(body.m_Counts[i], 1U);
+      }
+
+      if(threads[t] > 0) {
+        EXPECT_LE(body.m_NumCalls, threads[t]);
+      }
+      EXPECT_LE(body.m_NumCalls, counts[c]);
+    }
+  }
+}
+
+TEST(Thread, ParallelForEmpty) {
+  CountingBody body(0);
+  TCParallelFor(0, 4, body);
+  EXPECT_EQ(body.m_NumCalls, 0U);
+}
+
+class QueueProducer : public TCCallable {
+ public:
+  QueueProducer(TCBoundedQueue<uint32> &queue, uint32 first, uint32 count)
+    : m_Queue(queue), m_First(first), m_Count(count) { }
+
+  virtual void operator()() {
+    for(uint32 i = 0; i < m_Count; i++) {
+      EXPECT_TRUE(m_Queue.Push(m_First + i));
+    }
+  }
+
+ private:
+  TCBoundedQueue<uint32> &m_Queue;
+  const uint32 m_First;
+  const uint32 m_Count;
+};
+
+TEST(Thread, BoundedQueueKeepsOrder) {
+  const uint32 kCount = 1000;
+  TCBoundedQueue<uint32> queue(3);
+  QueueProducer producer(queue, 0, kCount);
+  TCThread thread(producer);
+
+  for(uint32 i = 0; i < kCount; i++) {
+    uint32 item = kCount;
+    EXPECT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, i);
+  }
+
+  thread.Join();
+  queue.Close();
+
+  uint32 item;
+  EXPECT_FALSE(queue.Pop(item));
+}
+
+TEST(Thread, BoundedQueueDrainsAfterClose) {
+  TCBoundedQueue<uint32> queue(4);
+  EXPECT_TRUE(queue.Push(1));
+  EXPECT_TRUE(queue.Push(2));
+  queue.Close();
+  EXPECT_FALSE(queue.Push(3));
+
+  uint32 item = 0;
+  EXPECT_TRUE(queue.Pop(item));
+  EXPECT_EQ(item, 1U);
+  EXPECT_TRUE(queue.Pop(item));
+  EXPECT_EQ(item, 2U);
+  EXPECT_FALSE(queue.Pop(item));
+}
+
+TEST(Thread, BoundedQueueManyProducers) {
+  const uint32 kPerProducer = 500;
+  TCBoundedQueue<uint32> queue(2);
+  QueueProducer a(queue, 0, kPerProducer);
+  QueueProducer b(queue, kPerProducer, kPerProducer);
+  TCThread ta(a);
+  TCThread tb(b);
+
+  std::vector<uint32> seen(2 * kPerProducer, 0);
+  for(uint32 i = 0; i < 2 * kPerProducer; i++) {
+    uint32 item = 0;
+    ASSERT_TRUE(queue.Pop(item));
+    ASSERT_LT(item, 2 * kPerProducer);
+    seen[item]++;
+  }
+
+  ta.Join();
+  tb.Join();
+  for(uint32 i = 0; i < 2 * kPerProducer; i++) {
+    EXPECT_EQ(seen[i], 1U);
+  }
+}
@@ -0,0 +1,137 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "gtest/gtest.h"
+#include "FasTC/Trace.h"
+#include "FasTC/Thread.h"
+
+#include <cstdio>
+#include <string>
+
+#ifdef FASTC_ENABLE_TRACING
+
+static const char *kTraceFile = "TestTrace.json";
+
+static std::string ReadTrace() {
+  std::string contents;
+  FILE *f = fopen(kTraceFile, "rb");
+  if(!f) {
+    return contents;
+  }
+
+  char buf[4096];
+  size_t n;
+  while((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    contents.append(buf, n);
+  }
+  fclose(f);
+  remove(kTraceFile);
+  return contents;
+}
+
+static uint32 CountOccurrences(const std::string &str, const std::string &sub) {
+  uint32 count = 0;
+  for(size_t pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+class TracingThread : public TCCallable {
+ public:
+  virtual void operator()() {
+    TCTrace::SetThreadName("Tracing \"Thread\"");
+    FASTC_TRACE_ZONE("Thread Zone");
+  }
+};
+
+TEST(Trace, RecordsOnlyWhileStarted) {
+  {
+    FASTC_TRACE_ZONE("Before Start");
+  }
+
+  ASSERT_TRUE(TCTrace::Start());
+  EXPECT_TRUE(TCTrace::IsRecording());
+  TCTrace::SetThreadName("Main");
+  {
+    FASTC_TRACE_ZONE("Outer");
+    FASTC_TRACE_ZONE("Inner");
+  }
+  TCTrace::Stop();
+  EXPECT_FALSE(TCTrace::IsRecording());
+
+  {
+    FASTC_TRACE_ZONE("After Stop");
+  }
+
+  ASSERT_TRUE(TCTrace::WriteChromeTrace(kTraceFile));
+  const std::string trace = ReadTrace();
+  EXPECT_EQ(CountOccurrences(trace, "\"ph\":\"X\""), 2U);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"Outer\""), 1U);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"Inner\""), 1U);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"Main\""), 1U);
+  EXPECT_EQ(CountOccurrences(trace, "Before Start"), 0U);
+  EXPECT_EQ(CountOccurrences(trace, "After Stop"), 0U);
+}
+
+TEST(Trace, SeparatesThreads) {
+  ASSERT_TRUE(TCTrace::Start());
+  {
+    FASTC_TRACE_ZONE("Main Zone");
+    TracingThread body;
+    TCThread thread(body);
+    thread.Join();
+  }
+  TCTrace::Stop();
+
+  ASSERT_TRUE(TCTrace::WriteChromeTrace(kTraceFile));
+  const std::string trace = ReadTrace();
+  EXPECT_EQ(CountOccurrences(trace, "\"ph\":\"X\""), 2U);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"Tracing \\\"Thread\\\"\""), 1U);
+
+  const size_t mainZone = trace.find("\"name\":\"Main Zone\"");
+  const size_t threadZone = trace.find("\"name\":\"Thread Zone\"");
+  ASSERT_NE(mainZone, std::string::npos);
+  ASSERT_NE(threadZone, std::string::npos);
+  EXPECT_NE(trace.substr(trace.find("\"tid\"", mainZone), 10),
+            trace.substr(trace.find("\"tid\"", threadZone), 10));
+}
+
+TEST(Trace, RingBufferKeepsNewestZones) {
+  ASSERT_TRUE(TCTrace::Start(4));
+  TCTrace::Record("Old", 0, 1);
+  for(uint32 i = 0; i < 10; i++) {
+    FASTC_TRACE_ZONE("New");
+  }
+  TCTrace::Stop();
+  EXPECT_EQ(TCTrace::NumDroppedEvents(), 7U);
+
+  ASSERT_TRUE(TCTrace::WriteChromeTrace(kTraceFile));
+  const std::string trace = ReadTrace();
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"New\""), 4U);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"Old\""), 0U);
+  EXPECT_EQ(CountOccurrences(trace, "\"droppedEvents\":7"), 1U);
+}
+
+#else  // FASTC_ENABLE_TRACING
+
+TEST(Trace, CompiledOut) {
+  EXPECT_FALSE(TCTrace::Start());
+  EXPECT_FALSE(TCTrace::IsRecording());
+}
+
+#endif  // FASTC_ENABLE_TRACING
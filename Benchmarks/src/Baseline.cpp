@@ -0,0 +1,484 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Baseline.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Just enough of a JSON parser to read the files that FasTCBenchmarks
+// writes. Values that aren't needed are parsed and skipped.
+class JSONReader {
+ public:
+  explicit JSONReader(const std::string &text)
+    : m_Text(text), m_Pos(0) { }
+
+  bool AtEnd() {
+    SkipWhitespace();
+    return m_Pos >= m_Text.size();
+  }
+
+  // Consumes c if it is the next character.
+  bool Accept(char c) {
+    SkipWhitespace();
+    if(m_Pos < m_Text.size() && m_Text[m_Pos] == c) {
+      m_Pos++;
+      return true;
+    }
+    return false;
+  }
+
+  bool Peek(char c) {
+    SkipWhitespace();
+    return m_Pos < m_Text.size() && m_Text[m_Pos] == c;
+  }
+
+  bool ReadString(std::string &out) {
+    if(!Accept('"')) {
+      return false;
+    }
+
+    out.clear();
+    while(m_Pos < m_Text.size() && m_Text[m_Pos] != '"') {
+      if(m_Text[m_Pos] == '\\') {
+        // Only quotes and backslashes are ever escaped, in the compiler flags.
+        m_Pos++;
+        if(m_Pos >= m_Text.size()) {
+          return false;
+        }
+      }
+      out += m_Text[m_Pos++];
+    }
+    return Accept('"');
+  }
+
+  // Reads a number, or null, in which case out is set to -1.
+  bool ReadNumber(double &out) {
+    SkipWhitespace();
+    if(m_Text.compare(m_Pos, 4, "null") == 0) {
+      m_Pos += 4;
+      out = -1.0;
+      return true;
+    }
+
+    const char *start = m_Text.c_str() + m_Pos;
+    char *end = NULL;
+    out = strtod(start, &end);
+    if(end == start) {
+      return false;
+    }
+    m_Pos += end - start;
+    return true;
+  }
+
+  bool SkipValue() {
+    std::string str;
+    double num;
+    if(Peek('"')) {
+      return ReadString(str);
+    } else if(Accept('{')) {
+      if(Accept('}')) {
+        return true;
+      }
+      do {
+        if(!ReadString(str) || !Accept(':') || !SkipValue()) {
+          return false;
+        }
+      } while(Accept(','));
+      return Accept('}');
+    } else if(Accept('[')) {
+      if(Accept(']')) {
+        return true;
+      }
+      do {
+        if(!SkipValue()) {
+          return false;
+        }
+      } while(Accept(','));
+      return Accept(']');
+    } else if(m_Text.compare(m_Pos, 4, "true") == 0) {
+      m_Pos += 4;
+      return true;
+    } else if(m_Text.compare(m_Pos, 5, "false") == 0) {
+      m_Pos += 5;
+      return true;
+    }
+    return ReadNumber(num);
+  }
+
+ private:
+  const std::string &m_Text;
+  size_t m_Pos;
+
+  void SkipWhitespace() {
+    while(m_Pos < m_Text.size() &&
+          isspace(static_cast<unsigned char>(m_Text[m_Pos]))) {
+      m_Pos++;
+    }
+  }
+};
+
+static bool ReadResult(JSONReader &rdr, SResult &r) {
+  r.width = r.height = 0;
+  r.encodeMS = r.decodeMS = -1.0;
+  r.encodeMinMS = r.decodeMinMS = -1.0;
+  r.psnr = r.ssim = -1.0;
+  r.calibrationMS = -1.0;
+  r.encodeRelative = r.decodeRelative = -1.0;
+  r.encodeNoise = r.decodeNoise = 0.0;
+
+  if(!rdr.Accept('{')) {
+    return false;
+  }
+  if(rdr.Accept('}')) {
+    return true;
+  }
+
+  do {
+    std::string key;
+    if(!rdr.ReadString(key) || !rdr.Accept(':')) {
+      return false;
+    }
+
+    double v = 0.0;
+    bool ok = true;
+    if(key == "codec") {
+      ok = rdr.ReadString(r.codec);
+    } else if(key == "image") {
+      ok = rdr.ReadString(r.image);
+    } else if(key == "width") {
+      ok = rdr.ReadNumber(v);
+      r.width = static_cast<uint32>(v);
+    } else if(key == "height") {
+      ok = rdr.ReadNumber(v);
+      r.height = static_cast<uint32>(v);
+    } else if(key == "encode_ms") {
+      ok = rdr.ReadNumber(r.encodeMS);
+    } else if(key == "decode_ms") {
+      ok = rdr.ReadNumber(r.decodeMS);
+    } else if(key == "encode_min_ms") {
+      ok = rdr.ReadNumber(r.encodeMinMS);
+    } else if(key == "decode_min_ms") {
+      ok = rdr.ReadNumber(r.decodeMinMS);
+    } else if(key == "psnr") {
+      ok = rdr.ReadNumber(r.psnr);
+    } else if(key == "ssim") {
+      ok = rdr.ReadNumber(r.ssim);
+    } else if(key == "calibration_ms") {
+      ok = rdr.ReadNumber(r.calibrationMS);
+    } else if(key == "encode_rel") {
+      ok = rdr.ReadNumber(r.encodeRelative);
+    } else if(key == "decode_rel") {
+      ok = rdr.ReadNumber(r.decodeRelative);
+    } else if(key == "encode_noise") {
+      ok = rdr.ReadNumber(r.encodeNoise);
+      r.encodeNoise = std::max(r.encodeNoise, 0.0);
+    } else if(key == "decode_noise") {
+      ok = rdr.ReadNumber(r.decodeNoise);
+      r.decodeNoise = std::max(r.decodeNoise, 0.0);
+    } else {
+      ok = rdr.SkipValue();
+    }
+
+    if(!ok) {
+      return false;
+    }
+  } while(rdr.Accept(','));
+
+  return rdr.Accept('}');
+}
+
+static bool ReadBuildInfo(JSONReader &rdr, SBuildInfo &build) {
+  if(!rdr.Accept('{')) {
+    return false;
+  }
+  if(rdr.Accept('}')) {
+    return true;
+  }
+
+  do {
+    std::string key;
+    if(!rdr.ReadString(key) || !rdr.Accept(':')) {
+      return false;
+    }
+
+    bool ok = true;
+    if(key == "type") {
+      ok = rdr.ReadString(build.buildType);
+    } else if(key == "compiler") {
+      ok = rdr.ReadString(build.compiler);
+    } else if(key == "cxx_flags") {
+      ok = rdr.ReadString(build.cxxFlags);
+    } else if(key == "sse") {
+      ok = rdr.ReadString(build.sse);
+    } else {
+      ok = rdr.SkipValue();
+    }
+
+    if(!ok) {
+      return false;
+    }
+  } while(rdr.Accept(','));
+
+  return rdr.Accept('}');
+}
+
+static bool ParseBaseline(JSONReader &rdr, SBaseline *out) {
+  if(!rdr.Accept('{')) {
+    return false;
+  }
+  if(rdr.Accept('}')) {
+    return true;
+  }
+
+  do {
+    std::string key;
+    if(!rdr.ReadString(key) || !rdr.Accept(':')) {
+      return false;
+    }
+
+    double v = 0.0;
+    if(key == "quality") {
+      if(!rdr.ReadNumber(v)) {
+        return false;
+      }
+      out->quality = static_cast<int>(v);
+    } else if(key == "threads") {
+      if(!rdr.ReadNumber(v)) {
+        return false;
+      }
+      out->numThreads = static_cast<int>(v);
+    } else if(key == "build") {
+      if(!ReadBuildInfo(rdr, out->build)) {
+        return false;
+      }
+    } else if(key == "results") {
+      if(!rdr.Accept('[')) {
+        return false;
+      }
+      if(!rdr.Accept(']')) {
+        do {
+          SResult r;
+          if(!ReadResult(rdr, r)) {
+            return false;
+          }
+          out->results.push_back(r);
+        } while(rdr.Accept(','));
+
+        if(!rdr.Accept(']')) {
+          return false;
+        }
+      }
+    } else if(!rdr.SkipValue()) {
+      return false;
+    }
+  } while(rdr.Accept(','));
+
+  return rdr.Accept('}') && rdr.AtEnd();
+}
+
+bool ReadBaseline(const char *filename, SBaseline *out) {
+  FILE *f = fopen(filename, "rb");
+  if(NULL == f) {
+    fprintf(stderr, "Unable to open baseline: %s\n", filename);
+    return false;
+  }
+
+  std::string text;
+  char buf[4096];
+  size_t nRead;
+  while((nRead = fread(buf, 1, sizeof(buf), f)) > 0) {
+    text.append(buf, nRead);
+  }
+  fclose(f);
+
+  *out = SBaseline();
+  JSONReader rdr(text);
+  if(!ParseBaseline(rdr, out)) {
+    fprintf(stderr, "Malformed baseline: %s\n", filename);
+    return false;
+  }
+
+  for(size_t i = 0; i < out->results.size(); i++) {
+    const SResult &r = out->results[i];
+    if(r.calibrationMS <= 0.0 ||
+       (r.encodeMS >= 0.0 && r.encodeRelative <= 0.0) ||
+       (r.decodeMS >= 0.0 && r.decodeRelative <= 0.0)) {
+      fprintf(stderr, "Baseline has no calibrated times for %s %s: %s\n",
+              r.codec.c_str(), r.image.c_str(), filename);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static const SResult *FindResult(const std::vector<SResult> &results,
+                                 const SResult &r) {
+  for(size_t i = 0; i < results.size(); i++) {
+    if(results[i].codec == r.codec && results[i].image == r.image) {
+      return &results[i];
+    }
+  }
+  return NULL;
+}
+
+// The geometric mean of the slowdowns of one operation of one codec over
+// every image that it was measured on, along with that of the noise of the
+// measurements. Noise mostly averages out across the images, so these are
+// what get compared with the tolerance.
+struct SSlowdown {
+  std::string codec;
+  const char *what;
+  double logSum;
+  double logNoiseSum;
+  uint32 count;
+
+  double GetSlowdown() const { return exp(logSum / static_cast<double>(count)); }
+
+  // A codec counts as slower only if it got slower by more than both the
+  // tolerance and what its measurements varied by when they were repeated.
+  double GetLimit(const SGateTolerances &tolerances) const {
+    const double noise = exp(logNoiseSum / static_cast<double>(count));
+    return (1.0 + tolerances.maxSlowdown) * noise;
+  }
+};
+
+static void AddSlowdown(std::vector<SSlowdown> &slowdowns,
+                        const std::string &codec, const char *what,
+                        double relative, double noise,
+                        double baseRelative, double baseNoise) {
+  if(relative <= 0.0 || baseRelative <= 0.0) {
+    return;
+  }
+
+  // Both times are relative to the speed of their machine at the time.
+  const double logSlowdown = log(relative / baseRelative);
+  const double logNoise = log(1.0 + std::max(noise, baseNoise));
+
+  for(size_t i = 0; i < slowdowns.size(); i++) {
+    if(slowdowns[i].codec == codec && strcmp(slowdowns[i].what, what) == 0) {
+      slowdowns[i].logSum += logSlowdown;
+      slowdowns[i].logNoiseSum += logNoise;
+      slowdowns[i].count++;
+      return;
+    }
+  }
+
+  SSlowdown s;
+  s.codec = codec;
+  s.what = what;
+  s.logSum = logSlowdown;
+  s.logNoiseSum = logNoise;
+  s.count = 1;
+  slowdowns.push_back(s);
+}
+
+static void ComputeSlowdowns(const std::vector<SResult> &results,
+                             const SBaseline &baseline,
+                             std::vector<SSlowdown> &slowdowns) {
+  for(size_t i = 0; i < results.size(); i++) {
+    const SResult &r = results[i];
+    const SResult *base = FindResult(baseline.results, r);
+    if(NULL == base || base->width != r.width || base->height != r.height) {
+      continue;
+    }
+
+    AddSlowdown(slowdowns, r.codec, "encode", r.encodeRelative, r.encodeNoise,
+                base->encodeRelative, base->encodeNoise);
+    AddSlowdown(slowdowns, r.codec, "decode", r.decodeRelative, r.decodeNoise,
+                base->decodeRelative, base->decodeNoise);
+  }
+}
+
+void FindSlowCodecs(const std::vector<SResult> &results,
+                    const SBaseline &baseline,
+                    const SGateTolerances &tolerances,
+                    std::vector<std::string> &slowCodecs) {
+  slowCodecs.clear();
+
+  std::vector<SSlowdown> slowdowns;
+  ComputeSlowdowns(results, baseline, slowdowns);
+  for(size_t i = 0; i < slowdowns.size(); i++) {
+    const SSlowdown &s = slowdowns[i];
+    if(s.GetSlowdown() > s.GetLimit(tolerances) &&
+       std::find(slowCodecs.begin(), slowCodecs.end(), s.codec) == slowCodecs.end()) {
+      slowCodecs.push_back(s.codec);
+    }
+  }
+}
+
+uint32 CompareWithBaseline(const std::vector<SResult> &results,
+                           const SBaseline &baseline,
+                           const SGateTolerances &tolerances,
+                           bool bCompareTimes) {
+  uint32 numRegressions = 0;
+  uint32 numCompared = 0;
+  for(size_t i = 0; i < results.size(); i++) {
+    const SResult &r = results[i];
+    const SResult *base = FindResult(baseline.results, r);
+    if(NULL == base) {
+      fprintf(stdout, "No baseline for %s %s\n", r.codec.c_str(), r.image.c_str());
+      continue;
+    }
+
+    if(base->width != r.width || base->height != r.height) {
+      fprintf(stdout, "REGRESSION: %s %s is %ux%u, but the baseline is %ux%u\n",
+              r.codec.c_str(), r.image.c_str(), r.width, r.height,
+              base->width, base->height);
+      numRegressions++;
+      continue;
+    }
+
+    numCompared++;
+    if(r.psnr < base->psnr - tolerances.maxPSNRDrop) {
+      fprintf(stdout, "REGRESSION: %s %s PSNR dropped from %.2f dB to %.2f dB (limit %.2f dB)\n",
+              r.codec.c_str(), r.image.c_str(), base->psnr, r.psnr,
+              tolerances.maxPSNRDrop);
+      numRegressions++;
+    }
+  }
+
+  std::vector<SSlowdown> slowdowns;
+  if(bCompareTimes) {
+    ComputeSlowdowns(results, baseline, slowdowns);
+  }
+
+  for(size_t i = 0; i < slowdowns.size(); i++) {
+    const SSlowdown &s = slowdowns[i];
+    const double slowdown = s.GetSlowdown();
+    const double limit = s.GetLimit(tolerances);
+    const bool bRegressed = slowdown > limit;
+    fprintf(stdout, "%s%s %s takes %.2fx the baseline time over %u image%s (limit %.2fx)\n",
+            bRegressed? "REGRESSION: " : "", s.codec.c_str(), s.what, slowdown,
+            s.count, (s.count == 1)? "" : "s", limit);
+    if(bRegressed) {
+      numRegressions++;
+    }
+  }
+
+  fprintf(stdout, "Compared %u results against the baseline: %u regression%s\n",
+          numCompared, numRegressions, (numRegressions == 1)? "" : "s");
+  return numRegressions;
+}
@@ -0,0 +1,105 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _BENCHMARKS_BASELINE_H_
+#define _BENCHMARKS_BASELINE_H_
+
+#include <string>
+#include <vector>
+
+#include "BenchmarkResult.h"
+
+// The kind of build that results were measured with. Timings from builds
+// that differ in any of these can't be compared with each other.
+struct SBuildInfo {
+  // The CMake build type, such as "Release", or "None" if there wasn't one.
+  std::string buildType;
+
+  // The compiler and its version, such as "GNU 12.2.0".
+  std::string compiler;
+
+  // The flags that every C++ file was compiled with.
+  std::string cxxFlags;
+
+  // The newest SSE instructions that the BPTC encoder was built to use, or
+  // "none".
+  std::string sse;
+};
+
+inline bool operator==(const SBuildInfo &a, const SBuildInfo &b) {
+  return a.buildType == b.buildType && a.compiler == b.compiler &&
+    a.cxxFlags == b.cxxFlags && a.sse == b.sse;
+}
+
+// A set of results to compare new results against. Baselines are just the
+// JSON files written by FasTCBenchmarks --json, so regenerating one is a
+// matter of running the benchmarks again.
+struct SBaseline {
+  // The encoder settings that the baseline was recorded with. Results are
+  // only comparable if they were measured with the same settings.
+  int quality;
+  int numThreads;
+
+  // Empty if the baseline doesn't say what kind of build it came from.
+  SBuildInfo build;
+
+  std::vector<SResult> results;
+
+  SBaseline() : quality(-1), numThreads(-1) { }
+};
+
+// How much worse than the baseline a result may be before it counts as a
+// regression.
+struct SGateTolerances {
+  // The fraction by which the encodes or decodes of a codec may be slower
+  // than the baseline. Each image compares its fastest time divided by its
+  // calibration time, and the geometric mean over the images of the codec
+  // is compared with the tolerance. The tolerance is on top of the noise of
+  // the measurements: 0.2 allows a codec to be up to 20% slower than the
+  // baseline plus however far apart its repeated measurements were.
+  double maxSlowdown;
+
+  // How many dB the PSNR may drop below the baseline.
+  double maxPSNRDrop;
+
+  SGateTolerances() : maxSlowdown(0.2), maxPSNRDrop(0.1) { }
+};
+
+// Reads a baseline written by FasTCBenchmarks --json. Returns false and
+// prints a message if the file can't be read or parsed.
+extern bool ReadBaseline(const char *filename, SBaseline *out);
+
+// Compares each result with the baseline result of the same codec and
+// image, and prints the slowdown of each codec along with every regression.
+// Results without a baseline are reported but don't count as regressions.
+// If bCompareTimes is false, only the PSNR is compared, which is what to do
+// when the baseline came from a different kind of build. Returns the number
+// of regressions found.
+extern uint32 CompareWithBaseline(const std::vector<SResult> &results,
+                                  const SBaseline &baseline,
+                                  const SGateTolerances &tolerances,
+                                  bool bCompareTimes);
+
+// Finds the codecs whose encodes or decodes are slower than the baseline
+// allows, without printing anything. These are worth measuring again before
+// they are reported, in case something else slowed the machine down.
+extern void FindSlowCodecs(const std::vector<SResult> &results,
+                           const SBaseline &baseline,
+                           const SGateTolerances &tolerances,
+                           std::vector<std::string> &slowCodecs);
+
+#endif  // _BENCHMARKS_BASELINE_H_
@@ -0,0 +1,64 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _BENCHMARKS_BENCHMARK_RESULT_H_
+#define _BENCHMARKS_BENCHMARK_RESULT_H_
+
+#include <string>
+
+#include "FasTC/TexCompTypes.h"
+
+// The measurements of one codec on one image. The codec and image together
+// identify the result, which is how results are matched with a baseline.
+struct SResult {
+  std::string codec;
+  std::string image;
+  uint32 width;
+  uint32 height;
+
+  // Median times of a single encode and decode. The encode times are
+  // negative for codecs that are only measured decoding.
+  double encodeMS;
+  double decodeMS;
+
+  // The fastest times of a single encode and decode.
+  double encodeMinMS;
+  double decodeMinMS;
+
+  double psnr;
+  double ssim;
+
+  // The fastest time of one run of the calibration kernel (see
+  // Calibration.h), which is run in between the encodes and decodes so
+  // that it sees the machine in the same state.
+  double calibrationMS;
+
+  // The fastest encode and decode times divided by the fastest calibration
+  // time. Noise only ever makes things slower, so these are what get
+  // compared against a baseline. When the result was measured more than
+  // once, these are the best of the measurements.
+  double encodeRelative;
+  double decodeRelative;
+
+  // How far apart the relative times of repeated measurements of the result
+  // were, as the fraction by which the slowest exceeded the fastest. This is
+  // zero if the result was only measured once.
+  double encodeNoise;
+  double decodeNoise;
+};
+
+#endif  // _BENCHMARKS_BENCHMARK_RESULT_H_
@@ -0,0 +1,1016 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+// FasTCBenchmarks measures the speed and quality of every encoder and decoder
+// on the images listed in a corpus manifest and on a set of synthetic images
+// of different sizes and content, and reports both side by side.
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "FasTC/BPTCConfig.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/Image.h"
+#include "FasTC/ImageFile.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/StopWatch.h"
+#include "FasTC/TexComp.h"
+
+#include "Baseline.h"
+#include "BenchmarkConfig.h"
+#include "BenchmarkResult.h"
+#include "Calibration.h"
+#include "SyntheticImages.h"
+
+// The most times that a single measurement repeats an operation, which
+// keeps operations that take no time at all from repeating forever.
+static const uint32 kMaxRepeats = 1 << 20;
+
+// Samples that come out shorter than the minimum, because the machine sped
+// up after the repeat count was chosen, are measured again with more
+// repeats. This many are allowed before giving up.
+static const uint32 kMaxShortSamples = 8;
+
+// Identical images have an infinite PSNR, which is reported as this instead
+// so that the results stay comparable and valid JSON.
+static const double kMaxPSNR = 99.0;
+
+// What the benchmarks exit with when their timings couldn't be compared with
+// the baseline. CTest reports the test as skipped rather than passed.
+static const int kSkippedExitCode = 77;
+
+struct SCodec {
+  const char *name;
+  FasTC::ECompressionFormat format;
+  bool bUseSIMD;
+};
+
+static const SCodec kCodecs[] = {
+  { "BPTC", FasTC::eCompressionFormat_BPTC, false },
+  { "BPTC-SIMD", FasTC::eCompressionFormat_BPTC, true },
+  { "DXT1", FasTC::eCompressionFormat_DXT1, false },
+  { "DXT5", FasTC::eCompressionFormat_DXT5, false },
+  { "ETC1", FasTC::eCompressionFormat_ETC1, false },
+  { "PVRTC4", FasTC::eCompressionFormat_PVRTC4, false },
+};
+static const size_t kNumCodecs = sizeof(kCodecs) / sizeof(kCodecs[0]);
+
+struct SBenchmarkOptions {
+  std::string corpusManifest;
+  std::vector<uint32> sizes;
+  std::vector<std::string> codecs;
+  uint32 numWarmups;
+  uint32 numIterations;
+  int quality;
+  int numThreads;
+  double minSampleMS;
+  uint32 numRuns;
+  uint32 numRetries;
+  const char *jsonFile;
+  const char *baselineFile;
+  SGateTolerances tolerances;
+
+  SBenchmarkOptions()
+    : numWarmups(1)
+    , numIterations(5)
+    , quality(50)
+    , numThreads(1)
+    , minSampleMS(20.0)
+    , numRuns(1)
+    , numRetries(2)
+    , jsonFile(NULL)
+    , baselineFile(NULL)
+  { }
+};
+
+// An uncompressed image that every encoder is run on.
+struct SSourceImage {
+  std::string name;
+  FasTC::RGBA8Image pixels;
+};
+
+// A compressed image from the corpus that is only decoded, along with the
+// image that it is expected to decode to.
+struct SDecodeImage {
+  std::string name;
+  std::string compressedPath;
+  std::string referencePath;
+};
+
+static void PrintUsage() {
+  fprintf(stderr, "Usage: FasTCBenchmarks [OPTIONS]\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "\t--corpus <file>\tBenchmark the images listed in this manifest.\n");
+  fprintf(stderr, "\t--sizes <n,...>\tSizes of the square synthetic images. Each one must be a multiple of four. Default: 64,256\n");
+  fprintf(stderr, "\t--codecs <c,...>\tOnly run these codecs. One or more of BPTC, BPTC-SIMD, DXT1, DXT5, ETC1, PVRTC4 and ASTC. Default: all\n");
+  fprintf(stderr, "\t--warmup <num>\tRuns of each codec that aren't measured. At least one is always done. Default: 1\n");
+  fprintf(stderr, "\t--iterations <num>\tMeasured runs of each codec. The median is reported. Default: 5\n");
+  fprintf(stderr, "\t--quality <num>\tQuality setting of the encoders that have one. Default: 50\n");
+  fprintf(stderr, "\t--threads <num>\tThreads used by each encoder. Default: 1\n");
+  fprintf(stderr, "\t--min-sample <ms>\tRepeat encodes and decodes until each measurement takes at least this long. Default: 20\n");
+  fprintf(stderr, "\t--runs <num>\tMeasure everything this many times, keeping the best times and recording how far apart they were. Default: 1\n");
+  fprintf(stderr, "\t--retries <num>\tMeasure codecs that are slower than the baseline up to this many more times before calling them regressions. Default: 2\n");
+  fprintf(stderr, "\t--json <file>\tAlso write the results to this JSON file. The file can be used as a baseline.\n");
+  fprintf(stderr, "\t--baseline <file>\tFail if any result regressed compared to this JSON file. If the file came from a different kind of build, only the PSNR is compared and the exit code is 77.\n");
+  fprintf(stderr, "\t--max-slowdown <frac>\tFraction by which results may be slower than the baseline, relative to the calibration kernel, on top of the noise recorded in the baseline. Default: 0.2\n");
+  fprintf(stderr, "\t--max-psnr-drop <dB>\tHow much the PSNR may drop below the baseline. Default: 0.1\n");
+}
+
+static bool ParseUInts(const char *str, std::vector<uint32> &out) {
+  out.clear();
+  const char *c = str;
+  while(*c) {
+    char *end = NULL;
+    long v = strtol(c, &end, 10);
+    if(end == c || v <= 0) {
+      return false;
+    }
+    out.push_back(static_cast<uint32>(v));
+
+    c = end;
+    if(*c == ',') {
+      c++;
+    } else if(*c) {
+      return false;
+    }
+  }
+  return !out.empty();
+}
+
+static void ParseNames(const char *str, std::vector<std::string> &out) {
+  out.clear();
+  std::string s(str);
+  size_t start = 0;
+  while(start <= s.size()) {
+    size_t end = s.find(',', start);
+    if(end == std::string::npos) {
+      end = s.size();
+    }
+    if(end > start) {
+      out.push_back(s.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+}
+
+static bool IsCodecEnabled(const SBenchmarkOptions &opts, const char *name) {
+  if(opts.codecs.empty()) {
+    return true;
+  }
+  return std::find(opts.codecs.begin(), opts.codecs.end(), std::string(name))
+    != opts.codecs.end();
+}
+
+static bool IsPowerOfTwo(uint32 x) {
+  return x && !(x & (x - 1));
+}
+
+static double Median(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[(samples.size() - 1) / 2];
+}
+
+// Something whose speed the benchmarks measure.
+class TimedOperation {
+ public:
+  virtual ~TimedOperation() { }
+
+  // Performs the operation numRepeats times and returns how long that took
+  // in milliseconds, or a negative number if it failed.
+  virtual double Run(uint32 numRepeats) = 0;
+};
+
+class CalibrationOperation : public TimedOperation {
+ public:
+  virtual double Run(uint32 numRepeats) { return TimeCalibrationKernel(numRepeats); }
+};
+
+// The times of one operation, along with those of the calibration kernel
+// taken in between its samples.
+struct STiming {
+  double medianMS;
+  double minMS;
+  double calibrationMS;
+  double relative;
+};
+
+// Finds how many times op has to be repeated for a run to take at least
+// minSampleMS. Timings any shorter than a few milliseconds are mostly timer
+// resolution and noise. This counts as one warmup run.
+static bool FindNumRepeats(TimedOperation &op, double minSampleMS, uint32 *numRepeats) {
+  uint32 n = 1;
+  for(;;) {
+    const double ms = op.Run(n);
+    if(ms < 0.0) {
+      return false;
+    }
+
+    if(ms >= minSampleMS || n >= kMaxRepeats) {
+      *numRepeats = n;
+      return true;
+    }
+
+    // Aim a little past the minimum, since the first runs are often slow.
+    const double scale = (ms > 0.0)? 1.25 * minSampleMS / ms : 1000.0;
+    n = static_cast<uint32>(std::min<double>(kMaxRepeats, std::max(2.0, scale) * n));
+  }
+}
+
+// Takes a sample of op, which is only kept if it took at least minSampleMS.
+// Otherwise the repeat count goes up and the sample is taken again.
+static double Sample(TimedOperation &op, double minSampleMS, uint32 *numRepeats) {
+  for(uint32 i = 0; ; i++) {
+    const double ms = op.Run(*numRepeats);
+    if(ms < 0.0 || ms >= minSampleMS || *numRepeats >= kMaxRepeats ||
+       i >= kMaxShortSamples) {
+      return (ms < 0.0)? ms : ms / *numRepeats;
+    }
+    *numRepeats = std::min(2 * *numRepeats, kMaxRepeats);
+  }
+}
+
+// Measures op after the warmup runs, interleaving its samples with samples
+// of the calibration kernel so that both see the machine in the same state.
+static bool Measure(TimedOperation &op, const SBenchmarkOptions &opts, STiming *out) {
+  CalibrationOperation calibration;
+  uint32 numRepeats, numCalibrationRepeats;
+  if(!FindNumRepeats(op, opts.minSampleMS, &numRepeats) ||
+     !FindNumRepeats(calibration, opts.minSampleMS, &numCalibrationRepeats)) {
+    return false;
+  }
+
+  for(uint32 i = 1; i < opts.numWarmups; i++) {
+    if(op.Run(numRepeats) < 0.0) {
+      return false;
+    }
+  }
+
+  std::vector<double> samples;
+  std::vector<double> calibrationSamples;
+  calibrationSamples.push_back(Sample(calibration, opts.minSampleMS, &numCalibrationRepeats));
+  for(uint32 i = 0; i < opts.numIterations; i++) {
+    const double ms = Sample(op, opts.minSampleMS, &numRepeats);
+    if(ms < 0.0) {
+      return false;
+    }
+    samples.push_back(ms);
+    calibrationSamples.push_back(Sample(calibration, opts.minSampleMS, &numCalibrationRepeats));
+  }
+
+  out->medianMS = Median(samples);
+  out->minMS = *std::min_element(samples.begin(), samples.end());
+  out->calibrationMS = *std::min_element(calibrationSamples.begin(), calibrationSamples.end());
+  out->relative = out->minMS / out->calibrationMS;
+  return true;
+}
+
+class EncodeOperation : public TimedOperation {
+ public:
+  EncodeOperation(const FasTC::RGBA8Image &pixels, const SCompressionSettings &settings)
+    : m_Pixels(pixels), m_Settings(settings), m_Result(NULL) { }
+  virtual ~EncodeOperation() { delete m_Result; }
+
+  // CompressImage times the compressions by themselves, leaving out the
+  // allocation and copying around them.
+  virtual double Run(uint32 numRepeats) {
+    delete m_Result;
+
+    double ms = 0.0;
+    m_Settings.iNumCompressions = numRepeats;
+    m_Result = CompressImage(&m_Pixels, m_Settings, &ms);
+    return m_Result? ms * numRepeats : -1.0;
+  }
+
+  // The image that the last run compressed to.
+  const CompressedImage *GetResult() const { return m_Result; }
+
+ private:
+  const FasTC::RGBA8Image &m_Pixels;
+  SCompressionSettings m_Settings;
+  CompressedImage *m_Result;
+};
+
+class DecodeOperation : public TimedOperation {
+ public:
+  explicit DecodeOperation(const CompressedImage &ci) : m_Image(ci) { }
+
+  virtual double Run(uint32 numRepeats) {
+    StopWatch sw;
+    sw.Start();
+    for(uint32 i = 0; i < numRepeats; i++) {
+      if(!m_Image.DecompressImage(&m_Decoded)) {
+        return -1.0;
+      }
+    }
+    sw.Stop();
+    return sw.TimeInMilliseconds();
+  }
+
+  const FasTC::RGBA8Image &GetDecoded() const { return m_Decoded; }
+
+ private:
+  const CompressedImage &m_Image;
+  FasTC::RGBA8Image m_Decoded;
+};
+
+static double MegapixelsPerSecond(uint32 w, uint32 h, double ms) {
+  if(ms <= 0.0) {
+    return 0.0;
+  }
+  return (static_cast<double>(w) * h / 1e6) / (ms / 1000.0);
+}
+
+// Crops img to a whole number of 4x4 blocks, so that the decoded image lines
+// up with the original without any padding.
+static void CropToBlocks(FasTC::RGBA8Image &img) {
+  const uint32 w = img.GetWidth() & ~3;
+  const uint32 h = img.GetHeight() & ~3;
+  if(w == img.GetWidth() && h == img.GetHeight()) {
+    return;
+  }
+
+  FasTC::RGBA8Image cropped(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    memcpy(cropped.GetRow(j), img.GetRow(j), cropped.GetRowSize());
+  }
+  img.Swap(cropped);
+}
+
+static void StoreQuality(const FasTC::ImageMetrics &metrics, SResult &result) {
+  result.psnr = std::min(metrics.m_PSNR, kMaxPSNR);
+  result.ssim = metrics.m_SSIM;
+}
+
+// Reads the corpus manifest. Every line that isn't blank or a comment is
+// one of
+//
+//   image <name> <file>
+//   decode <name> <compressed file> <expected decoded file>
+//
+// where the files are relative to the directory of the manifest.
+static bool LoadCorpus(const std::string &manifest,
+                       std::vector<SSourceImage> &sources,
+                       std::vector<SDecodeImage> &decodes) {
+  FILE *f = fopen(manifest.c_str(), "r");
+  if(NULL == f) {
+    fprintf(stderr, "Unable to open corpus manifest: %s\n", manifest.c_str());
+    return false;
+  }
+
+  std::string dir;
+  const size_t slash = manifest.find_last_of("/\\");
+  if(slash != std::string::npos) {
+    dir = manifest.substr(0, slash + 1);
+  }
+
+  bool ok = true;
+  char line[1024];
+  uint32 lineNum = 0;
+  while(ok && fgets(line, sizeof(line), f)) {
+    lineNum++;
+
+    char kind[32], name[256], path[512], reference[512];
+    const int n = sscanf(line, "%31s %255s %511s %511s", kind, name, path, reference);
+    if(n <= 0 || kind[0] == '#') {
+      continue;
+    }
+
+    if(n == 3 && strcmp(kind, "image") == 0) {
+      ImageFile file((dir + path).c_str());
+      if(!file.LoadRGBA8()) {
+        fprintf(stderr, "Unable to load corpus image: %s\n", (dir + path).c_str());
+        ok = false;
+        break;
+      }
+
+      SSourceImage src;
+      src.name = name;
+      sources.push_back(src);
+      sources.back().pixels = *file.GetRGBA8Image();
+      CropToBlocks(sources.back().pixels);
+    } else if(n == 4 && strcmp(kind, "decode") == 0) {
+      SDecodeImage dec;
+      dec.name = name;
+      dec.compressedPath = dir + path;
+      dec.referencePath = dir + reference;
+      decodes.push_back(dec);
+    } else {
+      fprintf(stderr, "%s:%u: malformed corpus entry\n", manifest.c_str(), lineNum);
+      ok = false;
+    }
+  }
+
+  fclose(f);
+  return ok;
+}
+
+// The name that decode only results are reported under. Every ASTC block
+// size is reported as the same codec.
+static const char *GetDecodeCodecName(FasTC::ECompressionFormat format) {
+  if(format >= FasTC::COMPRESSION_FORMAT_ASTC_BEGIN &&
+     format <= FasTC::COMPRESSION_FORMAT_ASTC_END) {
+    return "ASTC";
+  }
+
+  for(size_t i = 0; i < kNumCodecs; i++) {
+    if(kCodecs[i].format == format && !kCodecs[i].bUseSIMD) {
+      return kCodecs[i].name;
+    }
+  }
+  return "Unknown";
+}
+
+static void StoreEncodeTiming(const STiming &timing, SResult &result) {
+  result.encodeMS = timing.medianMS;
+  result.encodeMinMS = timing.minMS;
+  result.encodeRelative = timing.relative;
+  result.encodeNoise = 0.0;
+}
+
+static void StoreDecodeTiming(const STiming &timing, SResult &result) {
+  result.decodeMS = timing.medianMS;
+  result.decodeMinMS = timing.minMS;
+  result.decodeRelative = timing.relative;
+  result.decodeNoise = 0.0;
+}
+
+static bool BenchmarkEncoder(const SCodec &codec, const SSourceImage &src,
+                             const SBenchmarkOptions &opts, SResult &result) {
+  const uint32 w = src.pixels.GetWidth();
+  const uint32 h = src.pixels.GetHeight();
+
+  SCompressionSettings settings;
+  settings.format = codec.format;
+  settings.bUseSIMD = codec.bUseSIMD;
+  settings.iQuality = opts.quality;
+  settings.iNumThreads = opts.numThreads;
+
+  EncodeOperation encode(src.pixels, settings);
+  STiming encodeTiming;
+  if(!Measure(encode, opts, &encodeTiming)) {
+    fprintf(stderr, "%s failed to compress %s\n", codec.name, src.name.c_str());
+    return false;
+  }
+
+  DecodeOperation decode(*encode.GetResult());
+  STiming decodeTiming;
+  if(!Measure(decode, opts, &decodeTiming)) {
+    fprintf(stderr, "%s failed to decompress %s\n", codec.name, src.name.c_str());
+    return false;
+  }
+
+  const FasTC::RGBA8Image &decoded = decode.GetDecoded();
+  FasTC::Image<> original(w, h, reinterpret_cast<const uint32 *>(src.pixels.GetData()));
+  FasTC::Image<> roundTrip(w, h, reinterpret_cast<const uint32 *>(decoded.GetData()));
+  FasTC::ImageMetrics metrics;
+  if(!original.ComputeMetrics(&roundTrip, &metrics)) {
+    fprintf(stderr, "Unable to compare %s to its %s encoding\n", src.name.c_str(), codec.name);
+    return false;
+  }
+
+  result.codec = codec.name;
+  result.image = src.name;
+  result.width = w;
+  result.height = h;
+  StoreEncodeTiming(encodeTiming, result);
+  StoreDecodeTiming(decodeTiming, result);
+  result.calibrationMS = std::min(encodeTiming.calibrationMS, decodeTiming.calibrationMS);
+  StoreQuality(metrics, result);
+  return true;
+}
+
+// Sets bSkipped if the codec of the image wasn't requested.
+static bool BenchmarkDecoder(const SDecodeImage &dec,
+                             const SBenchmarkOptions &opts, SResult &result,
+                             bool &bSkipped) {
+  bSkipped = false;
+
+  ImageFile compressed(dec.compressedPath.c_str());
+  ImageFile reference(dec.referencePath.c_str());
+  if(!compressed.Load() || !reference.Load()) {
+    fprintf(stderr, "Unable to load %s or %s\n",
+            dec.compressedPath.c_str(), dec.referencePath.c_str());
+    return false;
+  }
+
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(compressed.GetImage());
+  if(NULL == ci) {
+    fprintf(stderr, "Not a compressed image: %s\n", dec.compressedPath.c_str());
+    return false;
+  }
+
+  result.codec = GetDecodeCodecName(ci->GetFormat());
+  if(!IsCodecEnabled(opts, result.codec.c_str())) {
+    bSkipped = true;
+    return true;
+  }
+
+  DecodeOperation decode(*ci);
+  STiming timing;
+  if(!Measure(decode, opts, &timing)) {
+    fprintf(stderr, "Failed to decompress %s\n", dec.compressedPath.c_str());
+    return false;
+  }
+
+  FasTC::ImageMetrics metrics;
+  if(!compressed.GetImage()->ComputeMetrics(reference.GetImage(), &metrics)) {
+    fprintf(stderr, "%s doesn't match the size of %s\n",
+            dec.compressedPath.c_str(), dec.referencePath.c_str());
+    return false;
+  }
+
+  result.image = dec.name;
+  result.width = ci->GetWidth();
+  result.height = ci->GetHeight();
+  result.encodeMS = -1.0;
+  result.encodeMinMS = -1.0;
+  result.encodeRelative = -1.0;
+  result.encodeNoise = 0.0;
+  StoreDecodeTiming(timing, result);
+  result.calibrationMS = timing.calibrationMS;
+  StoreQuality(metrics, result);
+  return true;
+}
+
+static void PrintResult(const SResult &r) {
+  char size[32];
+  sprintf(size, "%ux%u", r.width, r.height);
+
+  if(r.encodeMS >= 0.0) {
+    fprintf(stdout, "%-10s %-16s %-10s %10.3f %10.3f",
+            r.codec.c_str(), r.image.c_str(), size, r.encodeMS,
+            MegapixelsPerSecond(r.width, r.height, r.encodeMS));
+  } else {
+    fprintf(stdout, "%-10s %-16s %-10s %10s %10s",
+            r.codec.c_str(), r.image.c_str(), size, "-", "-");
+  }
+
+  fprintf(stdout, " %10.3f %10.3f %10.2f %8.4f\n",
+          r.decodeMS, MegapixelsPerSecond(r.width, r.height, r.decodeMS),
+          r.psnr, r.ssim);
+  fflush(stdout);
+}
+
+static void PrintHeader() {
+  fprintf(stdout, "%-10s %-16s %-10s %10s %10s %10s %10s %10s %8s\n",
+          "Codec", "Image", "Size", "Enc (ms)", "Enc MP/s",
+          "Dec (ms)", "Dec MP/s", "PSNR (dB)", "SSIM");
+}
+
+// Measures every enabled codec on every source image, and decodes every
+// compressed corpus image of an enabled codec.
+static bool RunBenchmarks(const SBenchmarkOptions &opts,
+                          const std::vector<SSourceImage> &sources,
+                          const std::vector<SDecodeImage> &decodes,
+                          std::vector<SResult> &results) {
+  PrintHeader();
+
+  bool ok = true;
+  for(size_t c = 0; c < kNumCodecs; c++) {
+    const SCodec &codec = kCodecs[c];
+    if(!IsCodecEnabled(opts, codec.name)) {
+      continue;
+    }
+
+#ifndef HAS_SSE_41
+    if(codec.bUseSIMD) {
+      fprintf(stdout, "%-10s skipped: FasTC was built without SSE4.1\n", codec.name);
+      continue;
+    }
+#endif
+
+    for(size_t i = 0; i < sources.size(); i++) {
+      const SSourceImage &src = sources[i];
+
+      // PVRTC only supports square power of two images.
+      if(codec.format == FasTC::eCompressionFormat_PVRTC4 &&
+         (src.pixels.GetWidth() != src.pixels.GetHeight() ||
+          !IsPowerOfTwo(src.pixels.GetWidth()))) {
+        continue;
+      }
+
+      SResult r;
+      if(!BenchmarkEncoder(codec, src, opts, r)) {
+        ok = false;
+        continue;
+      }
+      PrintResult(r);
+      results.push_back(r);
+    }
+  }
+
+  for(size_t i = 0; i < decodes.size(); i++) {
+    SResult r;
+    bool bSkipped;
+    if(!BenchmarkDecoder(decodes[i], opts, r, bSkipped)) {
+      ok = false;
+      continue;
+    }
+    if(bSkipped) {
+      continue;
+    }
+
+    PrintResult(r);
+    results.push_back(r);
+  }
+
+  return ok;
+}
+
+static const SResult *FindResult(const std::vector<SResult> &results,
+                                 const SResult &r) {
+  for(size_t i = 0; i < results.size(); i++) {
+    if(results[i].codec == r.codec && results[i].image == r.image) {
+      return &results[i];
+    }
+  }
+  return NULL;
+}
+
+// Picks the run whose relative time is the median, and records how far
+// apart the runs were as the noise of the operation.
+static size_t CombineTimings(const std::vector<double> &relatives, double &noise) {
+  std::vector<double> sorted = relatives;
+  std::sort(sorted.begin(), sorted.end());
+  noise = (sorted.front() > 0.0)? sorted.back() / sorted.front() - 1.0 : 0.0;
+
+  const double median = sorted[(sorted.size() - 1) / 2];
+  return std::find(relatives.begin(), relatives.end(), median) - relatives.begin();
+}
+
+// Combines the results of several runs. Each result gets the times of its
+// median run, which is what a single run typically measures, so a later
+// single run can be compared with them without a bias in either direction.
+static void CombineRuns(const std::vector<std::vector<SResult> > &runs,
+                        std::vector<SResult> &results) {
+  results.clear();
+  for(size_t i = 0; i < runs[0].size(); i++) {
+    const SResult &first = runs[0][i];
+
+    std::vector<const SResult *> measured;
+    std::vector<double> encodeRelatives, decodeRelatives;
+    for(size_t run = 0; run < runs.size(); run++) {
+      const SResult *r = FindResult(runs[run], first);
+      if(r) {
+        measured.push_back(r);
+        encodeRelatives.push_back(r->encodeRelative);
+        decodeRelatives.push_back(r->decodeRelative);
+      }
+    }
+
+    double encodeNoise, decodeNoise;
+    const SResult &encodeRun = *measured[CombineTimings(encodeRelatives, encodeNoise)];
+    const SResult &decodeRun = *measured[CombineTimings(decodeRelatives, decodeNoise)];
+
+    SResult r = first;
+    r.encodeMS = encodeRun.encodeMS;
+    r.encodeMinMS = encodeRun.encodeMinMS;
+    r.encodeRelative = encodeRun.encodeRelative;
+    r.encodeNoise = (r.encodeMS >= 0.0)? encodeNoise : 0.0;
+    r.decodeMS = decodeRun.decodeMS;
+    r.decodeMinMS = decodeRun.decodeMinMS;
+    r.decodeRelative = decodeRun.decodeRelative;
+    r.decodeNoise = decodeNoise;
+    r.calibrationMS = std::min(encodeRun.calibrationMS, decodeRun.calibrationMS);
+    results.push_back(r);
+  }
+}
+
+// Combines the relative times of two measurements of the same operation,
+// keeping the fastest and widening the noise to cover both.
+static void MergeTiming(double &relative, double &noise,
+                        double otherRelative, double otherNoise) {
+  if(relative <= 0.0 || otherRelative <= 0.0) {
+    return;
+  }
+
+  const double fastest = std::min(relative, otherRelative);
+  const double slowest = std::max(relative * (1.0 + noise),
+                                  otherRelative * (1.0 + otherNoise));
+  relative = fastest;
+  noise = slowest / fastest - 1.0;
+}
+
+// Merges the results of measuring slow codecs again into the results. The
+// times of the fastest measurement are kept, since a codec that is fast
+// again wasn't what slowed down.
+static void MergeRetry(std::vector<SResult> &results,
+                       const std::vector<SResult> &retry) {
+  for(size_t i = 0; i < retry.size(); i++) {
+    const SResult &o = retry[i];
+    SResult *r = NULL;
+    for(size_t j = 0; j < results.size(); j++) {
+      if(results[j].codec == o.codec && results[j].image == o.image) {
+        r = &results[j];
+        break;
+      }
+    }
+
+    if(NULL == r) {
+      results.push_back(o);
+      continue;
+    }
+
+    SResult merged = *r;
+    if(o.encodeRelative > 0.0 && o.encodeRelative < r->encodeRelative) {
+      merged.encodeMS = o.encodeMS;
+      merged.encodeMinMS = o.encodeMinMS;
+    }
+    if(o.decodeRelative > 0.0 && o.decodeRelative < r->decodeRelative) {
+      merged.decodeMS = o.decodeMS;
+      merged.decodeMinMS = o.decodeMinMS;
+    }
+    merged.calibrationMS = std::min(r->calibrationMS, o.calibrationMS);
+    MergeTiming(merged.encodeRelative, merged.encodeNoise, o.encodeRelative, o.encodeNoise);
+    MergeTiming(merged.decodeRelative, merged.decodeNoise, o.decodeRelative, o.decodeNoise);
+    *r = merged;
+  }
+}
+
+static SBuildInfo GetBuildInfo() {
+  SBuildInfo build;
+  build.buildType = FASTC_BENCHMARK_BUILD_TYPE;
+  build.compiler = FASTC_BENCHMARK_COMPILER;
+  build.cxxFlags = FASTC_BENCHMARK_CXX_FLAGS;
+#if defined(HAS_SSE_POPCNT)
+  build.sse = "sse4.2";
+#elif defined(HAS_SSE_41)
+  build.sse = "sse4.1";
+#else
+  build.sse = "none";
+#endif
+  return build;
+}
+
+static void PrintBuildInfo(FILE *f, const SBuildInfo &build) {
+  fprintf(f, "build type %s, compiler %s, flags \"%s\", SSE %s",
+          build.buildType.c_str(), build.compiler.c_str(),
+          build.cxxFlags.c_str(), build.sse.c_str());
+}
+
+static void WriteJSONString(FILE *f, const std::string &str) {
+  fputc('"', f);
+  for(size_t i = 0; i < str.size(); i++) {
+    if(str[i] == '"' || str[i] == '\\') {
+      fputc('\\', f);
+    }
+    fputc(str[i], f);
+  }
+  fputc('"', f);
+}
+
+static bool WriteJSON(const char *filename, const SBenchmarkOptions &opts,
+                      const std::vector<SResult> &results) {
+  FILE *f = fopen(filename, "w");
+  if(NULL == f) {
+    fprintf(stderr, "Unable to open %s for writing\n", filename);
+    return false;
+  }
+
+  fprintf(f, "{\n");
+  fprintf(f, "  \"warmups\": %u,\n", opts.numWarmups);
+  fprintf(f, "  \"iterations\": %u,\n", opts.numIterations);
+  fprintf(f, "  \"runs\": %u,\n", opts.numRuns);
+  fprintf(f, "  \"quality\": %d,\n", opts.quality);
+  fprintf(f, "  \"threads\": %d,\n", opts.numThreads);
+
+  const SBuildInfo build = GetBuildInfo();
+  fprintf(f, "  \"build\": { \"type\": ");
+  WriteJSONString(f, build.buildType);
+  fprintf(f, ", \"compiler\": ");
+  WriteJSONString(f, build.compiler);
+  fprintf(f, ", \"cxx_flags\": ");
+  WriteJSONString(f, build.cxxFlags);
+  fprintf(f, ", \"sse\": ");
+  WriteJSONString(f, build.sse);
+  fprintf(f, " },\n");
+
+  fprintf(f, "  \"results\": [\n");
+  for(size_t i = 0; i < results.size(); i++) {
+    const SResult &r = results[i];
+
+    // Codec and image names never need escaping.
+    fprintf(f, "    { \"codec\": \"%s\", \"image\": \"%s\", \"width\": %u, \"height\": %u, ",
+            r.codec.c_str(), r.image.c_str(), r.width, r.height);
+    if(r.encodeMS >= 0.0) {
+      fprintf(f, "\"encode_ms\": %.6f, \"encode_min_ms\": %.6f, \"encode_mpix_per_s\": %.6f, "
+                 "\"encode_rel\": %.6f, \"encode_noise\": %.6f, ",
+              r.encodeMS, r.encodeMinMS,
+              MegapixelsPerSecond(r.width, r.height, r.encodeMS),
+              r.encodeRelative, r.encodeNoise);
+    } else {
+      fprintf(f, "\"encode_ms\": null, \"encode_min_ms\": null, \"encode_mpix_per_s\": null, "
+                 "\"encode_rel\": null, \"encode_noise\": null, ");
+    }
+    fprintf(f, "\"decode_ms\": %.6f, \"decode_min_ms\": %.6f, \"decode_mpix_per_s\": %.6f, "
+               "\"decode_rel\": %.6f, \"decode_noise\": %.6f, "
+               "\"psnr\": %.4f, \"ssim\": %.6f, \"calibration_ms\": %.6f }%s\n",
+            r.decodeMS, r.decodeMinMS,
+            MegapixelsPerSecond(r.width, r.height, r.decodeMS),
+            r.decodeRelative, r.decodeNoise,
+            r.psnr, r.ssim, r.calibrationMS, (i + 1 < results.size())? "," : "");
+  }
+  fprintf(f, "  ]\n");
+  fprintf(f, "}\n");
+
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  SBenchmarkOptions opts;
+  opts.sizes.push_back(64);
+  opts.sizes.push_back(256);
+
+  for(int i = 1; i < argc; i++) {
+    const bool bHasArg = i + 1 < argc;
+    if(strcmp(argv[i], "--corpus") == 0 && bHasArg) {
+      opts.corpusManifest = argv[++i];
+    } else if(strcmp(argv[i], "--sizes") == 0 && bHasArg) {
+      if(!ParseUInts(argv[++i], opts.sizes)) {
+        PrintUsage();
+        return 1;
+      }
+    } else if(strcmp(argv[i], "--codecs") == 0 && bHasArg) {
+      ParseNames(argv[++i], opts.codecs);
+    } else if(strcmp(argv[i], "--warmup") == 0 && bHasArg) {
+      opts.numWarmups = static_cast<uint32>(atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--iterations") == 0 && bHasArg) {
+      opts.numIterations = static_cast<uint32>(atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--quality") == 0 && bHasArg) {
+      opts.quality = atoi(argv[++i]);
+    } else if(strcmp(argv[i], "--threads") == 0 && bHasArg) {
+      opts.numThreads = atoi(argv[++i]);
+    } else if(strcmp(argv[i], "--min-sample") == 0 && bHasArg) {
+      opts.minSampleMS = atof(argv[++i]);
+    } else if(strcmp(argv[i], "--runs") == 0 && bHasArg) {
+      opts.numRuns = static_cast<uint32>(atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--retries") == 0 && bHasArg) {
+      opts.numRetries = static_cast<uint32>(atoi(argv[++i]));
+    } else if(strcmp(argv[i], "--json") == 0 && bHasArg) {
+      opts.jsonFile = argv[++i];
+    } else if(strcmp(argv[i], "--baseline") == 0 && bHasArg) {
+      opts.baselineFile = argv[++i];
+    } else if(strcmp(argv[i], "--max-slowdown") == 0 && bHasArg) {
+      opts.tolerances.maxSlowdown = atof(argv[++i]);
+    } else if(strcmp(argv[i], "--max-psnr-drop") == 0 && bHasArg) {
+      opts.tolerances.maxPSNRDrop = atof(argv[++i]);
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  if(opts.numIterations == 0 || opts.numRuns == 0 || opts.numThreads <= 0 ||
+     opts.minSampleMS < 0.0) {
+    PrintUsage();
+    return 1;
+  }
+
+  for(size_t i = 0; i < opts.sizes.size(); i++) {
+    if(opts.sizes[i] % 4 != 0) {
+      fprintf(stderr, "Synthetic image sizes must be a multiple of four.\n");
+      return 1;
+    }
+  }
+
+  // Read the baseline up front, so that a bad baseline fails right away.
+  SBaseline baseline;
+  bool bCompareTimes = true;
+  if(opts.baselineFile) {
+    if(!ReadBaseline(opts.baselineFile, &baseline)) {
+      return 1;
+    }
+
+    if(baseline.quality != opts.quality || baseline.numThreads != opts.numThreads) {
+      fprintf(stderr, "The baseline was recorded with quality %d and %d threads, "
+                      "but the benchmarks use quality %d and %d threads.\n",
+              baseline.quality, baseline.numThreads, opts.quality, opts.numThreads);
+      return 1;
+    }
+
+    // Timings from an unoptimized build, or from another compiler, can't
+    // tell whether this build got slower.
+    if(!(baseline.build == GetBuildInfo())) {
+      bCompareTimes = false;
+      fprintf(stdout, "The baseline was recorded from a different build, so only the PSNR is compared.\n");
+      fprintf(stdout, "  Baseline: ");
+      if(baseline.build.buildType.empty()) {
+        fprintf(stdout, "unknown");
+      } else {
+        PrintBuildInfo(stdout, baseline.build);
+      }
+      fprintf(stdout, "\n  This build: ");
+      PrintBuildInfo(stdout, GetBuildInfo());
+      fprintf(stdout, "\n");
+
+      // The timings won't be used, so there's no point measuring them
+      // carefully. Unoptimized builds are slow enough as it is.
+      opts.numIterations = 1;
+      opts.minSampleMS = 0.0;
+      opts.numRuns = 1;
+    }
+  }
+
+  std::vector<SSourceImage> sources;
+  std::vector<SDecodeImage> decodes;
+  if(!opts.corpusManifest.empty() &&
+     !LoadCorpus(opts.corpusManifest, sources, decodes)) {
+    return 1;
+  }
+
+  for(size_t i = 0; i < opts.sizes.size(); i++) {
+    for(uint32 c = 0; c < kNumSyntheticContents; c++) {
+      const ESyntheticContent content = static_cast<ESyntheticContent>(c);
+
+      char name[64];
+      sprintf(name, "%s-%u", GetSyntheticContentName(content), opts.sizes[i]);
+
+      SSourceImage src;
+      src.name = name;
+      sources.push_back(src);
+      GenerateSyntheticImage(content, opts.sizes[i], opts.sizes[i],
+                             &sources.back().pixels);
+    }
+  }
+
+  bool ok = true;
+  bool bMerged = opts.numRuns > 1;
+  std::vector<std::vector<SResult> > runs(opts.numRuns);
+  for(uint32 run = 0; run < opts.numRuns; run++) {
+    if(opts.numRuns > 1) {
+      fprintf(stdout, "Run %u of %u\n", run + 1, opts.numRuns);
+    }
+    ok = RunBenchmarks(opts, sources, decodes, runs[run]) && ok;
+  }
+
+  std::vector<SResult> results;
+  CombineRuns(runs, results);
+
+  // Something else running on the machine can slow down a whole codec for
+  // a while. A regression has to show up again when the codec is measured
+  // again.
+  if(opts.baselineFile && bCompareTimes) {
+    for(uint32 retry = 0; retry < opts.numRetries; retry++) {
+      SBenchmarkOptions retryOpts = opts;
+      FindSlowCodecs(results, baseline, opts.tolerances, retryOpts.codecs);
+      if(retryOpts.codecs.empty()) {
+        break;
+      }
+
+      for(size_t i = 0; i < retryOpts.codecs.size(); i++) {
+        fprintf(stdout, "%s%s", (i == 0)? "Measuring again: " : ", ",
+                retryOpts.codecs[i].c_str());
+      }
+      fprintf(stdout, "\n");
+
+      std::vector<SResult> retryResults;
+      ok = RunBenchmarks(retryOpts, sources, decodes, retryResults) && ok;
+      MergeRetry(results, retryResults);
+      bMerged = true;
+    }
+  }
+
+  if(bMerged) {
+    fprintf(stdout, "\n");
+    PrintHeader();
+    for(size_t i = 0; i < results.size(); i++) {
+      PrintResult(results[i]);
+    }
+  }
+
+  if(opts.jsonFile && !WriteJSON(opts.jsonFile, opts, results)) {
+    ok = false;
+  }
+
+  if(opts.baselineFile &&
+     CompareWithBaseline(results, baseline, opts.tolerances, bCompareTimes) > 0) {
+    ok = false;
+  }
+
+  if(!ok) {
+    return 1;
+  }
+  return (opts.baselineFile && !bCompareTimes)? kSkippedExitCode : 0;
+}
@@ -0,0 +1,62 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "Calibration.h"
+
+#include <vector>
+
+#include "FasTC/StopWatch.h"
+
+// Keeps the compiler from optimizing the kernel away.
+static volatile float gCalibrationSink;
+
+static void RunCalibrationKernel() {
+  const uint32 kNumValues = 1 << 14;
+  const uint32 kNumPasses = 12;
+
+  std::vector<uint32> values(kNumValues);
+  uint32 hash = 2166136261U;
+  for(uint32 i = 0; i < kNumValues; i++) {
+    hash = (hash ^ i) * 16777619U;
+    values[i] = hash;
+  }
+
+  // Each pass hashes the values like a bit packer would and accumulates a
+  // squared error like the endpoint searches do.
+  float error = 0.0f;
+  for(uint32 pass = 0; pass < kNumPasses; pass++) {
+    for(uint32 i = 0; i < kNumValues; i++) {
+      hash = (hash ^ values[i]) * 16777619U;
+      values[i] = (hash >> 3) | (values[i] << 29);
+
+      const float d = static_cast<float>(hash & 0xFF) - 127.5f;
+      error = error * 0.5f + d * d;
+    }
+  }
+
+  gCalibrationSink = error + static_cast<float>(hash & 0xF);
+}
+
+double TimeCalibrationKernel(uint32 numRepeats) {
+  StopWatch sw;
+  sw.Start();
+  for(uint32 i = 0; i < numRepeats; i++) {
+    RunCalibrationKernel();
+  }
+  sw.Stop();
+  return sw.TimeInMilliseconds();
+}
@@ -0,0 +1,30 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _BENCHMARKS_CALIBRATION_H_
+#define _BENCHMARKS_CALIBRATION_H_
+
+#include "FasTC/TexCompTypes.h"
+
+// Runs a fixed kernel of integer and floating point work, similar in flavor
+// to what the encoders do, numRepeats times and returns how long that took
+// in milliseconds. Dividing codec times by the time of one run gives a
+// measure of speed that mostly cancels out how fast the machine is, so that
+// results can be compared against a baseline recorded somewhere else.
+extern double TimeCalibrationKernel(uint32 numRepeats);
+
+#endif  // _BENCHMARKS_CALIBRATION_H_
@@ -0,0 +1,94 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "SyntheticImages.h"
+
+#include <cassert>
+
+const char *GetSyntheticContentName(ESyntheticContent content) {
+  switch(content) {
+    case eSyntheticContent_Gradient: return "gradient";
+    case eSyntheticContent_Noise: return "noise";
+    case eSyntheticContent_Alpha: return "alpha";
+    case eSyntheticContent_Flat: return "flat";
+    default: return "unknown";
+  }
+}
+
+// Scales x in [0, n) to a channel value in [0, 255].
+static uint8 Ramp(uint32 x, uint32 n) {
+  if(n <= 1) {
+    return 0;
+  }
+  return static_cast<uint8>((static_cast<uint64>(x) * 255) / (n - 1));
+}
+
+void GenerateSyntheticImage(ESyntheticContent content,
+                            uint32 width, uint32 height,
+                            FasTC::RGBA8Image *out) {
+  assert(out);
+  FasTC::RGBA8Image img(width, height);
+
+  // A fixed seed linear congruential generator, so that the noise is the
+  // same on every platform.
+  uint32 seed = 0x2545F491;
+
+  for(uint32 j = 0; j < height; j++) {
+    for(uint32 i = 0; i < width; i++) {
+      uint8 *p = img(i, j);
+      switch(content) {
+        case eSyntheticContent_Gradient:
+          p[0] = Ramp(i, width);
+          p[1] = Ramp(j, height);
+          p[2] = Ramp(i + j, width + height - 1);
+          p[3] = 255;
+          break;
+
+        case eSyntheticContent_Noise:
+          seed = seed * 1664525 + 1013904223;
+          p[0] = static_cast<uint8>(seed >> 24);
+          p[1] = static_cast<uint8>(seed >> 16);
+          p[2] = static_cast<uint8>(seed >> 8);
+          p[3] = 255;
+          break;
+
+        case eSyntheticContent_Alpha: {
+          p[0] = Ramp(j, height);
+          p[1] = 128;
+          p[2] = Ramp(width - 1 - i, width);
+
+          const bool bCutout =
+            i >= width / 4 && i < (3 * width) / 4 &&
+            j >= height / 4 && j < (3 * height) / 4 &&
+            ((i / 8) + (j / 8)) % 2 == 0;
+          p[3] = bCutout? 0 : Ramp(i, width);
+        }
+        break;
+
+        case eSyntheticContent_Flat:
+        default:
+          p[0] = 200;
+          p[1] = 120;
+          p[2] = 40;
+          p[3] = 255;
+          break;
+      }
+    }
+  }
+
+  out->Swap(img);
+}
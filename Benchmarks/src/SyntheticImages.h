@@ -0,0 +1,52 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _BENCHMARKS_SYNTHETIC_IMAGES_H_
+#define _BENCHMARKS_SYNTHETIC_IMAGES_H_
+
+#include "FasTC/RGBAImage.h"
+
+// The kinds of content that the benchmarks generate in addition to the
+// images in the corpus. Each one stresses a different part of the encoders.
+enum ESyntheticContent {
+  // Smooth ramps in every color channel, fully opaque.
+  eSyntheticContent_Gradient,
+
+  // Uniformly distributed random colors, fully opaque. This is the worst
+  // case for every block format.
+  eSyntheticContent_Noise,
+
+  // A color gradient whose alpha ramps from transparent to opaque, with a
+  // hard edged cutout in the middle.
+  eSyntheticContent_Alpha,
+
+  // A single opaque color.
+  eSyntheticContent_Flat,
+
+  kNumSyntheticContents
+};
+
+extern const char *GetSyntheticContentName(ESyntheticContent content);
+
+// Fills out with a width x height image of the given content. The images
+// only depend on their arguments, so results are reproducible across runs
+// and machines.
+extern void GenerateSyntheticImage(ESyntheticContent content,
+                                   uint32 width, uint32 height,
+                                   FasTC::RGBA8Image *out);
+
+#endif  // _BENCHMARKS_SYNTHETIC_IMAGES_H_
@@ -0,0 +1,584 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "batch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <Windows.h>
+#  include <direct.h>
+#  undef min
+#  undef max
+#else
+#  include <dirent.h>
+#  include <glob.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#endif
+
+#include "FasTC/CompressedImage.h"
+#include "FasTC/CompressionCache.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/StopWatch.h"
+#include "FasTC/TexComp.h"
+#include "FasTC/Thread.h"
+#include "FasTC/Trace.h"
+
+const char *GetOutputSuffix(FasTC::ECompressionFormat format) {
+  switch(format) {
+    case FasTC::eCompressionFormat_BPTC: return "-bptc";
+    case FasTC::eCompressionFormat_PVRTC4: return "-pvrtc-4bpp";
+    case FasTC::eCompressionFormat_DXT1: return "-dxt1";
+    case FasTC::eCompressionFormat_DXT5: return "-dxt5";
+    case FasTC::eCompressionFormat_ETC1: return "-etc1";
+    default: return "";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Finding the inputs
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct BatchInput {
+  std::string path;
+
+  // The directory of the input relative to the batch directory, or empty if
+  // the input didn't come from one.
+  std::string subdir;
+};
+
+static bool IsSeparator(char c) {
+  return c == '/' || c == '\\';
+}
+
+static std::string JoinPath(const std::string &dir, const std::string &name) {
+  if(dir.empty()) {
+    return name;
+  }
+
+  if(IsSeparator(dir[dir.size() - 1])) {
+    return dir + name;
+  }
+  return dir + "/" + name;
+}
+
+// Returns the position just past the last path separator, or zero.
+static size_t BasenameStart(const std::string &path) {
+  size_t start = path.size();
+  while(start > 0 && !IsSeparator(path[start - 1])) {
+    start--;
+  }
+  return start;
+}
+
+// Only files with an extension that ImageFile knows are picked up, and
+// ImageFile can't hold paths that are any longer than this.
+static bool IsImagePath(const std::string &path) {
+  const size_t kMaxPathSz = 255;
+  if(path.size() > kMaxPathSz ||
+     path.find('.', BasenameStart(path)) == std::string::npos) {
+    return false;
+  }
+  return ImageFile::DetectFileFormat(path.c_str()) != kNumImageFileFormats;
+}
+
+static bool IsDirectory(const char *path) {
+#ifdef _WIN32
+  DWORD attrs = GetFileAttributesA(path);
+  return attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY);
+#else
+  struct stat st;
+  return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+static bool HasWildcards(const char *path) {
+  return strpbrk(path, "*?[") != NULL;
+}
+
+// The end of the name of every output, such as "-dxt1.png".
+static std::string GetOutputEnding(const SBatchSettings &batch,
+                                   FasTC::ECompressionFormat format) {
+  return std::string(GetOutputSuffix(format)) + "." + batch.extension;
+}
+
+// True if the file looks like the output of an earlier batch with the same
+// settings. These are left alone so that running the same batch again
+// doesn't compress the outputs of the last run.
+static bool IsBatchOutput(const std::string &path, const std::string &outputEnding) {
+  const std::string name = path.substr(BasenameStart(path));
+  return outputEnding[0] != '.' && name.size() > outputEnding.size() &&
+    name.compare(name.size() - outputEnding.size(), std::string::npos, outputEnding) == 0;
+}
+
+static void FindImagesInDirectory(const std::string &root,
+                                  const std::string &subdir,
+                                  const std::string &outputEnding,
+                                  std::vector<BatchInput> &inputs) {
+  const std::string dir = JoinPath(root, subdir);
+  std::vector<std::string> names;
+
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE h = FindFirstFileA(JoinPath(dir, "*").c_str(), &data);
+  if(h == INVALID_HANDLE_VALUE) {
+    fprintf(stderr, "Unable to read directory: %s\n", dir.c_str());
+    return;
+  }
+
+  do {
+    names.push_back(data.cFileName);
+  } while(FindNextFileA(h, &data));
+  FindClose(h);
+#else
+  DIR *d = opendir(dir.c_str());
+  if(NULL == d) {
+    fprintf(stderr, "Unable to read directory: %s\n", dir.c_str());
+    return;
+  }
+
+  struct dirent *entry;
+  while((entry = readdir(d)) != NULL) {
+    names.push_back(entry->d_name);
+  }
+  closedir(d);
+#endif
+
+  // Directory order isn't stable between file systems, so sort the names
+  // to get the same batch every time.
+  std::sort(names.begin(), names.end());
+
+  for(size_t i = 0; i < names.size(); i++) {
+    if(names[i] == "." || names[i] == "..") {
+      continue;
+    }
+
+    const std::string path = JoinPath(dir, names[i]);
+    if(IsDirectory(path.c_str())) {
+      FindImagesInDirectory(root, JoinPath(subdir, names[i]), outputEnding, inputs);
+    } else if(IsImagePath(path) && !IsBatchOutput(path, outputEnding)) {
+      BatchInput input;
+      input.path = path;
+      input.subdir = subdir;
+      inputs.push_back(input);
+    }
+  }
+}
+
+static void FindImagesMatching(const char *pattern,
+                               const std::string &outputEnding,
+                               std::vector<BatchInput> &inputs) {
+  std::vector<std::string> paths;
+
+#ifdef _WIN32
+  // Windows only expands wildcards in the last part of the path.
+  const std::string pat(pattern);
+  const std::string dir = pat.substr(0, BasenameStart(pat));
+
+  WIN32_FIND_DATAA data;
+  HANDLE h = FindFirstFileA(pattern, &data);
+  if(h != INVALID_HANDLE_VALUE) {
+    do {
+      paths.push_back(dir + data.cFileName);
+    } while(FindNextFileA(h, &data));
+    FindClose(h);
+  }
+  std::sort(paths.begin(), paths.end());
+#else
+  glob_t g;
+  if(glob(pattern, 0, NULL, &g) == 0) {
+    for(size_t i = 0; i < g.gl_pathc; i++) {
+      paths.push_back(g.gl_pathv[i]);
+    }
+  }
+  globfree(&g);
+#endif
+
+  for(size_t i = 0; i < paths.size(); i++) {
+    if(IsImagePath(paths[i]) && !IsDirectory(paths[i].c_str()) &&
+       !IsBatchOutput(paths[i], outputEnding)) {
+      BatchInput input;
+      input.path = paths[i];
+      inputs.push_back(input);
+    }
+  }
+}
+
+static bool ReadManifest(const char *filename,
+                         std::vector<BatchInput> &inputs) {
+  std::ifstream manifest(filename);
+  if(!manifest) {
+    fprintf(stderr, "Unable to open manifest: %s\n", filename);
+    return false;
+  }
+
+  std::string line;
+  while(std::getline(manifest, line)) {
+    // Trim the whitespace, including the carriage returns of DOS files.
+    const size_t first = line.find_first_not_of(" \t\r");
+    if(first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    const size_t last = line.find_last_not_of(" \t\r");
+
+    BatchInput input;
+    input.path = line.substr(first, last - first + 1);
+    if(!IsImagePath(input.path)) {
+      fprintf(stderr, "Skipping unsupported file in manifest: %s\n", input.path.c_str());
+      continue;
+    }
+    inputs.push_back(input);
+  }
+
+  return true;
+}
+
+// Where the output of the input goes.
+static std::string GetOutputPath(const SBatchSettings &batch,
+                                 FasTC::ECompressionFormat format,
+                                 const BatchInput &input) {
+  const size_t baseStart = BasenameStart(input.path);
+  std::string name = input.path.substr(baseStart);
+  name = name.substr(0, name.rfind('.'));
+  name += GetOutputEnding(batch, format);
+
+  if(batch.outputDir) {
+    return JoinPath(JoinPath(batch.outputDir, input.subdir), name);
+  }
+  return JoinPath(input.path.substr(0, baseStart), name);
+}
+
+// Drops every input whose output would overwrite the output of an earlier
+// input, such as a.tga after a.png, and reports it. Returns the number of
+// inputs that were dropped.
+static uint32 RemoveCollisions(const SBatchSettings &batch,
+                               FasTC::ECompressionFormat format,
+                               std::vector<BatchInput> &inputs) {
+  std::map<std::string, size_t> outputs;
+  std::vector<BatchInput> kept;
+  kept.reserve(inputs.size());
+
+  for(size_t i = 0; i < inputs.size(); i++) {
+    const std::string path = GetOutputPath(batch, format, inputs[i]);
+    std::map<std::string, size_t>::const_iterator it = outputs.find(path);
+    if(it != outputs.end()) {
+      fprintf(stderr, "%s: output %s would overwrite the output of %s\n",
+              inputs[i].path.c_str(), path.c_str(), kept[it->second].path.c_str());
+      continue;
+    }
+
+    outputs[path] = kept.size();
+    kept.push_back(inputs[i]);
+  }
+
+  const uint32 numDropped = static_cast<uint32>(inputs.size() - kept.size());
+  inputs.swap(kept);
+  return numDropped;
+}
+
+static void MakeDirectories(const std::string &path) {
+  for(size_t i = 1; i <= path.size(); i++) {
+    if(i == path.size() || IsSeparator(path[i])) {
+      const std::string dir = path.substr(0, i);
+      if(!IsDirectory(dir.c_str())) {
+#ifdef _WIN32
+        _mkdir(dir.c_str());
+#else
+        mkdir(dir.c_str(), 0777);
+#endif
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Pipeline
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct BatchItem {
+  uint32 index;
+  ImageFile *file;
+  CompressedImage *compressed;
+};
+
+typedef TCBoundedQueue<BatchItem *> BatchQueue;
+
+// The state that is shared by every stage of the pipeline.
+class BatchState {
+ public:
+  BatchState(const SBatchSettings &batch, const SCompressionSettings &settings,
+             const std::vector<BatchInput> &inputs,
+             uint32 numLoaders, uint32 numCompressors)
+    : m_Batch(batch)
+    , m_Settings(settings)
+    , m_Inputs(inputs)
+    , m_Loaded(2 * numCompressors)
+    , m_Compressed(2 * numCompressors)
+    , m_NextInput(0)
+    , m_NumFailed(0)
+    , m_LoadersLeft(numLoaders)
+    , m_CompressorsLeft(numCompressors)
+  { }
+
+  const SBatchSettings &m_Batch;
+  const SCompressionSettings &m_Settings;
+  const std::vector<BatchInput> &m_Inputs;
+
+  BatchQueue m_Loaded;
+  BatchQueue m_Compressed;
+
+  bool NextInput(uint32 &index) {
+    TCLock lock(m_Mutex);
+    if(m_NextInput >= m_Inputs.size()) {
+      return false;
+    }
+    index = m_NextInput++;
+    return true;
+  }
+
+  void Fail(uint32 index, const char *what) {
+    TCLock lock(m_Mutex);
+    fprintf(stderr, "%s: %s\n", m_Inputs[index].path.c_str(), what);
+    m_NumFailed++;
+  }
+
+  // The last thread of each stage closes the queue that it feeds, which
+  // lets the next stage finish once it has drained the queue.
+  void LoaderDone() {
+    TCLock lock(m_Mutex);
+    if(--m_LoadersLeft == 0) {
+      m_Loaded.Close();
+    }
+  }
+
+  void CompressorDone() {
+    TCLock lock(m_Mutex);
+    if(--m_CompressorsLeft == 0) {
+      m_Compressed.Close();
+    }
+  }
+
+  uint32 NumFailed() const { return m_NumFailed; }
+
+ private:
+  TCMutex m_Mutex;
+  uint32 m_NextInput;
+  uint32 m_NumFailed;
+  uint32 m_LoadersLeft;
+  uint32 m_CompressorsLeft;
+};
+
+class BatchLoader : public TCCallable {
+ public:
+  BatchLoader() : TCCallable(), m_State(NULL) { }
+  void SetState(BatchState *state) { m_State = state; }
+
+  virtual void operator()() {
+    TCTrace::SetThreadName("Batch Loader");
+
+    uint32 index;
+    while(m_State->NextInput(index)) {
+      ImageFile *file = new ImageFile(m_State->m_Inputs[index].path.c_str());
+      if(!file->LoadRGBA8()) {
+        delete file;
+        m_State->Fail(index, "unable to load image");
+        continue;
+      }
+
+      BatchItem *item = new BatchItem;
+      item->index = index;
+      item->file = file;
+      item->compressed = NULL;
+      if(!m_State->m_Loaded.Push(item)) {
+        delete file;
+        delete item;
+      }
+    }
+
+    m_State->LoaderDone();
+  }
+
+ private:
+  BatchState *m_State;
+};
+
+class BatchCompressor : public TCCallable {
+ public:
+  BatchCompressor() : TCCallable(), m_State(NULL) { }
+  void SetState(BatchState *state) { m_State = state; }
+
+  virtual void operator()() {
+    TCTrace::SetThreadName("Batch Compressor");
+
+    // Images are compressed in parallel with each other, so each one only
+    // gets a single thread.
+    SCompressionSettings settings = m_State->m_Settings;
+    settings.iNumThreads = 1;
+
+    BatchItem *item;
+    while(m_State->m_Loaded.Pop(item)) {
+      if(m_State->m_Batch.cache) {
+        item->compressed = CompressImageCached(
+          *m_State->m_Batch.cache, item->file->GetRGBA8Image(), settings);
+      } else {
+        item->compressed = CompressImage(item->file->GetRGBA8Image(), settings);
+      }
+      delete item->file;
+      item->file = NULL;
+
+      if(NULL == item->compressed) {
+        m_State->Fail(item->index, "unable to compress image");
+        delete item;
+        continue;
+      }
+
+      if(!m_State->m_Compressed.Push(item)) {
+        delete item->compressed;
+        delete item;
+      }
+    }
+
+    m_State->CompressorDone();
+  }
+
+ private:
+  BatchState *m_State;
+};
+
+class BatchWriter : public TCCallable {
+ public:
+  BatchWriter() : TCCallable(), m_State(NULL) { }
+  void SetState(BatchState *state) { m_State = state; }
+
+  virtual void operator()() {
+    TCTrace::SetThreadName("Batch Writer");
+
+    BatchItem *item;
+    while(m_State->m_Compressed.Pop(item)) {
+      Write(*item);
+      delete item->compressed;
+      delete item;
+    }
+  }
+
+ private:
+  BatchState *m_State;
+
+  void Write(const BatchItem &item) {
+    const SBatchSettings &batch = m_State->m_Batch;
+    const BatchInput &input = m_State->m_Inputs[item.index];
+
+    const std::string path = GetOutputPath(batch, m_State->m_Settings.format, input);
+    if(batch.outputDir) {
+      MakeDirectories(path.substr(0, BasenameStart(path)));
+    }
+
+    EImageFileFormat fmt = kNumImageFileFormats;
+    if(IsImagePath(path)) {
+      fmt = ImageFile::DetectFileFormat(path.c_str());
+    }
+
+    ImageFile out(path.c_str(), fmt, *item.compressed);
+    out.SetPNGSettings(batch.pngSettings);
+    if(!out.Write()) {
+      m_State->Fail(item.index, "unable to write image");
+    }
+  }
+};
+
+uint32 CompressBatch(const SBatchSettings &batch,
+                     const SCompressionSettings &settings) {
+  const std::string outputEnding = GetOutputEnding(batch, settings.format);
+
+  std::vector<BatchInput> inputs;
+  if(IsDirectory(batch.input)) {
+    FindImagesInDirectory(batch.input, "", outputEnding, inputs);
+  } else if(HasWildcards(batch.input)) {
+    FindImagesMatching(batch.input, outputEnding, inputs);
+  } else if(!ReadManifest(batch.input, inputs)) {
+    return 1;
+  }
+
+  if(inputs.empty()) {
+    fprintf(stderr, "No images found in %s\n", batch.input);
+    return 0;
+  }
+
+  const uint32 numFound = static_cast<uint32>(inputs.size());
+  const uint32 numCollisions = RemoveCollisions(batch, settings.format, inputs);
+  if(inputs.empty()) {
+    return numCollisions;
+  }
+
+  const uint32 numInputs = static_cast<uint32>(inputs.size());
+  const uint32 numIO = std::max<uint32>(1, std::min(batch.numIOThreads, numInputs));
+  const uint32 numCompressors =
+    std::max<uint32>(1, std::min<uint32>(settings.iNumThreads, numInputs));
+
+  BatchState state(batch, settings, inputs, numIO, numCompressors);
+  std::vector<BatchLoader> loaders(numIO);
+  std::vector<BatchCompressor> compressors(numCompressors);
+  std::vector<BatchWriter> writers(numIO);
+
+  StopWatch stopWatch;
+  stopWatch.Start();
+
+  std::vector<TCThread> threads;
+  threads.reserve(2 * numIO + numCompressors);
+  for(uint32 i = 0; i < numIO; i++) {
+    loaders[i].SetState(&state);
+    threads.push_back(TCThread(loaders[i]));
+  }
+  for(uint32 i = 0; i < numCompressors; i++) {
+    compressors[i].SetState(&state);
+    threads.push_back(TCThread(compressors[i]));
+  }
+  for(uint32 i = 0; i < numIO; i++) {
+    writers[i].SetState(&state);
+    threads.push_back(TCThread(writers[i]));
+  }
+
+  for(size_t i = 0; i < threads.size(); i++) {
+    threads[i].Join();
+  }
+
+  stopWatch.Stop();
+
+  const uint32 numFailed = state.NumFailed() + numCollisions;
+  fprintf(stdout, "Compressed %u of %u images in %.3f s\n",
+          numFound - numFailed, numFound, stopWatch.TimeInSeconds());
+  if(batch.cache) {
+    fprintf(stdout, "Cache: %llu hits, %llu misses\n",
+            static_cast<unsigned long long>(batch.cache->GetNumHits()),
+            static_cast<unsigned long long>(batch.cache->GetNumMisses()));
+  }
+  return numFailed;
+}
@@ -0,0 +1,81 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _CLTOOL_BATCH_H_
+#define _CLTOOL_BATCH_H_
+
+#include <cstddef>
+
+#include "FasTC/TexCompTypes.h"
+#include "FasTC/CompressionFormat.h"
+#include "FasTC/ImageFile.h"
+
+class CompressionCache;
+struct SCompressionSettings;
+
+// The suffix that is added to the basename of an image that was compressed
+// with the given format, such as "-bptc".
+extern const char *GetOutputSuffix(FasTC::ECompressionFormat format);
+
+struct SBatchSettings {
+  // A directory, which is searched recursively for images, a glob pattern,
+  // or a manifest file that lists one image per line. Blank lines and lines
+  // that start with '#' are ignored in the manifest.
+  const char *input;
+
+  // Where the outputs go. Images found in a directory keep their place in
+  // the tree below it. If this is NULL, every output is written next to its
+  // input.
+  const char *outputDir;
+
+  // The extension of the output files, which picks their format. Outputs
+  // are named <basename>-<fmt>.<extension>, like the single file output.
+  // Directories and glob patterns skip files that are already named that
+  // way, since they are the outputs of an earlier run. Inputs that would
+  // write the same output, like a.png and a.tga, are reported as failures
+  // and only the first of them is compressed.
+  const char *extension;
+
+  // The number of threads that load images and that write them out. The
+  // number of compression threads comes from the compression settings.
+  uint32 numIOThreads;
+
+  SPNGSettings pngSettings;
+
+  // If this is not NULL, images whose blocks are already in the cache are
+  // not compressed again, and the blocks of the others are added to it.
+  CompressionCache *cache;
+
+  SBatchSettings()
+    : input(NULL)
+    , outputDir(NULL)
+    , extension("png")
+    , numIOThreads(2)
+    , cache(NULL)
+  { }
+};
+
+// Compresses every image given by the batch settings. Loading, compressing
+// and writing run on separate threads that are connected by bounded queues,
+// so that file I/O overlaps compression without holding more than a few
+// images in memory. Each image is compressed by a single thread, and
+// settings.iNumThreads images are compressed at once. Returns the number of
+// images that failed.
+extern uint32 CompressBatch(const SBatchSettings &batch,
+                            const SCompressionSettings &settings);
+
+#endif  // _CLTOOL_BATCH_H_
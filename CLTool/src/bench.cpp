@@ -0,0 +1,255 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/TexComp.h"
+
+struct BenchmarkResult {
+  uint32 numThreads;
+  double minMS;
+  double medianMS;
+  double p95MS;
+  double maxMS;
+  double meanMS;
+  double megapixelsPerSecond;
+};
+
+static const char *FormatName(FasTC::ECompressionFormat format) {
+  switch(format) {
+    case FasTC::eCompressionFormat_BPTC: return "BPTC";
+    case FasTC::eCompressionFormat_ETC1: return "ETC1";
+    case FasTC::eCompressionFormat_DXT1: return "DXT1";
+    case FasTC::eCompressionFormat_DXT5: return "DXT5";
+    case FasTC::eCompressionFormat_PVRTC4: return "PVRTC";
+    default: return "Unknown";
+  }
+}
+
+// The nearest rank percentile of the sorted samples.
+static double Percentile(const std::vector<double> &sorted, double p) {
+  size_t rank = static_cast<size_t>(ceil(p * static_cast<double>(sorted.size())));
+  rank = std::max<size_t>(rank, 1);
+  return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+static bool Measure(const FasTC::RGBA8Image &img,
+                    const SCompressionSettings &settings,
+                    const SBenchmarkSettings &bench,
+                    BenchmarkResult &result) {
+  std::vector<double> samples;
+  samples.reserve(bench.numIterations);
+
+  for(uint32 i = 0; i < bench.numWarmups + bench.numIterations; i++) {
+    double ms = 0.0;
+    CompressedImage *ci = CompressImage(&img, settings, &ms);
+    if(NULL == ci) {
+      return false;
+    }
+    delete ci;
+
+    if(i >= bench.numWarmups) {
+      samples.push_back(ms);
+    }
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  double total = 0.0;
+  for(size_t i = 0; i < samples.size(); i++) {
+    total += samples[i];
+  }
+
+  result.numThreads = settings.iNumThreads;
+  result.minMS = samples.front();
+  result.medianMS = Percentile(samples, 0.5);
+  result.p95MS = Percentile(samples, 0.95);
+  result.maxMS = samples.back();
+  result.meanMS = total / static_cast<double>(samples.size());
+
+  const double megapixels =
+    static_cast<double>(img.GetWidth()) * img.GetHeight() / 1e6;
+  result.megapixelsPerSecond =
+    (result.medianMS > 0.0)? megapixels / (result.medianMS / 1000.0) : 0.0;
+  return true;
+}
+
+static std::string EscapeJSON(const char *str) {
+  std::string escaped;
+  for(const char *c = str; *c; c++) {
+    if(*c == '"' || *c == '\\') {
+      escaped += '\\';
+      escaped += *c;
+    } else if(static_cast<unsigned char>(*c) < 0x20) {
+      char buf[8];
+      sprintf(buf, "\\u%04x", *c);
+      escaped += buf;
+    } else {
+      escaped += *c;
+    }
+  }
+  return escaped;
+}
+
+static void WriteJSON(FILE *f, const FasTC::RGBA8Image &img,
+                      const SCompressionSettings &settings,
+                      const SBenchmarkSettings &bench,
+                      const std::vector<BenchmarkResult> &results) {
+  fprintf(f, "{\n");
+  fprintf(f, "  \"image\": \"%s\",\n", EscapeJSON(bench.imageName).c_str());
+  fprintf(f, "  \"format\": \"%s\",\n", FormatName(settings.format));
+  fprintf(f, "  \"width\": %u,\n", img.GetWidth());
+  fprintf(f, "  \"height\": %u,\n", img.GetHeight());
+  fprintf(f, "  \"quality\": %d,\n", settings.iQuality);
+  fprintf(f, "  \"warmups\": %u,\n", bench.numWarmups);
+  fprintf(f, "  \"iterations\": %u,\n", bench.numIterations);
+  fprintf(f, "  \"results\": [\n");
+  for(size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult &r = results[i];
+    fprintf(f, "    { \"threads\": %u, \"min_ms\": %.6f, \"median_ms\": %.6f, "
+               "\"p95_ms\": %.6f, \"max_ms\": %.6f, \"mean_ms\": %.6f, "
+               "\"mpix_per_s\": %.6f }%s\n",
+            r.numThreads, r.minMS, r.medianMS, r.p95MS, r.maxMS, r.meanMS,
+            r.megapixelsPerSecond, (i + 1 < results.size())? "," : "");
+  }
+  fprintf(f, "  ]\n");
+  fprintf(f, "}\n");
+}
+
+static std::string EscapeCSV(const char *str) {
+  std::string escaped;
+  for(const char *c = str; *c; c++) {
+    if(*c == '"') {
+      escaped += '"';
+    }
+    escaped += *c;
+  }
+  return escaped;
+}
+
+static void WriteCSV(FILE *f, const FasTC::RGBA8Image &img,
+                     const SCompressionSettings &settings,
+                     const SBenchmarkSettings &bench,
+                     const std::vector<BenchmarkResult> &results) {
+  fprintf(f, "image,format,width,height,quality,warmups,iterations,threads,"
+             "min_ms,median_ms,p95_ms,max_ms,mean_ms,mpix_per_s\n");
+  for(size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult &r = results[i];
+    fprintf(f, "\"%s\",%s,%u,%u,%d,%u,%u,%u,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+            EscapeCSV(bench.imageName).c_str(), FormatName(settings.format),
+            img.GetWidth(), img.GetHeight(), settings.iQuality,
+            bench.numWarmups, bench.numIterations, r.numThreads,
+            r.minMS, r.medianMS, r.p95MS, r.maxMS, r.meanMS,
+            r.megapixelsPerSecond);
+  }
+}
+
+static bool HasExtension(const char *filename, const char *ext) {
+  const size_t len = strlen(filename);
+  const size_t extLen = strlen(ext);
+  return len >= extLen && strcmp(filename + len - extLen, ext) == 0;
+}
+
+bool RunBenchmark(const FasTC::RGBA8Image &img,
+                  const SCompressionSettings &settings,
+                  const SBenchmarkSettings &bench) {
+  if(bench.numIterations == 0) {
+    fprintf(stderr, "Benchmark needs at least one iteration.\n");
+    return false;
+  }
+
+  FILE *out = NULL;
+  if(bench.outputFile) {
+    if(!HasExtension(bench.outputFile, ".json") &&
+       !HasExtension(bench.outputFile, ".csv")) {
+      fprintf(stderr, "Benchmark output must be a .json or .csv file.\n");
+      return false;
+    }
+
+    out = fopen(bench.outputFile, "w");
+    if(NULL == out) {
+      fprintf(stderr, "Unable to open benchmark output: %s\n", bench.outputFile);
+      return false;
+    }
+  }
+
+  // Pad the image once up front, rather than inside of every compression.
+  const FasTC::RGBA8Image *src = &img;
+  FasTC::RGBA8Image padded;
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(settings.format, blockDims);
+  if(img.GetWidth() % blockDims[0] != 0 || img.GetHeight() % blockDims[1] != 0) {
+    const uint32 w = ((img.GetWidth() + blockDims[0] - 1) / blockDims[0]) * blockDims[0];
+    const uint32 h = ((img.GetHeight() + blockDims[1] - 1) / blockDims[1]) * blockDims[1];
+    FasTC::RGBA8Image tmp(w, h);
+    memset(tmp.GetData(), 0, tmp.GetDataSize());
+    for(uint32 j = 0; j < img.GetHeight(); j++) {
+      memcpy(tmp.GetRow(j), img.GetRow(j), img.GetRowSize());
+    }
+    padded.Swap(tmp);
+    src = &padded;
+  }
+
+  std::vector<uint32> threadCounts = bench.threadCounts;
+  if(threadCounts.empty()) {
+    threadCounts.push_back(settings.iNumThreads);
+  }
+
+  fprintf(stdout, "%-8s %12s %12s %12s %12s %12s\n",
+          "Threads", "Min (ms)", "Median (ms)", "P95 (ms)", "Max (ms)", "MP/s");
+
+  std::vector<BenchmarkResult> results;
+  for(size_t i = 0; i < threadCounts.size(); i++) {
+    SCompressionSettings s = settings;
+    s.iNumThreads = threadCounts[i];
+    s.iNumCompressions = 1;
+
+    BenchmarkResult r;
+    if(!Measure(*src, s, bench, r)) {
+      if(out) {
+        fclose(out);
+      }
+      return false;
+    }
+
+    fprintf(stdout, "%-8u %12.3f %12.3f %12.3f %12.3f %12.3f\n",
+            r.numThreads, r.minMS, r.medianMS, r.p95MS, r.maxMS,
+            r.megapixelsPerSecond);
+    results.push_back(r);
+  }
+
+  if(out) {
+    if(HasExtension(bench.outputFile, ".json")) {
+      WriteJSON(out, *src, settings, bench, results);
+    } else {
+      WriteCSV(out, *src, settings, bench, results);
+    }
+    fclose(out);
+  }
+
+  return true;
+}
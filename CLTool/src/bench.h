@@ -0,0 +1,65 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _CLTOOL_BENCH_H_
+#define _CLTOOL_BENCH_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "FasTC/TexCompTypes.h"
+#include "FasTC/ImageFwd.h"
+
+struct SCompressionSettings;
+
+struct SBenchmarkSettings {
+  // Compressions that are run and thrown away before any are measured, so
+  // that caches, page tables and the CPU clock have settled.
+  uint32 numWarmups;
+
+  // The number of measured compressions for each thread count.
+  uint32 numIterations;
+
+  // The thread counts to measure. If this is empty, only the number of
+  // threads in the compression settings is measured.
+  std::vector<uint32> threadCounts;
+
+  // Where to write the results. The format is picked by the extension,
+  // which is either .json or .csv. The results are only printed if this is
+  // NULL.
+  const char *outputFile;
+
+  // The name of the image that is reported with the results.
+  const char *imageName;
+
+  SBenchmarkSettings()
+    : numWarmups(2)
+    , numIterations(10)
+    , outputFile(NULL)
+    , imageName("")
+  { }
+};
+
+// Compresses img over and over with the given settings and reports the
+// minimum, median, 95th percentile and maximum compression time, and the
+// throughput in megapixels per second, for each thread count. Returns false
+// if a compression fails or the results can't be written.
+extern bool RunBenchmark(const FasTC::RGBA8Image &img,
+                         const SCompressionSettings &settings,
+                         const SBenchmarkSettings &bench);
+
+#endif  // _CLTOOL_BENCH_H_
@@ -32,7 +32,6 @@
 #include "FasTC/Image.h"
 #include "FasTC/ImageFile.h"
 #include "FasTC/TexComp.h"
-#include "FasTC/ThreadSafeStreambuf.h"
 
 static void PrintUsageAndExit() {
   fprintf(stderr, "Usage: compare [-d] <img1> <img2>\n");
@@ -108,20 +107,26 @@ int main(int argc, char **argv) {
 
     EImageFileFormat fmt = ImageFile::DetectFileFormat(fname_buf);
     ImageFile cImgFile (fname_buf, fmt, diff);
+
+    // Deflate the diff image on every core.
+    SPNGSettings pngSettings;
+    pngSettings.iNumThreads = 0;
+    cImgFile.SetPNGSettings(pngSettings);
     cImgFile.Write();
   }
 
-  double PSNR = img1.ComputePSNR(&img2);
-  if(PSNR > 0.0) {
-    fprintf(stdout, "PSNR: %.3f\n", PSNR);
+  FasTC::ImageMetrics metrics;
+  img1.ComputeMetrics(&img2, &metrics);
+
+  if(metrics.m_PSNR > 0.0) {
+    fprintf(stdout, "PSNR: %.3f\n", metrics.m_PSNR);
   }
   else {
     fprintf(stderr, "Error computing PSNR\n");
   }
 
-  double SSIM = img1.ComputeSSIM(&img2);
-  if(SSIM > 0.0) {
-    fprintf(stdout, "SSIM: %.9f\n", SSIM);
+  if(metrics.m_SSIM > 0.0) {
+    fprintf(stdout, "SSIM: %.9f\n", metrics.m_SSIM);
   } else {
     fprintf(stderr, "Error computing MSSIM\n");
   }
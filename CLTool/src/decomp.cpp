@@ -31,7 +31,6 @@
 #include "FasTC/Image.h"
 #include "FasTC/ImageFile.h"
 #include "FasTC/TexComp.h"
-#include "FasTC/ThreadSafeStreambuf.h"
 
 void PrintUsage() {
   fprintf(stderr, "Usage: decomp <in_img> <out_img>\n");
@@ -52,6 +51,11 @@ int main(int argc, char **argv) {
 
   EImageFileFormat fmt = ImageFile::DetectFileFormat(argv[2]);
   ImageFile cImgFile (argv[2], fmt, *img);
+
+  // Deflate PNG output on every core.
+  SPNGSettings pngSettings;
+  pngSettings.iNumThreads = 0;
+  cImgFile.SetPNGSettings(pngSettings);
   cImgFile.Write();
 
   return 0;
@@ -0,0 +1,108 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+// Runs a DaemonServer that compresses images sent over a Unix domain socket
+// until it receives SIGINT or SIGTERM.
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "FasTC/DaemonServer.h"
+
+static FasTC::DaemonServer *gServer = NULL;
+
+static void HandleSignal(int) {
+  if(gServer) {
+    gServer->Stop();
+  }
+}
+
+static void PrintUsageAndExit() {
+  fprintf(stderr, "Usage: fastcd [OPTIONS] <socket>\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "\t-h|--help\tPrint this help.\n");
+  fprintf(stderr, "\t-w <num>\tCompress <num> jobs at once. Default: one per hardware thread\n");
+  fprintf(stderr, "\t-t <num>\tCompress each job with <num> threads. Default: 1\n");
+  fprintf(stderr, "\t-queue <num>\tTurn jobs away once <num> are waiting for a worker. Default: 64\n");
+  fprintf(stderr, "\t-max-request <MB>\tReject requests larger than this. Default: 1024\n");
+  fprintf(stderr, "\t-no-files\tOnly accept pixels, and don't load images from files.\n");
+  exit(1);
+}
+
+static uint32 ParseCount(int argc, char **argv, int &arg, uint32 minValue) {
+  if(++arg >= argc) {
+    PrintUsageAndExit();
+  }
+
+  const int value = atoi(argv[arg]);
+  if(value < static_cast<int>(minValue)) {
+    PrintUsageAndExit();
+  }
+  return static_cast<uint32>(value);
+}
+
+int main(int argc, char **argv) {
+  FasTC::SDaemonSettings settings;
+
+  int arg = 1;
+  for(; arg < argc && argv[arg][0] == '-'; arg++) {
+    if(strcmp(argv[arg], "-w") == 0) {
+      settings.numWorkers = ParseCount(argc, argv, arg, 1);
+    } else if(strcmp(argv[arg], "-t") == 0) {
+      settings.numThreadsPerJob = ParseCount(argc, argv, arg, 1);
+    } else if(strcmp(argv[arg], "-queue") == 0) {
+      settings.maxQueuedJobs = ParseCount(argc, argv, arg, 1);
+    } else if(strcmp(argv[arg], "-max-request") == 0) {
+      settings.maxRequestBytes =
+        static_cast<uint64>(ParseCount(argc, argv, arg, 1)) * 1024 * 1024;
+    } else if(strcmp(argv[arg], "-no-files") == 0) {
+      settings.bAllowFiles = false;
+    } else {
+      PrintUsageAndExit();
+    }
+  }
+
+  if(arg + 1 != argc) {
+    PrintUsageAndExit();
+  }
+  settings.socketPath = argv[arg];
+
+  FasTC::DaemonServer server(settings);
+  if(!server.Listen()) {
+    return 1;
+  }
+
+  gServer = &server;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = HandleSignal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  fprintf(stdout, "fastcd listening on %s\n", settings.socketPath);
+  fflush(stdout);
+
+  server.Run();
+
+  gServer = NULL;
+  fprintf(stdout, "fastcd stopped\n");
+  return 0;
+}
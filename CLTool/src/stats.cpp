@@ -0,0 +1,270 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+// Summarizes the block statistics that tc -l writes out.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "FasTC/BlockStats.h"
+
+using FasTC::BlockStat;
+using FasTC::BlockStatList;
+
+static void PrintUsageAndExit() {
+  fprintf(stderr, "Usage: stats <file.stats> [<file.stats> ...]\n");
+  exit(1);
+}
+
+static const char *FormatName(uint8 fmt) {
+  switch(fmt) {
+    case FasTC::eCompressionFormat_DXT1: return "DXT1";
+    case FasTC::eCompressionFormat_DXT5: return "DXT5";
+    case FasTC::eCompressionFormat_ETC1: return "ETC1";
+    case FasTC::eCompressionFormat_BPTC: return "BPTC";
+    case FasTC::eCompressionFormat_PVRTC2: return "PVRTC2";
+    case FasTC::eCompressionFormat_PVRTC4: return "PVRTC4";
+    default: return "Unknown";
+  }
+}
+
+static const char *PathName(uint8 fmt, uint8 path) {
+  if(fmt == FasTC::eCompressionFormat_BPTC) {
+    switch(path) {
+      case 0: return "single color";
+      case 1: return "transparent";
+      case 2: return "exact shape";
+      case 3: return "searched";
+    }
+  }
+  return "other";
+}
+
+static double Percent(uint64 n, uint64 total) {
+  return total? (100.0 * static_cast<double>(n)) / static_cast<double>(total) : 0.0;
+}
+
+// Running totals over the records of a single format.
+struct FormatSummary {
+  static const uint32 kNumValues = 256;
+
+  uint64 m_NumBlocks;
+  double m_ErrorSum;
+  float m_MaxError;
+
+  uint64 m_NumPaths[kNumValues];
+
+  uint64 m_NumWithMode[kNumValues];
+  double m_ErrorWithMode[kNumValues];
+  std::vector<bool> m_ShapesWithMode[BlockStat::kMaxNumModes];
+
+  // How often each mode was tried, and the sum of the estimated and actual
+  // errors that it got when it was.
+  uint64 m_NumEstimated[BlockStat::kMaxNumModes];
+  double m_EstimateSum[BlockStat::kMaxNumModes];
+  uint64 m_NumTried[BlockStat::kMaxNumModes];
+  double m_TriedErrorSum[BlockStat::kMaxNumModes];
+
+  // The number of blocks that had estimates, and of those, how many ended
+  // up with the mode that had the lowest estimate.
+  uint64 m_NumWithEstimates;
+  uint64 m_NumLowestEstimateChosen;
+
+  uint64 m_AnnealingSum;
+  uint32 m_MaxAnnealing;
+
+  FormatSummary()
+    : m_NumBlocks(0), m_ErrorSum(0.0), m_MaxError(0.0f)
+    , m_NumWithEstimates(0), m_NumLowestEstimateChosen(0)
+    , m_AnnealingSum(0), m_MaxAnnealing(0)
+  {
+    for(uint32 i = 0; i < kNumValues; i++) {
+      m_NumPaths[i] = m_NumWithMode[i] = 0;
+      m_ErrorWithMode[i] = 0.0;
+    }
+
+    for(uint32 i = 0; i < BlockStat::kMaxNumModes; i++) {
+      m_NumEstimated[i] = m_NumTried[i] = 0;
+      m_EstimateSum[i] = m_TriedErrorSum[i] = 0.0;
+      m_ShapesWithMode[i].resize(kNumValues, false);
+    }
+  }
+
+  void Add(const BlockStat &s) {
+    m_NumBlocks++;
+    if(s.m_Error >= 0.0f) {
+      m_ErrorSum += s.m_Error;
+      if(s.m_Error > m_MaxError) {
+        m_MaxError = s.m_Error;
+      }
+    }
+
+    m_NumPaths[s.m_Path]++;
+    m_NumWithMode[s.m_Mode]++;
+    if(s.m_Error >= 0.0f) {
+      m_ErrorWithMode[s.m_Mode] += s.m_Error;
+    }
+
+    if(s.m_Mode < BlockStat::kMaxNumModes && s.m_Shape != BlockStat::kNone) {
+      m_ShapesWithMode[s.m_Mode][s.m_Shape] = true;
+    }
+
+    int lowestEstimate = -1;
+    for(uint32 i = 0; i < BlockStat::kMaxNumModes; i++) {
+      if(s.m_ModeEstimate[i] >= 0.0f) {
+        m_NumEstimated[i]++;
+        m_EstimateSum[i] += s.m_ModeEstimate[i];
+        if(lowestEstimate < 0 || s.m_ModeEstimate[i] < s.m_ModeEstimate[lowestEstimate]) {
+          lowestEstimate = i;
+        }
+      }
+
+      if(s.m_ModeError[i] >= 0.0f) {
+        m_NumTried[i]++;
+        m_TriedErrorSum[i] += s.m_ModeError[i];
+      }
+    }
+
+    if(lowestEstimate >= 0) {
+      m_NumWithEstimates++;
+      if(static_cast<uint8>(lowestEstimate) == s.m_Mode) {
+        m_NumLowestEstimateChosen++;
+      }
+    }
+
+    m_AnnealingSum += s.m_AnnealingSteps;
+    if(s.m_AnnealingSteps > m_MaxAnnealing) {
+      m_MaxAnnealing = s.m_AnnealingSteps;
+    }
+  }
+
+  void Print(uint8 fmt) const {
+    fprintf(stdout, "%s: %llu blocks\n", FormatName(fmt),
+            static_cast<unsigned long long>(m_NumBlocks));
+    fprintf(stdout, "  Error per block: mean %.3f, max %.3f\n",
+            m_ErrorSum / static_cast<double>(m_NumBlocks), m_MaxError);
+
+    if(m_NumPaths[BlockStat::kNone] != m_NumBlocks) {
+      fprintf(stdout, "  Paths:\n");
+      for(uint32 i = 0; i < kNumValues; i++) {
+        if(m_NumPaths[i] > 0 && i != BlockStat::kNone) {
+          fprintf(stdout, "    %-14s %10llu (%5.1f%%)\n", PathName(fmt, i),
+                  static_cast<unsigned long long>(m_NumPaths[i]),
+                  Percent(m_NumPaths[i], m_NumBlocks));
+        }
+      }
+    }
+
+    // Only some formats try more than one mode for each block.
+    bool bTriedModes = false;
+    for(uint32 i = 0; i < BlockStat::kMaxNumModes; i++) {
+      bTriedModes = bTriedModes || m_NumTried[i] > 0 || m_NumEstimated[i] > 0;
+    }
+
+    fprintf(stdout, "  Mode      Blocks            Shapes  Mean error");
+    if(bTriedModes) {
+      fprintf(stdout, "   Tried  Mean estimate  Mean error when tried");
+    }
+    fprintf(stdout, "\n");
+    for(uint32 i = 0; i < kNumValues; i++) {
+      const bool bInTable = i < BlockStat::kMaxNumModes;
+      if(m_NumWithMode[i] == 0 && (!bInTable || m_NumTried[i] == 0)) {
+        continue;
+      }
+
+      if(i == BlockStat::kNone) {
+        fprintf(stdout, "  none");
+      } else {
+        fprintf(stdout, "  %4u", i);
+      }
+
+      uint32 numShapes = 0;
+      if(bInTable) {
+        for(uint32 s = 0; s < kNumValues; s++) {
+          numShapes += m_ShapesWithMode[i][s]? 1 : 0;
+        }
+      }
+
+      fprintf(stdout, "  %10llu (%5.1f%%)  %6u  %10.3f",
+              static_cast<unsigned long long>(m_NumWithMode[i]),
+              Percent(m_NumWithMode[i], m_NumBlocks), numShapes,
+              m_NumWithMode[i]? m_ErrorWithMode[i] / m_NumWithMode[i] : 0.0);
+
+      if(bTriedModes && bInTable) {
+        fprintf(stdout, "  %6llu", static_cast<unsigned long long>(m_NumTried[i]));
+        if(m_NumEstimated[i] > 0) {
+          fprintf(stdout, "  %13.3f", m_EstimateSum[i] / m_NumEstimated[i]);
+        } else {
+          fprintf(stdout, "  %13s", "-");
+        }
+        if(m_NumTried[i] > 0) {
+          fprintf(stdout, "  %21.3f", m_TriedErrorSum[i] / m_NumTried[i]);
+        } else {
+          fprintf(stdout, "  %21s", "-");
+        }
+      }
+      fprintf(stdout, "\n");
+    }
+
+    if(m_NumWithEstimates > 0) {
+      fprintf(stdout, "  Mode with the lowest estimate was chosen: %.1f%% of %llu blocks\n",
+              Percent(m_NumLowestEstimateChosen, m_NumWithEstimates),
+              static_cast<unsigned long long>(m_NumWithEstimates));
+    }
+
+    if(m_MaxAnnealing > 0) {
+      fprintf(stdout, "  Annealing steps per block: mean %.1f, max %u\n",
+              static_cast<double>(m_AnnealingSum) / m_NumBlocks, m_MaxAnnealing);
+    }
+  }
+};
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    PrintUsageAndExit();
+  }
+
+  std::vector<FormatSummary> summaries(FasTC::kNumCompressionFormats + 1);
+  for(int arg = 1; arg < argc; arg++) {
+    BlockStatList stats;
+    if(!stats.Read(argv[arg])) {
+      return 1;
+    }
+
+    for(size_t i = 0; i < stats.Size(); i++) {
+      uint32 fmt = stats[i].m_Format;
+      if(fmt > FasTC::kNumCompressionFormats) {
+        fmt = FasTC::kNumCompressionFormats;
+      }
+      summaries[fmt].Add(stats[i]);
+    }
+  }
+
+  bool bPrinted = false;
+  for(size_t fmt = 0; fmt < summaries.size(); fmt++) {
+    if(summaries[fmt].m_NumBlocks > 0) {
+      summaries[fmt].Print(static_cast<uint8>(fmt));
+      bPrinted = true;
+    }
+  }
+
+  if(!bPrinted) {
+    fprintf(stdout, "No blocks were recorded.\n");
+  }
+  return 0;
+}
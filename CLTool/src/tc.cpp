@@ -24,7 +24,6 @@
 #include <cstdio>
 #include <cstring>
 #include <iostream>
-#include <fstream>
 #ifdef _MSC_VER
 #  include <SDKDDKVer.h>
 #  include <Windows.h>
@@ -32,18 +31,25 @@
 #  undef max
 #endif
 
+#include "FasTC/CompressionCache.h"
 #include "FasTC/Image.h"
 #include "FasTC/ImageFile.h"
+#include "FasTC/Memory.h"
+#include "FasTC/RGBAImage.h"
 #include "FasTC/TexComp.h"
-#include "FasTC/ThreadSafeStreambuf.h"
+#include "FasTC/Trace.h"
+
+#include "batch.h"
+#include "bench.h"
 
 void PrintUsage() {
   fprintf(stderr, "Usage: tc [OPTIONS] imagefile\n");
+  fprintf(stderr, "       tc [OPTIONS] -batch <dir|glob|manifest>\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "\t-h|--help\tPrint this help.\n");
-  fprintf(stderr, "\t-v\t\tVerbose mode: prints out Entropy, Mean Local Entropy, and MSSIM\n");
+  fprintf(stderr, "\t-v\t\tVerbose mode: prints out Entropy, Mean Local Entropy, MSSIM, and the memory used during each stage\n");
   fprintf(stderr, "\t-f <fmt>\tFormat to use. Either \"BPTC\", \"ETC1\", \"DXT1\", \"DXT5\", or \"PVRTC\". Default: BPTC\n");
-  fprintf(stderr, "\t-l\t\tSave an output log.\n");
+  fprintf(stderr, "\t-l\t\tSave statistics about each block to basename.stats, which the stats tool summarizes.\n");
   fprintf(stderr, "\t-d <file>\tSpecify decompressed output (default: basename-<fmt>.png)\n");
   fprintf(stderr, "\t-nd\t\tSuppress decompressed output\n");
   fprintf(stderr, "\t-q <quality>\tSet compression quality level. Default: 50\n");
@@ -52,8 +58,42 @@ void PrintUsage() {
   fprintf(stderr, "\t-t <num>\tCompress the image using <num> threads. Default: 1\n");
   fprintf(stderr, "\t-a \t\tCompress the image using synchronization via atomic operations. Default: Off\n");
   fprintf(stderr, "\t-j <num>\tUse <num> blocks for each work item in a worker queue threading model. Default: (Blocks / Threads)\n");
+  fprintf(stderr, "\t-png-level <num>\tzlib level from 0 to 9 for the decompressed PNG output. Default: 6\n");
+  fprintf(stderr, "\t-png-filter <f>\tPNG row filter. Either \"none\", \"sub\", \"up\", \"avg\", \"paeth\", or \"adaptive\". Default: adaptive\n");
+  fprintf(stderr, "\t\t\tThe PNG output is written with the number of threads given by -t.\n");
+  fprintf(stderr, "\t-bench\t\tBenchmark the compressor instead of writing any output. Reports the min, median, 95th percentile\n");
+  fprintf(stderr, "\t\t\tand max compression time and megapixels per second over -n compressions. Default -n: 10\n");
+  fprintf(stderr, "\t-warmup <num>\tNumber of unmeasured compressions before each benchmark. Default: 2\n");
+  fprintf(stderr, "\t-sweep <list>\tBenchmark each of a comma separated list of thread counts, such as 1,2,4,8. Default: -t\n");
+  fprintf(stderr, "\t-bench-out <file>\tAlso write the benchmark results to a .json or .csv file\n");
+  fprintf(stderr, "\t-batch <in>\tCompress every image in a directory tree, matching a glob pattern, or listed one per line in a manifest file.\n");
+  fprintf(stderr, "\t\t\tImages are loaded, compressed and written on separate threads, with <num> images from -t compressed at once.\n");
+  fprintf(stderr, "\t-o <dir>\tBatch output directory. Default: next to each input\n");
+  fprintf(stderr, "\t-e <ext>\tBatch output file extension, which picks the output format. Default: png\n");
+  fprintf(stderr, "\t-io <num>\tNumber of threads that load and that write images in batch mode. Default: 2\n");
+  fprintf(stderr, "\t-stream\t\tDecode the image in bands of rows while compressing it, rather than loading it all first. Image metrics are not computed.\n");
+  fprintf(stderr, "\t-cache <dir>\tReuse the blocks of images that were already compressed with the same settings, keeping them in <dir>.\n");
+  fprintf(stderr, "\t\t\tIgnored with -l, -stream and -bench.\n");
+  fprintf(stderr, "\t-cache-size <MB>\tThe most space the cache may take up before the least recently used blocks are removed. Default: 1024\n");
+  fprintf(stderr, "\t-trace <file>\tRecord where the time goes and write it to <file> as a Chrome trace (also --trace)\n");
 }
 
+// Stops recording and writes the trace when main returns, from wherever it
+// returns.
+class ScopedTraceFile {
+ public:
+  explicit ScopedTraceFile(const char *filename) : m_Filename(filename) { }
+  ~ScopedTraceFile() {
+    if (m_Filename) {
+      TCTrace::Stop();
+      TCTrace::WriteChromeTrace(m_Filename);
+    }
+  }
+
+ private:
+  const char *m_Filename;
+};
+
 void ExtractBasename(const char *filename, char *buf, size_t bufSz) {
   size_t len = strlen(filename);
   const char *end = filename + len;
@@ -78,6 +118,43 @@ void ExtractBasename(const char *filename, char *buf, size_t bufSz) {
   return;
 }
 
+static double ToMB(uint64 bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+static void PrintMemoryStats(const char *stage, const char *counted,
+                             const TCMemory::Stats &stats) {
+  fprintf(stdout, "Memory (%s, %s): %.2f MB peak, %.2f MB peak resident\n", stage, counted,
+          ToMB(stats.m_PeakLiveBytes), ToMB(TCMemory::GetPeakResidentBytes()));
+
+  for(uint32 i = 0; i < TCMemory::kNumCategories; i++) {
+    if(stats.m_NumAllocations[i] == 0 && stats.m_LiveBytes[i] == 0) {
+      continue;
+    }
+
+    const TCMemory::ECategory category = static_cast<TCMemory::ECategory>(i);
+    fprintf(stdout, "  %s: %.2f MB in %llu allocations, %.2f MB live\n",
+            TCMemory::GetCategoryName(category), ToMB(stats.m_BytesAllocated[i]),
+            static_cast<unsigned long long>(stats.m_NumAllocations[i]),
+            ToMB(stats.m_LiveBytes[i]));
+  }
+}
+
+// Prints the memory that was counted since the last call, and then starts
+// counting again for the next stage. The counts cover the whole process,
+// which is only this stage because tc runs one stage at a time.
+void PrintMemoryUsage(const char *stage) {
+  PrintMemoryStats(stage, "whole process", TCMemory::GetStats());
+  TCMemory::ResetStats();
+}
+
+// Prints the memory that the compression call itself reported, which
+// leaves out anything else the process holds.
+void PrintCompressionMemoryUsage(const char *stage, const TCMemory::Stats &stats) {
+  PrintMemoryStats(stage, "compression call", stats);
+  TCMemory::ResetStats();
+}
+
 int main(int argc, char **argv) {
 
   int fileArg = 1;
@@ -99,6 +176,15 @@ int main(int argc, char **argv) {
   bool bUsePVRTexLib = false;
   bool bUseNVTT = false;
   bool bVerbose = false;
+  bool bStream = false;
+  SPNGSettings pngSettings;
+  SBatchSettings batch;
+  bool bBenchmark = false;
+  bool bNumCompressionsSet = false;
+  SBenchmarkSettings bench;
+  const char *traceFile = NULL;
+  const char *cacheDir = NULL;
+  uint64 cacheSizeMB = 1024;
   FasTC::ECompressionFormat format = FasTC::eCompressionFormat_BPTC;
 
   bool knowArg = false;
@@ -112,6 +198,7 @@ int main(int argc, char **argv) {
         PrintUsage();
         exit(1);
       }
+      bNumCompressionsSet = true;
 
       fileArg++;
       knowArg = true;
@@ -236,6 +323,159 @@ int main(int argc, char **argv) {
       continue;
     }
 
+    if (strcmp(argv[fileArg], "-stream") == 0) {
+      fileArg++;
+      bStream = true;
+      knowArg = true;
+      continue;
+    }
+
+    if (strcmp(argv[fileArg], "-png-level") == 0) {
+      fileArg++;
+
+      if (fileArg == argc ||
+          (pngSettings.iZLibLevel = atoi(argv[fileArg])) < 0 ||
+          pngSettings.iZLibLevel > 9) {
+        PrintUsage();
+        exit(1);
+      }
+
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
+
+    if (strcmp(argv[fileArg], "-png-filter") == 0) {
+      fileArg++;
+
+      if (fileArg == argc) {
+        PrintUsage();
+        exit(1);
+      } else if (!strcmp(argv[fileArg], "none")) {
+        pngSettings.filter = ePNGFilter_None;
+      } else if (!strcmp(argv[fileArg], "sub")) {
+        pngSettings.filter = ePNGFilter_Sub;
+      } else if (!strcmp(argv[fileArg], "up")) {
+        pngSettings.filter = ePNGFilter_Up;
+      } else if (!strcmp(argv[fileArg], "avg")) {
+        pngSettings.filter = ePNGFilter_Average;
+      } else if (!strcmp(argv[fileArg], "paeth")) {
+        pngSettings.filter = ePNGFilter_Paeth;
+      } else if (!strcmp(argv[fileArg], "adaptive")) {
+        pngSettings.filter = ePNGFilter_Adaptive;
+      } else {
+        PrintUsage();
+        exit(1);
+      }
+
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
+
+    if (strcmp(argv[fileArg], "-batch") == 0 ||
+        strcmp(argv[fileArg], "-o") == 0 ||
+        strcmp(argv[fileArg], "-e") == 0) {
+      const char *opt = argv[fileArg];
+      fileArg++;
+
+      if (fileArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
+      if (opt[1] == 'b') {
+        batch.input = argv[fileArg];
+      } else if (opt[1] == 'o') {
+        batch.outputDir = argv[fileArg];
+      } else {
+        batch.extension = argv[fileArg];
+      }
+
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
+
+    if (strcmp(argv[fileArg], "-bench") == 0) {
+      fileArg++;
+      bBenchmark = true;
+      knowArg = true;
+      continue;
+    }
+
+    if (strcmp(argv[fileArg], "-warmup") == 0) {
+      fileArg++;
+
+      int numWarmups = 0;
+      if (fileArg == argc || (numWarmups = atoi(argv[fileArg])) < 0) {
+        PrintUsage();
+        exit(1);
+      }
+      bench.numWarmups = numWarmups;
+
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
+
+    if (strcmp(argv[fileArg], "-sweep") == 0) {
+      fileArg++;
+
+      if (fileArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
+      const char *list = argv[fileArg];
+      while (*list) {
+        int threads = atoi(list);
+        if (threads < 1) {
+          PrintUsage();
+          exit(1);
+        }
+        bench.threadCounts.push_back(threads);
+
+        list += strcspn(list, ",");
+        if (*list == ',') {
+          list++;
+        }
+      }
+
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
+
+    if (strcmp(argv[fileArg], "-bench-out") == 0) {
+      fileArg++;
+
+      if (fileArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+      bench.outputFile = argv[fileArg];
+
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
+
+    if (strcmp(argv[fileArg], "-io") == 0) {
+      fileArg++;
+
+      int numIOThreads = 0;
+      if (fileArg == argc || (numIOThreads = atoi(argv[fileArg])) < 1) {
+        PrintUsage();
+        exit(1);
+      }
+      batch.numIOThreads = numIOThreads;
+
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
+
     if (strcmp(argv[fileArg], "-a") == 0) {
       fileArg++;
       bUseAtomics = true;
@@ -243,36 +483,61 @@ int main(int argc, char **argv) {
       continue;
     }
 
-  } while (knowArg && fileArg < argc);
+    if (strcmp(argv[fileArg], "-cache") == 0) {
+      fileArg++;
 
-  if (fileArg == argc) {
-    PrintUsage();
-    exit(1);
-  }
+      if (fileArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+      cacheDir = argv[fileArg];
 
-  char basename[256];
-  ExtractBasename(argv[fileArg], basename, 256);
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
 
-  ImageFile file(argv[fileArg]);
-  if (!file.Load()) {
-    return 1;
-  }
+    if (strcmp(argv[fileArg], "-cache-size") == 0) {
+      fileArg++;
+
+      int sizeMB = 0;
+      if (fileArg == argc || (sizeMB = atoi(argv[fileArg])) < 1) {
+        PrintUsage();
+        exit(1);
+      }
+      cacheSizeMB = static_cast<uint64>(sizeMB);
 
-  FasTC::Image<> img(*file.GetImage());
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
 
-  if (bVerbose) {
-    fprintf(stdout, "Entropy: %.5f\n", img.ComputeEntropy());
-    fprintf(stdout, "Mean Local Entropy: %.5f\n", img.ComputeMeanLocalEntropy());
+    if (strcmp(argv[fileArg], "-trace") == 0 || strcmp(argv[fileArg], "--trace") == 0) {
+      fileArg++;
+
+      if (fileArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+      traceFile = argv[fileArg];
+
+      fileArg++;
+      knowArg = true;
+      continue;
+    }
+
+  } while (knowArg && fileArg < argc);
+
+  if (bBenchmark && (bStream || batch.input)) {
+    fprintf(stderr, "-bench can't be combined with -stream or -batch.\n");
+    exit(1);
   }
 
-  std::ofstream logFile;
-  ThreadSafeStreambuf streamBuf(logFile);
-  std::ostream logStream(&streamBuf);
-  if (bSaveLog) {
-    char logname[256];
-    sprintf(logname, "%s.log", basename);
-    logFile.open(logname);
+  if (traceFile && !TCTrace::Start()) {
+    exit(1);
   }
+  ScopedTraceFile trace(traceFile);
+  TCTrace::SetThreadName("Main");
 
   SCompressionSettings settings;
   settings.format = format;
@@ -284,63 +549,174 @@ int main(int argc, char **argv) {
   settings.iJobSize = numJobs;
   settings.bUsePVRTexLib = bUsePVRTexLib;
   settings.bUseNVTT = bUseNVTT;
+
+  CompressionCache *cache = NULL;
+  if (cacheDir && !bStream && !bBenchmark) {
+    cache = new CompressionCache(cacheDir, cacheSizeMB * 1024 * 1024);
+    if (!cache->IsValid()) {
+      delete cache;
+      exit(1);
+    }
+  }
+
+  if (batch.input) {
+    if (fileArg != argc) {
+      PrintUsage();
+      exit(1);
+    }
+
+    batch.pngSettings = pngSettings;
+    batch.cache = cache;
+    const uint32 numFailed = CompressBatch(batch, settings);
+    delete cache;
+    return numFailed == 0? 0 : 1;
+  }
+
+  if (fileArg == argc) {
+    PrintUsage();
+    exit(1);
+  }
+
+  char basename[256];
+  ExtractBasename(argv[fileArg], basename, 256);
+
+  FasTC::BlockStatList blockStats;
   if (bSaveLog) {
-    settings.logStream = &logStream;
+    settings.blockStats = &blockStats;
+  }
+
+  TCMemory::Stats cmpMemoryStats;
+  if (bVerbose) {
+    settings.memoryStats = &cmpMemoryStats;
+  }
+
+  TCMemory::ResetStats();
+
+  ImageFile file(argv[fileArg]);
+  CompressedImage *ci = NULL;
+  FasTC::Image<> *img = NULL;
+  double cmpTimeMS = 0.0;
+  if (bStream) {
+    // The whole image is never in memory, so there's nothing to compare the
+    // compressed image against.
+    RGBA8RowSource *src = file.OpenRowSource();
+    if (NULL == src) {
+      return 1;
+    }
+
+    ci = CompressImageStreaming(*src, settings, &cmpTimeMS);
+    delete src;
+
+    if (bVerbose) {
+      PrintCompressionMemoryUsage("Load and compress", cmpMemoryStats);
+    }
   } else {
-    settings.logStream = NULL;
+    if (!file.LoadRGBA8()) {
+      return 1;
+    }
+
+    if (bBenchmark) {
+      if (bNumCompressionsSet) {
+        bench.numIterations = numCompressions;
+      }
+      bench.imageName = argv[fileArg];
+      return RunBenchmark(*file.GetRGBA8Image(), settings, bench)? 0 : 1;
+    }
+
+    // The compressor reads the packed pixels directly, so we only need an
+    // Image<> for computing metrics.
+    const FasTC::RGBA8Image &rgba = *file.GetRGBA8Image();
+    img = new FasTC::Image<>(rgba.GetWidth(), rgba.GetHeight(),
+                             reinterpret_cast<const uint32 *>(rgba.GetData()));
+
+    if (bVerbose) {
+      fprintf(stdout, "Entropy: %.5f\n", img->ComputeEntropy());
+      fprintf(stdout, "Mean Local Entropy: %.5f\n", img->ComputeMeanLocalEntropy());
+      PrintMemoryUsage("Load");
+    }
+
+    if (cache) {
+      bool bCacheHit = false;
+      ci = CompressImageCached(*cache, &rgba, settings, &cmpTimeMS, &bCacheHit);
+      if (bCacheHit) {
+        fprintf(stdout, "Compressed blocks found in cache: %s\n", cacheDir);
+      }
+    } else {
+      ci = CompressImage(&rgba, settings, &cmpTimeMS);
+    }
+    if (bVerbose) {
+      PrintCompressionMemoryUsage("Compress", cmpMemoryStats);
+    }
   }
 
-  CompressedImage *ci = CompressImage(&img, settings);
   if (NULL == ci) {
+    delete img;
+    delete cache;
     return 1;
   }
 
-  if (ci->GetWidth() != img.GetWidth() ||
-      ci->GetHeight() != img.GetHeight()) {
+  fprintf(stdout, "Compression time: %0.3f ms\n", cmpTimeMS);
+
+  if (bSaveLog) {
+    char statsname[256];
+    sprintf(statsname, "%s.stats", basename);
+    blockStats.Write(statsname);
+  }
+
+  if (img && (ci->GetWidth() != img->GetWidth() ||
+              ci->GetHeight() != img->GetHeight())) {
     fprintf(stderr, "Cannot compute image metrics: compressed and uncompressed dimensions differ.\n");
-  } else {
-    double PSNR = img.ComputePSNR(ci);
-    if(PSNR > 0.0) {
-      fprintf(stdout, "PSNR: %.3f\n", PSNR);
+  } else if (img) {
+    // Only decompress the image once for all of the metrics...
+    FasTC::ImageMetrics metrics;
+    img->ComputeMetrics(ci, &metrics, bVerbose);
+
+    if(metrics.m_PSNR > 0.0) {
+      fprintf(stdout, "PSNR: %.3f\n", metrics.m_PSNR);
     }
     else {
       fprintf(stderr, "Error computing PSNR\n");
     }
 
     if(bVerbose) {
-      double SSIM = img.ComputeSSIM(ci);
-      if(SSIM > 0.0) {
-        fprintf(stdout, "SSIM: %.9f\n", SSIM);
+      if(metrics.m_SSIM > 0.0) {
+        fprintf(stdout, "SSIM: %.9f\n", metrics.m_SSIM);
       } else {
         fprintf(stderr, "Error computing SSIM\n");
       }
+
+      fprintf(stdout, "Channel MSE (R, G, B, A): %.3f %.3f %.3f %.3f\n",
+              metrics.m_ChannelMSE[0], metrics.m_ChannelMSE[1],
+              metrics.m_ChannelMSE[2], metrics.m_ChannelMSE[3]);
+      fprintf(stdout, "Channel Max Error (R, G, B, A): %d %d %d %d\n",
+              metrics.m_ChannelMaxError[0], metrics.m_ChannelMaxError[1],
+              metrics.m_ChannelMaxError[2], metrics.m_ChannelMaxError[3]);
+      PrintMemoryUsage("Metrics");
     }
   }
 
   if(bDecompress) {
     if(decompressedOutput[0] != '\0') {
       memcpy(basename, decompressedOutput, 256);
-    } else if(format == FasTC::eCompressionFormat_BPTC) {
-      strcat(basename, "-bptc.png");
-    } else if(format == FasTC::eCompressionFormat_PVRTC4) {
-      strcat(basename, "-pvrtc-4bpp.png");
-    } else if(format == FasTC::eCompressionFormat_DXT1) {
-      strcat(basename, "-dxt1.png");
-    } else if(format == FasTC::eCompressionFormat_DXT5) {
-      strcat(basename, "-dxt5.png");
-    } else if(format == FasTC::eCompressionFormat_ETC1) {
-      strcat(basename, "-etc1.png");
+    } else {
+      strcat(basename, GetOutputSuffix(format));
+      strcat(basename, ".png");
     }
 
     EImageFileFormat fmt = ImageFile::DetectFileFormat(basename);
     ImageFile cImgFile (basename, fmt, *ci);
+    pngSettings.iNumThreads = numThreads;
+    cImgFile.SetPNGSettings(pngSettings);
     cImgFile.Write();
+
+    if (bVerbose) {
+      PrintMemoryUsage("Write");
+    }
   }
 
   // Cleanup 
   delete ci;
-  if(bSaveLog) {
-    logFile.close();
-  }
+  delete img;
+  delete cache;
   return 0;
 }
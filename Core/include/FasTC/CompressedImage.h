@@ -21,12 +21,21 @@
 #include "FasTC/TexCompTypes.h"
 #include "FasTC/CompressionFormat.h"
 #include "FasTC/Image.h"
+#include "FasTC/RGBAImage.h"
 
 class CompressedImage : public FasTC::Image<FasTC::Pixel> {
  private:
   FasTC::ECompressionFormat m_Format;
   uint8 *m_CompressedData;
 
+  // False if m_CompressedData belongs to someone else and must not be freed.
+  bool m_bOwnsCompressedData;
+
+  // True if the pixels of the base image hold the decompressed contents of
+  // m_CompressedData. This is only reset when the compressed data changes,
+  // so repeated calls to ComputePixels don't decompress the image again.
+  bool m_bDecodedPixelsValid;
+
   typedef FasTC::Image<FasTC::Pixel> UncompressedImage;
 
  public:
@@ -43,28 +52,68 @@ class CompressedImage : public FasTC::Image<FasTC::Pixel> {
     const uint8 *data
   );
 
+  // Create a compressed image that takes ownership of the passed data
+  // instead of copying it. The data must have been allocated with
+  // TCMemory::NewArray under TCMemory::eCategory_CompressedData and is
+  // freed when the image is destroyed.
+  enum ETakeOwnership { eTakeOwnership };
+  CompressedImage(
+    const uint32 width,
+    const uint32 height,
+    const FasTC::ECompressionFormat format,
+    uint8 *data,
+    ETakeOwnership
+  );
+
+  // Create a compressed image that refers to the passed data without copying
+  // it or taking ownership of it. The data must outlive the image, which is
+  // useful for decompressing data that lives in a larger buffer, such as a
+  // memory mapped file. Copies of the image always hold their own data.
+  enum EWrapData { eWrapData };
+  CompressedImage(
+    const uint32 width,
+    const uint32 height,
+    const FasTC::ECompressionFormat format,
+    const uint8 *data,
+    EWrapData
+  );
+
   virtual ~CompressedImage();
 
   virtual FasTC::Image<FasTC::Pixel> *Clone() const {
     return new CompressedImage(*this);
   }
 
+  // Decompresses the image into its pixel array. The decoded pixels are
+  // cached, so subsequent calls are free until the compressed data changes.
   virtual void ComputePixels();
 
-  static uint32 GetCompressedSize(uint32 width, uint32 height, FasTC::ECompressionFormat format);
+  // The size of the compressed data in bytes. This is 64 bits wide because
+  // very large images can have more than 4GB of compressed blocks.
+  static uint64 GetCompressedSize(uint32 width, uint32 height, FasTC::ECompressionFormat format);
 
-  uint32 GetCompressedSize() const {
+  uint64 GetCompressedSize() const {
     return GetCompressedSize(GetWidth(), GetHeight(), m_Format);
   }
-  uint32 GetUncompressedSize() const {
-    return GetWidth() * GetHeight() * sizeof(uint32);
+  uint64 GetUncompressedSize() const {
+    return static_cast<uint64>(GetWidth()) * GetHeight() * sizeof(uint32);
   }
 
-  // Decompress the compressed image data into outBuf. outBufSz is expected
-  // to be the proper size determined by the width, height, and format.
-  // !FIXME! We should have a function to explicitly return the in/out buf
-  // size for a given compressed image.
-  bool DecompressImage(uint8 *outBuf, uint32 outBufSz) const;
+  // Decompress the compressed image data into outBuf as tightly packed RGBA8
+  // pixels. Returns false if outBufSz is smaller than GetUncompressedSize.
+  bool DecompressImage(uint8 *outBuf, uint64 outBufSz) const;
+
+  // Decompress the compressed image data into out, which is resized to the
+  // dimensions of this image.
+  bool DecompressImage(FasTC::RGBA8Image *out) const;
+
+  // Decompress only the w x h pixels whose top left corner is at (x, y) into
+  // out, which is resized to w x h. Only the blocks that overlap the region
+  // are decoded, except for PVRTC, where every pixel depends on the
+  // neighboring blocks and so the whole image is decoded and cropped.
+  // Returns false if the region doesn't lie within the image.
+  bool DecompressRegion(uint32 x, uint32 y, uint32 w, uint32 h,
+                        FasTC::RGBA8Image *out) const;
 
   const uint8 *GetCompressedData() const { return m_CompressedData; }
 
@@ -0,0 +1,122 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _COMPRESSION_CACHE_H_
+#define _COMPRESSION_CACHE_H_
+
+#include "FasTC/TexComp.h"
+#include "FasTC/Thread.h"
+
+#include <string>
+
+// A directory of compressed blocks that survives from one run to the next,
+// so that images that haven't changed don't have to be compressed again.
+// Each entry is found by a 128 bit hash of the pixels, their dimensions, the
+// format, the settings that change how that format is compressed, and the
+// version of its encoder. Settings that only change how fast the image is
+// compressed, such as the number of threads, are left out.
+//
+// Entries are written to a temporary file that is renamed into place, so
+// that other processes sharing the directory, such as several tc processes
+// building assets at once, either see a whole entry or none at all. Each
+// entry also holds a hash of its blocks, and entries that don't match it are
+// removed. Once the entries add up to more than the size limit, the ones
+// that were used least recently are removed, going by their modification
+// time, which is updated whenever an entry is used.
+//
+// Every method may be called from any thread.
+class CompressionCache {
+ public:
+  // Opens the cache in the directory at path, creating it if it doesn't
+  // exist. A maxBytes of zero means that the cache may grow without bound.
+  CompressionCache(const char *path, uint64 maxBytes);
+
+  // False if the directory could not be created.
+  bool IsValid() const { return m_bValid; }
+
+  // True if images compressed with the settings can be cached. Block
+  // statistics can't be recovered from the cache, so compressions that
+  // collect them always run. So do those that use PVRTexLib or NVTT, whose
+  // versions aren't known, and the SIMD BPTC compressor, which doesn't
+  // produce the same blocks every time.
+  static bool IsCacheable(const SCompressionSettings &settings);
+
+  // Copies the blocks that were stored for the width x height pixels in
+  // data, compressed with settings, to cmpData. Returns false if there
+  // aren't any, or if they aren't exactly cmpDataSz bytes.
+  bool Load(const uint8 *data, uint32 width, uint32 height,
+            const SCompressionSettings &settings,
+            uint8 *cmpData, uint64 cmpDataSz);
+
+  // Stores the blocks that the pixels compressed to, replacing any that were
+  // stored for them before. Returns false if they couldn't be written.
+  bool Store(const uint8 *data, uint32 width, uint32 height,
+             const SCompressionSettings &settings,
+             const uint8 *cmpData, uint64 cmpDataSz);
+
+  // The number of calls to Load that did and didn't find their blocks.
+  uint64 GetNumHits() const;
+  uint64 GetNumMisses() const;
+
+ private:
+  // Not copyable
+  CompressionCache(const CompressionCache &);
+  CompressionCache &operator=(const CompressionCache &);
+
+  const std::string m_Path;
+  const uint64 m_MaxBytes;
+  bool m_bValid;
+
+  mutable TCMutex m_Mutex;
+  uint64 m_TotalBytes;
+  uint64 m_NumHits;
+  uint64 m_NumMisses;
+  uint32 m_NumTempFiles;
+
+  // Adds up the size of the entries, removing the least recently used ones
+  // if they don't fit, and any temporary files that were left behind.
+  // Expects m_Mutex to be held.
+  void Trim();
+};
+
+// Compresses an image like CompressImageData, unless the same pixels were
+// compressed with the same settings before, in which case the blocks are
+// copied out of the cache and cmpTimeMS is set to zero. If bCacheHit is not
+// NULL, it is set to whether the blocks came from the cache.
+extern bool CompressImageDataCached(
+  CompressionCache &cache,
+  const uint8 *data,
+  const uint32 width,
+  const uint32 height,
+  uint8 *cmpData,
+  const uint64 cmpDataSz,
+  const SCompressionSettings &settings,
+  double *cmpTimeMS = NULL,
+  bool *bCacheHit = NULL
+);
+
+// Compresses an image like CompressImage, reusing the blocks in the cache
+// like CompressImageDataCached.
+extern CompressedImage *CompressImageCached(
+  CompressionCache &cache,
+  const FasTC::RGBA8Image *img,
+  const SCompressionSettings &settings,
+  double *cmpTimeMS = NULL,
+  bool *bCacheHit = NULL
+);
+
+#endif  // _COMPRESSION_CACHE_H_
@@ -18,10 +18,11 @@
 #ifndef _TEX_COMP_H_
 #define _TEX_COMP_H_
 
+#include "FasTC/BlockStats.h"
 #include "FasTC/CompressedImage.h"
 #include "FasTC/CompressionJob.h"
+#include "FasTC/Memory.h"
 
-#include <iosfwd>
 #include "FasTC/ImageFwd.h"
 
 // Forward declarations
@@ -70,21 +71,210 @@ struct SCompressionSettings {
   // flag is ignored.
   bool bUseNVTT;
 
-  // This is the output stream with which we should output the logs for the
-  // compression functions.
-  std::ostream *logStream;
+  // If this is not NULL, the compressors add a record of how they handled
+  // each block to this list. Each thread fills a list of its own, and these
+  // are appended here once the threads are done. The records of a single
+  // compression are ordered by block index, which is in row major order over
+  // the whole image, even when it is compressed in bands or tiles. Every
+  // format supports this except for PVRTexLib, the atomics based threading
+  // and CompressImageTiled with PVRTC.
+  FasTC::BlockStatList *blockStats;
+
+  // If this is not NULL, it receives the memory counted for the call: what
+  // it allocated, the most it had allocated at once, and what it still holds
+  // when it returns, such as the compressed image. Unlike TCMemory::GetStats,
+  // only the call and the threads that it starts are counted, so the stats
+  // stay accurate while other jobs run. CompressImageAsync fills them in once
+  // the compression stops, before the callback is called.
+  TCMemory::Stats *memoryStats;
 };
 
 template<typename PixelType>
 extern CompressedImage *CompressImage(FasTC::Image<PixelType> *img, const SCompressionSettings &settings);
 
+// Compresses an image whose pixels are already laid out the way the
+// compressors expect them. Unless the image needs to be padded to a multiple
+// of the block size, its pixels are compressed in place without any copies.
+//
+// If cmpTimeMS is not NULL, it receives the average time in milliseconds
+// that one of the settings.iNumCompressions compressions took. This is the
+// case for every compression function below. Times come from a monotonic
+// clock and cover only the compression itself: worker threads are created
+// and lined up before the clock starts, whichever threading model is used.
+extern CompressedImage *CompressImage(const FasTC::RGBA8Image *img,
+                                      const SCompressionSettings &settings,
+                                      double *cmpTimeMS = NULL);
+
+// Supplies the pixels of an image to CompressImageStreaming a few rows at a
+// time, from the top of the image to the bottom.
+class RGBA8RowSource {
+ public:
+  virtual ~RGBA8RowSource() { }
+
+  virtual uint32 GetWidth() const = 0;
+  virtual uint32 GetHeight() const = 0;
+
+  // Writes the next nRows rows of the image into rows as tightly packed RGBA8
+  // pixels. Returns false if the rows could not be produced.
+  virtual bool ReadRows(uint8 *rows, uint32 nRows) = 0;
+};
+
+// Compresses the image produced by src one band of block rows at a time.
+// The next bands are read from src on a separate thread while the current
+// band is being compressed, so that only a few bands of uncompressed pixels
+// are ever held in memory. PVRTC compresses the whole image at once, so for
+// that format every row is read before compression starts.
+extern CompressedImage *CompressImageStreaming(
+  RGBA8RowSource &src, const SCompressionSettings &settings,
+  double *cmpTimeMS = NULL
+);
+
+// Supplies the pixels of an image to CompressImageTiled one rectangular
+// tile at a time.
+class RGBA8TileSource {
+ public:
+  virtual ~RGBA8TileSource() { }
+
+  virtual uint32 GetWidth() const = 0;
+  virtual uint32 GetHeight() const = 0;
+
+  // Writes the w x h pixels whose upper left corner is (x, y) into pixels as
+  // tightly packed RGBA8 rows. The region always lies inside of the image.
+  // Returns false if the pixels could not be produced.
+  virtual bool ReadTile(uint32 x, uint32 y, uint32 w, uint32 h, uint8 *pixels) = 0;
+};
+
+// Receives the compressed blocks produced by CompressImageTiled.
+class CompressedBlockSink {
+ public:
+  virtual ~CompressedBlockSink() { }
+
+  // Called with a run of dataSz bytes of blocks that starts at block index
+  // firstBlock of the compressed image. The blocks are in the same order as
+  // the data of a CompressedImage: row by row for every format but PVRTC,
+  // whose blocks are in Morton order. Each run starts where the previous one
+  // ended, so appending them gives the same data as CompressImage.
+  // Returning false stops the compression.
+  virtual bool WriteBlocks(uint64 firstBlock, const uint8 *data, uint64 dataSz) = 0;
+};
+
+// Compresses an image that may be too large to fit in memory, reading it
+// from src in tiles of roughly tileSize x tileSize pixels and handing the
+// compressed blocks to sink a row of tiles at a time. Only one tile of
+// pixels and one row of tiles worth of compressed blocks are held in memory.
+// Images that are not a multiple of the block size are padded with zeros.
+// The blocks are the same as those that CompressImage produces.
+//
+// PVRTC images must still be square and power-of-two. Since every PVRTC
+// block affects the pixels of its neighbors, each tile is compressed along
+// with a border of the surrounding pixels, wrapping around the edges of the
+// image like the format does, and only the blocks in the middle half of the
+// tile are kept. These are handed to the sink one tile at a time, in Morton
+// order. The blocks only match those of CompressImage when a single tile
+// covers the whole image, since elsewhere the compressor can't see past the
+// border.
+extern bool CompressImageTiled(
+  RGBA8TileSource &src,
+  CompressedBlockSink &sink,
+  const SCompressionSettings &settings,
+  uint32 tileSize = 256,
+  double *cmpTimeMS = NULL
+);
+
 extern bool CompressImageData(
   const unsigned char *data,
   const unsigned int width,
   const unsigned int height,
   unsigned char *cmpData,
-  const unsigned int cmpDataSz,
-  const SCompressionSettings &settings
+  const uint64 cmpDataSz,
+  const SCompressionSettings &settings,
+  double *cmpTimeMS = NULL
+);
+
+// The state of a compression started with CompressImageAsync.
+enum ECompressionStatus {
+  eCompressionStatus_Running,
+  eCompressionStatus_Finished,
+  eCompressionStatus_Cancelled
+};
+
+class CompressionHandle;
+class CompressionHandleImpl;
+
+// Told when a compression started with CompressImageAsync stops, whether it
+// finished or was cancelled. It is called on the thread that did the
+// compressing, before CompressionHandle::Wait returns, and may call any
+// method of the handle except for Wait. It must not delete the handle.
+class CompressionCallback {
+ public:
+  virtual ~CompressionCallback() { }
+  virtual void operator()(CompressionHandle &handle) = 0;
+};
+
+// Keeps track of a compression running in the background. The handle acts as
+// the future of the compressed image: Wait blocks until it is ready and
+// TakeResult hands it over. Every method may be called from any thread.
+class CompressionHandle {
+ public:
+  // Created by CompressImageAsync.
+  explicit CompressionHandle(CompressionHandleImpl *impl);
+
+  // Cancels the compression if it is still running and waits for it to stop.
+  ~CompressionHandle();
+
+  // The number of blocks compressed so far and the number that will have
+  // been compressed once the compression finishes. Each block is counted
+  // once for each of the settings.iNumCompressions compressions.
+  void GetProgress(uint64 *blocksCompleted, uint64 *totalBlocks) const;
+
+  // Asks the compression to stop. The blocks already handed to the
+  // compressors are finished first, which takes a few milliseconds at most.
+  // Does nothing if the compression has already stopped.
+  void Cancel();
+
+  ECompressionStatus GetStatus() const;
+  bool IsDone() const { return GetStatus() != eCompressionStatus_Running; }
+
+  // Blocks until the compression stops and the callback, if there is one,
+  // has returned.
+  ECompressionStatus Wait();
+
+  // Hands the compressed image over to the caller, who must delete it.
+  // Returns NULL unless the compression finished, or if the image has
+  // already been taken.
+  CompressedImage *TakeResult();
+
+  // The average time in milliseconds that each compression took, once the
+  // compression has finished.
+  double GetCompressionTime() const;
+
+ private:
+  CompressionHandleImpl *m_Impl;
+
+  // Not copyable
+  CompressionHandle(const CompressionHandle &);
+  CompressionHandle &operator=(const CompressionHandle &);
+};
+
+// Starts compressing img on a separate thread and returns right away with a
+// handle to it, which the caller must delete. The pixels are copied, padding
+// them to a multiple of the block size, so img may change or go away as soon
+// as this returns.
+//
+// The settings.iNumThreads threads take turns at compressing tiles of
+// settings.iJobSize blocks, and the compression checks whether it was
+// cancelled before starting each tile. If settings.iJobSize is zero, each
+// thread sizes its tiles to take a couple of milliseconds. The threading
+// options of the settings are otherwise ignored. PVRTC
+// compresses the whole image at once on a single thread, so it can only be
+// cancelled between compressions.
+//
+// If settings.blockStats is not NULL, the list is filled as the compression
+// runs, and it must be left alone until the handle is done. Returns NULL if
+// the image can't be compressed with the settings.
+extern CompressionHandle *CompressImageAsync(
+  const FasTC::RGBA8Image *img, const SCompressionSettings &settings,
+  CompressionCallback *callback = NULL
 );
 
 // This function computes the Peak Signal to Noise Ratio between a 
@@ -17,14 +17,17 @@
 
 #include "FasTC/CompressedImage.h"
 
+#include <algorithm>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 
+#include "FasTC/Memory.h"
 #include "FasTC/Pixel.h"
 
 #include "FasTC/TexCompTypes.h"
+#include "FasTC/Trace.h"
 #include "FasTC/BPTCCompressor.h"
 #include "FasTC/PVRTCCompressor.h"
 #include "FasTC/DXTCompressor.h"
@@ -39,10 +42,13 @@ CompressedImage::CompressedImage( const CompressedImage &other )
   : UncompressedImage(other)
   , m_Format(other.m_Format)
   , m_CompressedData(0)
+  , m_bOwnsCompressedData(true)
+  , m_bDecodedPixelsValid(other.m_bDecodedPixelsValid)
 {
   if(other.m_CompressedData) {
-    uint32 compressedSz = GetCompressedSize();
-    m_CompressedData = new uint8[compressedSz];
+    uint64 compressedSz = GetCompressedSize();
+    m_CompressedData = TCMemory::NewArray<uint8>(
+      TCMemory::eCategory_CompressedData, compressedSz);
     memcpy(m_CompressedData, other.m_CompressedData, compressedSz);
   }
 }
@@ -56,56 +62,106 @@ CompressedImage::CompressedImage(
   : UncompressedImage(width, height, reinterpret_cast<uint32 *>(NULL))
   , m_Format(format)
   , m_CompressedData(0)
+  , m_bOwnsCompressedData(true)
+  , m_bDecodedPixelsValid(false)
 {
-  uint32 cmpSz = GetCompressedSize();
+  uint64 cmpSz = GetCompressedSize();
   if(cmpSz > 0) {
     assert(!m_CompressedData);
-    m_CompressedData = new uint8[cmpSz];
+    m_CompressedData = TCMemory::NewArray<uint8>(
+      TCMemory::eCategory_CompressedData, cmpSz);
     memcpy(m_CompressedData, data, cmpSz);
   }
 }
 
+CompressedImage::CompressedImage(
+  const unsigned int width,
+  const unsigned int height,
+  const ECompressionFormat format,
+  unsigned char *data,
+  ETakeOwnership
+)
+  : UncompressedImage(width, height, reinterpret_cast<uint32 *>(NULL))
+  , m_Format(format)
+  , m_CompressedData(data)
+  , m_bOwnsCompressedData(true)
+  , m_bDecodedPixelsValid(false)
+{ }
+
+CompressedImage::CompressedImage(
+  const unsigned int width,
+  const unsigned int height,
+  const ECompressionFormat format,
+  const unsigned char *data,
+  EWrapData
+)
+  : UncompressedImage(width, height, reinterpret_cast<uint32 *>(NULL))
+  , m_Format(format)
+  , m_CompressedData(const_cast<uint8 *>(data))
+  , m_bOwnsCompressedData(false)
+  , m_bDecodedPixelsValid(false)
+{ }
+
 CompressedImage &CompressedImage::operator=(const CompressedImage &other) {
+  if(this == &other) {
+    return *this;
+  }
+
+  // Free the compressed data before the dimensions change, since they
+  // determine how much of it there is.
+  if(m_CompressedData && m_bOwnsCompressedData) {
+    TCMemory::DeleteArray(TCMemory::eCategory_CompressedData,
+                          m_CompressedData, GetCompressedSize());
+  }
+  m_CompressedData = NULL;
+
   UncompressedImage::operator=(other);
   m_Format = other.m_Format;
+  m_bOwnsCompressedData = true;
+
   if(other.m_CompressedData) {
-    uint32 cmpSz = GetCompressedSize();
-    m_CompressedData = new uint8[cmpSz];
+    uint64 cmpSz = GetCompressedSize();
+    m_CompressedData = TCMemory::NewArray<uint8>(
+      TCMemory::eCategory_CompressedData, cmpSz);
     memcpy(m_CompressedData, other.m_CompressedData, cmpSz);
   }
+
+  // The pixels were copied along with the compressed data, so they're
+  // only valid if they were valid for the other image.
+  m_bDecodedPixelsValid = other.m_bDecodedPixelsValid;
   return *this;
 }
 
 CompressedImage::~CompressedImage() {
-  if(m_CompressedData) {
-    delete m_CompressedData;
+  if(m_CompressedData && m_bOwnsCompressedData) {
+    TCMemory::DeleteArray(TCMemory::eCategory_CompressedData,
+                          m_CompressedData, GetCompressedSize());
     m_CompressedData = NULL;
   }
 }
 
-bool CompressedImage::DecompressImage(unsigned char *outBuf, unsigned int outBufSz) const {
-
-  assert(outBufSz == GetUncompressedSize());
-
-  uint8 *byteData = reinterpret_cast<uint8 *>(m_CompressedData);
-  DecompressionJob dj (m_Format, byteData, outBuf, GetWidth(), GetHeight());
-  if(m_Format == FasTC::eCompressionFormat_DXT1) {
+// Decodes width x height pixels worth of blocks in the given format into
+// tightly packed RGBA8 pixels, all in one job.
+static bool DecompressJob(ECompressionFormat fmt, const uint8 *blocks,
+                          uint8 *outBuf, uint32 width, uint32 height) {
+  DecompressionJob dj (fmt, blocks, outBuf, width, height);
+  if(fmt == FasTC::eCompressionFormat_DXT1) {
     DXTC::DecompressDXT1(dj);
-  } else if(m_Format == FasTC::eCompressionFormat_DXT5) {
+  } else if(fmt == FasTC::eCompressionFormat_DXT5) {
     DXTC::DecompressDXT5(dj);
-  } else if (m_Format == FasTC::eCompressionFormat_ETC1) {
+  } else if (fmt == FasTC::eCompressionFormat_ETC1) {
     ETCC::Decompress(dj);
-  } else if(FasTC::COMPRESSION_FORMAT_PVRTC_BEGIN <= m_Format &&
-            FasTC::COMPRESSION_FORMAT_PVRTC_END >= m_Format) {
+  } else if(FasTC::COMPRESSION_FORMAT_PVRTC_BEGIN <= fmt &&
+            FasTC::COMPRESSION_FORMAT_PVRTC_END >= fmt) {
 #ifndef NDEBUG
     PVRTCC::Decompress(dj, PVRTCC::eWrapMode_Wrap, true);
 #else
     PVRTCC::Decompress(dj);
 #endif
-  } else if(m_Format == FasTC::eCompressionFormat_BPTC) {
+  } else if(fmt == FasTC::eCompressionFormat_BPTC) {
     BPTCC::Decompress(dj);
-  } else if(FasTC::COMPRESSION_FORMAT_ASTC_BEGIN <= m_Format &&
-            FasTC::COMPRESSION_FORMAT_ASTC_END >= m_Format) {
+  } else if(FasTC::COMPRESSION_FORMAT_ASTC_BEGIN <= fmt &&
+            FasTC::COMPRESSION_FORMAT_ASTC_END >= fmt) {
     ASTCC::Decompress(dj);
   } else {
     const char *errStr = "Have not implemented decompression method.";
@@ -117,23 +173,168 @@ bool CompressedImage::DecompressImage(unsigned char *outBuf, unsigned int outBuf
   return true;
 }
 
+// Decodes width x height pixels worth of blocks in the given format into
+// tightly packed RGBA8 pixels. Images whose pixels don't fit in a single job
+// are decoded in bands of block rows, except for PVRTC, where every pixel
+// depends on the blocks around it.
+static bool DecompressBlocks(ECompressionFormat fmt, const uint8 *blocks,
+                             uint8 *outBuf, uint32 width, uint32 height) {
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(fmt, blockDims);
+  const uint32 blocksWide = (width + blockDims[0] - 1) / blockDims[0];
+  const uint32 blocksHigh = (height + blockDims[1] - 1) / blockDims[1];
+  const uint64 blockRowSz = static_cast<uint64>(width) * blockDims[1] * 4;
+  const uint32 bandBlockRows = static_cast<uint32>(
+    std::min<uint64>(blocksHigh, FasTC::kMaxJobPixelBytes / blockRowSz));
+
+  const bool bPVRTC = FasTC::COMPRESSION_FORMAT_PVRTC_BEGIN <= fmt &&
+    FasTC::COMPRESSION_FORMAT_PVRTC_END >= fmt;
+
+  // The ASTC decoder flips every band upside down, so the bands also have
+  // to be stacked from the bottom of the image up.
+  const bool bFlipped = FasTC::COMPRESSION_FORMAT_ASTC_BEGIN <= fmt &&
+    FasTC::COMPRESSION_FORMAT_ASTC_END >= fmt;
+  if(bandBlockRows == blocksHigh) {
+    return DecompressJob(fmt, blocks, outBuf, width, height);
+  } else if(bandBlockRows == 0 || bPVRTC) {
+    fprintf(stderr, "CompressedImage -- image is too large to decompress.\n");
+    return false;
+  }
+
+  const uint64 cmpBlockRowSz = static_cast<uint64>(blocksWide) * FasTC::GetBlockSize(fmt);
+  for(uint32 by = 0; by < blocksHigh; by += bandBlockRows) {
+    const uint32 y = by * blockDims[1];
+    const uint32 h = std::min(bandBlockRows * blockDims[1], height - y);
+    const uint64 outY = bFlipped? height - y - h : y;
+    uint8 *bandOut = outBuf + outY * width * 4;
+    if(!DecompressJob(fmt, blocks + by * cmpBlockRowSz, bandOut, width, h)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CompressedImage::DecompressImage(uint8 *outBuf, uint64 outBufSz) const {
+  FASTC_TRACE_ZONE("Decompress Image");
+
+  if(outBufSz < GetUncompressedSize()) {
+    fprintf(stderr, "CompressedImage -- output buffer is too small.\n");
+    return false;
+  }
+  return DecompressBlocks(m_Format, m_CompressedData, outBuf, GetWidth(), GetHeight());
+}
+
+bool CompressedImage::DecompressImage(FasTC::RGBA8Image *out) const {
+  FasTC::RGBA8Image result(GetWidth(), GetHeight());
+  if(!DecompressImage(result.GetData(), result.GetDataSize())) {
+    return false;
+  }
+
+  out->Swap(result);
+  return true;
+}
+
+bool CompressedImage::DecompressRegion(uint32 x, uint32 y, uint32 w, uint32 h,
+                                       FasTC::RGBA8Image *out) const {
+  if(w == 0 || h == 0 || x >= GetWidth() || y >= GetHeight() ||
+     w > GetWidth() - x || h > GetHeight() - y) {
+    fprintf(stderr, "CompressedImage -- region is outside of the image.\n");
+    return false;
+  }
+
+  FasTC::RGBA8Image decoded;
+  uint32 cropX = x, cropY = y;
+
+  if(FasTC::COMPRESSION_FORMAT_PVRTC_BEGIN <= m_Format &&
+     FasTC::COMPRESSION_FORMAT_PVRTC_END >= m_Format) {
+    if(!DecompressImage(&decoded)) {
+      return false;
+    }
+  } else {
+    uint32 blockDim[2];
+    FasTC::GetBlockDimensions(m_Format, blockDim);
+    const uint32 blockSz = FasTC::GetBlockSize(m_Format);
+    const uint32 blocksWide = (GetWidth() + blockDim[0] - 1) / blockDim[0];
+
+    // The ASTC decoder flips the image vertically, so its first row of
+    // blocks ends up at the bottom of the image.
+    const bool bFlipped = FasTC::COMPRESSION_FORMAT_ASTC_BEGIN <= m_Format &&
+      FasTC::COMPRESSION_FORMAT_ASTC_END >= m_Format;
+    const uint32 blockY = bFlipped? GetHeight() - y - h : y;
+
+    const uint32 firstBlockX = x / blockDim[0];
+    const uint32 firstBlockY = blockY / blockDim[1];
+    const uint32 nBlocksX = (x + w + blockDim[0] - 1) / blockDim[0] - firstBlockX;
+    const uint32 nBlocksY = (blockY + h + blockDim[1] - 1) / blockDim[1] - firstBlockY;
+
+    // Blocks are stored in rows, so the region's blocks are already
+    // contiguous when it spans the whole width of the image.
+    const uint8 *rowStart = m_CompressedData +
+      (static_cast<uint64>(firstBlockY) * blocksWide + firstBlockX) * blockSz;
+
+    const uint8 *blocks = rowStart;
+    uint8 *gathered = NULL;
+    if(nBlocksX != blocksWide) {
+      const uint64 regionRowSz = static_cast<uint64>(nBlocksX) * blockSz;
+      gathered = TCMemory::NewArray<uint8>(TCMemory::eCategory_Compressor,
+                                           regionRowSz * nBlocksY);
+      for(uint32 j = 0; j < nBlocksY; j++) {
+        const uint64 srcRow = static_cast<uint64>(j) * blocksWide * blockSz;
+        memcpy(gathered + j * regionRowSz, rowStart + srcRow, regionRowSz);
+      }
+      blocks = gathered;
+    }
+
+    FasTC::RGBA8Image result(nBlocksX * blockDim[0], nBlocksY * blockDim[1]);
+    const bool bOK = DecompressBlocks(m_Format, blocks, result.GetData(),
+                                      result.GetWidth(), result.GetHeight());
+    TCMemory::DeleteArray(TCMemory::eCategory_Compressor, gathered,
+                          static_cast<uint64>(nBlocksX) * blockSz * nBlocksY);
+    if(!bOK) {
+      return false;
+    }
+
+    decoded.Swap(result);
+    cropX = x - firstBlockX * blockDim[0];
+    cropY = blockY - firstBlockY * blockDim[1];
+    if(bFlipped) {
+      cropY = decoded.GetHeight() - cropY - h;
+    }
+  }
+
+  // Crop the decoded blocks down to the region.
+  FasTC::RGBA8Image region(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    memcpy(region.GetRow(j), decoded(cropX, cropY + j), region.GetRowSize());
+  }
+
+  out->Swap(region);
+  return true;
+}
+
 void CompressedImage::ComputePixels() {
 
-  uint32 unCompSz = GetWidth() * GetHeight() * 4;
-  uint8 *unCompBuf = new uint8[unCompSz];
-  DecompressImage(unCompBuf, unCompSz);
+  // Don't decompress the same data twice...
+  if(m_bDecodedPixelsValid) {
+    return;
+  }
+
+  FasTC::RGBA8Image unComp;
+  DecompressImage(&unComp);
 
-  uint32 * newPixelBuf = reinterpret_cast<uint32 *>(unCompBuf);
+  const uint32 *newPixelBuf = reinterpret_cast<const uint32 *>(unComp.GetData());
 
-  FasTC::Pixel *newPixels = new FasTC::Pixel[GetWidth() * GetHeight()];
+  FasTC::Pixel *newPixels = TCMemory::NewArray<FasTC::Pixel>(
+    TCMemory::eCategory_Image, GetNumPixels());
   for(uint32 i = 0; i < GetWidth() * GetHeight(); i++) {
     newPixels[i].Unpack(newPixelBuf[i]);
   }
 
   SetImageData(GetWidth(), GetHeight(), newPixels);
+  m_bDecodedPixelsValid = true;
 }
 
-uint32 CompressedImage::GetCompressedSize(uint32 width, uint32 height, ECompressionFormat format) {
+uint64 CompressedImage::GetCompressedSize(uint32 width, uint32 height, ECompressionFormat format) {
   // The compressed size is the block size times the number of blocks
   uint32 blockDim[2];
   GetBlockDimensions(format, blockDim);
@@ -142,7 +343,7 @@ uint32 CompressedImage::GetCompressedSize(uint32 width, uint32 height, ECompress
   const uint32 blocksHigh = (height + blockDim[1] - 1) / blockDim[1];
   const uint32 uncompBlockSize = blockDim[0] * blockDim[1] * sizeof(uint32);
 
-  const uint32 nBlocks = blocksWide * blocksHigh;
+  const uint64 nBlocks = static_cast<uint64>(blocksWide) * blocksHigh;
   const uint32 blockSz = GetBlockSize(format);
 
   return nBlocks * blockSz;
@@ -0,0 +1,633 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "FasTC/CompressionCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <Windows.h>
+#  include <direct.h>
+#  include <sys/types.h>
+#  include <sys/utime.h>
+#  undef min
+#  undef max
+#else
+#  include <dirent.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#  include <unistd.h>
+#  include <utime.h>
+#endif
+
+#include "FasTC/Memory.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/Trace.h"
+
+#include "CompressionFuncs.h"
+
+using FasTC::ECompressionFormat;
+
+// The version of the encoder of each format. Bump it whenever the encoder
+// starts producing different blocks for the same pixels and settings, so
+// that the blocks produced by the old one are no longer used.
+static uint32 GetEncoderVersion(ECompressionFormat format) {
+  switch(format) {
+    // 2: Simulated annealing is seeded from the pixels of each block.
+    case FasTC::eCompressionFormat_BPTC: return 2;
+    default: return 1;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Entries
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Each entry starts with a header, all of whose fields are little endian:
+//   0: kMagic
+//   4: kFileVersion
+//   8: encoder version
+//  12: format
+//  16: width
+//  20: height
+//  24: quality, or zero if the format doesn't use it
+//  28: reserved, zero
+//  32: 128 bit hash of the pixels
+//  48: size of the blocks in bytes
+//  56: hash of the blocks
+// The blocks follow the header. The first kKeySz bytes of the header are all
+// that's known before compressing, and they are hashed to name the entry.
+static const uint8 kMagic[4] = { 'F', 'T', 'C', 'C' };
+static const uint32 kFileVersion = 1;
+static const uint32 kHeaderSz = 64;
+static const uint32 kKeySz = 48;
+
+static const char *kEntryExtension = ".ftcc";
+static const char *kTempExtension = ".tmp";
+
+// Temporary files this old were left behind by a process that went away.
+static const double kStaleTempFileSeconds = 60.0 * 60.0;
+
+static void WriteLE32(uint8 *out, uint32 x) {
+  for(uint32 i = 0; i < 4; i++) {
+    out[i] = static_cast<uint8>(x >> (8 * i));
+  }
+}
+
+static void WriteLE64(uint8 *out, uint64 x) {
+  for(uint32 i = 0; i < 8; i++) {
+    out[i] = static_cast<uint8>(x >> (8 * i));
+  }
+}
+
+static uint64 ReadLE64(const uint8 *in) {
+  uint64 x = 0;
+  for(uint32 i = 0; i < 8; i++) {
+    x |= static_cast<uint64>(in[i]) << (8 * i);
+  }
+  return x;
+}
+
+// MurmurHash64A by Austin Appleby, which is in the public domain, run twice
+// over the data at once with different seeds to get 128 bits.
+static void HashBytes(const uint8 *data, uint64 sz, uint64 out[2]) {
+  const uint64 m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+
+  uint64 h[2] = {
+    0x9ae16a3b2f90404fULL ^ (sz * m),
+    0xc3a5c85c97cb3127ULL ^ (sz * m)
+  };
+
+  const uint64 nWords = sz / 8;
+  for(uint64 i = 0; i < nWords; i++) {
+    uint64 k;
+    memcpy(&k, data + i * 8, 8);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h[0] ^= k;
+    h[0] *= m;
+    h[1] ^= k;
+    h[1] *= m;
+  }
+
+  const uint8 *tail = data + nWords * 8;
+  const uint32 tailSz = static_cast<uint32>(sz & 7);
+  if(tailSz > 0) {
+    uint64 k = 0;
+    for(uint32 i = 0; i < tailSz; i++) {
+      k |= static_cast<uint64>(tail[i]) << (8 * i);
+    }
+    h[0] ^= k;
+    h[0] *= m;
+    h[1] ^= k;
+    h[1] *= m;
+  }
+
+  for(uint32 i = 0; i < 2; i++) {
+    h[i] ^= h[i] >> r;
+    h[i] *= m;
+    h[i] ^= h[i] >> r;
+    out[i] = h[i];
+  }
+}
+
+// Fills in the part of the header that identifies the pixels and settings.
+static void WriteKey(const uint8 *data, uint32 width, uint32 height,
+                     const SCompressionSettings &settings,
+                     uint8 (&header)[kHeaderSz]) {
+  FASTC_TRACE_ZONE("Hash Pixels");
+
+  // Only BPTC uses the quality.
+  const uint32 quality = (settings.format == FasTC::eCompressionFormat_BPTC)?
+    static_cast<uint32>(settings.iQuality) : 0;
+
+  memset(header, 0, kHeaderSz);
+  memcpy(header, kMagic, 4);
+  WriteLE32(header + 4, kFileVersion);
+  WriteLE32(header + 8, GetEncoderVersion(settings.format));
+  WriteLE32(header + 12, static_cast<uint32>(settings.format));
+  WriteLE32(header + 16, width);
+  WriteLE32(header + 20, height);
+  WriteLE32(header + 24, quality);
+
+  uint64 pixelHash[2];
+  HashBytes(data, static_cast<uint64>(width) * height * 4, pixelHash);
+  WriteLE64(header + 32, pixelHash[0]);
+  WriteLE64(header + 40, pixelHash[1]);
+}
+
+// Returns the name of the entry for a header whose key is filled in.
+static std::string EntryName(const uint8 (&header)[kHeaderSz]) {
+  uint64 key[2];
+  HashBytes(header, kKeySz, key);
+
+  char name[64];
+  sprintf(name, "%016llx%016llx%s",
+          static_cast<unsigned long long>(key[0]),
+          static_cast<unsigned long long>(key[1]), kEntryExtension);
+  return name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// File system
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static bool IsSeparator(char c) {
+  return c == '/' || c == '\\';
+}
+
+static std::string JoinPath(const std::string &dir, const std::string &name) {
+  if(dir.empty() || IsSeparator(dir[dir.size() - 1])) {
+    return dir + name;
+  }
+  return dir + "/" + name;
+}
+
+static bool EndsWith(const std::string &str, const char *suffix) {
+  const size_t suffixSz = strlen(suffix);
+  return str.size() >= suffixSz &&
+    str.compare(str.size() - suffixSz, suffixSz, suffix) == 0;
+}
+
+static bool IsDirectory(const char *path) {
+#ifdef _WIN32
+  DWORD attrs = GetFileAttributesA(path);
+  return attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY);
+#else
+  struct stat st;
+  return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+static bool MakeDirectories(const std::string &path) {
+  for(size_t i = 1; i <= path.size(); i++) {
+    if(i == path.size() || IsSeparator(path[i])) {
+      const std::string dir = path.substr(0, i);
+      if(!IsDirectory(dir.c_str())) {
+#ifdef _WIN32
+        _mkdir(dir.c_str());
+#else
+        mkdir(dir.c_str(), 0777);
+#endif
+      }
+    }
+  }
+  return IsDirectory(path.c_str());
+}
+
+static bool ListDirectory(const std::string &dir, std::vector<std::string> &names) {
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE h = FindFirstFileA(JoinPath(dir, "*").c_str(), &data);
+  if(h == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  do {
+    names.push_back(data.cFileName);
+  } while(FindNextFileA(h, &data));
+  FindClose(h);
+#else
+  DIR *d = opendir(dir.c_str());
+  if(NULL == d) {
+    return false;
+  }
+
+  struct dirent *entry;
+  while((entry = readdir(d)) != NULL) {
+    names.push_back(entry->d_name);
+  }
+  closedir(d);
+#endif
+  return true;
+}
+
+// Gets the size of the file and the time it was last modified in seconds
+// since the epoch. Entries are often written within the same second, so the
+// time keeps whatever fraction of a second the file system records.
+static bool GetFileInfo(const char *path, uint64 *size, double *mtime) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if(!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) {
+    return false;
+  }
+  *size = (static_cast<uint64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+
+  // FILETIMEs count 100ns intervals since 1601.
+  const uint64 ft = (static_cast<uint64>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+    data.ftLastWriteTime.dwLowDateTime;
+  *mtime = static_cast<double>(ft - 116444736000000000ULL) * 1e-7;
+#else
+  struct stat st;
+  if(stat(path, &st) != 0) {
+    return false;
+  }
+  *size = static_cast<uint64>(st.st_size);
+#  if defined(__APPLE__)
+  *mtime = static_cast<double>(st.st_mtimespec.tv_sec) + st.st_mtimespec.tv_nsec * 1e-9;
+#  else
+  *mtime = static_cast<double>(st.st_mtim.tv_sec) + st.st_mtim.tv_nsec * 1e-9;
+#  endif
+#endif
+  return true;
+}
+
+// Marks the file as just used.
+static void TouchFile(const char *path) {
+#ifdef _WIN32
+  _utime(path, NULL);
+#else
+  utime(path, NULL);
+#endif
+}
+
+// Moves src over dst in a single step, so that dst is always either the old
+// file or the new one.
+static bool ReplaceFile(const char *src, const char *dst) {
+#ifdef _WIN32
+  return MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return rename(src, dst) == 0;
+#endif
+}
+
+static unsigned long GetProcessID() {
+#ifdef _WIN32
+  return static_cast<unsigned long>(GetCurrentProcessId());
+#else
+  return static_cast<unsigned long>(getpid());
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CompressionCache
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CompressionCache::CompressionCache(const char *path, uint64 maxBytes)
+  : m_Path(path)
+  , m_MaxBytes(maxBytes)
+  , m_bValid(false)
+  , m_TotalBytes(0)
+  , m_NumHits(0)
+  , m_NumMisses(0)
+  , m_NumTempFiles(0)
+{
+  m_bValid = MakeDirectories(m_Path);
+  if(!m_bValid) {
+    fprintf(stderr, "CompressionCache -- Unable to create directory: %s\n", path);
+    return;
+  }
+
+  TCLock lock(m_Mutex);
+  Trim();
+}
+
+bool CompressionCache::IsCacheable(const SCompressionSettings &settings) {
+  // The versions of PVRTexLib and NVTT aren't known, and the SIMD BPTC
+  // compressor doesn't produce the same blocks every time.
+  const bool bBPTC = settings.format == FasTC::eCompressionFormat_BPTC;
+  const bool bPVRTC = settings.format == FasTC::eCompressionFormat_PVRTC4;
+  return NULL == settings.blockStats &&
+    !(bBPTC && (settings.bUseSIMD || settings.bUseNVTT)) &&
+    !(bPVRTC && settings.bUsePVRTexLib);
+}
+
+bool CompressionCache::Load(const uint8 *data, uint32 width, uint32 height,
+                            const SCompressionSettings &settings,
+                            uint8 *cmpData, uint64 cmpDataSz) {
+  FASTC_TRACE_ZONE("Cache Load");
+
+  if(!m_bValid || !IsCacheable(settings)) {
+    return false;
+  }
+
+  uint8 expected[kHeaderSz];
+  WriteKey(data, width, height, settings, expected);
+  const std::string path = JoinPath(m_Path, EntryName(expected));
+
+  bool bFound = false;
+  bool bCorrupt = false;
+  FILE *f = fopen(path.c_str(), "rb");
+  if(f) {
+    uint8 header[kHeaderSz];
+    if(fread(header, 1, kHeaderSz, f) != kHeaderSz) {
+      bCorrupt = true;
+    } else if(memcmp(header, expected, kKeySz) == 0 &&
+              ReadLE64(header + 48) == cmpDataSz) {
+      uint64 blockHash[2];
+      if(fread(cmpData, 1, cmpDataSz, f) != cmpDataSz) {
+        bCorrupt = true;
+      } else {
+        HashBytes(cmpData, cmpDataSz, blockHash);
+        bFound = blockHash[0] == ReadLE64(header + 56);
+        bCorrupt = !bFound;
+      }
+    }
+    fclose(f);
+  }
+
+  if(bFound) {
+    TouchFile(path.c_str());
+  } else if(bCorrupt) {
+    fprintf(stderr, "CompressionCache -- Removing damaged entry: %s\n", path.c_str());
+    remove(path.c_str());
+  }
+
+  TCLock lock(m_Mutex);
+  if(bFound) {
+    m_NumHits++;
+  } else {
+    m_NumMisses++;
+  }
+  return bFound;
+}
+
+bool CompressionCache::Store(const uint8 *data, uint32 width, uint32 height,
+                             const SCompressionSettings &settings,
+                             const uint8 *cmpData, uint64 cmpDataSz) {
+  FASTC_TRACE_ZONE("Cache Store");
+
+  if(!m_bValid || !IsCacheable(settings)) {
+    return false;
+  }
+
+  uint8 header[kHeaderSz];
+  WriteKey(data, width, height, settings, header);
+
+  uint64 blockHash[2];
+  HashBytes(cmpData, cmpDataSz, blockHash);
+  WriteLE64(header + 48, cmpDataSz);
+  WriteLE64(header + 56, blockHash[0]);
+
+  const std::string name = EntryName(header);
+  const std::string path = JoinPath(m_Path, name);
+
+  uint32 tempIdx;
+  {
+    TCLock lock(m_Mutex);
+    tempIdx = m_NumTempFiles++;
+  }
+
+  char tempSuffix[64];
+  sprintf(tempSuffix, ".%lu.%u%s", GetProcessID(), tempIdx, kTempExtension);
+  const std::string tempPath = path + tempSuffix;
+
+  FILE *f = fopen(tempPath.c_str(), "wb");
+  if(NULL == f) {
+    return false;
+  }
+
+  bool bWritten =
+    fwrite(header, 1, kHeaderSz, f) == kHeaderSz &&
+    fwrite(cmpData, 1, cmpDataSz, f) == cmpDataSz;
+  bWritten = (fclose(f) == 0) && bWritten;
+
+  // Another process may have stored the same entry in the meantime, in which
+  // case ours simply replaces it.
+  if(!bWritten || !ReplaceFile(tempPath.c_str(), path.c_str())) {
+    remove(tempPath.c_str());
+    return false;
+  }
+
+  TCLock lock(m_Mutex);
+  m_TotalBytes += kHeaderSz + cmpDataSz;
+  if(m_MaxBytes > 0 && m_TotalBytes > m_MaxBytes) {
+    Trim();
+  }
+  return true;
+}
+
+uint64 CompressionCache::GetNumHits() const {
+  TCLock lock(m_Mutex);
+  return m_NumHits;
+}
+
+uint64 CompressionCache::GetNumMisses() const {
+  TCLock lock(m_Mutex);
+  return m_NumMisses;
+}
+
+struct CacheEntry {
+  std::string path;
+  uint64 size;
+  double mtime;
+
+  bool operator<(const CacheEntry &other) const {
+    return mtime < other.mtime;
+  }
+};
+
+void CompressionCache::Trim() {
+  FASTC_TRACE_ZONE("Cache Trim");
+
+  std::vector<std::string> names;
+  if(!ListDirectory(m_Path, names)) {
+    return;
+  }
+
+  const double now = static_cast<double>(time(NULL));
+  std::vector<CacheEntry> entries;
+  m_TotalBytes = 0;
+  for(size_t i = 0; i < names.size(); i++) {
+    const bool bEntry = EndsWith(names[i], kEntryExtension);
+    const bool bTemp = EndsWith(names[i], kTempExtension);
+    if(!bEntry && !bTemp) {
+      continue;
+    }
+
+    CacheEntry entry;
+    entry.path = JoinPath(m_Path, names[i]);
+    if(!GetFileInfo(entry.path.c_str(), &entry.size, &entry.mtime)) {
+      continue;
+    }
+
+    if(bTemp) {
+      if(now - entry.mtime > kStaleTempFileSeconds) {
+        remove(entry.path.c_str());
+      }
+      continue;
+    }
+
+    entries.push_back(entry);
+    m_TotalBytes += entry.size;
+  }
+
+  if(0 == m_MaxBytes || m_TotalBytes <= m_MaxBytes) {
+    return;
+  }
+
+  // Leave some room so that the next few entries don't each have to trim
+  // the cache again.
+  const uint64 target = m_MaxBytes - m_MaxBytes / 8;
+  std::sort(entries.begin(), entries.end());
+  for(size_t i = 0; i < entries.size() && m_TotalBytes > target; i++) {
+    // If another process removed it first, it's gone all the same.
+    remove(entries[i].path.c_str());
+    m_TotalBytes -= entries[i].size;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Compression
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool CompressImageDataCached(
+  CompressionCache &cache,
+  const uint8 *data,
+  const uint32 width,
+  const uint32 height,
+  uint8 *cmpData,
+  const uint64 cmpDataSz,
+  const SCompressionSettings &settings,
+  double *cmpTimeMS,
+  bool *bCacheHit
+) {
+  CompressionMemoryScope memoryScope(settings);
+  if(bCacheHit) {
+    *bCacheHit = false;
+  }
+
+  // Leave it to CompressImageData to complain about the buffer being too
+  // small.
+  const uint64 sz = CompressedImage::GetCompressedSize(width, height, settings.format);
+  if(sz > 0 && sz <= cmpDataSz &&
+     cache.Load(data, width, height, settings, cmpData, sz)) {
+    if(cmpTimeMS) {
+      *cmpTimeMS = 0.0;
+    }
+    if(bCacheHit) {
+      *bCacheHit = true;
+    }
+    return true;
+  }
+
+  if(!CompressImageData(data, width, height, cmpData, cmpDataSz, settings, cmpTimeMS)) {
+    return false;
+  }
+
+  cache.Store(data, width, height, settings, cmpData, sz);
+  return true;
+}
+
+CompressedImage *CompressImageCached(
+  CompressionCache &cache,
+  const FasTC::RGBA8Image *img,
+  const SCompressionSettings &settings,
+  double *cmpTimeMS,
+  bool *bCacheHit
+) {
+  if(bCacheHit) {
+    *bCacheHit = false;
+  }
+
+  if(!img) {
+    return NULL;
+  }
+
+  const uint32 width = img->GetWidth();
+  const uint32 height = img->GetHeight();
+
+  // The blocks are stored under the pixels that were given to us, but
+  // CompressImage pads them to a multiple of the block size first.
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(settings.format, blockDims);
+  const uint32 paddedWidth = ((width + (blockDims[0] - 1)) / blockDims[0]) * blockDims[0];
+  const uint32 paddedHeight = ((height + (blockDims[1] - 1)) / blockDims[1]) * blockDims[1];
+
+  const uint64 cmpDataSz =
+    CompressedImage::GetCompressedSize(paddedWidth, paddedHeight, settings.format);
+  if(cmpDataSz > 0 && CompressionCache::IsCacheable(settings)) {
+    uint8 *cmpData =
+      TCMemory::NewArray<uint8>(TCMemory::eCategory_CompressedData, cmpDataSz);
+    if(cache.Load(img->GetData(), width, height, settings, cmpData, cmpDataSz)) {
+      if(cmpTimeMS) {
+        *cmpTimeMS = 0.0;
+      }
+      if(bCacheHit) {
+        *bCacheHit = true;
+      }
+      return new CompressedImage(paddedWidth, paddedHeight, settings.format, cmpData,
+                                 CompressedImage::eTakeOwnership);
+    }
+    TCMemory::DeleteArray(TCMemory::eCategory_CompressedData, cmpData, cmpDataSz);
+  }
+
+  CompressedImage *ci = CompressImage(img, settings, cmpTimeMS);
+  if(ci) {
+    cache.Store(img->GetData(), width, height, settings,
+                ci->GetCompressedData(), ci->GetCompressedSize());
+  }
+  return ci;
+}
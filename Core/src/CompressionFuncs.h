@@ -18,8 +18,10 @@
 #ifndef CORE_SRC_COMPRESSIONFUNCS_H_
 #define CORE_SRC_COMPRESSIONFUNCS_H_
 
+#include "FasTC/BlockStats.h"
 #include "FasTC/CompressionJob.h"
-#include <iosfwd>
+#include "FasTC/Memory.h"
+#include "FasTC/TexComp.h"
 
 // A compression function format. It takes the raw data and image dimensions and 
 // returns the compressed image data into outData. It is assumed that there is
@@ -27,10 +29,27 @@
 // is dependent on the compression format.
 typedef void (* CompressionFunc)(const FasTC::CompressionJob &);
 
-// A compression function format. It takes the raw data and image dimensions and 
-// returns the compressed image data into outData. It is assumed that there is
-// enough space allocated for outData to store the compressed data. Allocation
-// is dependent on the compression format.
-typedef void (* CompressionFuncWithStats)(const FasTC::CompressionJob &, std::ostream *logStream);
+// The same as above, but the function also adds a record for each block that
+// it compresses to stats. The list is only ever touched by the calling thread.
+typedef void (* CompressionFuncWithStats)(const FasTC::CompressionJob &, FasTC::BlockStatList *stats);
+
+// Counts the memory used by one call to a compression function, along with
+// the threads that it starts, and hands the counts to settings.memoryStats
+// once the call returns.
+class CompressionMemoryScope {
+ public:
+  explicit CompressionMemoryScope(const SCompressionSettings &settings)
+    : m_Stats(settings.memoryStats) { }
+
+  ~CompressionMemoryScope() {
+    if(m_Stats) {
+      *m_Stats = m_Scope.GetStats();
+    }
+  }
+
+ private:
+  TCMemory::Scope m_Scope;
+  TCMemory::Stats *m_Stats;
+};
 
 #endif  // CORE_SRC_COMPRESSIONFUNCS_H_
@@ -23,17 +23,21 @@
 #include <cassert>
 #include <iostream>
 #include <string.h>
+#include <vector>
 
 #include "FasTC/BPTCCompressor.h"
 #include "FasTC/CompressionFormat.h"
 #include "FasTC/DXTCompressor.h"
 #include "FasTC/ETCCompressor.h"
 #include "FasTC/ImageFile.h"
+#include "FasTC/Memory.h"
 #include "FasTC/Pixel.h"
 #include "FasTC/PVRTCCompressor.h"
+#include "FasTC/RGBAImage.h"
 
 #include "CompressionFuncs.h"
-#include "Thread.h"
+#include "FasTC/Thread.h"
+#include "FasTC/Trace.h"
 #include "ThreadGroup.h"
 #include "WorkerQueue.h"
 
@@ -51,20 +55,30 @@ static inline T sad(const T &a, const T &b) {
   return (a > b)? a - b : b - a;
 }
 
-static BPTCC::CompressionSettings gBPTCSettings;
+static BPTCC::CompressionSettings GetBPTCSettings(const CompressionJob &cj) {
+  BPTCC::CompressionSettings settings;
+  settings.m_NumSimulatedAnnealingSteps = cj.Quality();
+  return settings;
+}
+
 static void CompressBPTC(const CompressionJob &cj) {
-  BPTCC::Compress(cj, gBPTCSettings);
+  BPTCC::Compress(cj, GetBPTCSettings(cj));
 }
 
 static void CompressBPTCWithStats(const CompressionJob &cj,
-                                  std::ostream *strm) {
-  BPTCC::CompressWithStats(cj, strm, gBPTCSettings);
+                                  FasTC::BlockStatList *stats) {
+  BPTCC::CompressWithStats(cj, stats, GetBPTCSettings(cj));
 }
 
 static void CompressPVRTC(const CompressionJob &cj) {
   PVRTCC::Compress(cj);
 }
 
+static void CompressPVRTCWithStats(const CompressionJob &cj,
+                                   FasTC::BlockStatList *stats) {
+  PVRTCC::CompressWithStats(cj, stats);
+}
+
 static void CompressPVRTCLib(const CompressionJob &cj) {
 #ifdef PVRTEXLIB_FOUND
   PVRTCC::CompressPVRLib(cj);
@@ -78,8 +92,14 @@ SCompressionSettings:: SCompressionSettings()
   : format(FasTC::eCompressionFormat_BPTC)
   , bUseSIMD(false)
   , iNumThreads(1)
-  , iQuality(50)
+  , iQuality(FasTC::kDefaultQuality)
   , iNumCompressions(1)
+  , iJobSize(0)
+  , bUseAtomics(false)
+  , bUsePVRTexLib(false)
+  , bUseNVTT(false)
+  , blockStats(NULL)
+  , memoryStats(NULL)
 {
   clamp(iQuality, 0, 256);
 }
@@ -97,7 +117,26 @@ static  CompressionFuncWithStats ChooseFuncFromSettingsWithStats(const SCompress
        return CompressBPTCWithStats;
     }
     break;
-    
+
+    case FasTC::eCompressionFormat_DXT1:
+      return DXTC::CompressImageDXT1WithStats;
+
+    case FasTC::eCompressionFormat_DXT5:
+      return DXTC::CompressImageDXT5WithStats;
+
+    case FasTC::eCompressionFormat_PVRTC4:
+    {
+      // PVRTexLib doesn't tell us anything about the blocks.
+      if(s.bUsePVRTexLib) {
+        return NULL;
+      } else {
+        return CompressPVRTCWithStats;
+      }
+    }
+
+    case FasTC::eCompressionFormat_ETC1:
+      return ETCC::Compress_RGWithStats;
+
     default:
     {
       assert(!"Not implemented!");
@@ -111,7 +150,6 @@ static CompressionFunc ChooseFuncFromSettings(const SCompressionSettings &s) {
   switch(s.format) {
     case FasTC::eCompressionFormat_BPTC:
     {
-      gBPTCSettings.m_NumSimulatedAnnealingSteps = s.iQuality;
 #ifdef HAS_SSE_41
       if(s.bUseSIMD) {
         return BPTCC::CompressImageBPTCSIMD;
@@ -164,7 +202,7 @@ static double CompressImageInSerial(
 ) {
   CompressionFunc f = ChooseFuncFromSettings(settings);
   CompressionFuncWithStats fStats = NULL;
-  if (settings.logStream) {
+  if (settings.blockStats) {
     fStats = ChooseFuncFromSettingsWithStats(settings);
   }
 
@@ -176,8 +214,8 @@ static double CompressImageInSerial(
     stopWatch.Reset();
     stopWatch.Start();
 
-    if(fStats && settings.logStream) {
-      (*fStats)(job, settings.logStream);
+    if(fStats) {
+      (*fStats)(job, settings.blockStats);
     } else {
       (*f)(job);
     }
@@ -310,11 +348,14 @@ static double CompressImageWithThreads(
 ) {
 
   CompressionFunc f = ChooseFuncFromSettings(settings);
-  CompressionFuncWithStats fStats = ChooseFuncFromSettingsWithStats(settings);
+  CompressionFuncWithStats fStats = NULL;
+  if (settings.blockStats) {
+    fStats = ChooseFuncFromSettingsWithStats(settings);
+  }
 
   double cmpTimeTotal = 0.0;
-  if(fStats && settings.logStream) {
-    ThreadGroup tgrp (settings.iNumThreads, job, fStats, settings.logStream);
+  if(fStats) {
+    ThreadGroup tgrp (settings.iNumThreads, job, fStats, settings.blockStats);
     cmpTimeTotal = CompressThreadGroup(tgrp, settings);
   }
   else {
@@ -336,17 +377,20 @@ static double CompressImageWithWorkerQueue(
   const SCompressionSettings &settings
 ) {
   CompressionFunc f = ChooseFuncFromSettings(settings);
-  CompressionFuncWithStats fStats = ChooseFuncFromSettingsWithStats(settings);
+  CompressionFuncWithStats fStats = NULL;
+  if (settings.blockStats) {
+    fStats = ChooseFuncFromSettingsWithStats(settings);
+  }
 
   double cmpTimeTotal = 0.0;
-  if(fStats && settings.logStream) {
+  if(fStats) {
     WorkerQueue wq (
       settings.iNumCompressions,
       settings.iNumThreads,
       settings.iJobSize,
       job,
       fStats,
-      settings.logStream
+      settings.blockStats
     );
     cmpTimeTotal = RunWorkerQueue(wq);
   }
@@ -364,10 +408,132 @@ static double CompressImageWithWorkerQueue(
   return cmpTimeTotal / double(settings.iNumCompressions);
 }
 
-template<typename PixelType>
+// Make sure that the platform supports the options that were chosen.
+static bool CheckPlatformSupport(const SCompressionSettings &settings) {
+  #ifndef HAS_SSE_41
+  if(settings.bUseSIMD) {
+    ReportError("Platform does not support SIMD!\n");
+    return false;
+  }
+  #endif
+
+  #ifndef HAS_ATOMICS
+  if(settings.bUseAtomics) {
+    ReportError("Compiler's atomic operations are not supported!\n");
+    return false;
+  }
+  #endif
+
+  return true;
+}
+
+// Compresses a job with whichever threading model the settings ask for, and
+// returns the average time taken in milliseconds.
+static double CompressJob(
+  const CompressionJob &cj,
+  const uint32 numThreads,
+  const SCompressionSettings &settings
+) {
+  FASTC_TRACE_ZONE("Compress Job");
+
+  const size_t firstStat = settings.blockStats? settings.blockStats->Size() : 0;
+
+  double cmpTime;
+  if(numThreads > 1) {
+    if(settings.bUseAtomics) {
+      cmpTime = CompressImageWithAtomics(cj, settings);
+    } else if(settings.iJobSize > 0) {
+      cmpTime = CompressImageWithWorkerQueue(cj, settings);
+    } else {
+      cmpTime = CompressImageWithThreads(cj, settings);
+    }
+  } else {
+    cmpTime = CompressImageInSerial(cj, settings);
+  }
+
+  // The threads hand back their records in the order that they finished
+  // their share of the blocks.
+  if(settings.blockStats) {
+    settings.blockStats->SortByBlock(firstStat);
+  }
+
+  return cmpTime;
+}
+
+// Moves the records added since firstStat from the block indices of a region
+// that is regionBlocksW blocks wide, and whose first block is at (bx, by), to
+// the block indices of the whole image, which is imageBlocksW blocks wide.
+static void OffsetBlockStats(FasTC::BlockStatList *stats, size_t firstStat,
+                             uint32 regionBlocksW, uint32 bx, uint32 by,
+                             uint32 imageBlocksW) {
+  if(!stats) {
+    return;
+  }
+
+  for(size_t i = firstStat; i < stats->Size(); i++) {
+    FasTC::BlockStat &s = (*stats)[i];
+    const uint32 x = bx + s.m_BlockIdx % regionBlocksW;
+    const uint32 y = by + s.m_BlockIdx / regionBlocksW;
+    s.m_BlockIdx = y * imageBlocksW + x;
+  }
+}
+
+// Makes sure that a width x height image, whose dimensions are already a
+// multiple of the block size, can be compressed with the settings, and
+// returns the number of threads that it will be compressed with.
+static bool CheckImageData(const uint32 width, const uint32 height,
+                           const SCompressionSettings &settings,
+                           uint32 *numThreads) {
+  *numThreads = settings.iNumThreads;
+  if(settings.format == FasTC::eCompressionFormat_PVRTC4 &&
+     (settings.iNumThreads > 1 || (settings.blockStats && settings.bUsePVRTexLib))) {
+    if(settings.iNumThreads > 1) {
+      ReportError("WARNING - PVRTC compressor does not support multithreading.");
+      *numThreads = 1;
+    }
+
+    if(settings.blockStats && settings.bUsePVRTexLib) {
+      ReportError("WARNING - PVRTexLib does not support stat collection.");
+    }
+  }
+
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(settings.format, blockDims);
+  if ((width % blockDims[0]) != 0 || (height % blockDims[1]) != 0) {
+    ReportError("ERROR - CompressImageData: width or height is not multiple of block dimension");
+    return false;
+  } else if (settings.format == FasTC::eCompressionFormat_PVRTC4 &&
+             ((width & (width - 1)) != 0 ||
+              (height & (height - 1)) != 0 ||
+              width != height)) {
+    ReportError("ERROR - CompressImageData: PVRTC4 images must be square and power-of-two.");
+    return false;
+  }
+
+  return true;
+}
+
+// Copies img into the top left corner of out, which is resized to
+// width x height, and fills the rest of out with zeros.
+static void CopyPadded(const FasTC::RGBA8Image &img, uint32 width,
+                       uint32 height, FasTC::RGBA8Image *out) {
+  FasTC::RGBA8Image tmp(width, height);
+  if(width != img.GetWidth() || height != img.GetHeight()) {
+    memset(tmp.GetData(), 0, tmp.GetDataSize());
+  }
+  for(uint32 j = 0; j < img.GetHeight(); j++) {
+    memcpy(tmp.GetRow(j), img.GetRow(j), img.GetRowSize());
+  }
+  out->Swap(tmp);
+}
+
 CompressedImage *CompressImage(
-  FasTC::Image<PixelType> *img, const SCompressionSettings &settings
+  const FasTC::RGBA8Image *img, const SCompressionSettings &settings,
+  double *cmpTimeMS
 ) {
+  FASTC_TRACE_ZONE("Compress Image");
+  CompressionMemoryScope memoryScope(settings);
+
   if(!img) return NULL;
 
   uint32 width = img->GetWidth();
@@ -377,9 +543,13 @@ CompressedImage *CompressImage(
 
   // Make sure that the width and height of the image is a multiple of
   // the block size of the format
+  const FasTC::RGBA8Image *src = img;
+  FasTC::RGBA8Image padded;
+
   uint32 blockDims[2];
   FasTC::GetBlockDimensions(settings.format, blockDims);
   if ((width % blockDims[0]) != 0 || (height % blockDims[1]) != 0) {
+    FASTC_TRACE_ZONE("Pad Image");
     ReportError("WARNING - Image size is not a multiple of block size. Padding with zeros...");
     uint32 newWidth = ((width + (blockDims[0] - 1)) / blockDims[0]) * blockDims[0];
     uint32 newHeight = ((height + (blockDims[1] - 1)) / blockDims[1]) * blockDims[1];
@@ -388,35 +558,46 @@ CompressedImage *CompressImage(
     assert(newWidth % blockDims[0] == 0);
     assert(newHeight % blockDims[1] == 0);
 
+    CopyPadded(*img, newWidth, newHeight, &padded);
+    src = &padded;
+
     width = newWidth;
     height = newHeight;
   }
 
-  uint32 *data = new uint32[width * height];
-  memset(data, 0, width * height * sizeof(data[0]));
+  // Allocate data based on the compression method
+  uint64 cmpDataSz = CompressedImage::GetCompressedSize(width, height, settings.format);
+  uint8 *cmpData =
+    TCMemory::NewArray<uint8>(TCMemory::eCategory_CompressedData, cmpDataSz);
+  if (!CompressImageData(src->GetData(), width, height, cmpData, cmpDataSz, settings, cmpTimeMS)) {
+    TCMemory::DeleteArray(TCMemory::eCategory_CompressedData, cmpData, cmpDataSz);
+    return NULL;
+  }
 
-  CompressedImage *outImg = NULL;
+  // The compressed image takes over the buffer that we compressed into.
+  return new CompressedImage(width, height, settings.format, cmpData,
+                             CompressedImage::eTakeOwnership);
+}
 
-  // Allocate data based on the compression method
-  uint32 cmpDataSz = CompressedImage::GetCompressedSize(width, height, settings.format);
+template<typename PixelType>
+CompressedImage *CompressImage(
+  FasTC::Image<PixelType> *img, const SCompressionSettings &settings
+) {
+  CompressionMemoryScope memoryScope(settings);
+  if(!img) return NULL;
 
   // Make sure that we have RGBA data...
   img->ComputePixels();
+
+  FasTC::RGBA8Image rgba(img->GetWidth(), img->GetHeight());
+  uint32 *data = reinterpret_cast<uint32 *>(rgba.GetData());
   for(uint32 j = 0; j < img->GetHeight(); j++) {
     for(uint32 i = 0; i < img->GetWidth(); i++) {
-      data[j * width + i] = (*img)(i, j).Pack();
+      data[j * img->GetWidth() + i] = (*img)(i, j).Pack();
     }
   }
 
-  unsigned char *cmpData = new unsigned char[cmpDataSz];
-  uint8 *dataPtr = reinterpret_cast<uint8 *>(data);
-  if (CompressImageData(dataPtr, width, height, cmpData, cmpDataSz, settings)) {
-    outImg = new CompressedImage(width, height, settings.format, cmpData);
-  }
-
-  delete [] data;
-  delete [] cmpData;
-  return outImg;
+  return CompressImage(&rgba, settings);
 }
 
 // !FIXME! Ideally, we wouldn't have to do this because there would be a way to instantiate this
@@ -424,66 +605,503 @@ CompressedImage *CompressImage(
 // at the moment.
 template CompressedImage *CompressImage(FasTC::Image<FasTC::Pixel> *, const SCompressionSettings &settings);
 
-bool CompressImageData(
-  const uint8 *data, 
-  const uint32 width,
-  const uint32 height,
-  uint8 *compressedData,
-  const uint32 cmpDataSz,
-  const SCompressionSettings &settings
-) {
+// Sources hand out tightly packed rows of pixels that are w pixels wide. This
+// spreads the first nRows of them out to the full width of img, starting from
+// the last row, which never overwrites a row that hasn't moved yet, and fills
+// everything to the right of and below them with zeros.
+static void PadRows(FasTC::RGBA8Image *img, uint32 w, uint32 nRows) {
+  const uint32 srcRowSz = w * 4;
+  const uint32 dstRowSz = img->GetRowSize();
+  if(srcRowSz != dstRowSz) {
+    for(uint32 j = nRows; j > 0; j--) {
+      uint8 *row = img->GetRow(j - 1);
+      memmove(row, img->GetData() + (j - 1) * srcRowSz, srcRowSz);
+      memset(row + srcRowSz, 0, dstRowSz - srcRowSz);
+    }
+  }
 
-  uint32 dataSz = width * height * 4;
+  if(nRows < img->GetHeight()) {
+    memset(img->GetRow(nRows), 0, (img->GetHeight() - nRows) * dstRowSz);
+  }
+}
 
-  // Make sure that platform supports SSE if they chose this
-  // option...
-  #ifndef HAS_SSE_41
-  if(settings.bUseSIMD) {
-    ReportError("Platform does not support SIMD!\n");
-    return false;
+// Reads an RGBA8RowSource into a small ring of band buffers on its own thread.
+// Band b is decoded into buffer b % kNumBuffers, so the reader can run at most
+// kNumBuffers - 1 bands ahead of the bands that have been released back to it.
+class StreamingBandReader : public TCCallable {
+ public:
+  static const uint32 kNumBuffers = 3;
+
+  StreamingBandReader(
+    RGBA8RowSource &src,
+    uint32 bandWidth,
+    uint32 bandHeight,
+    uint32 numBands
+  ) : TCCallable(),
+    m_Source(src),
+    m_BandWidth(bandWidth),
+    m_BandHeight(bandHeight),
+    m_NumBands(numBands),
+    m_NumBandsRead(0),
+    m_NumBandsReleased(0),
+    m_bFailed(false)
+  {
+    for(uint32 i = 0; i < std::min(kNumBuffers, numBands); i++) {
+      FasTC::RGBA8Image buf(bandWidth, bandHeight);
+      m_Buffers[i].Swap(buf);
+    }
   }
-  #endif
 
-  #ifndef HAS_ATOMICS
-  if(settings.bUseAtomics) {
-    ReportError("Compiler's atomic operations are not supported!\n");
-    return false;
+  virtual ~StreamingBandReader() { }
+
+  virtual void operator()() {
+    TCTrace::SetThreadName("Band Reader");
+    for(uint32 b = 0; b < m_NumBands; b++) {
+      {
+        TCLock lock(m_Mutex);
+        while(b - m_NumBandsReleased >= kNumBuffers) {
+          m_BufferFree.Wait(lock);
+        }
+      }
+
+      const bool bRead = ReadBand(b);
+
+      TCLock lock(m_Mutex);
+      if(bRead) {
+        m_NumBandsRead++;
+      } else {
+        m_bFailed = true;
+      }
+      m_BandRead.NotifyOne();
+
+      if(!bRead) {
+        return;
+      }
+    }
   }
-  #endif
 
-  if(dataSz <= 0) {
+  // Blocks until band b has been read and returns its pixels, or NULL if
+  // the source failed before producing it.
+  const uint8 *WaitForBand(uint32 b) {
+    FASTC_TRACE_ZONE("Wait For Band");
+    TCLock lock(m_Mutex);
+    while(m_NumBandsRead <= b && !m_bFailed) {
+      m_BandRead.Wait(lock);
+    }
+
+    if(m_NumBandsRead <= b) {
+      return NULL;
+    }
+    return m_Buffers[b % kNumBuffers].GetData();
+  }
+
+  // Hands the buffer of the oldest unreleased band back to the reader.
+  void ReleaseBand() {
+    TCLock lock(m_Mutex);
+    m_NumBandsReleased++;
+    m_BufferFree.NotifyOne();
+  }
+
+ private:
+  RGBA8RowSource &m_Source;
+  const uint32 m_BandWidth;
+  const uint32 m_BandHeight;
+  const uint32 m_NumBands;
+
+  FasTC::RGBA8Image m_Buffers[kNumBuffers];
+
+  TCMutex m_Mutex;
+  TCConditionVariable m_BandRead;
+  TCConditionVariable m_BufferFree;
+  uint32 m_NumBandsRead;
+  uint32 m_NumBandsReleased;
+  bool m_bFailed;
+
+  // Fills the buffer of band b, padding it with zeros to the right of and
+  // below the rows that the source provides.
+  bool ReadBand(uint32 b) {
+    FASTC_TRACE_ZONE("Read Band");
+    FasTC::RGBA8Image &buf = m_Buffers[b % kNumBuffers];
+
+    const uint32 firstRow = b * m_BandHeight;
+    const uint32 srcHeight = m_Source.GetHeight();
+    const uint32 nRows =
+      (firstRow < srcHeight)? std::min(m_BandHeight, srcHeight - firstRow) : 0;
+
+    if(nRows > 0 && !m_Source.ReadRows(buf.GetData(), nRows)) {
+      return false;
+    }
+
+    PadRows(&buf, m_Source.GetWidth(), nRows);
+    return true;
+  }
+};
+
+const uint32 StreamingBandReader::kNumBuffers;
+
+CompressedImage *CompressImageStreaming(
+  RGBA8RowSource &src, const SCompressionSettings &settings, double *cmpTimeMS
+) {
+  FASTC_TRACE_ZONE("Compress Image Streaming");
+  CompressionMemoryScope memoryScope(settings);
+
+  const uint32 width = src.GetWidth();
+  const uint32 height = src.GetHeight();
+  if(0 == width || 0 == height) {
     ReportError("No data sent to compress!");
+    return NULL;
+  }
+
+  // Every PVRTC block depends on its neighbors, so there's no way to
+  // compress the image in bands.
+  if(settings.format == FasTC::eCompressionFormat_PVRTC4) {
+    FasTC::RGBA8Image img(width, height);
+    if(!src.ReadRows(img.GetData(), height)) {
+      return NULL;
+    }
+    return CompressImage(&img, settings, cmpTimeMS);
+  }
+
+  if(!CheckPlatformSupport(settings)) {
+    return NULL;
+  }
+
+  if(!ChooseFuncFromSettings(settings)) {
+    ReportError("Could not find adequate compression function for specified settings");
+    return NULL;
+  }
+
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(settings.format, blockDims);
+
+  const uint32 paddedWidth = ((width + (blockDims[0] - 1)) / blockDims[0]) * blockDims[0];
+  const uint32 paddedHeight = ((height + (blockDims[1] - 1)) / blockDims[1]) * blockDims[1];
+  if(paddedWidth != width || paddedHeight != height) {
+    ReportError("WARNING - Image size is not a multiple of block size. Padding with zeros...");
+  }
+
+  // Make the bands tall enough that each one has a reasonable amount of
+  // work to spread across the compression threads.
+  const uint32 kMinBlocksPerBand = 4096;
+  const uint32 blocksWide = paddedWidth / blockDims[0];
+  const uint32 blockRowsPerBand =
+    std::max<uint32>(1, (kMinBlocksPerBand + blocksWide - 1) / blocksWide);
+  const uint32 bandHeight = std::min(blockRowsPerBand * blockDims[1], paddedHeight);
+  const uint32 numBands = (paddedHeight + bandHeight - 1) / bandHeight;
+
+  // Compressed blocks are stored in rows, so each band compresses into its
+  // own contiguous piece of the output.
+  const uint64 cmpDataSz =
+    CompressedImage::GetCompressedSize(paddedWidth, paddedHeight, settings.format);
+  const uint64 bandCmpDataSz =
+    CompressedImage::GetCompressedSize(paddedWidth, bandHeight, settings.format);
+  uint8 *cmpData =
+    TCMemory::NewArray<uint8>(TCMemory::eCategory_CompressedData, cmpDataSz);
+
+  StreamingBandReader reader(src, paddedWidth, bandHeight, numBands);
+  TCThread readerThread(reader);
+
+  bool bSuccess = true;
+  double cmpMSTime = 0.0;
+  for(uint32 b = 0; b < numBands; b++) {
+    const uint8 *band = reader.WaitForBand(b);
+    if(!band) {
+      ReportError("Could not read image rows");
+      bSuccess = false;
+      break;
+    }
+
+    const uint32 h = std::min(bandHeight, paddedHeight - b * bandHeight);
+    CompressionJob cj(settings.format, band, cmpData + b * bandCmpDataSz, paddedWidth, h);
+    cj.SetQuality(static_cast<uint32>(settings.iQuality));
+    const size_t firstStat = settings.blockStats? settings.blockStats->Size() : 0;
+    cmpMSTime += CompressJob(cj, settings.iNumThreads, settings);
+    OffsetBlockStats(settings.blockStats, firstStat, blocksWide,
+                     0, (b * bandHeight) / blockDims[1], blocksWide);
+
+    reader.ReleaseBand();
+  }
+
+  readerThread.Join();
+
+  if(!bSuccess) {
+    TCMemory::DeleteArray(TCMemory::eCategory_CompressedData, cmpData, cmpDataSz);
+    return NULL;
+  }
+
+  if(cmpTimeMS) {
+    *cmpTimeMS = cmpMSTime;
+  }
+
+  return new CompressedImage(paddedWidth, paddedHeight, settings.format, cmpData,
+                             CompressedImage::eTakeOwnership);
+}
+
+// Returns the index of the block at (x, y) in a square, power-of-two PVRTC
+// image, whose blocks are stored in Morton order.
+static uint32 PVRTCBlockIndex(uint32 x, uint32 y) {
+  uint32 idx = 0;
+  for(uint32 b = 0; b < 16; b++) {
+    idx |= ((y >> b) & 1) << (2 * b);
+    idx |= ((x >> b) & 1) << (2 * b + 1);
+  }
+  return idx;
+}
+
+static bool CompressImageTiledPVRTC(
+  RGBA8TileSource &src,
+  CompressedBlockSink &sink,
+  const SCompressionSettings &settings,
+  uint32 tileSize,
+  double *cmpTimeMS
+) {
+  const uint32 imgSize = src.GetWidth();
+  if(imgSize != src.GetHeight() || (imgSize & (imgSize - 1)) != 0 || imgSize < 4) {
+    ReportError("ERROR - CompressImageTiled: PVRTC4 images must be square and power-of-two.");
     return false;
   }
 
-  uint32 numThreads = settings.iNumThreads;
-  if(settings.format == FasTC::eCompressionFormat_PVRTC4 &&
-     (settings.iNumThreads > 1 || settings.logStream)) {
-    if(settings.iNumThreads > 1) {
-      ReportError("WARNING - PVRTC compressor does not support multithreading.");
-      numThreads = 1;
+  if(settings.iNumThreads > 1) {
+    ReportError("WARNING - PVRTC compressor does not support multithreading.");
+  }
+
+  if(settings.blockStats) {
+    ReportError("WARNING - Tiled PVRTC compression does not support stat collection.");
+  }
+
+  // The blocks of a CompressedImage are in Morton order, where every
+  // aligned, power-of-two square of blocks is one contiguous run. The blocks
+  // that we keep from each tile are such a square, and the tiles are visited
+  // in Morton order, so each run follows the previous one. The compressor
+  // needs each tile to be square and power-of-two too, so the kept blocks
+  // are the middle half of the tile, with a border a quarter of the tile
+  // wide on every side.
+  uint32 tileDim = 64;
+  while(tileDim < tileSize) {
+    tileDim <<= 1;
+  }
+
+  uint32 keptDim = tileDim / 2;
+  if(tileDim >= imgSize) {
+    tileDim = keptDim = imgSize;
+  }
+
+  const uint32 border = (tileDim - keptDim) / 2;
+  const uint32 keptBlocks = keptDim / 4;
+  const uint32 tilesWide = imgSize / keptDim;
+  const uint32 kBlockSz = FasTC::GetBlockSize(settings.format);
+
+  FasTC::RGBA8Image tile(tileDim, tileDim);
+  FasTC::RGBA8Image piece(tileDim, tileDim);
+  std::vector<uint8> tileCmp(CompressedImage::GetCompressedSize(tileDim, tileDim, settings.format));
+  std::vector<uint8> kept(static_cast<size_t>(keptBlocks) * keptBlocks * kBlockSz);
+
+  SCompressionSettings tileSettings = settings;
+  tileSettings.blockStats = NULL;
+
+  double cmpMSTime = 0.0;
+  for(uint32 t = 0; t < tilesWide * tilesWide; t++) {
+    // Tiles are numbered like the blocks of a tilesWide x tilesWide image,
+    // whose Morton indices interleave the bits of y and x.
+    uint32 tx = 0, ty = 0;
+    for(uint32 b = 0; b < 16; b++) {
+      ty |= ((t >> (2 * b)) & 1) << b;
+      tx |= ((t >> (2 * b + 1)) & 1) << b;
+    }
+    tx *= keptDim;
+    ty *= keptDim;
+
+    // The tile starts border pixels up and to the left of the blocks that we
+    // keep, and wraps around the edges of the image. Read it in as many as
+    // four pieces that each lie inside of the image.
+    const uint32 x0 = (tx + imgSize - border) % imgSize;
+    const uint32 y0 = (ty + imgSize - border) % imgSize;
+    for(uint32 dy = 0; dy < tileDim; ) {
+      const uint32 y = (y0 + dy) % imgSize;
+      const uint32 h = std::min(tileDim - dy, imgSize - y);
+
+      for(uint32 dx = 0; dx < tileDim; ) {
+        const uint32 x = (x0 + dx) % imgSize;
+        const uint32 w = std::min(tileDim - dx, imgSize - x);
+
+        if(!src.ReadTile(x, y, w, h, piece.GetData())) {
+          ReportError("Could not read image tile");
+          return false;
+        }
+
+        for(uint32 j = 0; j < h; j++) {
+          memcpy(tile(dx, dy + j), piece.GetData() + j * w * 4, w * 4);
+        }
+        dx += w;
+      }
+      dy += h;
     }
 
-    if(settings.logStream) {
-      ReportError("WARNING - PVRTC compressor does not support stat collection.");
+    CompressionJob cj(settings.format, tile.GetData(), &tileCmp[0], tileDim, tileDim);
+    cj.SetQuality(static_cast<uint32>(settings.iQuality));
+    cmpMSTime += CompressJob(cj, 1, tileSettings);
+
+    const uint32 firstBlock = border / 4;
+    for(uint32 j = 0; j < keptBlocks; j++) {
+      for(uint32 i = 0; i < keptBlocks; i++) {
+        const uint32 srcIdx = PVRTCBlockIndex(firstBlock + i, firstBlock + j);
+        memcpy(&kept[0] + PVRTCBlockIndex(i, j) * kBlockSz,
+               &tileCmp[0] + srcIdx * kBlockSz, kBlockSz);
+      }
+    }
+
+    if(!sink.WriteBlocks(PVRTCBlockIndex(tx / 4, ty / 4), &kept[0], kept.size())) {
+      return false;
     }
   }
 
+  if(cmpTimeMS) {
+    *cmpTimeMS = cmpMSTime;
+  }
+  return true;
+}
+
+bool CompressImageTiled(
+  RGBA8TileSource &src,
+  CompressedBlockSink &sink,
+  const SCompressionSettings &settings,
+  uint32 tileSize,
+  double *cmpTimeMS
+) {
+  FASTC_TRACE_ZONE("Compress Image Tiled");
+  CompressionMemoryScope memoryScope(settings);
+
+  const uint32 width = src.GetWidth();
+  const uint32 height = src.GetHeight();
+  if(0 == width || 0 == height) {
+    ReportError("No data sent to compress!");
+    return false;
+  }
+
+  if(!CheckPlatformSupport(settings)) {
+    return false;
+  }
+
+  if(!ChooseFuncFromSettings(settings)) {
+    ReportError("Could not find adequate compression function for specified settings");
+    return false;
+  }
+
+  if(settings.format == FasTC::eCompressionFormat_PVRTC4) {
+    return CompressImageTiledPVRTC(src, sink, settings, tileSize, cmpTimeMS);
+  }
+
   uint32 blockDims[2];
   FasTC::GetBlockDimensions(settings.format, blockDims);
-  if ((width % blockDims[0]) != 0 || (height % blockDims[1]) != 0) {
-    ReportError("ERROR - CompressImageData: width or height is not multiple of block dimension");
+  const uint32 kBlockSz = FasTC::GetBlockSize(settings.format);
+
+  const uint32 paddedWidth = ((width + (blockDims[0] - 1)) / blockDims[0]) * blockDims[0];
+  const uint32 paddedHeight = ((height + (blockDims[1] - 1)) / blockDims[1]) * blockDims[1];
+  if(paddedWidth != width || paddedHeight != height) {
+    ReportError("WARNING - Image size is not a multiple of block size. Padding with zeros...");
+  }
+
+  // Tiles are a whole number of blocks, and never larger than the image.
+  tileSize = std::max<uint32>(tileSize, 1);
+  const uint32 tileWidth =
+    std::min(((tileSize + blockDims[0] - 1) / blockDims[0]) * blockDims[0], paddedWidth);
+  const uint32 tileHeight =
+    std::min(((tileSize + blockDims[1] - 1) / blockDims[1]) * blockDims[1], paddedHeight);
+
+  FasTC::RGBA8Image tile(tileWidth, tileHeight);
+  std::vector<uint8> tileCmp(
+    CompressedImage::GetCompressedSize(tileWidth, tileHeight, settings.format));
+
+  // The compressed blocks of a row of tiles, laid out as in the final image.
+  const uint64 blockRowSz = static_cast<uint64>(paddedWidth / blockDims[0]) * kBlockSz;
+  std::vector<uint8> strip(blockRowSz * (tileHeight / blockDims[1]));
+
+  const size_t firstStat = settings.blockStats? settings.blockStats->Size() : 0;
+
+  double cmpMSTime = 0.0;
+  for(uint32 ty = 0; ty < paddedHeight; ty += tileHeight) {
+    const uint32 th = std::min(tileHeight, paddedHeight - ty);
+    const uint32 nBlockRows = th / blockDims[1];
+
+    for(uint32 tx = 0; tx < paddedWidth; tx += tileWidth) {
+      const uint32 tw = std::min(tileWidth, paddedWidth - tx);
+      const uint32 nBlockCols = tw / blockDims[0];
+
+      // Only the tiles along the right and bottom edges can be smaller.
+      if(tile.GetWidth() != tw || tile.GetHeight() != th) {
+        FasTC::RGBA8Image resized(tw, th);
+        tile.Swap(resized);
+      }
+
+      const uint32 w = std::min(tw, width - tx);
+      const uint32 h = std::min(th, height - ty);
+      if(!src.ReadTile(tx, ty, w, h, tile.GetData())) {
+        ReportError("Could not read image tile");
+        return false;
+      }
+      PadRows(&tile, w, h);
+
+      CompressionJob cj(settings.format, tile.GetData(), &tileCmp[0], tw, th);
+      cj.SetQuality(static_cast<uint32>(settings.iQuality));
+      const size_t firstTileStat = settings.blockStats? settings.blockStats->Size() : 0;
+      cmpMSTime += CompressJob(cj, settings.iNumThreads, settings);
+      OffsetBlockStats(settings.blockStats, firstTileStat, nBlockCols,
+                       tx / blockDims[0], ty / blockDims[1],
+                       paddedWidth / blockDims[0]);
+
+      const uint32 tileBlockRowSz = nBlockCols * kBlockSz;
+      for(uint32 j = 0; j < nBlockRows; j++) {
+        memcpy(&strip[0] + j * blockRowSz + (tx / blockDims[0]) * kBlockSz,
+               &tileCmp[0] + j * tileBlockRowSz, tileBlockRowSz);
+      }
+    }
+
+    const uint64 firstBlock = static_cast<uint64>(ty / blockDims[1]) * (paddedWidth / blockDims[0]);
+    if(!sink.WriteBlocks(firstBlock, &strip[0], nBlockRows * blockRowSz)) {
+      return false;
+    }
+  }
+
+  // The records were added one tile at a time.
+  if(settings.blockStats) {
+    settings.blockStats->SortByBlock(firstStat);
+  }
+
+  if(cmpTimeMS) {
+    *cmpTimeMS = cmpMSTime;
+  }
+  return true;
+}
+
+bool CompressImageData(
+  const uint8 *data, 
+  const uint32 width,
+  const uint32 height,
+  uint8 *compressedData,
+  const uint64 cmpDataSz,
+  const SCompressionSettings &settings,
+  double *cmpTimeMS
+) {
+  CompressionMemoryScope memoryScope(settings);
+
+  uint64 dataSz = static_cast<uint64>(width) * height * 4;
+
+  if(!CheckPlatformSupport(settings)) {
     return false;
-  } else if (settings.format == FasTC::eCompressionFormat_PVRTC4 &&
-             ((width & (width - 1)) != 0 ||
-              (height & (height - 1)) != 0 ||
-              width != height)) {
-    ReportError("ERROR - CompressImageData: PVRTC4 images must be square and power-of-two.");
+  }
+
+  if(dataSz <= 0) {
+    ReportError("No data sent to compress!");
+    return false;
+  }
+
+  uint32 numThreads;
+  if(!CheckImageData(width, height, settings, &numThreads)) {
     return false;
   }
 
   // Allocate data based on the compression method
-  uint32 compressedDataSzNeeded =
+  uint64 compressedDataSzNeeded =
     CompressedImage::GetCompressedSize(width, height, settings.format);
 
   if(compressedDataSzNeeded == 0) {
@@ -495,33 +1113,433 @@ bool CompressImageData(
     return false;
   }
 
-  if(ChooseFuncFromSettings(settings)) {
+  if(!ChooseFuncFromSettings(settings)) {
+    ReportError("Could not find adequate compression function for specified settings");
+    return false;
+  }
+
+  // Images whose pixels don't fit in a single job are compressed in bands of
+  // block rows. PVRTC blocks depend on the whole image, so they can't be.
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(settings.format, blockDims);
+  const uint32 blocksWide = width / blockDims[0];
+  const uint32 blocksHigh = height / blockDims[1];
+  const uint64 blockRowSz = static_cast<uint64>(width) * blockDims[1] * 4;
+  const uint32 bandBlockRows = static_cast<uint32>(
+    std::min<uint64>(blocksHigh, FasTC::kMaxJobPixelBytes / blockRowSz));
+  if(bandBlockRows == 0 ||
+     (bandBlockRows < blocksHigh && settings.format == FasTC::eCompressionFormat_PVRTC4)) {
+    ReportError("ERROR - CompressImageData: image is too large to compress");
+    return false;
+  }
+
+  const uint64 cmpBlockRowSz =
+    static_cast<uint64>(blocksWide) * FasTC::GetBlockSize(settings.format);
+
+  double cmpMSTime = 0.0;
+  for(uint32 by = 0; by < blocksHigh; by += bandBlockRows) {
+    const uint32 nBlockRows = std::min(bandBlockRows, blocksHigh - by);
+    CompressionJob cj(settings.format, data + by * blockRowSz,
+                      compressedData + by * cmpBlockRowSz,
+                      width, nBlockRows * blockDims[1]);
+    cj.SetQuality(static_cast<uint32>(settings.iQuality));
+    const size_t firstStat = settings.blockStats? settings.blockStats->Size() : 0;
+    cmpMSTime += CompressJob(cj, numThreads, settings);
+    OffsetBlockStats(settings.blockStats, firstStat, blocksWide, 0, by, blocksWide);
+  }
+
+  if(cmpTimeMS) {
+    *cmpTimeMS = cmpMSTime;
+  }
+
+  return true;
+}
 
-    CompressionJob cj(settings.format, data, compressedData, width, height);
+// One of the threads that compress the tiles of a CompressionHandleImpl.
+class AsyncTileWorker : public TCCallable {
+ public:
+  AsyncTileWorker(CompressionHandleImpl &parent, TCBarrier *barrier)
+    : TCCallable(), m_Parent(parent), m_Barrier(barrier) { }
+  virtual ~AsyncTileWorker() { }
+  virtual void operator()();
+
+  FasTC::BlockStatList &GetStats() { return m_Stats; }
+
+ private:
+  CompressionHandleImpl &m_Parent;
+  TCBarrier *m_Barrier;
+  FasTC::BlockStatList m_Stats;
+};
 
-    double cmpMSTime = 0.0;
-    if(numThreads > 1) {
-      if(settings.bUseAtomics) {
-        cmpMSTime = CompressImageWithAtomics(cj, settings);
-      } else if(settings.iJobSize > 0) {
-        cmpMSTime = CompressImageWithWorkerQueue(cj, settings);
+// Compresses its own copy of an image on a separate thread for a
+// CompressionHandle. The worker threads take the blocks a tile at a time,
+// where a tile is a run of blocks in row major order. Checking for
+// cancellation before handing out each tile means that only the tiles
+// already being compressed hold up a cancelled compression.
+class CompressionHandleImpl : public TCCallable {
+ public:
+  CompressionHandleImpl(
+    FasTC::RGBA8Image &img,
+    const SCompressionSettings &settings,
+    uint32 numThreads,
+    CompressionCallback *callback
+  ) : TCCallable(),
+    m_Settings(settings),
+    m_NumThreads(numThreads),
+    m_Callback(callback),
+    m_Handle(NULL),
+    m_Thread(NULL),
+    m_Job(settings.format, NULL, NULL, 0, 0),
+    m_Func(ChooseFuncFromSettings(settings)),
+    m_FuncWithStats(NULL),
+    m_NumBlocks(0),
+    m_BlocksPerTile(0),
+    m_NextBlock(0),
+    m_BlocksCompleted(0),
+    m_Status(eCompressionStatus_Running),
+    m_bCancelled(false),
+    m_bDone(false),
+    m_Result(NULL),
+    m_CmpTimeMS(0.0)
+  {
+    m_Image.Swap(img);
+
+    if(m_Settings.blockStats) {
+      m_FuncWithStats = ChooseFuncFromSettingsWithStats(m_Settings);
+    }
+
+    uint32 blockDims[2];
+    FasTC::GetBlockDimensions(m_Settings.format, blockDims);
+    m_NumBlocks = (m_Image.GetWidth() / blockDims[0]) * (m_Image.GetHeight() / blockDims[1]);
+
+    // Every PVRTC block depends on its neighbors, so the image is one tile.
+    // Otherwise a tile is settings.iJobSize blocks, like for the worker
+    // queue, or zero to let each thread size its tiles as it goes.
+    if(m_Settings.format == FasTC::eCompressionFormat_PVRTC4) {
+      m_BlocksPerTile = m_NumBlocks;
+      m_NumThreads = 1;
+    } else if(m_Settings.iJobSize > 0) {
+      m_BlocksPerTile = m_Settings.iJobSize;
+    }
+  }
+
+  virtual ~CompressionHandleImpl() {
+    delete m_Result;
+  }
+
+  void Start(CompressionHandle *handle) {
+    m_Handle = handle;
+    m_Thread = new TCThread(*this);
+  }
+
+  // Stops the compression and waits for the thread to exit.
+  void Stop() {
+    Cancel();
+    m_Thread->Join();
+    delete m_Thread;
+    m_Thread = NULL;
+  }
+
+  virtual void operator()() {
+    TCTrace::SetThreadName("Async Compression");
+
+    Compress();
+
+    // The pixels aren't needed anymore, so don't hold on to them for as
+    // long as the handle is around.
+    FasTC::RGBA8Image empty;
+    m_Image.Swap(empty);
+
+    if(m_Callback) {
+      (*m_Callback)(*m_Handle);
+    }
+
+    TCLock lock(m_Mutex);
+    m_bDone = true;
+    m_DoneCV.NotifyAll();
+  }
+
+  // Compresses tiles until there are none left or the compression is
+  // cancelled, adding a record for each block to stats if it isn't NULL.
+  // Unless the tile size is fixed, tiles start out as a single block and
+  // grow or shrink so that each one takes about kTargetTileMS, since the
+  // time per block ranges from microseconds to milliseconds depending on
+  // the format, the quality and the image.
+  void CompressTiles(FasTC::BlockStatList *stats) {
+    const double kTargetTileMS = 2.0;
+    const uint32 kMaxBlocksPerTile = 4096;
+
+    uint32 tileSize = m_BlocksPerTile? m_BlocksPerTile : 1;
+    CompressionJob cj = m_Job;
+    uint32 nBlocks = 0;
+    StopWatch stopWatch;
+    while(NextTile(nBlocks, tileSize, &cj, &nBlocks)) {
+      stopWatch.Reset();
+      stopWatch.Start();
+
+      if(stats && m_FuncWithStats) {
+        (*m_FuncWithStats)(cj, stats);
       } else {
-        cmpMSTime = CompressImageWithThreads(cj, settings);
+        (*m_Func)(cj);
+      }
+
+      stopWatch.Stop();
+      if(0 == m_BlocksPerTile && nBlocks == tileSize) {
+        const double tileMS = stopWatch.TimeInMilliseconds();
+        if(tileMS < 0.5 * kTargetTileMS) {
+          tileSize = std::min(2 * tileSize, kMaxBlocksPerTile);
+        } else if(tileMS > 2.0 * kTargetTileMS) {
+          tileSize = std::max<uint32>(1, tileSize / 2);
+        }
       }
     }
-    else {
-      cmpMSTime = CompressImageInSerial(cj, settings);
+  }
+
+  void GetProgress(uint64 *blocksCompleted, uint64 *totalBlocks) {
+    TCLock lock(m_Mutex);
+    if(blocksCompleted) {
+      *blocksCompleted = m_BlocksCompleted;
     }
+    if(totalBlocks) {
+      *totalBlocks = static_cast<uint64>(m_NumBlocks) * m_Settings.iNumCompressions;
+    }
+  }
 
-    // Report compression time
-    fprintf(stdout, "Compression time: %0.3f ms\n", cmpMSTime);
+  void Cancel() {
+    TCLock lock(m_Mutex);
+    m_bCancelled = true;
   }
-  else {
+
+  ECompressionStatus GetStatus() {
+    TCLock lock(m_Mutex);
+    return m_Status;
+  }
+
+  ECompressionStatus Wait() {
+    TCLock lock(m_Mutex);
+    while(!m_bDone) {
+      m_DoneCV.Wait(lock);
+    }
+    return m_Status;
+  }
+
+  CompressedImage *TakeResult() {
+    TCLock lock(m_Mutex);
+    CompressedImage *result = m_Result;
+    m_Result = NULL;
+    return result;
+  }
+
+  double GetCompressionTime() {
+    TCLock lock(m_Mutex);
+    return m_CmpTimeMS;
+  }
+
+ private:
+  FasTC::RGBA8Image m_Image;
+  const SCompressionSettings m_Settings;
+  uint32 m_NumThreads;
+  CompressionCallback *const m_Callback;
+  CompressionHandle *m_Handle;
+  TCThread *m_Thread;
+
+  CompressionJob m_Job;
+  CompressionFunc m_Func;
+  CompressionFuncWithStats m_FuncWithStats;
+  uint32 m_NumBlocks;
+  uint32 m_BlocksPerTile;
+
+  // Everything below is guarded by m_Mutex.
+  TCMutex m_Mutex;
+  TCConditionVariable m_DoneCV;
+  uint64 m_NextBlock;
+  uint64 m_BlocksCompleted;
+  ECompressionStatus m_Status;
+  bool m_bCancelled;
+  bool m_bDone;
+  CompressedImage *m_Result;
+  double m_CmpTimeMS;
+
+  // Records that the blocksDone blocks of the last tile are compressed and
+  // sets cj to the next tile of nBlocks blocks, which is at most maxBlocks
+  // and never runs past the end of the image. Blocks are numbered across all
+  // of the compressions, so the image is compressed over again once every
+  // block has been handed out. Returns false once there are no blocks left
+  // or the compression was cancelled.
+  bool NextTile(uint32 blocksDone, uint32 maxBlocks,
+                CompressionJob *cj, uint32 *nBlocks) {
+    TCLock lock(m_Mutex);
+    m_BlocksCompleted += blocksDone;
+
+    const uint64 numBlocks = static_cast<uint64>(m_NumBlocks) * m_Settings.iNumCompressions;
+    if(m_bCancelled || m_NextBlock >= numBlocks) {
+      return false;
+    }
+
+    const uint32 firstBlock = static_cast<uint32>(m_NextBlock % m_NumBlocks);
+    *nBlocks = std::min(maxBlocks, m_NumBlocks - firstBlock);
+    m_NextBlock += *nBlocks;
+
+    if(*nBlocks == m_NumBlocks) {
+      *cj = m_Job;
+      return true;
+    }
+
+    uint32 start[2], end[2];
+    m_Job.BlockIdxToCoords(firstBlock, start);
+    m_Job.BlockIdxToCoords(firstBlock + *nBlocks, end);
+    *cj = CompressionJob(m_Job.Format(), m_Job.InBuf(), m_Job.OutBuf(),
+                         m_Job.Width(), m_Job.Height(),
+                         start[0], start[1], end[0], end[1]);
+    cj->SetQuality(m_Job.Quality());
+    return true;
+  }
+
+  // Compresses the image into a new buffer on m_NumThreads threads, and
+  // hands it over to m_Result if the compression wasn't cancelled.
+  void Compress() {
+    FASTC_TRACE_ZONE("Compress Image Async");
+    CompressionMemoryScope memoryScope(m_Settings);
+
+    const uint64 cmpDataSz = CompressedImage::GetCompressedSize(
+      m_Image.GetWidth(), m_Image.GetHeight(), m_Settings.format);
+    uint8 *cmpData =
+      TCMemory::NewArray<uint8>(TCMemory::eCategory_CompressedData, cmpDataSz);
+    m_Job = CompressionJob(m_Settings.format, m_Image.GetData(), cmpData,
+                           m_Image.GetWidth(), m_Image.GetHeight());
+    m_Job.SetQuality(static_cast<uint32>(m_Settings.iQuality));
+
+    // Line the threads up before starting the clock, like the other
+    // threading models do.
+    TCBarrier barrier(m_NumThreads + 1);
+    std::vector<AsyncTileWorker> workers;
+    for(uint32 i = 0; i < m_NumThreads; i++) {
+      workers.push_back(AsyncTileWorker(*this, &barrier));
+    }
+
+    std::vector<TCThread> threads;
+    for(uint32 i = 0; i < m_NumThreads; i++) {
+      threads.push_back(TCThread(workers[i]));
+    }
+
+    barrier.Wait();
+
+    StopWatch stopWatch;
+    stopWatch.Start();
+    for(uint32 i = 0; i < m_NumThreads; i++) {
+      threads[i].Join();
+    }
+    stopWatch.Stop();
+
+    FasTC::BlockStatList *stats = m_Settings.blockStats;
+    if(stats && m_FuncWithStats) {
+      const size_t firstStat = stats->Size();
+      for(uint32 i = 0; i < m_NumThreads; i++) {
+        stats->Merge(workers[i].GetStats());
+      }
+      stats->SortByBlock(firstStat);
+    }
+
+    TCLock lock(m_Mutex);
+    if(m_bCancelled) {
+      m_Status = eCompressionStatus_Cancelled;
+      TCMemory::DeleteArray(TCMemory::eCategory_CompressedData, cmpData, cmpDataSz);
+    } else {
+      m_Status = eCompressionStatus_Finished;
+      m_CmpTimeMS = stopWatch.TimeInMilliseconds() / double(m_Settings.iNumCompressions);
+      m_Result = new CompressedImage(m_Image.GetWidth(), m_Image.GetHeight(),
+                                     m_Settings.format, cmpData,
+                                     CompressedImage::eTakeOwnership);
+    }
+  }
+};
+
+void AsyncTileWorker::operator()() {
+  TCTrace::SetThreadName("Async Tile Worker");
+  m_Barrier->Wait();
+  m_Parent.CompressTiles(&m_Stats);
+}
+
+CompressionHandle::CompressionHandle(CompressionHandleImpl *impl)
+  : m_Impl(impl)
+{ }
+
+CompressionHandle::~CompressionHandle() {
+  m_Impl->Stop();
+  delete m_Impl;
+}
+
+void CompressionHandle::GetProgress(uint64 *blocksCompleted, uint64 *totalBlocks) const {
+  m_Impl->GetProgress(blocksCompleted, totalBlocks);
+}
+
+void CompressionHandle::Cancel() {
+  m_Impl->Cancel();
+}
+
+ECompressionStatus CompressionHandle::GetStatus() const {
+  return m_Impl->GetStatus();
+}
+
+ECompressionStatus CompressionHandle::Wait() {
+  return m_Impl->Wait();
+}
+
+CompressedImage *CompressionHandle::TakeResult() {
+  return m_Impl->TakeResult();
+}
+
+double CompressionHandle::GetCompressionTime() const {
+  return m_Impl->GetCompressionTime();
+}
+
+CompressionHandle *CompressImageAsync(
+  const FasTC::RGBA8Image *img, const SCompressionSettings &settings,
+  CompressionCallback *callback
+) {
+  if(!img || 0 == img->GetWidth() || 0 == img->GetHeight()) {
+    ReportError("No data sent to compress!");
+    return NULL;
+  }
+
+  if(!CheckPlatformSupport(settings)) {
+    return NULL;
+  }
+
+  if(!ChooseFuncFromSettings(settings)) {
     ReportError("Could not find adequate compression function for specified settings");
-    return false;
+    return NULL;
   }
 
-  return true;
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(settings.format, blockDims);
+  const uint32 width = img->GetWidth();
+  const uint32 height = img->GetHeight();
+  const uint32 paddedWidth = ((width + (blockDims[0] - 1)) / blockDims[0]) * blockDims[0];
+  const uint32 paddedHeight = ((height + (blockDims[1] - 1)) / blockDims[1]) * blockDims[1];
+  if(paddedWidth != width || paddedHeight != height) {
+    ReportError("WARNING - Image size is not a multiple of block size. Padding with zeros...");
+  }
+
+  uint32 numThreads;
+  if(!CheckImageData(paddedWidth, paddedHeight, settings, &numThreads)) {
+    return NULL;
+  }
+
+  // The tiles are all parts of a single job over the whole image.
+  if(static_cast<uint64>(paddedWidth) * paddedHeight * 4 > FasTC::kMaxJobPixelBytes) {
+    ReportError("ERROR - CompressImageAsync: image is too large to compress");
+    return NULL;
+  }
+
+  FasTC::RGBA8Image pixels;
+  CopyPadded(*img, paddedWidth, paddedHeight, &pixels);
+
+  CompressionHandleImpl *impl =
+    new CompressionHandleImpl(pixels, settings, numThreads, callback);
+  CompressionHandle *handle = new CompressionHandle(impl);
+  impl->Start(handle);
+  return handle;
 }
 
 void YieldThread() {
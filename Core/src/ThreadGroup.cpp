@@ -17,11 +17,11 @@
 
 #include "ThreadGroup.h"
 #include "FasTC/BPTCCompressor.h"
+#include "FasTC/Trace.h"
 
 #include <cstdlib>
 #include <cstdio>
 #include <cassert>
-#include <iostream>
 
 using FasTC::CompressionJob;
 
@@ -34,7 +34,6 @@ CmpThread::CmpThread()
   , m_Job(CompressionJob(FasTC::kNumCompressionFormats, NULL, NULL, 0, 0))
   , m_CmpFunc(NULL)
   , m_CmpFuncWithStats(NULL)
-  , m_LogStream(NULL)
 { }
 
 void CmpThread::operator()() {
@@ -47,23 +46,31 @@ void CmpThread::operator()() {
     return;
   }
 
-  if(!(m_CmpFunc || (m_CmpFuncWithStats && m_LogStream))) {
+  if(!(m_CmpFunc || m_CmpFuncWithStats)) {
     fprintf(stderr, "Incorrect thread function pointer.\n");
     return;
   }
 
+  TCTrace::SetThreadName("ThreadGroup Worker");
+
   while(1) {
     // Wait for signal to start work...
-    m_StartBarrier->Wait();
+    {
+      FASTC_TRACE_ZONE("Idle");
+      m_StartBarrier->Wait();
+    }
 
     if(*m_ParentExitFlag) {
       return;
     }
 
-    if(m_CmpFunc)
-      (*m_CmpFunc)(m_Job);
-    else
-      (*m_CmpFuncWithStats)(m_Job, m_LogStream);
+    {
+      FASTC_TRACE_ZONE("ThreadGroup Task");
+      if(m_CmpFunc)
+        (*m_CmpFunc)(m_Job);
+      else
+        (*m_CmpFuncWithStats)(m_Job, &m_Stats);
+    }
 
     {
       TCLock lock(*m_ParentCounterLock);
@@ -85,6 +92,7 @@ ThreadGroup::ThreadGroup(uint32 numThreads,
   , m_Job(job)
   , m_ThreadState(eThreadState_Done)
   , m_ExitFlag(false)
+  , m_Stats(NULL)
 { 
   for(uint32 i = 0; i < kMaxNumThreads; i++) {
     // Thread synchronization primitives
@@ -101,7 +109,7 @@ ThreadGroup::ThreadGroup(
   uint32 numThreads, 
   const CompressionJob &job,
   CompressionFuncWithStats func, 
-  std::ostream *logStream
+  FasTC::BlockStatList *stats
 )
   : m_StartBarrier(new TCBarrier(numThreads + 1))
   , m_FinishMutex(new TCMutex())
@@ -111,6 +119,7 @@ ThreadGroup::ThreadGroup(
   , m_Job(job)
   , m_ThreadState(eThreadState_Done)
   , m_ExitFlag(false)
+  , m_Stats(stats)
 { 
   for(uint32 i = 0; i < kMaxNumThreads; i++) {
     // Thread synchronization primitives
@@ -120,7 +129,6 @@ ThreadGroup::ThreadGroup(
     m_Threads[i].m_StartBarrier = m_StartBarrier;
     m_Threads[i].m_ParentExitFlag = &m_ExitFlag;
     m_Threads[i].m_CmpFuncWithStats = func;
-    m_Threads[i].m_LogStream = logStream;
   }
 }
 
@@ -143,6 +151,8 @@ bool ThreadGroup::PrepareThreads() {
     return true;
   }
 
+  FASTC_TRACE_ZONE("ThreadGroup Prepare");
+
   // We can assume that the image data is in block stream order
   // so, the size of the data given to each thread will be (nb*4)x4
   uint32 blockDim[2];
@@ -176,6 +186,7 @@ bool ThreadGroup::PrepareThreads() {
                       m_Job.Width(), m_Job.Height(),
                       start[0], start[1],
                       end[0], end[1]);
+    cj.SetQuality(m_Job.Quality());
 
     CmpThread &t = m_Threads[m_ActiveThreads];
     t.m_Job = cj;
@@ -201,13 +212,15 @@ bool ThreadGroup::Start() {
     return false;
   }
 
-  m_StopWatch.Reset();
-  m_StopWatch.Start();
-
-  // Last thread to activate the barrier is this one.
+  // Last thread to activate the barrier is this one. The timer starts once
+  // every thread is released, so that it doesn't count how long they took to
+  // get to the barrier, just like the other threading models.
   m_ThreadState = eThreadState_Running;
   m_StartBarrier->Wait();
 
+  m_StopWatch.Reset();
+  m_StopWatch.Start();
+
   return true;
 }
 
@@ -231,6 +244,11 @@ bool ThreadGroup::CleanUpThreads() {
   for(uint32 i = 0; i < m_ActiveThreads; i++) {
     m_ThreadHandles[i]->Join();
     delete m_ThreadHandles[i];
+
+    // The threads are done, so their statistics can be read without a lock.
+    if(m_Stats) {
+      m_Stats->Merge(m_Threads[i].m_Stats);
+    }
   }
 
   // Reset active number of threads...
@@ -241,6 +259,7 @@ bool ThreadGroup::CleanUpThreads() {
 }
 
 void ThreadGroup::Join() {
+  FASTC_TRACE_ZONE("ThreadGroup Join");
 
   TCLock lock(*m_FinishMutex);
   while(m_ThreadsFinished != m_ActiveThreads) {
@@ -21,9 +21,7 @@
 #include "FasTC/StopWatch.h"
 
 #include "CompressionFuncs.h"
-#include "Thread.h"
-
-#include <iosfwd>
+#include "FasTC/Thread.h"
 
 struct CmpThread : public TCCallable {
   friend class ThreadGroup;  
@@ -40,7 +38,10 @@ private:
   FasTC::CompressionJob m_Job;
   CompressionFunc m_CmpFunc;
   CompressionFuncWithStats m_CmpFuncWithStats;
-  std::ostream *m_LogStream;
+
+  // The records of the blocks that this thread compressed. They are merged
+  // into the thread group's list once the threads are cleaned up.
+  FasTC::BlockStatList m_Stats;
 
   CmpThread();
 
@@ -61,7 +62,7 @@ class ThreadGroup {
     uint32 numThreads,
     const FasTC::CompressionJob &cj,
     CompressionFuncWithStats func,
-    std::ostream *logStream
+    FasTC::BlockStatList *stats
   );
 
   ~ThreadGroup();
@@ -100,6 +101,8 @@ class ThreadGroup {
 
   EThreadState m_ThreadState;
   bool m_ExitFlag;
+
+  FasTC::BlockStatList *const m_Stats;
 };
 
 #endif // _THREAD_GROUP_H_
@@ -21,9 +21,9 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cassert>
-#include <iostream>
 
 #include "FasTC/BPTCCompressor.h"
+#include "FasTC/Trace.h"
 
 using FasTC::CompressionJob;
 
@@ -48,13 +48,14 @@ void WorkerThread::operator()() {
 
   CompressionFunc f = m_Parent->GetCompressionFunc();
   CompressionFuncWithStats fStat = m_Parent->GetCompressionFuncWithStats();
-  std::ostream *logStream = m_Parent->GetLogStream();
 
-  if(!(f || (fStat && logStream))) {
+  if(!(f || fStat)) {
     fprintf(stderr, "%s\n", "Illegal worker queue initialization -- compression func is NULL.");
     return;
   }
 
+  TCTrace::SetThreadName("WorkerQueue Worker");
+
   bool quitFlag = false;
   while(!quitFlag) {
     
@@ -68,12 +69,14 @@ void WorkerThread::operator()() {
 
       case eAction_Wait:
       {
+        FASTC_TRACE_ZONE("Idle");
         TCThread::Yield();
         break;
       }
 
       case eAction_DoWork:
       {
+        FASTC_TRACE_ZONE("WorkerQueue Task");
         const CompressionJob &job = m_Parent->GetCompressionJob();
 
         uint32 start[2];
@@ -87,10 +90,11 @@ void WorkerThread::operator()() {
                            job.Width(), job.Height(),
                            start[0], start[1],
                            end[0], end[1]);
+        cj.SetQuality(job.Quality());
         if(f)
           (*f)(cj);
         else
-          (*fStat)(cj, logStream);
+          (*fStat)(cj, &m_Stats);
 
         break;
       }
@@ -126,7 +130,7 @@ WorkerQueue::WorkerQueue(
   , m_NextBlock(0)
   , m_CompressionFunc(func)
   , m_CompressionFuncWithStats(NULL)
-  , m_LogStream(NULL)
+  , m_Stats(NULL)
 {
   clamp(m_NumThreads, uint32(1), uint32(kMaxNumWorkerThreads));
 }
@@ -137,7 +141,7 @@ WorkerQueue::WorkerQueue(
   uint32 jobSize,
   const CompressionJob &job,
   CompressionFuncWithStats func, 
-  std::ostream *logStream
+  FasTC::BlockStatList *stats
 )
   : m_NumCompressions(0)
   , m_TotalNumCompressions(std::max(uint32(1), numCompressions))
@@ -149,13 +153,14 @@ WorkerQueue::WorkerQueue(
   , m_NextBlock(0)
   , m_CompressionFunc(NULL)
   , m_CompressionFuncWithStats(func)
-  , m_LogStream(logStream)
+  , m_Stats(stats)
 {
   clamp(m_NumThreads, uint32(1), uint32(kMaxNumWorkerThreads));
 }
 
 void WorkerQueue::Run() {
-  
+  FASTC_TRACE_ZONE("WorkerQueue Run");
+
   // Spawn a bunch of threads...
   TCLock lock(m_Mutex);
   for(uint32 i = 0; i < m_NumThreads; i++) {
@@ -181,6 +186,10 @@ void WorkerQueue::Run() {
   for(uint32 i = 0; i < m_NumThreads; i++) {
     m_ThreadHandles[i]->Join();
     delete m_ThreadHandles[i];
+
+    if(m_Stats) {
+      m_Stats->Merge(m_Workers[i]->m_Stats);
+    }
     delete m_Workers[i];
   }
 }
@@ -25,11 +25,9 @@ class WorkerQueue;
 #include "FasTC/TexCompTypes.h"
 #include "FasTC/StopWatch.h"
 
-#include "Thread.h"
+#include "FasTC/Thread.h"
 #include "CompressionFuncs.h"
 
-#include <iosfwd>
-
 class WorkerThread : public TCCallable {
   friend class WorkerQueue;
 public:
@@ -49,6 +47,10 @@ public:
 private:
   uint32 m_ThreadIdx;
   WorkerQueue *const m_Parent;
+
+  // The records of the blocks that this worker compressed, which are merged
+  // into the queue's list after the workers are joined.
+  FasTC::BlockStatList m_Stats;
 };
 
 class WorkerQueue {
@@ -68,7 +70,7 @@ class WorkerQueue {
     uint32 jobSize,
     const FasTC::CompressionJob &job,
     CompressionFuncWithStats func, 
-    std::ostream *logStream
+    FasTC::BlockStatList *stats
   );
 
   ~WorkerQueue() { }
@@ -108,8 +110,7 @@ class WorkerQueue {
   const CompressionFuncWithStats m_CompressionFuncWithStats;
   CompressionFuncWithStats GetCompressionFuncWithStats() const { return m_CompressionFuncWithStats; }
 
-  std::ostream *m_LogStream;
-  std::ostream *GetLogStream() const { return m_LogStream; }
+  FasTC::BlockStatList *const m_Stats;
 
   StopWatch m_StopWatch;
 
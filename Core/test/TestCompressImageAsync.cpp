@@ -0,0 +1,296 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+#include "gtest/gtest.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/TexComp.h"
+#include "FasTC/Thread.h"
+
+#include <vector>
+
+static FasTC::RGBA8Image MakeImage(uint32 w, uint32 h) {
+  FasTC::RGBA8Image img(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      uint8 *p = img(i, j);
+      p[0] = static_cast<uint8>(i * 3);
+      p[1] = static_cast<uint8>(j * 5);
+      p[2] = static_cast<uint8>((i * j) & 0xFF);
+      p[3] = static_cast<uint8>(255 - ((i + j) & 0x3F));
+    }
+  }
+  return img;
+}
+
+static std::vector<uint8> GetBlocks(const CompressedImage *ci) {
+  std::vector<uint8> data;
+  if(ci) {
+    data.assign(ci->GetCompressedData(), ci->GetCompressedData() + ci->GetCompressedSize());
+  }
+  return data;
+}
+
+static std::vector<uint8> Compress(const FasTC::RGBA8Image &img,
+                                   const SCompressionSettings &settings) {
+  CompressedImage *ci = CompressImage(&img, settings);
+  std::vector<uint8> data = GetBlocks(ci);
+  delete ci;
+  return data;
+}
+
+// Remembers what the handle looked like each time the callback was called.
+class RecordingCallback : public CompressionCallback {
+ public:
+  RecordingCallback()
+    : m_NumCalls(0), m_Status(eCompressionStatus_Running)
+    , m_BlocksCompleted(0), m_TotalBlocks(0) { }
+
+  virtual void operator()(CompressionHandle &handle) {
+    TCLock lock(m_Mutex);
+    m_NumCalls++;
+    m_Status = handle.GetStatus();
+    handle.GetProgress(&m_BlocksCompleted, &m_TotalBlocks);
+  }
+
+  TCMutex m_Mutex;
+  uint32 m_NumCalls;
+  ECompressionStatus m_Status;
+  uint64 m_BlocksCompleted;
+  uint64 m_TotalBlocks;
+};
+
+TEST(CompressImageAsync, MatchesCompressImage) {
+  const FasTC::RGBA8Image img = MakeImage(64, 48);
+  const FasTC::ECompressionFormat kFormats[] = {
+    FasTC::eCompressionFormat_DXT1,
+    FasTC::eCompressionFormat_DXT5,
+    FasTC::eCompressionFormat_ETC1,
+    FasTC::eCompressionFormat_BPTC
+  };
+
+  for(size_t i = 0; i < sizeof(kFormats) / sizeof(kFormats[0]); i++) {
+    SCompressionSettings settings;
+    settings.format = kFormats[i];
+    settings.iQuality = 0;
+    settings.iNumThreads = 3;
+
+    CompressionHandle *handle = CompressImageAsync(&img, settings);
+    ASSERT_TRUE(handle != NULL);
+    EXPECT_EQ(handle->Wait(), eCompressionStatus_Finished);
+    EXPECT_TRUE(handle->IsDone());
+    EXPECT_GE(handle->GetCompressionTime(), 0.0);
+
+    CompressedImage *ci = handle->TakeResult();
+    ASSERT_TRUE(ci != NULL);
+    EXPECT_EQ(ci->GetWidth(), 64U);
+    EXPECT_EQ(ci->GetHeight(), 48U);
+    EXPECT_EQ(GetBlocks(ci), Compress(img, settings));
+    delete ci;
+
+    // The image is only handed over once.
+    EXPECT_TRUE(handle->TakeResult() == NULL);
+    delete handle;
+  }
+}
+
+TEST(CompressImageAsync, ReportsProgress) {
+  const FasTC::RGBA8Image img = MakeImage(256, 256);
+  const uint64 kNumBlocks = (256 / 4) * (256 / 4);
+
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_DXT1;
+  settings.iNumThreads = 2;
+  settings.iNumCompressions = 3;
+  settings.iJobSize = 16;
+
+  CompressionHandle *handle = CompressImageAsync(&img, settings);
+  ASSERT_TRUE(handle != NULL);
+
+  // The blocks are counted once for each compression, and the count only
+  // ever goes up.
+  uint64 lastCompleted = 0;
+  while(!handle->IsDone()) {
+    uint64 completed, total;
+    handle->GetProgress(&completed, &total);
+    EXPECT_EQ(total, kNumBlocks * 3);
+    EXPECT_LE(completed, total);
+    EXPECT_GE(completed, lastCompleted);
+    lastCompleted = completed;
+    YieldThread();
+  }
+
+  EXPECT_EQ(handle->Wait(), eCompressionStatus_Finished);
+  uint64 completed, total;
+  handle->GetProgress(&completed, &total);
+  EXPECT_EQ(completed, kNumBlocks * 3);
+  EXPECT_EQ(total, kNumBlocks * 3);
+  delete handle;
+}
+
+TEST(CompressImageAsync, CanBeCancelled) {
+  const FasTC::RGBA8Image img = MakeImage(256, 256);
+
+  // Far more work than can finish before the cancellation arrives.
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_BPTC;
+  settings.iQuality = 256;
+  settings.iNumThreads = 2;
+  settings.iNumCompressions = 1000;
+
+  RecordingCallback callback;
+  CompressionHandle *handle = CompressImageAsync(&img, settings, &callback);
+  ASSERT_TRUE(handle != NULL);
+
+  handle->Cancel();
+  EXPECT_EQ(handle->Wait(), eCompressionStatus_Cancelled);
+  EXPECT_EQ(handle->GetStatus(), eCompressionStatus_Cancelled);
+  EXPECT_TRUE(handle->TakeResult() == NULL);
+
+  uint64 completed, total;
+  handle->GetProgress(&completed, &total);
+  EXPECT_LT(completed, total);
+
+  // Cancelling a compression that has stopped does nothing.
+  handle->Cancel();
+  EXPECT_EQ(handle->GetStatus(), eCompressionStatus_Cancelled);
+
+  EXPECT_EQ(callback.m_NumCalls, 1U);
+  EXPECT_EQ(callback.m_Status, eCompressionStatus_Cancelled);
+  EXPECT_EQ(callback.m_BlocksCompleted, completed);
+  delete handle;
+
+  // Deleting the handle of a running compression cancels it.
+  handle = CompressImageAsync(&img, settings);
+  ASSERT_TRUE(handle != NULL);
+  delete handle;
+}
+
+TEST(CompressImageAsync, CallsBackWhenFinished) {
+  const FasTC::RGBA8Image img = MakeImage(32, 32);
+
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_DXT1;
+  settings.iNumCompressions = 2;
+
+  RecordingCallback callback;
+  CompressionHandle *handle = CompressImageAsync(&img, settings, &callback);
+  ASSERT_TRUE(handle != NULL);
+
+  // The callback has returned by the time Wait does.
+  EXPECT_EQ(handle->Wait(), eCompressionStatus_Finished);
+  EXPECT_EQ(callback.m_NumCalls, 1U);
+  EXPECT_EQ(callback.m_Status, eCompressionStatus_Finished);
+  EXPECT_EQ(callback.m_BlocksCompleted, 2U * 8 * 8);
+  EXPECT_EQ(callback.m_TotalBlocks, 2U * 8 * 8);
+
+  delete handle;
+  EXPECT_EQ(callback.m_NumCalls, 1U);
+}
+
+TEST(CompressImageAsync, KeepsTheQualityOfEachCompression) {
+  const FasTC::RGBA8Image img = MakeImage(16, 16);
+
+  SCompressionSettings fast;
+  fast.format = FasTC::eCompressionFormat_BPTC;
+  fast.iQuality = 0;
+  fast.iNumCompressions = 2;
+  fast.iJobSize = 1;
+
+  SCompressionSettings slow = fast;
+  slow.iQuality = 128;
+
+  // Both compressions run at once, each at its own quality.
+  CompressionHandle *fastHandle = CompressImageAsync(&img, fast);
+  CompressionHandle *slowHandle = CompressImageAsync(&img, slow);
+  ASSERT_TRUE(fastHandle != NULL);
+  ASSERT_TRUE(slowHandle != NULL);
+
+  EXPECT_EQ(fastHandle->Wait(), eCompressionStatus_Finished);
+  EXPECT_EQ(slowHandle->Wait(), eCompressionStatus_Finished);
+
+  CompressedImage *fastImage = fastHandle->TakeResult();
+  CompressedImage *slowImage = slowHandle->TakeResult();
+
+  fast.iNumCompressions = slow.iNumCompressions = 1;
+  const std::vector<uint8> fastBlocks = Compress(img, fast);
+  const std::vector<uint8> slowBlocks = Compress(img, slow);
+  EXPECT_NE(fastBlocks, slowBlocks);
+  EXPECT_EQ(GetBlocks(fastImage), fastBlocks);
+  EXPECT_EQ(GetBlocks(slowImage), slowBlocks);
+
+  delete fastImage;
+  delete slowImage;
+  delete fastHandle;
+  delete slowHandle;
+}
+
+TEST(CompressImageAsync, ReportsTheMemoryOfEachJob) {
+  FasTC::RGBA8Image small = MakeImage(64, 64);
+  FasTC::RGBA8Image large = MakeImage(128, 128);
+
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_DXT1;
+  settings.iNumThreads = 2;
+
+  TCMemory::Stats smallStats, largeStats;
+  SCompressionSettings smallSettings = settings;
+  smallSettings.memoryStats = &smallStats;
+  SCompressionSettings largeSettings = settings;
+  largeSettings.memoryStats = &largeStats;
+
+  // Both jobs run at the same time, but each only sees its own blocks.
+  CompressionHandle *smallHandle = CompressImageAsync(&small, smallSettings);
+  CompressionHandle *largeHandle = CompressImageAsync(&large, largeSettings);
+  ASSERT_TRUE(smallHandle != NULL);
+  ASSERT_TRUE(largeHandle != NULL);
+  EXPECT_EQ(smallHandle->Wait(), eCompressionStatus_Finished);
+  EXPECT_EQ(largeHandle->Wait(), eCompressionStatus_Finished);
+
+  EXPECT_EQ(smallStats.m_BytesAllocated[TCMemory::eCategory_CompressedData], 64U * 64U / 2U);
+  EXPECT_EQ(smallStats.m_LiveBytes[TCMemory::eCategory_CompressedData], 64U * 64U / 2U);
+  EXPECT_EQ(largeStats.m_BytesAllocated[TCMemory::eCategory_CompressedData], 128U * 128U / 2U);
+  EXPECT_EQ(largeStats.m_LiveBytes[TCMemory::eCategory_CompressedData], 128U * 128U / 2U);
+  EXPECT_GE(largeStats.m_PeakLiveBytes, 128U * 128U / 2U);
+
+  delete smallHandle;
+  delete largeHandle;
+}
+
+TEST(CompressImage, ReportsTheMemoryOfTheCall) {
+  FasTC::RGBA8Image img = MakeImage(64, 62);
+
+  // Allocations from before the call aren't part of it.
+  FasTC::RGBA8Image unrelated = MakeImage(256, 256);
+
+  TCMemory::Stats stats;
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_DXT5;
+  settings.iNumThreads = 4;
+  settings.memoryStats = &stats;
+  CompressedImage *ci = CompressImage(&img, settings);
+  ASSERT_TRUE(ci != NULL);
+
+  // The image is padded to 64x64 and compressed into one byte per pixel.
+  EXPECT_EQ(stats.m_BytesAllocated[TCMemory::eCategory_CompressedData], 64U * 64U);
+  EXPECT_EQ(stats.m_LiveBytes[TCMemory::eCategory_CompressedData], 64U * 64U);
+  EXPECT_GT(stats.m_BytesAllocated[TCMemory::eCategory_Image], 0U);
+  EXPECT_EQ(stats.m_LiveBytes[TCMemory::eCategory_Image], 0U);
+  EXPECT_GE(stats.m_PeakLiveBytes, 64U * 64U + 64U * 64U * 4U);
+  EXPECT_LT(stats.m_PeakLiveBytes, static_cast<uint64>(unrelated.GetDataSize()));
+
+  delete ci;
+}
@@ -0,0 +1,96 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "gtest/gtest.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/TexComp.h"
+
+#include <cstring>
+#include <vector>
+
+static FasTC::RGBA8Image MakeImage(uint32 w, uint32 h) {
+  FasTC::RGBA8Image img(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      uint8 *p = img(i, j);
+      p[0] = static_cast<uint8>(i * 3);
+      p[1] = static_cast<uint8>(j * 5);
+      p[2] = static_cast<uint8>((i * j) & 0xFF);
+      p[3] = static_cast<uint8>(255 - ((i + j) & 0x3F));
+    }
+  }
+  return img;
+}
+
+class ImageRowSource : public RGBA8RowSource {
+ public:
+  explicit ImageRowSource(const FasTC::RGBA8Image &img) : m_Image(img), m_NextRow(0) { }
+
+  virtual uint32 GetWidth() const { return m_Image.GetWidth(); }
+  virtual uint32 GetHeight() const { return m_Image.GetHeight(); }
+
+  virtual bool ReadRows(uint8 *rows, uint32 nRows) {
+    EXPECT_LE(m_NextRow + nRows, GetHeight());
+    for(uint32 j = 0; j < nRows; j++) {
+      memcpy(rows + j * m_Image.GetRowSize(), m_Image.GetRow(m_NextRow++), m_Image.GetRowSize());
+    }
+    return true;
+  }
+
+ private:
+  const FasTC::RGBA8Image &m_Image;
+  uint32 m_NextRow;
+};
+
+static std::vector<uint8> GetData(const CompressedImage *ci) {
+  std::vector<uint8> data;
+  if(ci) {
+    data.assign(ci->GetCompressedData(), ci->GetCompressedData() + ci->GetCompressedSize());
+  }
+  return data;
+}
+
+static void ExpectMatchesCompressImage(FasTC::ECompressionFormat format, uint32 w, uint32 h) {
+  SCompressionSettings settings;
+  settings.format = format;
+  settings.iQuality = 0;
+
+  FasTC::RGBA8Image img = MakeImage(w, h);
+  CompressedImage *expected = CompressImage(&img, settings);
+  ASSERT_TRUE(expected != NULL);
+
+  ImageRowSource src(img);
+  double cmpTimeMS = -1.0;
+  CompressedImage *streamed = CompressImageStreaming(src, settings, &cmpTimeMS);
+  ASSERT_TRUE(streamed != NULL);
+
+  EXPECT_TRUE(GetData(streamed) == GetData(expected));
+  EXPECT_GT(cmpTimeMS, 0.0);
+
+  delete expected;
+  delete streamed;
+}
+
+TEST(CompressImageStreaming, MatchesCompressImage) {
+  // Tall enough to be compressed in more than one band.
+  ExpectMatchesCompressImage(FasTC::eCompressionFormat_DXT1, 256, 512);
+}
+
+TEST(CompressImageStreaming, PVRTCMatchesCompressImage) {
+  ExpectMatchesCompressImage(FasTC::eCompressionFormat_PVRTC4, 128, 128);
+}
@@ -0,0 +1,179 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "gtest/gtest.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/TexComp.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static FasTC::RGBA8Image MakeImage(uint32 w, uint32 h) {
+  FasTC::RGBA8Image img(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      uint8 *p = img(i, j);
+      p[0] = static_cast<uint8>(i * 3);
+      p[1] = static_cast<uint8>(j * 5);
+      p[2] = static_cast<uint8>((i * j) & 0xFF);
+      p[3] = static_cast<uint8>(255 - ((i + j) & 0x3F));
+    }
+  }
+  return img;
+}
+
+class ImageTileSource : public RGBA8TileSource {
+ public:
+  explicit ImageTileSource(const FasTC::RGBA8Image &img) : m_Image(img) { }
+
+  virtual uint32 GetWidth() const { return m_Image.GetWidth(); }
+  virtual uint32 GetHeight() const { return m_Image.GetHeight(); }
+
+  virtual bool ReadTile(uint32 x, uint32 y, uint32 w, uint32 h, uint8 *pixels) {
+    EXPECT_LE(x + w, GetWidth());
+    EXPECT_LE(y + h, GetHeight());
+    for(uint32 j = 0; j < h; j++) {
+      memcpy(pixels + j * w * 4, m_Image(x, y + j), w * 4);
+    }
+    return true;
+  }
+
+ private:
+  const FasTC::RGBA8Image &m_Image;
+};
+
+// Appends the blocks, checking that each run starts where the last one ended.
+class AppendingSink : public CompressedBlockSink {
+ public:
+  explicit AppendingSink(uint32 blockSz) : m_BlockSz(blockSz) { }
+
+  virtual bool WriteBlocks(uint64 firstBlock, const uint8 *data, uint64 dataSz) {
+    EXPECT_EQ(firstBlock * m_BlockSz, static_cast<uint64>(m_Data.size()));
+    EXPECT_EQ(dataSz % m_BlockSz, 0U);
+    m_Data.insert(m_Data.end(), data, data + dataSz);
+    return true;
+  }
+
+  const std::vector<uint8> &GetData() const { return m_Data; }
+
+ private:
+  const uint32 m_BlockSz;
+  std::vector<uint8> m_Data;
+};
+
+static std::vector<uint8> Compress(const FasTC::RGBA8Image &img,
+                                   const SCompressionSettings &settings) {
+  CompressedImage *ci = CompressImage(&img, settings);
+  std::vector<uint8> data;
+  if(ci) {
+    data.assign(ci->GetCompressedData(), ci->GetCompressedData() + ci->GetCompressedSize());
+    delete ci;
+  }
+  return data;
+}
+
+static std::vector<uint8> CompressTiled(const FasTC::RGBA8Image &img,
+                                        const SCompressionSettings &settings,
+                                        uint32 tileSize) {
+  ImageTileSource src(img);
+  AppendingSink sink(FasTC::GetBlockSize(settings.format));
+  EXPECT_TRUE(CompressImageTiled(src, sink, settings, tileSize));
+  return sink.GetData();
+}
+
+static double ComputePSNR(const FasTC::RGBA8Image &img, FasTC::ECompressionFormat format,
+                          const std::vector<uint8> &blocks) {
+  CompressedImage ci(img.GetWidth(), img.GetHeight(), format, &blocks[0]);
+  FasTC::RGBA8Image decoded;
+  EXPECT_TRUE(ci.DecompressImage(&decoded));
+
+  double mse = 0.0;
+  for(uint32 i = 0; i < img.GetDataSize(); i++) {
+    const double d = static_cast<double>(img.GetData()[i]) - decoded.GetData()[i];
+    mse += d * d;
+  }
+  mse /= static_cast<double>(img.GetDataSize());
+  return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+TEST(CompressImageTiled, MatchesCompressImage) {
+  const FasTC::ECompressionFormat kFormats[] = {
+    FasTC::eCompressionFormat_DXT1,
+    FasTC::eCompressionFormat_DXT5,
+    FasTC::eCompressionFormat_ETC1,
+    FasTC::eCompressionFormat_BPTC,
+  };
+
+  // Neither dimension is a multiple of the tile size, and the second image
+  // needs padding to a multiple of the block size.
+  const uint32 kSizes[][2] = { { 96, 80 }, { 70, 45 } };
+
+  for(size_t f = 0; f < sizeof(kFormats) / sizeof(kFormats[0]); f++) {
+    for(size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); s++) {
+      SCompressionSettings settings;
+      settings.format = kFormats[f];
+      settings.iQuality = 0;
+
+      FasTC::RGBA8Image img = MakeImage(kSizes[s][0], kSizes[s][1]);
+      const std::vector<uint8> expected = Compress(img, settings);
+      ASSERT_FALSE(expected.empty());
+      EXPECT_TRUE(CompressTiled(img, settings, 32) == expected)
+        << "Format " << kFormats[f] << ", " << kSizes[s][0] << "x" << kSizes[s][1];
+    }
+  }
+}
+
+TEST(CompressImageTiled, PVRTCSingleTileMatchesCompressImage) {
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_PVRTC4;
+
+  FasTC::RGBA8Image img = MakeImage(128, 128);
+  const std::vector<uint8> expected = Compress(img, settings);
+  ASSERT_FALSE(expected.empty());
+  EXPECT_TRUE(CompressTiled(img, settings, 128) == expected);
+}
+
+TEST(CompressImageTiled, PVRTCTilesAreInMortonOrder) {
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_PVRTC4;
+
+  // The tiles can't see past their borders, so the blocks aren't exactly
+  // the same, but if any were out of place the image would fall apart.
+  FasTC::RGBA8Image img = MakeImage(256, 256);
+  const std::vector<uint8> expected = Compress(img, settings);
+  const std::vector<uint8> tiled = CompressTiled(img, settings, 64);
+  ASSERT_EQ(tiled.size(), expected.size());
+
+  const double expectedPSNR = ComputePSNR(img, settings.format, expected);
+  const double tiledPSNR = ComputePSNR(img, settings.format, tiled);
+  EXPECT_GT(tiledPSNR, expectedPSNR - 1.0);
+}
+
+TEST(CompressedImage, DecompressRejectsSmallBuffer) {
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_DXT1;
+  FasTC::RGBA8Image img = MakeImage(16, 16);
+  CompressedImage *ci = CompressImage(&img, settings);
+  ASSERT_TRUE(ci != NULL);
+
+  std::vector<uint8> out(static_cast<size_t>(ci->GetUncompressedSize()));
+  EXPECT_FALSE(ci->DecompressImage(&out[0], out.size() - 1));
+  EXPECT_TRUE(ci->DecompressImage(&out[0], out.size()));
+  delete ci;
+}
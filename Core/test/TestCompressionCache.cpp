@@ -0,0 +1,348 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+#include "gtest/gtest.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/CompressionCache.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/TexComp.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+static const char *kCachePath = "TestCompressionCache.d";
+
+static FasTC::RGBA8Image MakeImage(uint32 w, uint32 h, uint32 seed) {
+  FasTC::RGBA8Image img(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      uint8 *p = img(i, j);
+      p[0] = static_cast<uint8>(i * 3 + seed);
+      p[1] = static_cast<uint8>(j * 5 + seed * 7);
+      p[2] = static_cast<uint8>((i * j) & 0xFF);
+      p[3] = 255;
+    }
+  }
+  return img;
+}
+
+// Blocks that are easy to tell apart. The cache doesn't care whether they
+// are what the pixels compress to.
+static std::vector<uint8> MakeBlocks(uint64 sz, uint32 seed) {
+  std::vector<uint8> blocks(static_cast<size_t>(sz));
+  for(size_t i = 0; i < blocks.size(); i++) {
+    blocks[i] = static_cast<uint8>(i * 13 + seed);
+  }
+  return blocks;
+}
+
+static std::string CachePath(const std::string &name) {
+  return std::string(kCachePath) + "/" + name;
+}
+
+// The names of the entries in the cache, in sorted order.
+static std::vector<std::string> ListEntries() {
+  std::vector<std::string> names;
+  DIR *d = opendir(kCachePath);
+  if(d) {
+    struct dirent *entry;
+    while((entry = readdir(d)) != NULL) {
+      const std::string name = entry->d_name;
+      if(name != "." && name != "..") {
+        names.push_back(name);
+      }
+    }
+    closedir(d);
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+static void RemoveCache() {
+  const std::vector<std::string> names = ListEntries();
+  for(size_t i = 0; i < names.size(); i++) {
+    remove(CachePath(names[i]).c_str());
+  }
+  rmdir(kCachePath);
+}
+
+// Starts each test with an empty cache directory and removes it afterwards.
+class CompressionCacheTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() { RemoveCache(); }
+  virtual void TearDown() { RemoveCache(); }
+
+  // Stores the blocks and returns the name of the entry that they went to.
+  static std::string Store(CompressionCache &cache, const FasTC::RGBA8Image &img,
+                           const SCompressionSettings &settings,
+                           const std::vector<uint8> &blocks) {
+    const std::vector<std::string> before = ListEntries();
+    EXPECT_TRUE(cache.Store(img.GetData(), img.GetWidth(), img.GetHeight(),
+                            settings, &blocks[0], blocks.size()));
+    const std::vector<std::string> after = ListEntries();
+
+    std::vector<std::string> added;
+    std::set_difference(after.begin(), after.end(), before.begin(), before.end(),
+                        std::back_inserter(added));
+    return added.size() == 1? added[0] : std::string();
+  }
+
+  // Whether the cache has exactly these blocks for the pixels.
+  static bool Load(CompressionCache &cache, const FasTC::RGBA8Image &img,
+                   const SCompressionSettings &settings,
+                   const std::vector<uint8> &blocks) {
+    std::vector<uint8> loaded(blocks.size());
+    return cache.Load(img.GetData(), img.GetWidth(), img.GetHeight(),
+                      settings, &loaded[0], loaded.size()) && loaded == blocks;
+  }
+};
+
+static SCompressionSettings MakeSettings(FasTC::ECompressionFormat format, int quality) {
+  SCompressionSettings settings;
+  settings.format = format;
+  settings.iQuality = quality;
+  return settings;
+}
+
+TEST_F(CompressionCacheTest, ReusesCompressedImages) {
+  const FasTC::RGBA8Image img = MakeImage(30, 18, 0);
+  const SCompressionSettings settings = MakeSettings(FasTC::eCompressionFormat_DXT1, 50);
+
+  CompressedImage *expected = CompressImage(&img, settings);
+  ASSERT_TRUE(expected != NULL);
+  const std::vector<uint8> expectedBlocks(
+    expected->GetCompressedData(),
+    expected->GetCompressedData() + expected->GetCompressedSize());
+  delete expected;
+
+  {
+    CompressionCache cache(kCachePath, 0);
+    ASSERT_TRUE(cache.IsValid());
+
+    bool bCacheHit = true;
+    CompressedImage *ci = CompressImageCached(cache, &img, settings, NULL, &bCacheHit);
+    ASSERT_TRUE(ci != NULL);
+    EXPECT_FALSE(bCacheHit);
+    delete ci;
+
+    double cmpTimeMS = -1.0;
+    ci = CompressImageCached(cache, &img, settings, &cmpTimeMS, &bCacheHit);
+    ASSERT_TRUE(ci != NULL);
+    EXPECT_TRUE(bCacheHit);
+    EXPECT_EQ(cmpTimeMS, 0.0);
+    EXPECT_EQ(ci->GetWidth(), 32U);
+    EXPECT_EQ(ci->GetHeight(), 20U);
+    EXPECT_EQ(std::vector<uint8>(ci->GetCompressedData(),
+                                 ci->GetCompressedData() + ci->GetCompressedSize()),
+              expectedBlocks);
+    delete ci;
+
+    EXPECT_EQ(cache.GetNumHits(), 1U);
+    EXPECT_EQ(cache.GetNumMisses(), 1U);
+  }
+
+  // The entries outlive the cache that stored them.
+  CompressionCache cache(kCachePath, 0);
+  EXPECT_TRUE(Load(cache, img, settings, expectedBlocks));
+  EXPECT_EQ(cache.GetNumHits(), 1U);
+  EXPECT_EQ(cache.GetNumMisses(), 0U);
+}
+
+TEST_F(CompressionCacheTest, KeysEntriesBySettings) {
+  CompressionCache cache(kCachePath, 0);
+  ASSERT_TRUE(cache.IsValid());
+
+  const FasTC::RGBA8Image img = MakeImage(16, 16, 0);
+  const std::vector<uint8> blocks = MakeBlocks(16 * 16, 0);
+
+  const SCompressionSettings bptc = MakeSettings(FasTC::eCompressionFormat_BPTC, 10);
+  EXPECT_FALSE(Load(cache, img, bptc, blocks));
+  EXPECT_FALSE(Store(cache, img, bptc, blocks).empty());
+  EXPECT_TRUE(Load(cache, img, bptc, blocks));
+
+  // BPTC produces different blocks at each quality.
+  EXPECT_FALSE(Load(cache, img, MakeSettings(FasTC::eCompressionFormat_BPTC, 20), blocks));
+
+  // Other formats with blocks of the same size don't share the entry.
+  EXPECT_FALSE(Load(cache, img, MakeSettings(FasTC::eCompressionFormat_DXT5, 10), blocks));
+
+  // Neither do other pixels, or a different amount of blocks.
+  EXPECT_FALSE(Load(cache, MakeImage(16, 16, 1), bptc, blocks));
+  EXPECT_FALSE(Load(cache, img, bptc, MakeBlocks(16 * 8, 0)));
+
+  // Settings that don't change the blocks don't matter.
+  SCompressionSettings threaded = bptc;
+  threaded.iNumThreads = 4;
+  threaded.iNumCompressions = 3;
+  EXPECT_TRUE(Load(cache, img, threaded, blocks));
+
+  // The other formats ignore the quality.
+  const SCompressionSettings dxt5 = MakeSettings(FasTC::eCompressionFormat_DXT5, 10);
+  const std::string dxt5Entry = Store(cache, img, dxt5, blocks);
+  EXPECT_FALSE(dxt5Entry.empty());
+  EXPECT_TRUE(Load(cache, img, MakeSettings(FasTC::eCompressionFormat_DXT5, 90), blocks));
+
+  // Storing the same pixels again replaces the entry.
+  const std::vector<uint8> newBlocks = MakeBlocks(16 * 16, 1);
+  EXPECT_TRUE(Store(cache, img, dxt5, newBlocks).empty());
+  EXPECT_FALSE(Load(cache, img, dxt5, blocks));
+  EXPECT_TRUE(Load(cache, img, dxt5, newBlocks));
+  EXPECT_EQ(ListEntries().size(), 2U);
+}
+
+TEST_F(CompressionCacheTest, SkipsUncacheableSettings) {
+  FasTC::BlockStatList stats;
+  SCompressionSettings settings = MakeSettings(FasTC::eCompressionFormat_DXT1, 50);
+  EXPECT_TRUE(CompressionCache::IsCacheable(settings));
+
+  settings.blockStats = &stats;
+  EXPECT_FALSE(CompressionCache::IsCacheable(settings));
+
+  settings = MakeSettings(FasTC::eCompressionFormat_BPTC, 50);
+  settings.bUseSIMD = true;
+  EXPECT_FALSE(CompressionCache::IsCacheable(settings));
+
+  CompressionCache cache(kCachePath, 0);
+  const FasTC::RGBA8Image img = MakeImage(16, 16, 0);
+  const std::vector<uint8> blocks = MakeBlocks(16 * 16, 0);
+  EXPECT_FALSE(cache.Store(img.GetData(), 16, 16, settings, &blocks[0], blocks.size()));
+  EXPECT_TRUE(ListEntries().empty());
+}
+
+TEST_F(CompressionCacheTest, EvictsLeastRecentlyUsedEntries) {
+  // Each entry is a 64 byte header and 16 DXT1 blocks, and four and a half
+  // of them fit.
+  const uint64 kEntrySz = 64 + 16 * 8;
+  CompressionCache cache(kCachePath, 4 * kEntrySz + kEntrySz / 2);
+  ASSERT_TRUE(cache.IsValid());
+
+  const SCompressionSettings settings = MakeSettings(FasTC::eCompressionFormat_DXT1, 50);
+  std::vector<FasTC::RGBA8Image> images;
+  std::vector<std::vector<uint8> > blocks;
+  std::vector<std::string> entries;
+  for(uint32 i = 0; i < 5; i++) {
+    images.push_back(MakeImage(16, 16, i));
+    blocks.push_back(MakeBlocks(16 * 8, i));
+  }
+
+  // Give the first four entries modification times that are far enough
+  // apart to order them, from oldest to newest.
+  const time_t now = time(NULL);
+  for(uint32 i = 0; i < 4; i++) {
+    entries.push_back(Store(cache, images[i], settings, blocks[i]));
+    ASSERT_FALSE(entries[i].empty());
+
+    utimbuf times;
+    times.actime = times.modtime = now - 100 + 10 * i;
+    ASSERT_EQ(utime(CachePath(entries[i]).c_str(), &times), 0);
+  }
+  EXPECT_EQ(ListEntries().size(), 4U);
+
+  // Using the oldest entry makes it the newest.
+  EXPECT_TRUE(Load(cache, images[0], settings, blocks[0]));
+
+  // The fifth entry doesn't fit, so the least recently used ones are removed
+  // until there is some room to spare.
+  EXPECT_FALSE(Store(cache, images[4], settings, blocks[4]).empty());
+  EXPECT_EQ(ListEntries().size(), 3U);
+
+  EXPECT_TRUE(Load(cache, images[0], settings, blocks[0]));
+  EXPECT_FALSE(Load(cache, images[1], settings, blocks[1]));
+  EXPECT_FALSE(Load(cache, images[2], settings, blocks[2]));
+  EXPECT_TRUE(Load(cache, images[3], settings, blocks[3]));
+  EXPECT_TRUE(Load(cache, images[4], settings, blocks[4]));
+
+  // A new cache trims the directory to its own limit, which leaves no room
+  // for an entry once some is spared.
+  CompressionCache smaller(kCachePath, kEntrySz);
+  EXPECT_TRUE(ListEntries().empty());
+}
+
+// Replaces the entry with its first sz bytes, flipping the bits of the byte
+// at flipIdx if it is less than sz.
+static void DamageEntry(const std::string &name, size_t sz, size_t flipIdx) {
+  const std::string path = CachePath(name);
+  std::vector<uint8> data(4096);
+  FILE *f = fopen(path.c_str(), "rb");
+  ASSERT_TRUE(f != NULL);
+  data.resize(fread(&data[0], 1, data.size(), f));
+  fclose(f);
+
+  ASSERT_LE(sz, data.size());
+  data.resize(sz);
+  if(flipIdx < sz) {
+    data[flipIdx] = ~data[flipIdx];
+  }
+
+  f = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(f != NULL);
+  if(!data.empty()) {
+    fwrite(&data[0], 1, data.size(), f);
+  }
+  fclose(f);
+}
+
+TEST_F(CompressionCacheTest, RemovesDamagedEntries) {
+  CompressionCache cache(kCachePath, 0);
+  ASSERT_TRUE(cache.IsValid());
+
+  const FasTC::RGBA8Image img = MakeImage(16, 16, 0);
+  const SCompressionSettings settings = MakeSettings(FasTC::eCompressionFormat_DXT1, 50);
+  const std::vector<uint8> blocks = MakeBlocks(16 * 8, 0);
+  const size_t kEntrySz = 64 + blocks.size();
+
+  struct {
+    size_t sz;
+    size_t flipIdx;
+  } kDamage[] = {
+    { kEntrySz, 64 + 5 },          // Corrupt blocks
+    { kEntrySz, 60 },              // Corrupt block hash
+    { kEntrySz - 1, kEntrySz },    // Missing the last byte
+    { 64, kEntrySz },              // Missing the blocks
+    { 10, kEntrySz },              // Missing most of the header
+    { 0, kEntrySz }                // Empty
+  };
+
+  for(size_t i = 0; i < sizeof(kDamage) / sizeof(kDamage[0]); i++) {
+    const std::string entry = Store(cache, img, settings, blocks);
+    ASSERT_FALSE(entry.empty());
+    ASSERT_TRUE(Load(cache, img, settings, blocks));
+
+    DamageEntry(entry, kDamage[i].sz, kDamage[i].flipIdx);
+    EXPECT_FALSE(Load(cache, img, settings, blocks)) << i;
+    EXPECT_TRUE(ListEntries().empty()) << i;
+  }
+
+  // Compressing the image again stores a good entry in place of the damaged
+  // one.
+  bool bCacheHit = true;
+  CompressedImage *ci = CompressImageCached(cache, &img, settings, NULL, &bCacheHit);
+  EXPECT_FALSE(bCacheHit);
+  delete ci;
+
+  ci = CompressImageCached(cache, &img, settings, NULL, &bCacheHit);
+  EXPECT_TRUE(bCacheHit);
+  delete ci;
+}
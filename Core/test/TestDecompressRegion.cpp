@@ -0,0 +1,187 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "gtest/gtest.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/TexComp.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static FasTC::RGBA8Image MakeImage(uint32 w, uint32 h) {
+  FasTC::RGBA8Image img(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      uint8 *p = img(i, j);
+      p[0] = static_cast<uint8>(i * 11);
+      p[1] = static_cast<uint8>(j * 7);
+      p[2] = static_cast<uint8>((i * j) & 0xFF);
+      p[3] = static_cast<uint8>(255 - ((i + 2 * j) & 0x7F));
+    }
+  }
+  return img;
+}
+
+struct Region {
+  uint32 x, y, w, h;
+};
+
+// Decodes a variety of regions of the image and checks each one against the
+// same pixels of the full decode. The image should be a few blocks across,
+// and not a multiple of the block size in either direction.
+static void ExpectRegionsMatchFullDecode(const CompressedImage &ci) {
+  FasTC::RGBA8Image full;
+  ASSERT_TRUE(ci.DecompressImage(&full));
+
+  const uint32 w = ci.GetWidth();
+  const uint32 h = ci.GetHeight();
+  const Region kRegions[] = {
+    // The whole image, and single pixels in the corners.
+    { 0, 0, w, h },
+    { 0, 0, 1, 1 },
+    { w - 1, 0, 1, 1 },
+    { 0, h - 1, 1, 1 },
+    { w - 1, h - 1, 1, 1 },
+
+    // Regions that don't start or end on a block boundary.
+    { 3, 5, 17, 9 },
+    { 1, 1, w / 2, h / 3 },
+    { 7, 13, 1, 11 },
+
+    // Regions that run into the partial blocks on the right and bottom.
+    { 13, 2, w - 13, h - 2 },
+    { 1, h - 7, w - 2, 7 },
+    { w - 3, 6, 3, h - 6 },
+
+    // Whole rows, which decode the blocks in place.
+    { 0, 9, w, 10 },
+    { 0, h - 5, w, 5 },
+  };
+
+  for(size_t r = 0; r < sizeof(kRegions) / sizeof(kRegions[0]); r++) {
+    const Region &rgn = kRegions[r];
+    FasTC::RGBA8Image region;
+    ASSERT_TRUE(ci.DecompressRegion(rgn.x, rgn.y, rgn.w, rgn.h, &region));
+    ASSERT_EQ(rgn.w, region.GetWidth());
+    ASSERT_EQ(rgn.h, region.GetHeight());
+
+    for(uint32 j = 0; j < rgn.h; j++) {
+      EXPECT_EQ(0, memcmp(region.GetRow(j), full(rgn.x, rgn.y + j), region.GetRowSize()))
+        << "Format " << ci.GetFormat() << ", region " << rgn.x << "," << rgn.y
+        << " " << rgn.w << "x" << rgn.h << ", row " << j;
+    }
+  }
+}
+
+TEST(DecompressRegion, MatchesFullDecode) {
+  const FasTC::ECompressionFormat kFormats[] = {
+    FasTC::eCompressionFormat_DXT1,
+    FasTC::eCompressionFormat_DXT5,
+    FasTC::eCompressionFormat_ETC1,
+    FasTC::eCompressionFormat_BPTC,
+  };
+
+  FasTC::RGBA8Image img = MakeImage(45, 37);
+  for(size_t f = 0; f < sizeof(kFormats) / sizeof(kFormats[0]); f++) {
+    SCompressionSettings settings;
+    settings.format = kFormats[f];
+    settings.iQuality = 0;
+
+    CompressedImage *ci = CompressImage(&img, settings);
+    ASSERT_TRUE(ci != NULL);
+    ExpectRegionsMatchFullDecode(*ci);
+    delete ci;
+  }
+}
+
+TEST(DecompressRegion, MatchesFullDecodePVRTC) {
+  SCompressionSettings settings;
+  settings.format = FasTC::eCompressionFormat_PVRTC4;
+
+  FasTC::RGBA8Image img = MakeImage(64, 64);
+  CompressedImage *ci = CompressImage(&img, settings);
+  ASSERT_TRUE(ci != NULL);
+  ExpectRegionsMatchFullDecode(*ci);
+  delete ci;
+}
+
+// Loads the blocks of one of the ASTC decoder's test images, which are
+// copied next to the test. There's no ASTC encoder to make them with. The
+// images are a whole number of blocks across, so half a block is trimmed off
+// of the right and the bottom to leave partial blocks there.
+static CompressedImage *LoadASTC(const char *filename, FasTC::ECompressionFormat fmt) {
+  std::vector<uint8> data;
+  FILE *f = fopen(filename, "rb");
+  if(!f) {
+    return NULL;
+  }
+
+  uint8 buf[4096];
+  size_t n;
+  while((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    data.insert(data.end(), buf, buf + n);
+  }
+  fclose(f);
+
+  if(data.size() < 16) {
+    return NULL;
+  }
+
+  const uint32 w = data[7] | (data[8] << 8) | (data[9] << 16);
+  const uint32 h = data[10] | (data[11] << 8) | (data[12] << 16);
+  if(data.size() - 16 != CompressedImage::GetCompressedSize(w, h, fmt)) {
+    return NULL;
+  }
+
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(fmt, blockDims);
+  return new CompressedImage(w - blockDims[0] / 2, h - blockDims[1] / 2, fmt, &data[16]);
+}
+
+// The ASTC decoder flips the image upside down, so the region's blocks come
+// from the other end of the image, and the partial row of blocks ends up at
+// the top.
+TEST(DecompressRegion, MatchesFullDecodeASTC) {
+  const struct {
+    const char *filename;
+    FasTC::ECompressionFormat format;
+  } kImages[] = {
+    { "mandrill_10x8.astc", FasTC::eCompressionFormat_ASTC10x8 },
+    { "mandrill_12x12.astc", FasTC::eCompressionFormat_ASTC12x12 },
+  };
+
+  for(size_t i = 0; i < sizeof(kImages) / sizeof(kImages[0]); i++) {
+    CompressedImage *ci = LoadASTC(kImages[i].filename, kImages[i].format);
+    ASSERT_TRUE(ci != NULL) << kImages[i].filename;
+    ExpectRegionsMatchFullDecode(*ci);
+    delete ci;
+  }
+}
+
+TEST(DecompressRegion, RejectsRegionsOutsideTheImage) {
+  const FasTC::ECompressionFormat fmt = FasTC::eCompressionFormat_DXT1;
+  std::vector<uint8> blocks(static_cast<size_t>(CompressedImage::GetCompressedSize(16, 16, fmt)));
+  CompressedImage ci(16, 16, fmt, &blocks[0]);
+
+  FasTC::RGBA8Image region;
+  EXPECT_FALSE(ci.DecompressRegion(0, 0, 0, 4, &region));
+  EXPECT_FALSE(ci.DecompressRegion(16, 0, 1, 1, &region));
+  EXPECT_FALSE(ci.DecompressRegion(0, 12, 4, 5, &region));
+  EXPECT_FALSE(ci.DecompressRegion(1, 0, 0xFFFFFFFF, 1, &region));
+}
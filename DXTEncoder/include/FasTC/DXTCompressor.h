@@ -17,6 +17,7 @@
 
 #include "FasTC/TexCompTypes.h"
 #include "FasTC/CompressionJob.h"
+#include "FasTC/BlockStats.h"
 
 namespace DXTC
 {
@@ -24,6 +25,13 @@ namespace DXTC
   void CompressImageDXT1(const FasTC::CompressionJob &);
   void CompressImageDXT5(const FasTC::CompressionJob &);
 
+  // The same as above, but also adds a record with the mode and error of
+  // each block to stats.
+  void CompressImageDXT1WithStats(const FasTC::CompressionJob &,
+                                  FasTC::BlockStatList *stats);
+  void CompressImageDXT5WithStats(const FasTC::CompressionJob &,
+                                  FasTC::BlockStatList *stats);
+
   void DecompressDXT1(const FasTC::DecompressionJob &);
   void DecompressDXT5(const FasTC::DecompressionJob &);
 }
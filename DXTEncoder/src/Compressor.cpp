@@ -16,6 +16,8 @@
 // <http://gamma.cs.unc.edu/FasTC/>
 
 #include "FasTC/DXTCompressor.h"
+#include "FasTC/Trace.h"
+
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
@@ -40,14 +42,16 @@ namespace DXTC
     }
   }
 
-  // Compress an image using DXT1 compression. Use the inBuf parameter to point to an image in
-  // 4-byte RGBA format. The width and height parameters specify the size of the image in pixels.
-  // The buffer pointed to by outBuf should be large enough to store the compressed image. This
-  // implementation has an 8:1 compression ratio.
-  void CompressImageDXT1(const FasTC::CompressionJob &cj) {
+  // Compresses the blocks of the job into DXT1 or DXT5. If stats is not
+  // NULL, each block is decoded again to record its mode and error.
+  static void CompressImageDXT(const FasTC::CompressionJob &cj,
+                               FasTC::ECompressionFormat fmt,
+                               FasTC::BlockStatList *stats) {
     uint8 block[64];
+    uint8 decoded[64];
 
-    const uint32 kBlockSz = GetBlockSize(FasTC::eCompressionFormat_DXT1);
+    const bool bAlpha = fmt == FasTC::eCompressionFormat_DXT5;
+    const uint32 kBlockSz = GetBlockSize(fmt);
     const uint32 startBlock = cj.CoordsToBlockIdx(cj.XStart(), cj.YStart());
     uint8 *outBuf = cj.OutBuf() + startBlock * kBlockSz;
 
@@ -60,37 +64,62 @@ namespace DXTC
 
         const uint32 kOffset = j*cj.Width() + i;
         ExtractBlock(inPixels + kOffset, cj.Width(), block);
-        stb_compress_dxt_block(outBuf, block, 0, STB_DXT_DITHER);
-        outBuf += 8;
+        stb_compress_dxt_block(outBuf, block, bAlpha? 1 : 0, STB_DXT_DITHER);
+
+        if(stats) {
+          FasTC::BlockStat stat(fmt, cj.CoordsToBlockIdx(i, j));
+
+          // DXT5 always decodes its colors with four entries. For DXT1, the
+          // endpoints are compared as they are stored to pick the mode.
+          const uint16 *colors = reinterpret_cast<const uint16 *>(outBuf);
+          stat.m_Mode = (bAlpha || colors[0] > colors[1])? 0 : 1;
+
+          FasTC::DecompressionJob dcj(fmt, outBuf, decoded, 4, 4);
+          if(bAlpha) {
+            DecompressDXT5(dcj);
+          } else {
+            DecompressDXT1(dcj);
+          }
+
+          stat.m_Error = FasTC::BlockStat::SquaredError(
+            reinterpret_cast<const uint32 *>(block),
+            reinterpret_cast<const uint32 *>(decoded), bAlpha);
+          stats->Add(stat);
+        }
+
+        outBuf += kBlockSz;
       }
       startX = 0;
     }
   }
 
+  // Compress an image using DXT1 compression. Use the inBuf parameter to point to an image in
+  // 4-byte RGBA format. The width and height parameters specify the size of the image in pixels.
+  // The buffer pointed to by outBuf should be large enough to store the compressed image. This
+  // implementation has an 8:1 compression ratio.
+  void CompressImageDXT1(const FasTC::CompressionJob &cj) {
+    FASTC_TRACE_ZONE("DXT1 Compress");
+    CompressImageDXT(cj, FasTC::eCompressionFormat_DXT1, NULL);
+  }
+
+  void CompressImageDXT1WithStats(const FasTC::CompressionJob &cj,
+                                  FasTC::BlockStatList *stats) {
+    FASTC_TRACE_ZONE("DXT1 Compress");
+    CompressImageDXT(cj, FasTC::eCompressionFormat_DXT1, stats);
+  }
+
   // Compress an image using DXT5 compression. Use the inBuf parameter to point to an image in
   // 4-byte RGBA format. The width and height parameters specify the size of the image in pixels.
   // The buffer pointed to by outBuf should be large enough to store the compressed image. This
   // implementation has an 4:1 compression ratio.
   void CompressImageDXT5(const FasTC::CompressionJob &cj) {
-    uint8 block[64];
-
-    const uint32 kBlockSz = GetBlockSize(FasTC::eCompressionFormat_DXT5);
-    const uint32 startBlock = cj.CoordsToBlockIdx(cj.XStart(), cj.YStart());
-    uint8 *outBuf = cj.OutBuf() + startBlock * kBlockSz;
-    
-    const uint32 *inPixels = reinterpret_cast<const uint32 *>(cj.InBuf());
-    uint32 endY = std::min(cj.YEnd(), cj.Height() - 4);
-    uint32 startX = cj.XStart();
-    for(uint32 j = cj.YStart(); j <= endY; j += 4) {
-      const uint32 endX = j == cj.YEnd()? cj.XEnd() : cj.Width();
-      for(uint32 i = startX; i < endX; i += 4) {
+    FASTC_TRACE_ZONE("DXT5 Compress");
+    CompressImageDXT(cj, FasTC::eCompressionFormat_DXT5, NULL);
+  }
 
-        const uint32 kOffset = j*cj.Width() + i;
-        ExtractBlock(inPixels + kOffset, cj.Width(), block);
-        stb_compress_dxt_block(outBuf, block, 1, STB_DXT_DITHER);
-        outBuf += 16;
-      }
-      startX = 0;
-    }
+  void CompressImageDXT5WithStats(const FasTC::CompressionJob &cj,
+                                  FasTC::BlockStatList *stats) {
+    FASTC_TRACE_ZONE("DXT5 Compress");
+    CompressImageDXT(cj, FasTC::eCompressionFormat_DXT5, stats);
   }
 }
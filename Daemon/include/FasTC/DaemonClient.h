@@ -0,0 +1,134 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef DAEMON_INCLUDE_DAEMONCLIENT_H_
+#define DAEMON_INCLUDE_DAEMONCLIENT_H_
+
+#include "FasTC/TexCompTypes.h"
+#include "FasTC/CompressionFormat.h"
+#include "FasTC/ImageFwd.h"
+
+#include <string>
+#include <vector>
+
+namespace FasTC {
+
+  // The outcome of a job sent to fastcd.
+  enum EDaemonStatus {
+    eDaemonStatus_OK,
+
+    // The daemon's queue is full. The job was not run and may be sent again
+    // later.
+    eDaemonStatus_Busy,
+
+    // The request was malformed or asked for something the daemon doesn't
+    // allow, such as reading files when that is turned off.
+    eDaemonStatus_BadRequest,
+
+    // The image could not be loaded or compressed.
+    eDaemonStatus_Failed,
+
+    // The daemon is shutting down and no longer takes jobs.
+    eDaemonStatus_ShuttingDown,
+
+    // The client couldn't talk to the daemon. This never comes from the
+    // daemon itself.
+    eDaemonStatus_ConnectionFailed,
+
+    kNumDaemonStatuses
+  };
+
+  extern const char *GetDaemonStatusString(EDaemonStatus status);
+
+  // What to do with the pixels of a job.
+  struct SDaemonJob {
+    ECompressionFormat format;
+    int quality;
+
+    // Queued jobs with a higher priority run first. Jobs with the same
+    // priority run in the order that they arrived.
+    int priority;
+
+    // Compare the compressed image against the original and return its PSNR.
+    bool bComputeMetrics;
+
+    SDaemonJob()
+      : format(eCompressionFormat_BPTC)
+      , quality(50)
+      , priority(0)
+      , bComputeMetrics(false)
+    { }
+  };
+
+  struct SDaemonResult {
+    EDaemonStatus status;
+
+    // Says what went wrong when the status isn't eDaemonStatus_OK.
+    std::string error;
+
+    // The compressed blocks, laid out like the data of a CompressedImage of
+    // the given size. The size is padded up to a multiple of the block size
+    // if the image wasn't already one.
+    ECompressionFormat format;
+    uint32 width;
+    uint32 height;
+    std::vector<uint8> data;
+
+    // The time spent compressing the image, and the time that the job
+    // waited in the queue before that.
+    double cmpTimeMS;
+    double queueTimeMS;
+
+    // Only set if bComputeMetrics was requested, and zero otherwise.
+    double psnr;
+
+    SDaemonResult()
+      : status(eDaemonStatus_ConnectionFailed)
+      , format(kNumCompressionFormats)
+      , width(0), height(0)
+      , cmpTimeMS(0.0), queueTimeMS(0.0), psnr(0.0)
+    { }
+  };
+
+  // Sends compression jobs to a fastcd daemon listening on a Unix domain
+  // socket. Every job uses its own connection, so a client may be used from
+  // several threads at once.
+  class DaemonClient {
+   public:
+    explicit DaemonClient(const char *socketPath) : m_SocketPath(socketPath) { }
+
+    // Compresses the pixels of img. The pixels are copied to the daemon.
+    // Returns true if result->status is eDaemonStatus_OK.
+    bool CompressPixels(const RGBA8Image &img, const SDaemonJob &job,
+                        SDaemonResult *result) const;
+
+    // Has the daemon load the image at path and compress it. Relative paths
+    // are relative to the daemon's working directory.
+    bool CompressFile(const char *path, const SDaemonJob &job,
+                      SDaemonResult *result) const;
+
+   private:
+    bool RunJob(uint32 type, uint32 width, uint32 height,
+                const uint8 *payload, uint64 payloadSz,
+                const SDaemonJob &job, SDaemonResult *result) const;
+
+    std::string m_SocketPath;
+  };
+
+}  // namespace FasTC
+
+#endif  // DAEMON_INCLUDE_DAEMONCLIENT_H_
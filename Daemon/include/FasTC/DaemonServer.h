@@ -0,0 +1,98 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef DAEMON_INCLUDE_DAEMONSERVER_H_
+#define DAEMON_INCLUDE_DAEMONSERVER_H_
+
+#include "FasTC/TexCompTypes.h"
+
+#include <cstddef>
+
+namespace FasTC {
+
+  struct SDaemonSettings {
+    // The path of the Unix domain socket to listen on.
+    const char *socketPath;
+
+    // The number of jobs that are compressed at once. If this is zero, one
+    // job per hardware thread is run.
+    uint32 numWorkers;
+
+    // The number of threads that compress each job.
+    uint32 numThreadsPerJob;
+
+    // The number of jobs that may wait for a worker. Jobs that arrive while
+    // the queue is full are turned away with eDaemonStatus_Busy rather than
+    // piling up in memory.
+    uint32 maxQueuedJobs;
+
+    // Requests with more payload than this are rejected.
+    uint64 maxRequestBytes;
+
+    // Whether clients may ask the daemon to load images from its file system.
+    bool bAllowFiles;
+
+    // Clients that haven't sent their whole request this many seconds after
+    // connecting are dropped.
+    uint32 requestTimeoutSeconds;
+
+    SDaemonSettings()
+      : socketPath(NULL)
+      , numWorkers(0)
+      , numThreadsPerJob(1)
+      , maxQueuedJobs(64)
+      , maxRequestBytes(static_cast<uint64>(1) << 30)
+      , bAllowFiles(true)
+      , requestTimeoutSeconds(30)
+    { }
+  };
+
+  class DaemonServerImpl;
+
+  // Compresses images sent by DaemonClient. A single thread accepts the
+  // connections and reads the requests as they arrive, without waiting on
+  // any one client, and a fixed pool of workers that lives as long as the
+  // server compresses them in order of priority and writes back the results.
+  class DaemonServer {
+   public:
+    explicit DaemonServer(const SDaemonSettings &settings);
+    ~DaemonServer();
+
+    // Creates the socket and starts listening. A socket file left behind by
+    // a daemon that is no longer running is replaced, but this fails if
+    // another daemon is still listening on it.
+    bool Listen();
+
+    // Accepts jobs until Stop is called. The jobs that were already queued
+    // are finished before this returns, and the socket file is removed.
+    void Run();
+
+    // Makes Run return. This may be called from any thread, and from a
+    // signal handler.
+    void Stop();
+
+   private:
+    // Not copyable.
+    DaemonServer(const DaemonServer &);
+    DaemonServer &operator=(const DaemonServer &);
+
+    DaemonServerImpl *m_Impl;
+  };
+
+}  // namespace FasTC
+
+#endif  // DAEMON_INCLUDE_DAEMONSERVER_H_
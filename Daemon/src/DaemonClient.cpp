@@ -0,0 +1,156 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/DaemonClient.h"
+
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "FasTC/RGBAImage.h"
+
+#include "DaemonProtocol.h"
+
+namespace FasTC {
+
+const char *GetDaemonStatusString(EDaemonStatus status) {
+  switch(status) {
+    case eDaemonStatus_OK: return "OK";
+    case eDaemonStatus_Busy: return "Busy";
+    case eDaemonStatus_BadRequest: return "Bad request";
+    case eDaemonStatus_Failed: return "Failed";
+    case eDaemonStatus_ShuttingDown: return "Shutting down";
+    case eDaemonStatus_ConnectionFailed: return "Connection failed";
+    default: return "Unknown";
+  }
+}
+
+static bool Fail(SDaemonResult *result, EDaemonStatus status, const char *error) {
+  result->status = status;
+  result->error = error;
+  return false;
+}
+
+// Closes the socket when it goes out of scope.
+class ScopedSocket {
+ public:
+  explicit ScopedSocket(int fd) : m_FD(fd) { }
+  ~ScopedSocket() {
+    if(m_FD >= 0) {
+      close(m_FD);
+    }
+  }
+
+  int Get() const { return m_FD; }
+
+ private:
+  int m_FD;
+};
+
+bool DaemonClient::CompressPixels(const RGBA8Image &img, const SDaemonJob &job,
+                                  SDaemonResult *result) const {
+  return RunJob(DaemonProtocol::eJobType_Pixels, img.GetWidth(), img.GetHeight(),
+                img.GetData(), img.GetDataSize(), job, result);
+}
+
+bool DaemonClient::CompressFile(const char *path, const SDaemonJob &job,
+                                SDaemonResult *result) const {
+  return RunJob(DaemonProtocol::eJobType_File, 0, 0,
+                reinterpret_cast<const uint8 *>(path), strlen(path), job, result);
+}
+
+bool DaemonClient::RunJob(uint32 type, uint32 width, uint32 height,
+                          const uint8 *payload, uint64 payloadSz,
+                          const SDaemonJob &job, SDaemonResult *result) const {
+  *result = SDaemonResult();
+
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(m_SocketPath.size() >= sizeof(addr.sun_path)) {
+    return Fail(result, eDaemonStatus_ConnectionFailed, "Socket path is too long");
+  }
+  memcpy(addr.sun_path, m_SocketPath.c_str(), m_SocketPath.size());
+
+  ScopedSocket sock(socket(AF_UNIX, SOCK_STREAM, 0));
+  if(sock.Get() < 0) {
+    return Fail(result, eDaemonStatus_ConnectionFailed, "Unable to create socket");
+  }
+  DaemonProtocol::DisableSigPipe(sock.Get());
+
+  if(connect(sock.Get(), reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    return Fail(result, eDaemonStatus_ConnectionFailed, "Unable to connect to daemon");
+  }
+
+  DaemonProtocol::RequestHeader request;
+  request.magic = DaemonProtocol::kRequestMagic;
+  request.version = DaemonProtocol::kVersion;
+  request.type = type;
+  request.format = job.format;
+  request.quality = job.quality;
+  request.priority = job.priority;
+  request.flags = job.bComputeMetrics? DaemonProtocol::kFlag_ComputeMetrics : 0;
+  request.width = width;
+  request.height = height;
+  request.payloadSz = payloadSz;
+
+  uint8 requestBuf[DaemonProtocol::kRequestHeaderSz];
+  DaemonProtocol::WriteRequestHeader(request, requestBuf);
+
+  // The daemon may turn the job away before it has read the whole payload,
+  // so a failed send isn't an error until we know there's no response.
+  bool bSent = DaemonProtocol::SendAll(sock.Get(), requestBuf, sizeof(requestBuf));
+  bSent = bSent && DaemonProtocol::SendAll(sock.Get(), payload, payloadSz);
+
+  uint8 responseBuf[DaemonProtocol::kResponseHeaderSz];
+  if(!DaemonProtocol::RecvAll(sock.Get(), responseBuf, sizeof(responseBuf))) {
+    return Fail(result, eDaemonStatus_ConnectionFailed,
+                bSent? "No response from daemon" : "Unable to send request");
+  }
+
+  DaemonProtocol::ResponseHeader response;
+  DaemonProtocol::ReadResponseHeader(responseBuf, &response);
+  if(response.magic != DaemonProtocol::kResponseMagic ||
+     response.status >= kNumDaemonStatuses) {
+    return Fail(result, eDaemonStatus_ConnectionFailed, "Invalid response from daemon");
+  }
+
+  std::vector<uint8> data(static_cast<size_t>(response.dataSz));
+  if(!data.empty() && !DaemonProtocol::RecvAll(sock.Get(), &data[0], data.size())) {
+    return Fail(result, eDaemonStatus_ConnectionFailed, "Truncated response from daemon");
+  }
+
+  result->status = static_cast<EDaemonStatus>(response.status);
+  if(result->status != eDaemonStatus_OK) {
+    result->error.assign(data.begin(), data.end());
+    return false;
+  }
+
+  result->format = static_cast<ECompressionFormat>(response.format);
+  result->width = response.width;
+  result->height = response.height;
+  result->cmpTimeMS = response.cmpTimeMS;
+  result->queueTimeMS = response.queueTimeMS;
+  result->psnr = response.psnr;
+  result->data.swap(data);
+  return true;
+}
+
+}  // namespace FasTC
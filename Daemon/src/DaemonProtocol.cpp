@@ -0,0 +1,195 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "DaemonProtocol.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+namespace {
+
+class ByteWriter {
+ public:
+  explicit ByteWriter(uint8 *buf) : m_Ptr(buf) { }
+
+  void Write32(uint32 v) {
+    for(uint32 i = 0; i < 4; i++) {
+      *m_Ptr++ = static_cast<uint8>(v >> (8 * i));
+    }
+  }
+
+  void Write64(uint64 v) {
+    for(uint32 i = 0; i < 8; i++) {
+      *m_Ptr++ = static_cast<uint8>(v >> (8 * i));
+    }
+  }
+
+  void WriteDouble(double v) {
+    uint64 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    Write64(bits);
+  }
+
+ private:
+  uint8 *m_Ptr;
+};
+
+class ByteReader {
+ public:
+  explicit ByteReader(const uint8 *buf) : m_Ptr(buf) { }
+
+  uint32 Read32() {
+    uint32 v = 0;
+    for(uint32 i = 0; i < 4; i++) {
+      v |= static_cast<uint32>(*m_Ptr++) << (8 * i);
+    }
+    return v;
+  }
+
+  uint64 Read64() {
+    uint64 v = 0;
+    for(uint32 i = 0; i < 8; i++) {
+      v |= static_cast<uint64>(*m_Ptr++) << (8 * i);
+    }
+    return v;
+  }
+
+  double ReadDouble() {
+    const uint64 bits = Read64();
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+ private:
+  const uint8 *m_Ptr;
+};
+
+}  // namespace
+
+namespace DaemonProtocol {
+
+void WriteRequestHeader(const RequestHeader &header, uint8 *buf) {
+  ByteWriter wtr(buf);
+  wtr.Write32(header.magic);
+  wtr.Write32(header.version);
+  wtr.Write32(header.type);
+  wtr.Write32(header.format);
+  wtr.Write32(static_cast<uint32>(header.quality));
+  wtr.Write32(static_cast<uint32>(header.priority));
+  wtr.Write32(header.flags);
+  wtr.Write32(header.width);
+  wtr.Write32(header.height);
+  wtr.Write64(header.payloadSz);
+}
+
+void ReadRequestHeader(const uint8 *buf, RequestHeader *header) {
+  ByteReader rdr(buf);
+  header->magic = rdr.Read32();
+  header->version = rdr.Read32();
+  header->type = rdr.Read32();
+  header->format = rdr.Read32();
+  header->quality = static_cast<int32>(rdr.Read32());
+  header->priority = static_cast<int32>(rdr.Read32());
+  header->flags = rdr.Read32();
+  header->width = rdr.Read32();
+  header->height = rdr.Read32();
+  header->payloadSz = rdr.Read64();
+}
+
+void WriteResponseHeader(const ResponseHeader &header, uint8 *buf) {
+  ByteWriter wtr(buf);
+  wtr.Write32(header.magic);
+  wtr.Write32(header.status);
+  wtr.Write32(header.format);
+  wtr.Write32(header.width);
+  wtr.Write32(header.height);
+  wtr.WriteDouble(header.cmpTimeMS);
+  wtr.WriteDouble(header.queueTimeMS);
+  wtr.WriteDouble(header.psnr);
+  wtr.Write64(header.dataSz);
+}
+
+void ReadResponseHeader(const uint8 *buf, ResponseHeader *header) {
+  ByteReader rdr(buf);
+  header->magic = rdr.Read32();
+  header->status = rdr.Read32();
+  header->format = rdr.Read32();
+  header->width = rdr.Read32();
+  header->height = rdr.Read32();
+  header->cmpTimeMS = rdr.ReadDouble();
+  header->queueTimeMS = rdr.ReadDouble();
+  header->psnr = rdr.ReadDouble();
+  header->dataSz = rdr.Read64();
+}
+
+void DisableSigPipe(int fd) {
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#else
+  (void)fd;
+#endif
+}
+
+bool SendAll(int fd, const void *data, uint64 sz) {
+  // A peer that hangs up shouldn't kill the process with SIGPIPE.
+#ifdef MSG_NOSIGNAL
+  const int flags = MSG_NOSIGNAL;
+#else
+  const int flags = 0;
+#endif
+
+  const uint8 *ptr = static_cast<const uint8 *>(data);
+  while(sz > 0) {
+    const ssize_t n = send(fd, ptr, static_cast<size_t>(sz), flags);
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if(n <= 0) {
+      return false;
+    }
+
+    ptr += n;
+    sz -= static_cast<uint64>(n);
+  }
+  return true;
+}
+
+bool RecvAll(int fd, void *data, uint64 sz) {
+  uint8 *ptr = static_cast<uint8 *>(data);
+  while(sz > 0) {
+    const ssize_t n = recv(fd, ptr, static_cast<size_t>(sz), 0);
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if(n <= 0) {
+      return false;
+    }
+
+    ptr += n;
+    sz -= static_cast<uint64>(n);
+  }
+  return true;
+}
+
+}  // namespace DaemonProtocol
@@ -0,0 +1,94 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef DAEMON_SRC_DAEMONPROTOCOL_H_
+#define DAEMON_SRC_DAEMONPROTOCOL_H_
+
+#include "FasTC/TexCompTypes.h"
+
+// The messages that DaemonClient and DaemonServer exchange. A client
+// connects, sends one request and reads one response, after which the
+// connection is closed. Every field is stored little endian.
+//
+// Request:  RequestHeader, then payloadSz bytes of either tightly packed
+//           RGBA8 pixels or a file path without a terminating zero.
+// Response: ResponseHeader, then dataSz bytes of either compressed blocks or,
+//           if the status isn't OK, an error message.
+namespace DaemonProtocol {
+
+  static const uint32 kRequestMagic = 0x51444346;  // "FCDQ"
+  static const uint32 kResponseMagic = 0x52444346;  // "FCDR"
+  static const uint32 kVersion = 1;
+
+  enum EJobType {
+    eJobType_Pixels,
+    eJobType_File
+  };
+
+  static const uint32 kFlag_ComputeMetrics = 0x1;
+
+  // The longest file path that a request may contain.
+  static const uint32 kMaxPathLength = 4096;
+
+  struct RequestHeader {
+    uint32 magic;
+    uint32 version;
+    uint32 type;
+    uint32 format;
+    int32 quality;
+    int32 priority;
+    uint32 flags;
+    uint32 width;
+    uint32 height;
+    uint64 payloadSz;
+  };
+
+  static const uint32 kRequestHeaderSz = 9 * 4 + 8;
+
+  struct ResponseHeader {
+    uint32 magic;
+    uint32 status;
+    uint32 format;
+    uint32 width;
+    uint32 height;
+    double cmpTimeMS;
+    double queueTimeMS;
+    double psnr;
+    uint64 dataSz;
+  };
+
+  static const uint32 kResponseHeaderSz = 5 * 4 + 4 * 8;
+
+  void WriteRequestHeader(const RequestHeader &header, uint8 *buf);
+  void ReadRequestHeader(const uint8 *buf, RequestHeader *header);
+
+  void WriteResponseHeader(const ResponseHeader &header, uint8 *buf);
+  void ReadResponseHeader(const uint8 *buf, ResponseHeader *header);
+
+  // Keeps writes to a socket whose peer has hung up from raising SIGPIPE
+  // on platforms that don't support MSG_NOSIGNAL.
+  void DisableSigPipe(int fd);
+
+  // Sends or receives exactly sz bytes over the socket, retrying after
+  // interruptions and short transfers. Returns false if the connection
+  // failed or was closed first.
+  bool SendAll(int fd, const void *data, uint64 sz);
+  bool RecvAll(int fd, void *data, uint64 sz);
+
+}  // namespace DaemonProtocol
+
+#endif  // DAEMON_SRC_DAEMONPROTOCOL_H_
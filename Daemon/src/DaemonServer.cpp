@@ -0,0 +1,768 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/DaemonServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "FasTC/CompressedImage.h"
+#include "FasTC/DaemonClient.h"
+#include "FasTC/Image.h"
+#include "FasTC/ImageFile.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/StopWatch.h"
+#include "FasTC/TexComp.h"
+#include "FasTC/Thread.h"
+#include "FasTC/Trace.h"
+
+#include "DaemonProtocol.h"
+
+using DaemonProtocol::RequestHeader;
+using DaemonProtocol::ResponseHeader;
+
+namespace FasTC {
+
+// A client that stops reading its response for this long is dropped, so
+// that it can't hold up a worker.
+static const int kSocketTimeoutSeconds = 30;
+
+// The most connections whose requests are read at once. Clients beyond
+// these are turned away as busy, so that they can't run the daemon out of
+// file descriptors.
+static const uint32 kMaxPendingRequests = 256;
+
+// The time on a clock that only moves forward, in milliseconds.
+static uint64 GetTimeMS() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// The formats that CompressImage can encode. The others can only be
+// decoded.
+static bool IsCompressible(uint32 format) {
+  switch(format) {
+    case eCompressionFormat_DXT1:
+    case eCompressionFormat_DXT5:
+    case eCompressionFormat_ETC1:
+    case eCompressionFormat_BPTC:
+    case eCompressionFormat_PVRTC4:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static void SendResponse(int fd, EDaemonStatus status, const ResponseHeader &header,
+                         const void *data, uint64 dataSz) {
+  ResponseHeader response = header;
+  response.magic = DaemonProtocol::kResponseMagic;
+  response.status = status;
+  response.dataSz = dataSz;
+
+  uint8 buf[DaemonProtocol::kResponseHeaderSz];
+  DaemonProtocol::WriteResponseHeader(response, buf);
+
+  // There's nothing to do if the client went away, so failures are ignored.
+  if(DaemonProtocol::SendAll(fd, buf, sizeof(buf))) {
+    DaemonProtocol::SendAll(fd, data, dataSz);
+  }
+}
+
+static void SendError(int fd, EDaemonStatus status, const char *error) {
+  ResponseHeader response;
+  memset(&response, 0, sizeof(response));
+  SendResponse(fd, status, response, error, strlen(error));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Job queue
+//
+////////////////////////////////////////////////////////////////////////////////
+
+struct DaemonJob {
+  int fd;
+  RequestHeader request;
+
+  // Pixel jobs carry their pixels and file jobs the path to load.
+  RGBA8Image *pixels;
+  std::string path;
+
+  // Breaks ties between jobs of the same priority in order of arrival.
+  uint64 sequence;
+  StopWatch queueTime;
+
+  DaemonJob() : fd(-1), pixels(NULL), sequence(0) { }
+  ~DaemonJob() {
+    delete pixels;
+    if(fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+struct DaemonJobOrder {
+  bool operator()(const DaemonJob *a, const DaemonJob *b) const {
+    if(a->request.priority != b->request.priority) {
+      return a->request.priority < b->request.priority;
+    }
+    return a->sequence > b->sequence;
+  }
+};
+
+// Hands jobs to the workers by priority. Unlike TCBoundedQueue, a full queue
+// turns jobs away instead of blocking, since the thread that adds them is
+// also the one that accepts new connections.
+class DaemonJobQueue {
+ public:
+  enum EPushResult {
+    ePushResult_OK,
+    ePushResult_Full,
+    ePushResult_Closed
+  };
+
+  explicit DaemonJobQueue(uint32 capacity)
+    : m_Capacity(capacity), m_NextSequence(0), m_bClosed(false) { }
+
+  // Whether there is room for numReserved more jobs besides the ones
+  // already queued.
+  bool IsFull(uint32 numReserved) {
+    TCLock lock(m_Mutex);
+    return m_Jobs.size() + numReserved >= m_Capacity;
+  }
+
+  EPushResult Push(DaemonJob *job) {
+    TCLock lock(m_Mutex);
+    if(m_bClosed) {
+      return ePushResult_Closed;
+    }
+
+    if(m_Jobs.size() >= m_Capacity) {
+      return ePushResult_Full;
+    }
+
+    job->sequence = m_NextSequence++;
+    job->queueTime.Start();
+    m_Jobs.push(job);
+    m_NotEmpty.NotifyOne();
+    return ePushResult_OK;
+  }
+
+  // Blocks until there is a job to run. Returns NULL once the queue is closed
+  // and every job has been handed out.
+  DaemonJob *Pop() {
+    TCLock lock(m_Mutex);
+    while(!m_bClosed && m_Jobs.empty()) {
+      m_NotEmpty.Wait(lock);
+    }
+
+    if(m_Jobs.empty()) {
+      return NULL;
+    }
+
+    DaemonJob *job = m_Jobs.top();
+    m_Jobs.pop();
+    return job;
+  }
+
+  void Close() {
+    TCLock lock(m_Mutex);
+    m_bClosed = true;
+    m_NotEmpty.NotifyAll();
+  }
+
+ private:
+  const uint32 m_Capacity;
+  uint64 m_NextSequence;
+  bool m_bClosed;
+  std::priority_queue<DaemonJob *, std::vector<DaemonJob *>, DaemonJobOrder> m_Jobs;
+
+  TCMutex m_Mutex;
+  TCConditionVariable m_NotEmpty;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Workers
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// The PSNR of the compressed image over the pixels of the original, leaving
+// out any padding that was added to reach a multiple of the block size.
+static double ComputePSNR(const RGBA8Image &img, const CompressedImage &ci) {
+  RGBA8Image decoded;
+  if(!ci.DecompressRegion(0, 0, img.GetWidth(), img.GetHeight(), &decoded)) {
+    return 0.0;
+  }
+
+  Image<> original(img.GetWidth(), img.GetHeight(),
+                   reinterpret_cast<const uint32 *>(img.GetData()));
+  Image<> compressed(decoded.GetWidth(), decoded.GetHeight(),
+                     reinterpret_cast<const uint32 *>(decoded.GetData()));
+
+  ImageMetrics metrics;
+  if(!original.ComputeMetrics(&compressed, &metrics, false)) {
+    return 0.0;
+  }
+  return metrics.m_PSNR;
+}
+
+class DaemonWorker : public TCCallable {
+ public:
+  DaemonWorker() : TCCallable(), m_Queue(NULL), m_NumThreads(1) { }
+  void SetQueue(DaemonJobQueue *queue, uint32 numThreads) {
+    m_Queue = queue;
+    m_NumThreads = numThreads;
+  }
+
+  virtual void operator()() {
+    TCTrace::SetThreadName("Daemon Worker");
+
+    DaemonJob *job;
+    while(NULL != (job = m_Queue->Pop())) {
+      Run(*job);
+      delete job;
+    }
+  }
+
+ private:
+  DaemonJobQueue *m_Queue;
+  uint32 m_NumThreads;
+
+  void Run(DaemonJob &job) {
+    FASTC_TRACE_ZONE("Daemon Job");
+    job.queueTime.Stop();
+
+    const RGBA8Image *img = job.pixels;
+    ImageFile *file = NULL;
+    if(!img) {
+      file = new ImageFile(job.path.c_str());
+      if(!file->LoadRGBA8()) {
+        delete file;
+        SendError(job.fd, eDaemonStatus_Failed, "Unable to load image");
+        return;
+      }
+      img = file->GetRGBA8Image();
+    }
+
+    SCompressionSettings settings;
+    settings.format = static_cast<ECompressionFormat>(job.request.format);
+    settings.iQuality = job.request.quality;
+    settings.iNumThreads = m_NumThreads;
+
+    ResponseHeader response;
+    memset(&response, 0, sizeof(response));
+    response.queueTimeMS = job.queueTime.TimeInMilliseconds();
+
+    CompressedImage *ci = CompressImage(img, settings, &response.cmpTimeMS);
+    if(NULL == ci) {
+      SendError(job.fd, eDaemonStatus_Failed, "Unable to compress image");
+      delete file;
+      return;
+    }
+
+    if(job.request.flags & DaemonProtocol::kFlag_ComputeMetrics) {
+      response.psnr = ComputePSNR(*img, *ci);
+    }
+
+    response.format = ci->GetFormat();
+    response.width = ci->GetWidth();
+    response.height = ci->GetHeight();
+    SendResponse(job.fd, eDaemonStatus_OK, response,
+                 ci->GetCompressedData(), ci->GetCompressedSize());
+
+    delete ci;
+    delete file;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Server
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class DaemonServerImpl {
+ public:
+  explicit DaemonServerImpl(const SDaemonSettings &settings)
+    : m_Settings(settings)
+    , m_ListenFD(-1)
+    , m_Queue(settings.maxQueuedJobs)
+  {
+    m_WakeFDs[0] = m_WakeFDs[1] = -1;
+    if(m_Settings.socketPath) {
+      m_SocketPath = m_Settings.socketPath;
+    }
+  }
+
+  ~DaemonServerImpl() {
+    CloseListener();
+    for(uint32 i = 0; i < 2; i++) {
+      if(m_WakeFDs[i] >= 0) {
+        close(m_WakeFDs[i]);
+      }
+    }
+  }
+
+  bool Listen();
+  void Run();
+
+  void Stop() {
+    // Only async-signal-safe calls are allowed here.
+    if(m_WakeFDs[1] >= 0) {
+      const char c = 0;
+      ssize_t n;
+      do {
+        n = write(m_WakeFDs[1], &c, 1);
+      } while(n < 0 && errno == EINTR);
+    }
+  }
+
+ private:
+  const SDaemonSettings m_Settings;
+  std::string m_SocketPath;
+  int m_ListenFD;
+
+  // Stop writes to the pipe to wake up Run.
+  int m_WakeFDs[2];
+
+  DaemonJobQueue m_Queue;
+
+  // A connection whose request is still arriving. Its socket doesn't block,
+  // and Run reads whatever has arrived each time poll says there is more.
+  struct PendingRequest {
+    DaemonJob *job;
+    uint8 header[DaemonProtocol::kRequestHeaderSz];
+
+    // The bytes of the header that have been read, and then those of the
+    // payload once the header is complete.
+    uint64 bytesRead;
+    bool bHaveHeader;
+
+    // The connection is dropped if the request isn't complete by then.
+    uint64 deadlineMS;
+  };
+
+  std::vector<PendingRequest> m_Pending;
+
+  bool GetAddress(sockaddr_un *addr) const;
+  void CloseListener();
+  void Accept(int fd);
+  const char *CheckRequest(const RequestHeader &request) const;
+  bool ReadRequest(PendingRequest &pending);
+  void QueueJob(DaemonJob *job);
+  uint32 NumPayloadsPending() const;
+};
+
+bool DaemonServerImpl::GetAddress(sockaddr_un *addr) const {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if(m_SocketPath.empty() || m_SocketPath.size() >= sizeof(addr->sun_path)) {
+    fprintf(stderr, "fastcd - invalid socket path: %s\n", m_SocketPath.c_str());
+    return false;
+  }
+  memcpy(addr->sun_path, m_SocketPath.c_str(), m_SocketPath.size());
+  return true;
+}
+
+bool DaemonServerImpl::Listen() {
+  sockaddr_un addr;
+  if(!GetAddress(&addr)) {
+    return false;
+  }
+
+  // A socket file that nobody accepts connections on was left behind by a
+  // daemon that didn't shut down cleanly and can be replaced.
+  struct stat st;
+  if(lstat(m_SocketPath.c_str(), &st) == 0) {
+    if(!S_ISSOCK(st.st_mode)) {
+      fprintf(stderr, "fastcd - %s exists and is not a socket\n", m_SocketPath.c_str());
+      return false;
+    }
+
+    const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    const bool bInUse = probe >= 0 &&
+      connect(probe, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    if(probe >= 0) {
+      close(probe);
+    }
+
+    if(bInUse) {
+      fprintf(stderr, "fastcd - another daemon is listening on %s\n", m_SocketPath.c_str());
+      return false;
+    }
+    unlink(m_SocketPath.c_str());
+  }
+
+  m_ListenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(m_ListenFD < 0) {
+    fprintf(stderr, "fastcd - unable to create socket: %s\n", strerror(errno));
+    return false;
+  }
+
+  if(bind(m_ListenFD, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+     listen(m_ListenFD, SOMAXCONN) != 0) {
+    fprintf(stderr, "fastcd - unable to listen on %s: %s\n",
+            m_SocketPath.c_str(), strerror(errno));
+    close(m_ListenFD);
+    m_ListenFD = -1;
+    return false;
+  }
+
+  if(pipe(m_WakeFDs) != 0) {
+    fprintf(stderr, "fastcd - unable to create pipe: %s\n", strerror(errno));
+    m_WakeFDs[0] = m_WakeFDs[1] = -1;
+    CloseListener();
+    return false;
+  }
+
+  return true;
+}
+
+void DaemonServerImpl::CloseListener() {
+  if(m_ListenFD >= 0) {
+    close(m_ListenFD);
+    m_ListenFD = -1;
+    unlink(m_SocketPath.c_str());
+  }
+}
+
+void DaemonServerImpl::Run() {
+  if(m_ListenFD < 0) {
+    return;
+  }
+
+  TCTrace::SetThreadName("Daemon Listener");
+
+  uint32 numWorkers = m_Settings.numWorkers;
+  if(0 == numWorkers) {
+    numWorkers = TCThread::NumHardwareThreads();
+  }
+
+  std::vector<DaemonWorker> workers(numWorkers);
+  std::vector<TCThread> threads;
+  threads.reserve(numWorkers);
+  for(uint32 i = 0; i < numWorkers; i++) {
+    workers[i].SetQueue(&m_Queue, std::max<uint32>(1, m_Settings.numThreadsPerJob));
+    threads.push_back(TCThread(workers[i]));
+  }
+
+  std::vector<pollfd> fds;
+  for(;;) {
+    // The listener and the pipe come first, followed by the connections
+    // whose requests are still arriving.
+    fds.resize(2 + m_Pending.size());
+    fds[0].fd = m_ListenFD;
+    fds[1].fd = m_WakeFDs[0];
+    for(size_t i = 0; i < m_Pending.size(); i++) {
+      fds[2 + i].fd = m_Pending[i].job->fd;
+    }
+
+    // Wake up in time to drop the first client that runs out of time.
+    const uint64 now = GetTimeMS();
+    int timeoutMS = -1;
+    for(size_t i = 0; i < m_Pending.size(); i++) {
+      const uint64 left = m_Pending[i].deadlineMS > now? m_Pending[i].deadlineMS - now : 0;
+      if(timeoutMS < 0 || left < static_cast<uint64>(timeoutMS)) {
+        timeoutMS = static_cast<int>(left);
+      }
+    }
+
+    for(size_t i = 0; i < fds.size(); i++) {
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+
+    if(poll(&fds[0], fds.size(), timeoutMS) < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "fastcd - poll failed: %s\n", strerror(errno));
+      break;
+    }
+
+    if(fds[1].revents) {
+      break;
+    }
+
+    // Read what has arrived on each connection, and drop the ones that are
+    // done or have run out of time. New connections are added at the end,
+    // so they aren't in fds yet.
+    const uint64 readTime = GetTimeMS();
+    size_t numKept = 0;
+    for(size_t i = 0; i < m_Pending.size(); i++) {
+      PendingRequest &pending = m_Pending[i];
+
+      bool bKeep = true;
+      if(fds[2 + i].revents) {
+        bKeep = ReadRequest(pending);
+      }
+
+      if(bKeep && readTime >= pending.deadlineMS) {
+        delete pending.job;
+        bKeep = false;
+      }
+
+      if(bKeep) {
+        m_Pending[numKept++] = pending;
+      }
+    }
+    m_Pending.resize(numKept);
+
+    if(fds[0].revents & POLLIN) {
+      const int fd = accept(m_ListenFD, NULL, NULL);
+      if(fd >= 0) {
+        Accept(fd);
+      }
+    }
+  }
+
+  // New clients are refused from here on, while the workers finish the jobs
+  // that are already queued.
+  for(size_t i = 0; i < m_Pending.size(); i++) {
+    SendError(m_Pending[i].job->fd, eDaemonStatus_ShuttingDown, "The daemon is shutting down");
+    delete m_Pending[i].job;
+  }
+  m_Pending.clear();
+
+  CloseListener();
+  m_Queue.Close();
+  for(size_t i = 0; i < threads.size(); i++) {
+    threads[i].Join();
+  }
+}
+
+// Starts reading the request of a new connection. The reads never block, so
+// that a slow client can't hold up the others or keep Run from stopping.
+void DaemonServerImpl::Accept(int fd) {
+  FASTC_TRACE_ZONE("Daemon Accept");
+  DaemonProtocol::DisableSigPipe(fd);
+
+  DaemonJob *job = new DaemonJob;
+  job->fd = fd;
+
+  const int flags = fcntl(fd, F_GETFL, 0);
+  if(flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+    delete job;
+    return;
+  }
+
+  if(m_Pending.size() >= kMaxPendingRequests) {
+    SendError(fd, eDaemonStatus_Busy, "Too many clients are connected");
+    delete job;
+    return;
+  }
+
+  PendingRequest pending;
+  pending.job = job;
+  pending.bytesRead = 0;
+  pending.bHaveHeader = false;
+  pending.deadlineMS = GetTimeMS() +
+    static_cast<uint64>(m_Settings.requestTimeoutSeconds) * 1000;
+  m_Pending.push_back(pending);
+}
+
+// Returns the reason that the request can't be run, or NULL if it can.
+const char *DaemonServerImpl::CheckRequest(const RequestHeader &request) const {
+  if(request.magic != DaemonProtocol::kRequestMagic ||
+     request.version != DaemonProtocol::kVersion) {
+    return "Unsupported protocol";
+  }
+
+  if(request.format >= kNumCompressionFormats) {
+    return "Unknown compression format";
+  }
+
+  if(!IsCompressible(request.format)) {
+    return "Images can't be compressed to this format";
+  }
+
+  if(request.payloadSz > m_Settings.maxRequestBytes) {
+    return "Request is too large";
+  }
+
+  if(request.type == DaemonProtocol::eJobType_Pixels) {
+    const uint64 imageSz = static_cast<uint64>(request.width) * request.height * 4;
+    if(0 == imageSz || request.payloadSz != imageSz) {
+      return "Pixel data doesn't match the image size";
+    }
+  } else if(request.type == DaemonProtocol::eJobType_File) {
+    if(!m_Settings.bAllowFiles) {
+      return "Loading files is disabled";
+    }
+
+    if(0 == request.payloadSz || request.payloadSz > DaemonProtocol::kMaxPathLength) {
+      return "Invalid file path";
+    }
+  } else {
+    return "Unknown job type";
+  }
+
+  return NULL;
+}
+
+// The number of requests whose payloads are being read. Each of these has
+// the memory for its payload and will take a spot in the queue.
+uint32 DaemonServerImpl::NumPayloadsPending() const {
+  uint32 n = 0;
+  for(size_t i = 0; i < m_Pending.size(); i++) {
+    if(m_Pending[i].bHaveHeader) {
+      n++;
+    }
+  }
+  return n;
+}
+
+// Reads whatever part of the request has arrived. Returns false once the
+// connection is no longer pending, because its job was queued or because it
+// was turned away or closed.
+bool DaemonServerImpl::ReadRequest(PendingRequest &pending) {
+  DaemonJob *job = pending.job;
+  RequestHeader &request = job->request;
+
+  uint8 *dst;
+  uint64 sz;
+  if(!pending.bHaveHeader) {
+    dst = pending.header;
+    sz = sizeof(pending.header);
+  } else if(request.type == DaemonProtocol::eJobType_Pixels) {
+    dst = job->pixels->GetData();
+    sz = request.payloadSz;
+  } else {
+    dst = reinterpret_cast<uint8 *>(&job->path[0]);
+    sz = request.payloadSz;
+  }
+
+  const ssize_t n = recv(job->fd, dst + pending.bytesRead,
+                         static_cast<size_t>(sz - pending.bytesRead), 0);
+  if(n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return true;
+  }
+
+  if(n <= 0) {
+    delete job;
+    return false;
+  }
+
+  pending.bytesRead += static_cast<uint64>(n);
+  if(pending.bytesRead < sz) {
+    return true;
+  }
+
+  if(pending.bHaveHeader) {
+    QueueJob(job);
+    return false;
+  }
+
+  DaemonProtocol::ReadRequestHeader(pending.header, &request);
+
+  const char *error = CheckRequest(request);
+  if(error) {
+    SendError(job->fd, eDaemonStatus_BadRequest, error);
+    delete job;
+    return false;
+  }
+
+  // Don't bother reading the payload of a job that can't be queued.
+  if(m_Queue.IsFull(NumPayloadsPending())) {
+    SendError(job->fd, eDaemonStatus_Busy, "Too many jobs are queued");
+    delete job;
+    return false;
+  }
+
+  if(request.type == DaemonProtocol::eJobType_Pixels) {
+    job->pixels = new RGBA8Image(request.width, request.height);
+  } else {
+    job->path.resize(static_cast<size_t>(request.payloadSz));
+  }
+
+  pending.bHaveHeader = true;
+  pending.bytesRead = 0;
+  return true;
+}
+
+// Hands a job whose request has arrived in full to the workers.
+void DaemonServerImpl::QueueJob(DaemonJob *job) {
+  const int fd = job->fd;
+
+  // The workers write the response with blocking sends, and give up on
+  // clients that stop reading it.
+  const int flags = fcntl(fd, F_GETFL, 0);
+  if(flags >= 0) {
+    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+  }
+
+  timeval timeout;
+  timeout.tv_sec = kSocketTimeoutSeconds;
+  timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  switch(m_Queue.Push(job)) {
+    case DaemonJobQueue::ePushResult_OK:
+      break;
+
+    case DaemonJobQueue::ePushResult_Full:
+      SendError(fd, eDaemonStatus_Busy, "Too many jobs are queued");
+      delete job;
+      break;
+
+    case DaemonJobQueue::ePushResult_Closed:
+      SendError(fd, eDaemonStatus_ShuttingDown, "The daemon is shutting down");
+      delete job;
+      break;
+  }
+}
+
+DaemonServer::DaemonServer(const SDaemonSettings &settings)
+  : m_Impl(new DaemonServerImpl(settings))
+{ }
+
+DaemonServer::~DaemonServer() {
+  delete m_Impl;
+}
+
+bool DaemonServer::Listen() {
+  return m_Impl->Listen();
+}
+
+void DaemonServer::Run() {
+  m_Impl->Run();
+}
+
+void DaemonServer::Stop() {
+  m_Impl->Stop();
+}
+
+}  // namespace FasTC
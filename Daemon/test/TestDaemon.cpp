@@ -0,0 +1,368 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "gtest/gtest.h"
+#include "FasTC/DaemonClient.h"
+#include "FasTC/DaemonServer.h"
+
+#include "FasTC/CompressedImage.h"
+#include "FasTC/Image.h"
+#include "FasTC/ImageFile.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/StopWatch.h"
+#include "FasTC/TexComp.h"
+#include "FasTC/Thread.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char *kSocketPath = "TestDaemon.sock";
+
+static FasTC::RGBA8Image MakeImage(uint32 w, uint32 h) {
+  FasTC::RGBA8Image img(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      uint8 *p = img(i, j);
+      p[0] = static_cast<uint8>(i * 4);
+      p[1] = static_cast<uint8>(j * 4);
+      p[2] = static_cast<uint8>((i * j) & 0xFF);
+      p[3] = 255;
+    }
+  }
+  return img;
+}
+
+// The blocks that compressing img in this process produces.
+static std::vector<uint8> CompressLocally(const FasTC::RGBA8Image &img,
+                                          FasTC::ECompressionFormat format) {
+  SCompressionSettings settings;
+  settings.format = format;
+  CompressedImage *ci = CompressImage(&img, settings);
+  std::vector<uint8> data;
+  if(ci) {
+    data.assign(ci->GetCompressedData(), ci->GetCompressedData() + ci->GetCompressedSize());
+    delete ci;
+  }
+  return data;
+}
+
+static bool FileExists(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0;
+}
+
+class ServerThread : public TCCallable {
+ public:
+  explicit ServerThread(FasTC::DaemonServer &server) : m_Server(server) { }
+  virtual void operator()() { m_Server.Run(); }
+
+ private:
+  FasTC::DaemonServer &m_Server;
+};
+
+// Runs a daemon on a separate thread for as long as it is in scope.
+class ScopedDaemon {
+ public:
+  explicit ScopedDaemon(const FasTC::SDaemonSettings &settings)
+    : m_Server(settings), m_Body(m_Server), m_Thread(NULL) {
+    m_bListening = m_Server.Listen();
+    if(m_bListening) {
+      m_Thread = new TCThread(m_Body);
+    }
+  }
+
+  ~ScopedDaemon() {
+    if(m_Thread) {
+      m_Server.Stop();
+      m_Thread->Join();
+      delete m_Thread;
+    }
+  }
+
+  bool IsListening() const { return m_bListening; }
+
+ private:
+  FasTC::DaemonServer m_Server;
+  ServerThread m_Body;
+  TCThread *m_Thread;
+  bool m_bListening;
+};
+
+static FasTC::SDaemonSettings DefaultSettings() {
+  FasTC::SDaemonSettings settings;
+  settings.socketPath = kSocketPath;
+  settings.numWorkers = 2;
+  return settings;
+}
+
+TEST(Daemon, CompressesPixels) {
+  ScopedDaemon daemon(DefaultSettings());
+  ASSERT_TRUE(daemon.IsListening());
+
+  const FasTC::RGBA8Image img = MakeImage(64, 48);
+  FasTC::SDaemonJob job;
+  job.format = FasTC::eCompressionFormat_DXT1;
+  job.bComputeMetrics = true;
+
+  FasTC::DaemonClient client(kSocketPath);
+  FasTC::SDaemonResult result;
+  ASSERT_TRUE(client.CompressPixels(img, job, &result)) << result.error;
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_OK);
+  EXPECT_EQ(result.format, FasTC::eCompressionFormat_DXT1);
+  EXPECT_EQ(result.width, 64U);
+  EXPECT_EQ(result.height, 48U);
+  EXPECT_GE(result.cmpTimeMS, 0.0);
+  EXPECT_GE(result.queueTimeMS, 0.0);
+  EXPECT_GT(result.psnr, 20.0);
+  EXPECT_EQ(result.data, CompressLocally(img, FasTC::eCompressionFormat_DXT1));
+}
+
+TEST(Daemon, PadsToBlockSize) {
+  ScopedDaemon daemon(DefaultSettings());
+  ASSERT_TRUE(daemon.IsListening());
+
+  const FasTC::RGBA8Image img = MakeImage(30, 18);
+  FasTC::SDaemonJob job;
+  job.format = FasTC::eCompressionFormat_DXT5;
+  job.bComputeMetrics = true;
+
+  FasTC::SDaemonResult result;
+  ASSERT_TRUE(FasTC::DaemonClient(kSocketPath).CompressPixels(img, job, &result));
+  EXPECT_EQ(result.width, 32U);
+  EXPECT_EQ(result.height, 20U);
+  EXPECT_EQ(result.data.size(),
+            CompressedImage::GetCompressedSize(32, 20, FasTC::eCompressionFormat_DXT5));
+  EXPECT_GT(result.psnr, 20.0);
+}
+
+TEST(Daemon, CompressesFiles) {
+  const char *kImagePath = "TestDaemon.png";
+  const FasTC::RGBA8Image img = MakeImage(32, 32);
+  {
+    FasTC::Image<> image(32, 32, reinterpret_cast<const uint32 *>(img.GetData()));
+    ImageFile file(kImagePath, eFileFormat_PNG, image);
+    ASSERT_TRUE(file.Write());
+  }
+
+  ScopedDaemon daemon(DefaultSettings());
+  ASSERT_TRUE(daemon.IsListening());
+
+  FasTC::SDaemonJob job;
+  job.format = FasTC::eCompressionFormat_ETC1;
+
+  FasTC::DaemonClient client(kSocketPath);
+  FasTC::SDaemonResult result;
+  EXPECT_TRUE(client.CompressFile(kImagePath, job, &result)) << result.error;
+  EXPECT_EQ(result.data, CompressLocally(img, FasTC::eCompressionFormat_ETC1));
+  EXPECT_EQ(result.psnr, 0.0);
+
+  EXPECT_FALSE(client.CompressFile("TestDaemonMissing.png", job, &result));
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_Failed);
+  EXPECT_FALSE(result.error.empty());
+
+  remove(kImagePath);
+}
+
+TEST(Daemon, RejectsBadRequests) {
+  FasTC::SDaemonSettings settings = DefaultSettings();
+  settings.bAllowFiles = false;
+  settings.maxRequestBytes = 64 * 64 * 4;
+  ScopedDaemon daemon(settings);
+  ASSERT_TRUE(daemon.IsListening());
+
+  FasTC::DaemonClient client(kSocketPath);
+  FasTC::SDaemonResult result;
+  FasTC::SDaemonJob job;
+
+  job.format = FasTC::kNumCompressionFormats;
+  EXPECT_FALSE(client.CompressPixels(MakeImage(8, 8), job, &result));
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_BadRequest);
+
+  // Formats that can only be decoded are turned away before they reach the
+  // compressors.
+  job.format = FasTC::eCompressionFormat_ASTC4x4;
+  EXPECT_FALSE(client.CompressPixels(MakeImage(8, 8), job, &result));
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_BadRequest);
+
+  job.format = FasTC::eCompressionFormat_PVRTC2;
+  EXPECT_FALSE(client.CompressPixels(MakeImage(8, 8), job, &result));
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_BadRequest);
+
+  job.format = FasTC::eCompressionFormat_DXT1;
+  EXPECT_FALSE(client.CompressFile("TestDaemon.png", job, &result));
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_BadRequest);
+
+  EXPECT_FALSE(client.CompressPixels(MakeImage(128, 128), job, &result));
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_BadRequest);
+
+  // The daemon keeps going after turning jobs away.
+  EXPECT_TRUE(client.CompressPixels(MakeImage(64, 64), job, &result));
+}
+
+TEST(Daemon, TurnsJobsAwayWhenFull) {
+  FasTC::SDaemonSettings settings = DefaultSettings();
+  settings.maxQueuedJobs = 0;
+  ScopedDaemon daemon(settings);
+  ASSERT_TRUE(daemon.IsListening());
+
+  FasTC::SDaemonJob job;
+  job.format = FasTC::eCompressionFormat_DXT1;
+
+  FasTC::SDaemonResult result;
+  EXPECT_FALSE(FasTC::DaemonClient(kSocketPath).CompressPixels(MakeImage(16, 16), job, &result));
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_Busy);
+}
+
+class ClientThread : public TCCallable {
+ public:
+  ClientThread() : m_Img(MakeImage(64, 64)), m_bOK(false) { }
+
+  virtual void operator()() {
+    FasTC::SDaemonJob job;
+    job.format = FasTC::eCompressionFormat_DXT1;
+
+    FasTC::DaemonClient client(kSocketPath);
+    m_bOK = true;
+    for(uint32 i = 0; i < 4; i++) {
+      FasTC::SDaemonResult result;
+      m_bOK = m_bOK && client.CompressPixels(m_Img, job, &result);
+      m_Data = result.data;
+    }
+  }
+
+  const FasTC::RGBA8Image m_Img;
+  bool m_bOK;
+  std::vector<uint8> m_Data;
+};
+
+TEST(Daemon, ServesConcurrentClients) {
+  ScopedDaemon daemon(DefaultSettings());
+  ASSERT_TRUE(daemon.IsListening());
+
+  const uint32 kNumClients = 6;
+  std::vector<ClientThread> clients(kNumClients);
+  std::vector<TCThread> threads;
+  for(uint32 i = 0; i < kNumClients; i++) {
+    threads.push_back(TCThread(clients[i]));
+  }
+
+  const std::vector<uint8> expected =
+    CompressLocally(clients[0].m_Img, FasTC::eCompressionFormat_DXT1);
+  for(uint32 i = 0; i < kNumClients; i++) {
+    threads[i].Join();
+    EXPECT_TRUE(clients[i].m_bOK);
+    EXPECT_EQ(clients[i].m_Data, expected);
+  }
+}
+
+// Connects to the daemon and sends the start of a request, leaving the
+// daemon waiting for the rest. Returns the socket, or -1 on failure.
+static int ConnectAndStall() {
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0) {
+    return -1;
+  }
+
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, kSocketPath, sizeof(addr.sun_path) - 1);
+
+  const uint8 partialHeader[4] = { 0x46, 0x43, 0x44, 0x51 };
+  if(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+     send(fd, partialHeader, sizeof(partialHeader), 0) != sizeof(partialHeader)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Whether the daemon closes or resets the connection within timeoutMS of
+// each read, after sending whatever response it likes.
+static bool IsClosedByDaemon(int fd, int timeoutMS) {
+  timeval timeout;
+  timeout.tv_sec = timeoutMS / 1000;
+  timeout.tv_usec = (timeoutMS % 1000) * 1000;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  uint8 buf[256];
+  ssize_t n;
+  while((n = recv(fd, buf, sizeof(buf), 0)) > 0) { }
+  return n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+TEST(Daemon, DoesNotWaitForSlowClients) {
+  FasTC::SDaemonSettings settings = DefaultSettings();
+  settings.requestTimeoutSeconds = 1;
+
+  int stalled = -1;
+  StopWatch elapsed;
+  elapsed.Start();
+  {
+    ScopedDaemon daemon(settings);
+    ASSERT_TRUE(daemon.IsListening());
+
+    const int fd = ConnectAndStall();
+    ASSERT_GE(fd, 0);
+
+    // Other clients are served while the first one is still sending.
+    FasTC::SDaemonJob job;
+    job.format = FasTC::eCompressionFormat_DXT1;
+    FasTC::SDaemonResult result;
+    EXPECT_TRUE(FasTC::DaemonClient(kSocketPath).CompressPixels(MakeImage(16, 16), job, &result));
+
+    // The slow client is dropped once its time is up.
+    EXPECT_TRUE(IsClosedByDaemon(fd, 5000));
+    close(fd);
+
+    // A client that is still sending doesn't keep the daemon from stopping.
+    stalled = ConnectAndStall();
+    ASSERT_GE(stalled, 0);
+  }
+  elapsed.Stop();
+  EXPECT_LT(elapsed.TimeInMilliseconds(), 5000.0);
+
+  EXPECT_TRUE(IsClosedByDaemon(stalled, 1000));
+  close(stalled);
+}
+
+TEST(Daemon, OwnsItsSocket) {
+  {
+    ScopedDaemon daemon(DefaultSettings());
+    ASSERT_TRUE(daemon.IsListening());
+    EXPECT_TRUE(FileExists(kSocketPath));
+
+    // A second daemon can't take over the socket while the first is running.
+    FasTC::DaemonServer other(DefaultSettings());
+    EXPECT_FALSE(other.Listen());
+  }
+
+  // The socket is removed on shutdown, after which clients can't connect.
+  EXPECT_FALSE(FileExists(kSocketPath));
+
+  FasTC::SDaemonResult result;
+  EXPECT_FALSE(FasTC::DaemonClient(kSocketPath).CompressPixels(
+    MakeImage(4, 4), FasTC::SDaemonJob(), &result));
+  EXPECT_EQ(result.status, FasTC::eDaemonStatus_ConnectionFailed);
+}
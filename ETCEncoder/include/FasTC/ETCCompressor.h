@@ -18,6 +18,7 @@
 #ifndef ETCENCODER_INCLUDE_ETCCOMPRESSOR_H_
 #define ETCENCODER_INCLUDE_ETCCOMPRESSOR_H_
 
+#include "FasTC/BlockStats.h"
 #include "FasTC/CompressionJob.h"
 #include "FasTC/TexCompTypes.h"
 
@@ -34,6 +35,11 @@ namespace ETCC {
   // https://code.google.com/p/rg-etc1
   void Compress_RG(const FasTC::CompressionJob &);
 
+  // The same as Compress_RG, but also adds a record with the diff bit, the
+  // flip bit and the error of each block to stats.
+  void Compress_RGWithStats(const FasTC::CompressionJob &,
+                            FasTC::BlockStatList *stats);
+
 }  // namespace PVRTCC
 
 #endif  // ETCENCODER_INCLUDE_ETCCOMPRESSOR_H_
@@ -16,6 +16,7 @@
 // <http://gamma.cs.unc.edu/FasTC/>
 
 #include "FasTC/ETCCompressor.h"
+#include "FasTC/Trace.h"
 
 #include "rg_etc1.h"
 #include <algorithm>
@@ -23,11 +24,22 @@
 
 namespace ETCC {
 
-  void Compress_RG(const FasTC::CompressionJob &cj) {
+  // The packer's lookup table never changes, so it only needs to be built
+  // once rather than for every job, which matters when jobs are only a few
+  // blocks. This also keeps threads from rebuilding it while others read it.
+  static void InitPacker() {
+    static const bool kInitialized = (rg_etc1::pack_etc1_block_init(), true);
+    (void)kInitialized;
+  }
+
+  // If stats is not NULL, a record of the diff and flip bits and the error
+  // that the packer reported is added to it for each block.
+  static void CompressETC1(const FasTC::CompressionJob &cj,
+                           FasTC::BlockStatList *stats) {
 
     rg_etc1::etc1_pack_params params;
     params.m_quality = rg_etc1::cLowQuality;
-    rg_etc1::pack_etc1_block_init();
+    InitPacker();
 
     uint32 kBlockSz = GetBlockSize(FasTC::eCompressionFormat_ETC1);
     const uint32 startBlock = cj.CoordsToBlockIdx(cj.XStart(), cj.YStart());
@@ -46,10 +58,32 @@ namespace ETCC {
         memcpy(pixels + 8, inPixels + (j+2)*cj.Width() + i, 4 * sizeof(uint32));
         memcpy(pixels + 12, inPixels + (j+3)*cj.Width() + i, 4 * sizeof(uint32));
 
-        pack_etc1_block(outBuf, pixels, params);
+        const uint32 err = pack_etc1_block(outBuf, pixels, params);
+
+        if(stats) {
+          // The diff and flip bits are the two lowest bits of the fourth
+          // byte of the block.
+          FasTC::BlockStat stat(FasTC::eCompressionFormat_ETC1,
+                                cj.CoordsToBlockIdx(i, j));
+          stat.m_Mode = (outBuf[3] >> 1) & 1;
+          stat.m_Shape = outBuf[3] & 1;
+          stat.m_Error = static_cast<float>(err);
+          stats->Add(stat);
+        }
         outBuf += kBlockSz;
       }
       startX = 0;
     }
   }
+
+  void Compress_RG(const FasTC::CompressionJob &cj) {
+    FASTC_TRACE_ZONE("ETC1 Compress");
+    CompressETC1(cj, NULL);
+  }
+
+  void Compress_RGWithStats(const FasTC::CompressionJob &cj,
+                            FasTC::BlockStatList *stats) {
+    FASTC_TRACE_ZONE("ETC1 Compress");
+    CompressETC1(cj, stats);
+  }
 }  // namespace PVRTCC
@@ -23,10 +23,61 @@
 
 #include "ImageFileFormat.h"
 
+#include <vector>
+
 // Forward declare
 class CompressedImage;
+class ImageLoader;
+class MappedFile;
+class RGBA8RowSource;
 struct SCompressionSettings;
 
+// The filter that is applied to each row of a PNG before it is deflated.
+enum EPNGFilter {
+  ePNGFilter_Default,   // Whatever libpng chooses, which is adaptive for RGBA.
+  ePNGFilter_None,
+  ePNGFilter_Sub,
+  ePNGFilter_Up,
+  ePNGFilter_Average,
+  ePNGFilter_Paeth,
+  ePNGFilter_Adaptive,  // Picks the filter with the smallest output per row.
+};
+
+// Options for writing PNG files. The defaults match what libpng does on its
+// own.
+struct SPNGSettings {
+  // The zlib compression level from 0 (no compression) to 9 (smallest
+  // output), or -1 for the zlib default.
+  int iZLibLevel;
+
+  EPNGFilter filter;
+
+  // With more than one thread, the image is split into stripes of rows that
+  // are filtered and deflated in parallel and then stitched into a single
+  // zlib stream. Each stripe is primed with the end of the previous one, so
+  // the file is only slightly larger than a serial one. Zero uses one thread
+  // per hardware thread.
+  int iNumThreads;
+
+  SPNGSettings()
+    : iZLibLevel(-1)
+    , filter(ePNGFilter_Default)
+    , iNumThreads(1)
+  { }
+};
+
+// Options for writing KTX2 files.
+struct SKTX2Settings {
+  // If this is set, which is the default, every mip level is zlib
+  // supercompressed on its own. Otherwise the levels are stored as they are,
+  // so that a runtime can upload them straight out of the file.
+  bool bZlibSupercompression;
+
+  SKTX2Settings()
+    : bZlibSupercompression(true)
+  { }
+};
+
 // Class definition
 class ImageFile {
 
@@ -43,6 +94,16 @@ public:
   // to be written to disk with the passed filename.
   ImageFile(const char *filename, EImageFileFormat format, const FasTC::Image<> &);
 
+  // Creates an imagefile holding a whole texture object, with one image for
+  // every mip level, array element and cube face, ordered by mip level, then
+  // array element, then face. numArrayElements is zero for textures that
+  // aren't arrays, and numFaces is six for cube maps. The images are not
+  // copied, so they must outlive the call to Write. Only KTX, KTX2, DDS and
+  // PVR files can hold more than one image.
+  ImageFile(const char *filename, EImageFileFormat format,
+            const FasTC::Image<> *const *images, uint32 numLevels,
+            uint32 numArrayElements, uint32 numFaces);
+
   ~ImageFile();
 
   static EImageFileFormat DetectFileFormat(const CHAR *filename);
@@ -51,12 +112,37 @@ public:
   FasTC::Image<> *GetImage() const { return m_Image; }
 
   // Loads the image into memory. If this function returns true, then a valid
-  // m_Image will be created and available.
+  // m_Image will be created and available. The file is memory mapped while
+  // it is parsed where possible, and is released once loading finishes.
+  // Compressed KTX, ASTC, DDS and PVR images are the exception: only their
+  // headers are parsed and they refer to the blocks in the mapped file
+  // without copying or decoding them, so the file stays mapped for as long
+  // as the image is loaded. Use CompressedImage::DecompressRegion to decode
+  // part of such an image on demand.
   bool Load();
 
+  // Loads the image into memory as a tightly packed RGBA8 image that can be
+  // passed straight to the compressor. If this function returns true, then
+  // GetRGBA8Image will return a valid image. Compressed files are decoded.
+  bool LoadRGBA8();
+  const FasTC::RGBA8Image *GetRGBA8Image() const { return m_RGBA8Image; }
+
+  // Opens the file so that CompressImageStreaming can read it a band of rows
+  // at a time. PNG files are decoded incrementally as the rows are requested,
+  // and every other format is decoded in full when the source is opened. The
+  // caller owns the returned source, which keeps the file open until it is
+  // deleted. Returns NULL on failure.
+  RGBA8RowSource *OpenRowSource() const;
+
   // Writes the given image to disk. Returns true on success.
   bool Write();
 
+  // Sets the options used when Write produces a PNG file.
+  void SetPNGSettings(const SPNGSettings &settings) { m_PNGSettings = settings; }
+
+  // Sets the options used when Write produces a KTX2 file.
+  void SetKTX2Settings(const SKTX2Settings &settings) { m_KTX2Settings = settings; }
+
  private:
 
   static const unsigned int kMaxFilenameSz = 256;
@@ -66,14 +152,25 @@ public:
 
   const EImageFileFormat m_FileFormat;
 
-  uint8 *m_FileData;
-  int32 m_FileDataSz;
-
   FasTC::Image<> *m_Image;
+  FasTC::RGBA8Image *m_RGBA8Image;
+
+  // The file that m_Image refers to, if it doesn't hold its own copy.
+  MappedFile *m_File;
+
+  // The texture object to write, if one was given instead of m_Image.
+  std::vector<const FasTC::Image<> *> m_TextureImages;
+  uint32 m_NumLevels;
+  uint32 m_NumArrayElements;
+  uint32 m_NumFaces;
+
+  SPNGSettings m_PNGSettings;
+  SKTX2Settings m_KTX2Settings;
   
-  bool ReadFileData(const CHAR *filename);
-  static bool WriteImageDataToFile(const uint8 *data, const uint32 dataSz, const CHAR *filename);
+  static bool WriteImageDataToFile(const uint8 *data, const uint64 dataSz, const CHAR *filename);
 
-  FasTC::Image<> *LoadImage() const;
+  ImageLoader *CreateLoader(const MappedFile &file) const;
+  FasTC::Image<> *LoadImage(const MappedFile &file, bool &bWrapsFile) const;
+  FasTC::RGBA8Image *LoadRGBA8Image(const MappedFile &file) const;
 };
 #endif // _IMAGE_FILE_H_ 
@@ -24,6 +24,8 @@ enum EImageFileFormat {
   eFileFormat_TGA,
   eFileFormat_KTX,
   eFileFormat_ASTC,
+  eFileFormat_KTX2,
+  eFileFormat_DDS,
 
   kNumImageFileFormats
 };
@@ -0,0 +1,68 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include "FasTC/TexCompTypes.h"
+
+#include <cstddef>
+
+// The read-only contents of a whole file. Where the platform supports it the
+// file is memory mapped, so that the bytes are paged in straight from the
+// file system cache as they're touched and never copied. Otherwise, or if
+// mapping fails, the file is read into a heap buffer instead.
+class MappedFile {
+ public:
+  enum EReadMode {
+    eReadMode_Mapped,
+    eReadMode_Buffered
+  };
+
+  explicit MappedFile(const CHAR *filename, EReadMode mode = eReadMode_Mapped);
+  ~MappedFile();
+
+  // Returns false if the file could not be opened, could not be read, or is
+  // empty.
+  bool IsValid() const { return NULL != m_Data; }
+
+  // True if the contents are memory mapped rather than buffered.
+  bool IsMapped() const { return m_bMapped; }
+
+  const uint8 *GetData() const { return m_Data; }
+  uint64 GetSize() const { return m_Size; }
+
+ private:
+  // Not copyable.
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+
+  const uint8 *m_Data;
+  uint64 m_Size;
+  bool m_bMapped;
+
+  // Holds the contents of the file when it is not mapped.
+  uint8 *m_Buffer;
+
+  bool ReadBuffered(const CHAR *filename);
+
+  // Platform specific implementation
+  bool Map(const CHAR *filename);
+  void Unmap();
+};
+
+#endif // __MAPPED_FILE_H__
@@ -0,0 +1,68 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _IO_SRC_DDS_DEFINES_H_
+#define _IO_SRC_DDS_DEFINES_H_
+
+// The parts of the DirectDraw Surface format that FasTC reads and writes.
+// Files start with the magic number, a 124 byte DDS_HEADER, and, if the
+// pixel format's FourCC is DX10, a 20 byte DDS_HEADER_DXT10.
+
+#define DDS_MAGIC                    0x20534444  // "DDS "
+#define DDS_HEADER_SIZE              124
+#define DDS_HEADER_DXT10_SIZE        20
+#define DDS_PIXELFORMAT_SIZE         32
+
+#define DDS_MAKEFOURCC(a, b, c, d) \
+  (static_cast<uint32>(a) | (static_cast<uint32>(b) << 8) | \
+   (static_cast<uint32>(c) << 16) | (static_cast<uint32>(d) << 24))
+
+#define DDS_FOURCC_DXT1              DDS_MAKEFOURCC('D', 'X', 'T', '1')
+#define DDS_FOURCC_DXT5              DDS_MAKEFOURCC('D', 'X', 'T', '5')
+#define DDS_FOURCC_DX10              DDS_MAKEFOURCC('D', 'X', '1', '0')
+
+// DDS_HEADER flags
+#define DDSD_CAPS                    0x1
+#define DDSD_HEIGHT                  0x2
+#define DDSD_WIDTH                   0x4
+#define DDSD_PITCH                   0x8
+#define DDSD_PIXELFORMAT             0x1000
+#define DDSD_MIPMAPCOUNT             0x20000
+#define DDSD_LINEARSIZE              0x80000
+
+// DDS_PIXELFORMAT flags
+#define DDPF_ALPHAPIXELS             0x1
+#define DDPF_FOURCC                  0x4
+#define DDPF_RGB                     0x40
+
+// Capabilities
+#define DDSCAPS_COMPLEX              0x8
+#define DDSCAPS_TEXTURE              0x1000
+#define DDSCAPS_MIPMAP               0x400000
+#define DDSCAPS2_CUBEMAP             0x200
+#define DDSCAPS2_CUBEMAP_ALLFACES    0xFC00
+
+// DDS_HEADER_DXT10
+#define DDS_DIMENSION_TEXTURE2D      3
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+
+#define DXGI_FORMAT_R8G8B8A8_UNORM   28
+#define DXGI_FORMAT_BC1_UNORM        71
+#define DXGI_FORMAT_BC3_UNORM        77
+#define DXGI_FORMAT_BC7_UNORM        98
+
+#endif  // _IO_SRC_DDS_DEFINES_H_
@@ -42,6 +42,7 @@
 #define GL_FLOAT                          0x1406
 #define GL_DOUBLE                         0x140A
 
+#define GL_RGB                            0x1907
 #define GL_RGBA                           0x1908
 #define GL_RGBA8                          0x8058
 
@@ -89,6 +90,16 @@
 #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// ETC definitions
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // ASTC definitions
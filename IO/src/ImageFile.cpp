@@ -28,7 +28,11 @@
 #include "FasTC/ImageLoader.h"
 #include "FasTC/CompressedImage.h"
 #include "FasTC/Image.h"
+#include "FasTC/RGBAImage.h"
 #include "FasTC/FileStream.h"
+#include "FasTC/MappedFile.h"
+#include "FasTC/TexComp.h"
+#include "FasTC/Trace.h"
 
 #ifdef PNG_FOUND
 #  include "ImageLoaderPNG.h"
@@ -41,10 +45,22 @@
 
 #include "ImageLoaderTGA.h"
 #include "ImageLoaderASTC.h"
+#include "ImageWriterASTC.h"
+
+#include "ImageLoaderPVR3.h"
+#include "ImageWriterPVR3.h"
 
 #include "ImageLoaderKTX.h"
 #include "ImageWriterKTX.h"
 
+#include "ImageLoaderDDS.h"
+#include "ImageWriterDDS.h"
+
+#ifdef ZLIB_FOUND
+#  include "ImageLoaderKTX2.h"
+#  include "ImageWriterKTX2.h"
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // Static helper functions
@@ -60,11 +76,42 @@ static inline T abs(const T &a) {
   return a > 0? a : -a;
 }
 
+// Hands out the rows of an image file from its loader. The loader reads
+// straight out of the mapped file, so both live as long as the source.
+class ImageFileRowSource : public RGBA8RowSource {
+ public:
+  ImageFileRowSource(MappedFile *file, ImageLoader *loader)
+    : m_File(file), m_Loader(loader) { }
+
+  virtual ~ImageFileRowSource() {
+    delete m_Loader;
+    delete m_File;
+  }
+
+  virtual uint32 GetWidth() const { return m_Loader->GetWidth(); }
+  virtual uint32 GetHeight() const { return m_Loader->GetHeight(); }
+
+  virtual bool ReadRows(uint8 *rows, uint32 nRows) {
+    return m_Loader->ReadRows(rows, nRows);
+  }
+
+ private:
+  MappedFile *m_File;
+  ImageLoader *m_Loader;
+};
+
 //!HACK!
 #ifdef _MSC_VER
 #define strncpy strncpy_s
 #endif
 
+// Copies as much of the filename as fits, always leaving it terminated.
+template <size_t kSz>
+static void CopyFilename(char (&dst)[kSz], const char *src) {
+  strncpy(dst, src, kSz - 1);
+  dst[kSz - 1] = '\0';
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // ImageFile implementation
@@ -73,29 +120,53 @@ static inline T abs(const T &a) {
 
 ImageFile::ImageFile(const CHAR *filename)
   : m_FileFormat(  DetectFileFormat(filename) )
-  , m_FileData(NULL)
-  , m_FileDataSz(-1)
   , m_Image(NULL)
+  , m_RGBA8Image(NULL)
+  , m_File(NULL)
+  , m_NumLevels(1)
+  , m_NumArrayElements(0)
+  , m_NumFaces(1)
 { 
-  strncpy(m_Filename, filename, kMaxFilenameSz);
+  CopyFilename(m_Filename, filename);
 }
 
 ImageFile::ImageFile(const CHAR *filename, EImageFileFormat format)
   : m_FileFormat(format)
-  , m_FileData(NULL)
-  , m_FileDataSz(-1)
   , m_Image(NULL)
+  , m_RGBA8Image(NULL)
+  , m_File(NULL)
+  , m_NumLevels(1)
+  , m_NumArrayElements(0)
+  , m_NumFaces(1)
 { 
-  strncpy(m_Filename, filename, kMaxFilenameSz);
+  CopyFilename(m_Filename, filename);
 }
 
 ImageFile::ImageFile(const char *filename, EImageFileFormat format, const FasTC::Image<> &image)
   : m_FileFormat(format)
-  , m_FileData(NULL)
-  , m_FileDataSz(-1)
   , m_Image(image.Clone())
+  , m_RGBA8Image(NULL)
+  , m_File(NULL)
+  , m_NumLevels(1)
+  , m_NumArrayElements(0)
+  , m_NumFaces(1)
 {
-  strncpy(m_Filename, filename, kMaxFilenameSz);
+  CopyFilename(m_Filename, filename);
+}
+
+ImageFile::ImageFile(const char *filename, EImageFileFormat format,
+                     const FasTC::Image<> *const *images, uint32 numLevels,
+                     uint32 numArrayElements, uint32 numFaces)
+  : m_FileFormat(format)
+  , m_Image(NULL)
+  , m_RGBA8Image(NULL)
+  , m_File(NULL)
+  , m_TextureImages(images, images + numLevels * std::max<uint32>(1, numArrayElements) * numFaces)
+  , m_NumLevels(numLevels)
+  , m_NumArrayElements(numArrayElements)
+  , m_NumFaces(numFaces)
+{
+  CopyFilename(m_Filename, filename);
 }
 
 ImageFile::~ImageFile() { 
@@ -104,46 +175,149 @@ ImageFile::~ImageFile() {
     m_Image = NULL;
   }
 
-  if(m_FileData) {
-    delete [] m_FileData;
-    m_FileData = NULL;
+  if(m_RGBA8Image) {
+    delete m_RGBA8Image;
+    m_RGBA8Image = NULL;
+  }
+
+  // Only after the image that might refer to it is gone.
+  if(m_File) {
+    delete m_File;
+    m_File = NULL;
   }
 }
 
 bool ImageFile::Load() {
+  FASTC_TRACE_ZONE("Load Image");
 
   if(m_Image) {
     delete m_Image;
     m_Image = NULL;
   }
-  
-  if(m_FileData) {
-    delete [] m_FileData;
-    m_FileData = NULL;
+
+  if(m_File) {
+    delete m_File;
+    m_File = NULL;
   }
 
-  if(ReadFileData(m_Filename)) {
-    m_Image = LoadImage();
+  MappedFile *file = new MappedFile(m_Filename);
+  if(file->IsValid()) {
+    bool bWrapsFile = false;
+    m_Image = LoadImage(*file, bWrapsFile);
+
+    // Keep the file around if the image points straight into it.
+    if(m_Image && bWrapsFile) {
+      m_File = file;
+      file = NULL;
+    }
   }
 
+  delete file;
   return m_Image != NULL;
 }
 
+bool ImageFile::LoadRGBA8() {
+  FASTC_TRACE_ZONE("Load Image");
+
+  if(m_RGBA8Image) {
+    delete m_RGBA8Image;
+    m_RGBA8Image = NULL;
+  }
+
+  MappedFile file(m_Filename);
+  if(file.IsValid()) {
+    m_RGBA8Image = LoadRGBA8Image(file);
+  }
+
+  return m_RGBA8Image != NULL;
+}
+
+RGBA8RowSource *ImageFile::OpenRowSource() const {
+
+  MappedFile *file = new MappedFile(m_Filename);
+  if(!file->IsValid()) {
+    delete file;
+    return NULL;
+  }
+
+  ImageLoader *loader = CreateLoader(*file);
+  if(!loader) {
+    delete file;
+    return NULL;
+  }
+
+  if(!loader->BeginReadingRows()) {
+    fprintf(stderr, "Unable to load image!\n");
+    delete loader;
+    delete file;
+    return NULL;
+  }
+
+  return new ImageFileRowSource(file, loader);
+}
+
 bool ImageFile::Write() {
+  FASTC_TRACE_ZONE("Write Image");
+
+  if(!m_TextureImages.empty() && m_FileFormat != eFileFormat_KTX &&
+     m_FileFormat != eFileFormat_KTX2 && m_FileFormat != eFileFormat_DDS &&
+     m_FileFormat != eFileFormat_PVR) {
+    fprintf(stderr, "Unable to write image: only KTX, DDS and PVR files can hold texture objects.\n");
+    return false;
+  }
 
   ImageWriter *writer = NULL;
   switch(m_FileFormat) {
 
 #ifdef PNG_FOUND
     case eFileFormat_PNG:
-      writer = new ImageWriterPNG(*m_Image);
+      writer = new ImageWriterPNG(*m_Image, m_PNGSettings);
       break;
 #endif // PNG_FOUND
 
     case eFileFormat_KTX:
-      writer = new ImageWriterKTX(*m_Image);
+      if(m_TextureImages.empty()) {
+        writer = new ImageWriterKTX(*m_Image);
+      } else {
+        writer = new ImageWriterKTX(&m_TextureImages[0], m_NumLevels,
+                                    m_NumArrayElements, m_NumFaces);
+      }
       break;
 
+    case eFileFormat_PVR:
+      if(m_TextureImages.empty()) {
+        writer = new ImageWriterPVR3(*m_Image);
+      } else {
+        writer = new ImageWriterPVR3(&m_TextureImages[0], m_NumLevels,
+                                     m_NumArrayElements, m_NumFaces);
+      }
+      break;
+
+    case eFileFormat_ASTC:
+      writer = new ImageWriterASTC(*m_Image);
+      break;
+
+    case eFileFormat_DDS:
+      if(m_TextureImages.empty()) {
+        writer = new ImageWriterDDS(*m_Image);
+      } else {
+        writer = new ImageWriterDDS(&m_TextureImages[0], m_NumLevels,
+                                    m_NumArrayElements, m_NumFaces);
+      }
+      break;
+
+#ifdef ZLIB_FOUND
+    case eFileFormat_KTX2:
+      if(m_TextureImages.empty()) {
+        writer = new ImageWriterKTX2(*m_Image, m_KTX2Settings);
+      } else {
+        writer = new ImageWriterKTX2(&m_TextureImages[0], m_NumLevels,
+                                     m_NumArrayElements, m_NumFaces,
+                                     m_KTX2Settings);
+      }
+      break;
+#endif // ZLIB_FOUND
+
   default:
     fprintf(stderr, "Unable to write image: unknown file format.\n");
     return false;
@@ -152,44 +326,82 @@ bool ImageFile::Write() {
   if(NULL == writer)
     return false;
 
-  if(!writer->WriteImage()) {
+  bool bEncoded;
+  {
+    FASTC_TRACE_ZONE("Encode Image");
+    bEncoded = writer->WriteImage();
+  }
+
+  if(!bEncoded) {
     delete writer;
     return false;
   }
 
-  WriteImageDataToFile(writer->GetRawFileData(), uint32(writer->GetRawFileDataSz()), m_Filename);
+  bool bWritten;
+  {
+    FASTC_TRACE_ZONE("Write File");
+    bWritten =
+      WriteImageDataToFile(writer->GetRawFileData(), writer->GetRawFileDataSz(), m_Filename);
+  }
 
   delete writer;
-  return true;
+  return bWritten;
 }
 
-FasTC::Image<> *ImageFile::LoadImage() const {
+ImageLoader *ImageFile::CreateLoader(const MappedFile &file) const {
+
+  // The loaders only deal in 32-bit sizes.
+  if(file.GetSize() > uint64(INT_MAX)) {
+    fprintf(stderr, "Unable to load image: file is too large.\n");
+    return NULL;
+  }
+
+  const uint8 *data = file.GetData();
+  const int32 dataSz = static_cast<int32>(file.GetSize());
 
   ImageLoader *loader = NULL;
   switch(m_FileFormat) {
 
 #ifdef PNG_FOUND
     case eFileFormat_PNG:
-      loader = new ImageLoaderPNG(m_FileData);
+      loader = new ImageLoaderPNG(data);
       break;
 #endif // PNG_FOUND
 
-#ifdef PVRTEXLIB_FOUND
     case eFileFormat_PVR:
-      loader = new ImageLoaderPVR(m_FileData);
+      // Older versions of the format need PVRTexLib.
+      if(ImageLoaderPVR3::IsPVR3(data, dataSz)) {
+        loader = new ImageLoaderPVR3(data, dataSz);
+        break;
+      }
+#ifdef PVRTEXLIB_FOUND
+      loader = new ImageLoaderPVR(data);
       break;
+#else
+      fprintf(stderr, "Unable to load image: only version 3 PVR files are supported.\n");
+      return NULL;
 #endif // PVRTEXLIB_FOUND
 
     case eFileFormat_TGA:
-      loader = new ImageLoaderTGA(m_FileData, m_FileDataSz);
+      loader = new ImageLoaderTGA(data, dataSz);
       break;
 
     case eFileFormat_KTX:
-      loader = new ImageLoaderKTX(m_FileData, m_FileDataSz);
+      loader = new ImageLoaderKTX(data, dataSz);
+      break;
+
+    case eFileFormat_DDS:
+      loader = new ImageLoaderDDS(data, dataSz);
       break;
 
+#ifdef ZLIB_FOUND
+    case eFileFormat_KTX2:
+      loader = new ImageLoaderKTX2(data, dataSz);
+      break;
+#endif // ZLIB_FOUND
+
     case eFileFormat_ASTC:
-      loader = new ImageLoaderASTC(m_FileData, m_FileDataSz);
+      loader = new ImageLoaderASTC(data, dataSz);
       break;
 
     default:
@@ -197,6 +409,12 @@ FasTC::Image<> *ImageFile::LoadImage() const {
       return NULL;
   }
 
+  return loader;
+}
+
+FasTC::Image<> *ImageFile::LoadImage(const MappedFile &file, bool &bWrapsFile) const {
+
+  ImageLoader *loader = CreateLoader(file);
   if(!loader)
     return NULL;
 
@@ -204,6 +422,24 @@ FasTC::Image<> *ImageFile::LoadImage() const {
   if(i == NULL) {
     fprintf(stderr, "Unable to load image!\n");
   }
+  bWrapsFile = loader->ImageWrapsRawData();
+
+  // Cleanup
+  delete loader;
+
+  return i;
+}
+
+FasTC::RGBA8Image *ImageFile::LoadRGBA8Image(const MappedFile &file) const {
+
+  ImageLoader *loader = CreateLoader(file);
+  if(!loader)
+    return NULL;
+
+  FasTC::RGBA8Image *i = loader->LoadRGBA8Image();
+  if(i == NULL) {
+    fprintf(stderr, "Unable to load image!\n");
+  }
 
   // Cleanup
   delete loader;
@@ -248,49 +484,18 @@ EImageFileFormat ImageFile::DetectFileFormat(const CHAR *filename) {
   else if(strcmp(ext, ".astc") == 0) {
     return eFileFormat_ASTC;
   }
-
-  return kNumImageFileFormats;
-}
-
-bool ImageFile::ReadFileData(const CHAR *filename) {
-  FileStream fstr (filename, eFileMode_ReadBinary);
-  if(fstr.Tell() < 0) {
-    fprintf(stderr, "Error opening file for reading: %s\n", filename);
-    return 0;
-  }
-
-  // Figure out the filesize.
-  fstr.Seek(0, FileStream::eSeekPosition_End);
-  uint32 fileSize = fstr.Tell();
-
-  // Allocate data for file contents
-  m_FileData = new unsigned char[fileSize];
-
-  // Return stream to beginning of file
-  fstr.Seek(0, FileStream::eSeekPosition_Beginning);
-  assert(fstr.Tell() == 0);
-
-  // Read all of the data
-  uint64 totalBytesRead = 0;
-  uint64 totalBytesLeft = fileSize;
-  int32 bytesRead;
-  while((bytesRead = fstr.Read(m_FileData, uint32(fileSize))) > 0) {
-    totalBytesRead += bytesRead;
-    totalBytesLeft -= bytesRead;
+  else if(strcmp(ext, ".ktx2") == 0) {
+    return eFileFormat_KTX2;
   }
-
-  if(totalBytesRead != fileSize) {
-    assert(!"We didn't read as much data as we thought we had!");
-    fprintf(stderr, "Internal error: Incorrect file size assumption\n");
-    return false;
+  else if(strcmp(ext, ".dds") == 0) {
+    return eFileFormat_DDS;
   }
 
-  m_FileDataSz = fileSize;
-  return true;
+  return kNumImageFileFormats;
 }
 
 bool ImageFile::WriteImageDataToFile(const uint8 *data,
-                                     const uint32 dataSz,
+                                     const uint64 dataSz,
                                      const CHAR *filename) {
 
   // Open a file stream and write out the data...
@@ -300,7 +505,15 @@ bool ImageFile::WriteImageDataToFile(const uint8 *data,
     return 0;
   }
 
-  fstr.Write(data, dataSz);
+  // FileStream only deals in 32-bit sizes, so write large files in pieces.
+  const uint64 kMaxWriteSz = 1 << 30;
+  for(uint64 offset = 0; offset < dataSz; offset += kMaxWriteSz) {
+    const uint32 sz = static_cast<uint32>(std::min(kMaxWriteSz, dataSz - offset));
+    if(fstr.Write(data + offset, sz) != static_cast<int32>(sz)) {
+      fprintf(stderr, "Error writing to file: %s\n", filename);
+      return false;
+    }
+  }
   fstr.Flush();
   return true;
 }
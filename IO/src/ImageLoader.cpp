@@ -17,33 +17,23 @@
 
 #include "FasTC/ImageLoader.h"
 #include "FasTC/Image.h"
+#include "FasTC/RGBAImage.h"
+#include "FasTC/Bits.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <limits.h>
 #include <assert.h>
 
+#include <algorithm>
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Static helper functions
 //
 ///////////////////////////////////////////////////////////////////////////////
 
-template <typename T>
-static inline T min(const T &a, const T &b) {
-  return (a > b)? b : a;
-}
-
-template <typename T>
-static inline T abs(const T &a) {
-  return (a > 0)? a : -a;
-}
-
-template <typename T>
-static inline T sad(const T &a, const T &b) {
-  return (a > b)? a - b : b - a;
-}
-
 void ReportError(const char *str) {
   fprintf(stderr, "ImageLoader.cpp -- ERROR: %s\n", str);
 }
@@ -95,21 +85,7 @@ unsigned int ImageLoader::GetChannelForPixel(uint32 x, uint32 y, uint32 ch) {
   const uint32 val = data[pixelIdx];
   
   if(prec < 8) {
-    int32 ret = 0;
-    for(uint32 precLeft = 8; precLeft > 0; precLeft -= min(prec, sad(prec, precLeft))) {
-      
-      if(prec > precLeft) {
-        const int toShift = prec - precLeft;
-        ret = ret << precLeft;
-        ret |= val >> toShift;
-      }
-      else {
-        ret = ret << prec;
-        ret |= val;
-      }
-    }
-
-    return static_cast<unsigned int>(ret);
+    return FasTC::Replicate(val, prec, 8);
   }
   else if(prec > 8) {
     const int32 toShift = prec - 8;
@@ -120,98 +96,166 @@ unsigned int ImageLoader::GetChannelForPixel(uint32 x, uint32 y, uint32 ch) {
 }
 
 bool ImageLoader::LoadFromPixelBuffer(const uint32 *data, bool flipY) {
-  m_RedChannelPrecision = 8;
-  m_GreenChannelPrecision = 8;
-  m_BlueChannelPrecision = 8;
-  m_AlphaChannelPrecision = 8;
-
-  const int nPixels = m_Width * m_Height;
-  m_RedData = new uint8[nPixels];
-  m_GreenData = new uint8[nPixels];
-  m_BlueData = new uint8[nPixels];
-  m_AlphaData = new uint8[nPixels];
+  delete m_RGBA8Data;
+  m_RGBA8Data = new FasTC::RGBA8Image(m_Width, m_Height);
 
+  // Packed pixels already have the same layout as the rows of an RGBA8
+  // image, so this is just a copy.
+  const size_t rowSz = static_cast<size_t>(m_RGBA8Data->GetRowSize());
   for (uint32 j = 0; j < m_Height; j++) {
-    for (uint32 i = 0; i < m_Width; i++) {
-      uint32 idx = j*m_Width + i;
-      uint32 pIdx = idx;
-      if(flipY)
-        idx = (m_Height - j - 1)*m_Width + i;
-      uint32 pixel = data[idx];
-      m_RedData[pIdx] = static_cast<uint8>(pixel & 0xFF);
-      m_GreenData[pIdx] = static_cast<uint8>((pixel >> 8) & 0xFF);
-      m_BlueData[pIdx] = static_cast<uint8>((pixel >> 16) & 0xFF);
-      m_AlphaData[pIdx] = static_cast<uint8>((pixel >> 24) & 0xFF);
-    }
+    const uint32 srcRow = flipY? m_Height - j - 1 : j;
+    memcpy(m_RGBA8Data->GetRow(j), data + static_cast<size_t>(srcRow) * m_Width, rowSz);
   }
 
   return true;
 }
 
-FasTC::Image<> *ImageLoader::LoadImage() {
+uint32 ImageLoader::GetMaxNumMipLevels(uint32 width, uint32 height) {
+  uint32 dim = std::max(width, height);
+  uint32 numLevels = 1;
+  while(dim > 1) {
+    dim >>= 1;
+    numLevels++;
+  }
+  return numLevels;
+}
 
-  // Do we already have pixel data?
-  if(m_PixelData) {
-    uint32 *pixels = reinterpret_cast<uint32 *>(m_PixelData);
-    return new FasTC::Image<>(m_Width, m_Height, pixels);
+// Fills table with the eight bit value of every prec bit value of a channel,
+// replicating the high bits into the low bits like GetChannelForPixel.
+static void BuildExpansionTable(uint8 table[256], uint32 prec) {
+  for(uint32 i = 0; i < 256; i++) {
+    const uint32 val = i & ((1 << prec) - 1);
+    table[i] = static_cast<uint8>(FasTC::Replicate(val, prec, 8));
   }
+}
 
-  // Read the image data!
-  if(!ReadData())
-    return NULL;
+FasTC::RGBA8Image *ImageLoader::InterleavePlanarData() {
+  const uint32 prec[4] = {
+    GetRedChannelPrecision(), GetGreenChannelPrecision(),
+    GetBlueChannelPrecision(), GetAlphaChannelPrecision()
+  };
+
+  FasTC::RGBA8Image *img = new FasTC::RGBA8Image(GetWidth(), GetHeight());
+
+  // Channels with more than eight bits are rare enough that they go through
+  // the general per-channel path.
+  if(prec[0] > 8 || prec[1] > 8 || prec[2] > 8 || prec[3] > 8) {
+    for(uint32 j = 0; j < GetHeight(); j++) {
+      uint8 *row = img->GetRow(j);
+      for(uint32 i = 0; i < GetWidth(); i++) {
+        const uint32 r = GetChannelForPixel(i, j, 0);
+        *row++ = static_cast<uint8>(r);
+        *row++ = static_cast<uint8>(prec[1]? GetChannelForPixel(i, j, 1) : r);
+        *row++ = static_cast<uint8>(prec[2]? GetChannelForPixel(i, j, 2) : r);
+        *row++ = static_cast<uint8>(prec[3]? GetChannelForPixel(i, j, 3) : 0xFF);
+      }
+    }
+    return img;
+  }
 
-  // Create RGBA buffer 
-  const unsigned int dataSz = 4 * GetWidth() * GetHeight();
-  m_PixelData = new unsigned char[dataSz];
+  // Missing green and blue channels mean that the image is grayscale, so
+  // they repeat red. A missing alpha channel is opaque.
+  const uint8 *src[4] = {
+    GetRedPixelData(), GetGreenPixelData(),
+    GetBluePixelData(), GetAlphaPixelData()
+  };
+  uint32 srcPrec[4] = { prec[0], prec[1], prec[2], prec[3] };
+  for(uint32 c = 1; c < 3; c++) {
+    if(0 == prec[c]) {
+      src[c] = src[0];
+      srcPrec[c] = prec[0];
+    }
+  }
 
-  int byteIdx = 0;
+  uint8 table[4][256];
+  for(uint32 c = 0; c < 4; c++) {
+    if(srcPrec[c] > 0 && src[c]) {
+      BuildExpansionTable(table[c], srcPrec[c]);
+    } else {
+      memset(table[c], (c == 3)? 0xFF : 0, 256);
+    }
+  }
+
+  static const uint8 kZero = 0;
   for(uint32 j = 0; j < GetHeight(); j++) {
-    for(uint32 i = 0; i < GetWidth(); i++) {
+    const uint32 offset = j * GetWidth();
+    const uint8 *srcRow[4];
+    uint32 srcStep[4];
+    for(uint32 c = 0; c < 4; c++) {
+      const bool valid = srcPrec[c] > 0 && src[c];
+      srcRow[c] = valid? src[c] + offset : &kZero;
+      srcStep[c] = valid? 1 : 0;
+    }
 
-      unsigned int redVal = GetChannelForPixel(i, j, 0);
-      if(redVal == INT_MAX) {
-        return NULL;
+    uint8 *row = img->GetRow(j);
+    for(uint32 i = 0; i < GetWidth(); i++) {
+      row[0] = table[0][*srcRow[0]];
+      row[1] = table[1][*srcRow[1]];
+      row[2] = table[2][*srcRow[2]];
+      row[3] = table[3][*srcRow[3]];
+      row += 4;
+
+      for(uint32 c = 0; c < 4; c++) {
+        srcRow[c] += srcStep[c];
       }
+    }
+  }
 
-      unsigned int greenVal = redVal;
-      unsigned int blueVal = redVal;
+  return img;
+}
 
-      if(GetGreenChannelPrecision() > 0) {
-        greenVal = GetChannelForPixel(i, j, 1);
-        if(greenVal == INT_MAX) {
-          return NULL;
-        }
-      }
+FasTC::RGBA8Image *ImageLoader::LoadRGBA8Image() {
 
-      if(GetBlueChannelPrecision() > 0) {
-        blueVal = GetChannelForPixel(i, j, 2);
-        if(blueVal == INT_MAX) {
-          return NULL;
-        }
-      }
+  // Do we already have pixel data?
+  if(m_PixelData) {
+    return new FasTC::RGBA8Image(m_Width, m_Height, m_PixelData);
+  }
 
-      unsigned int alphaVal = 0xFF;
-      if(GetAlphaChannelPrecision() > 0) {
-        alphaVal = GetChannelForPixel(i, j, 3);
-        if(alphaVal == INT_MAX) {
-          return NULL;
-        }
-      }
+  // Read the image data!
+  if(!ReadData())
+    return NULL;
 
-      // Red channel
-      m_PixelData[byteIdx++] = static_cast<uint8>(redVal & 0xFF);
+  // If the loader decoded straight into RGBA8, then we're done.
+  if(m_RGBA8Data) {
+    FasTC::RGBA8Image *img = m_RGBA8Data;
+    m_RGBA8Data = NULL;
+    return img;
+  }
 
-      // Green channel
-      m_PixelData[byteIdx++] = static_cast<uint8>(greenVal & 0xFF);
+  return InterleavePlanarData();
+}
 
-      // Blue channel
-      m_PixelData[byteIdx++] = static_cast<uint8>(blueVal & 0xFF);
+bool ImageLoader::BeginReadingRows() {
+  FasTC::RGBA8Image *img = LoadRGBA8Image();
+  if(!img)
+    return false;
+
+  // Hold on to the image so that ReadRows can copy out of it.
+  delete m_RGBA8Data;
+  m_RGBA8Data = img;
+  m_Width = img->GetWidth();
+  m_Height = img->GetHeight();
+  m_NextRow = 0;
+  return true;
+}
 
-      // Alpha channel
-      m_PixelData[byteIdx++] = static_cast<uint8>(alphaVal & 0xFF);
-    }
-  }
+bool ImageLoader::ReadRows(uint8 *rows, uint32 nRows) {
+  if(!m_RGBA8Data || nRows > m_Height - m_NextRow)
+    return false;
+
+  memcpy(rows, m_RGBA8Data->GetRow(m_NextRow),
+         static_cast<size_t>(nRows * m_RGBA8Data->GetRowSize()));
+  m_NextRow += nRows;
+  return true;
+}
+
+FasTC::Image<> *ImageLoader::LoadImage() {
+  FasTC::RGBA8Image *rgba = LoadRGBA8Image();
+  if(!rgba)
+    return NULL;
 
-  uint32 *pixels = reinterpret_cast<uint32 *>(m_PixelData);
-  return new FasTC::Image<>(m_Width, m_Height, pixels);
+  const uint32 *pixels = reinterpret_cast<const uint32 *>(rgba->GetData());
+  FasTC::Image<> *img = new FasTC::Image<>(m_Width, m_Height, pixels);
+  delete rgba;
+  return img;
 }
@@ -30,6 +30,7 @@
 
 #include "GLDefines.h"
 #include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
 
 static bool GetFormatForBlockDimensions(FasTC::ECompressionFormat &out,
                                         uint32 blockWidth, uint32 blockHeight) {
@@ -87,18 +88,34 @@ static bool GetFormatForBlockDimensions(FasTC::ECompressionFormat &out,
 
 ImageLoaderASTC::ImageLoaderASTC(const uint8 *rawData, const int32 rawDataSz)
   : ImageLoader(rawData, rawDataSz), m_BlockSizeX(0), m_BlockSizeY(0)
+  , m_BlockData(NULL)
 { }
 
 ImageLoaderASTC::~ImageLoaderASTC() { }
 
-FasTC::Image<> *ImageLoaderASTC::LoadImage() {
+FasTC::RGBA8Image *ImageLoaderASTC::LoadRGBA8Image() {
+  if(!ReadData()) {
+    return NULL;
+  }
 
-  // Get rid of the pixel data if it exists...
-  if(m_PixelData) {
-    delete m_PixelData;
-    m_PixelData = NULL;
+  FasTC::ECompressionFormat fmt;
+  if(!GetFormatForBlockDimensions(fmt, m_BlockSizeX, m_BlockSizeY)) {
+    return NULL;
+  }
+
+  // Decompress straight out of the file data.
+  CompressedImage ci(m_Width, m_Height, fmt, m_BlockData,
+                     CompressedImage::eWrapData);
+
+  FasTC::RGBA8Image *img = new FasTC::RGBA8Image;
+  if(!ci.DecompressImage(img)) {
+    delete img;
+    return NULL;
   }
+  return img;
+}
 
+FasTC::Image<> *ImageLoaderASTC::LoadImage() {
   if(!ReadData()) {
     return NULL;
   }
@@ -108,7 +125,10 @@ FasTC::Image<> *ImageLoaderASTC::LoadImage() {
     return NULL;
   }
 
-  return new CompressedImage(m_Width, m_Height, fmt, m_PixelData);
+  // Only the header has been parsed. The blocks stay in the file data until
+  // something asks for the pixels.
+  return new CompressedImage(m_Width, m_Height, fmt, m_BlockData,
+                             CompressedImage::eWrapData);
 }
 
 template <typename T>
@@ -129,7 +149,11 @@ uint32 ReadThreeWideInt(const uint8 *data, const bool bLittleEndian) {
 }
 
 bool ImageLoaderASTC::ReadData() {
-  
+  if(m_NumRawDataBytes < 16) {
+    fprintf(stderr, "ASTC loader - file is truncated\n");
+    return false;
+  }
+
   const uint8 *data = m_RawData;
   uint32 magic = reinterpret_cast<const uint32 *>(data)[0];
 
@@ -153,8 +177,11 @@ bool ImageLoaderASTC::ReadData() {
   uint8 blockDepth = *data;
   data++;
 
-  assert(blockWidth <= 12);
-  assert(blockHeight <= 12);
+  if(blockWidth > 12 || blockHeight > 12) {
+    fprintf(stderr, "ASTC loader - invalid block size %ux%u\n", blockWidth, blockHeight);
+    return false;
+  }
+
   if(blockDepth != 1) {
     fprintf(stderr, "3D compressed textures unsupported!\n");
     return false;
@@ -187,12 +214,14 @@ bool ImageLoaderASTC::ReadData() {
   m_Width = pixelWidth;
   m_Height = pixelHeight;
 
-  uint32 uncompressedSize = pixelWidth * pixelHeight * 4;
-  uint32 compressedSize = CompressedImage::GetCompressedSize(pixelWidth, pixelHeight, fmt);
+  uint64 compressedSize = CompressedImage::GetCompressedSize(pixelWidth, pixelHeight, fmt);
+
+  if(compressedSize + 16 > m_NumRawDataBytes) {
+    fprintf(stderr, "ASTC loader - file is truncated\n");
+    return false;
+  }
 
-  assert(compressedSize + 16 == m_NumRawDataBytes);
-  m_PixelData = new uint8[compressedSize];
-  memcpy(m_PixelData, data, compressedSize);
+  m_BlockData = data;
   return true;
 }
 
@@ -24,12 +24,20 @@ class ImageLoaderASTC : public ImageLoader {
  private:
   uint8 m_BlockSizeX;
   uint8 m_BlockSizeY;
+
+  // Points into the raw file data at the first block.
+  const uint8 *m_BlockData;
  public:
   ImageLoaderASTC(const uint8 *rawData, const int32 rawDataSz);
   virtual ~ImageLoaderASTC();
 
   virtual bool ReadData();
+  virtual FasTC::RGBA8Image *LoadRGBA8Image();
   virtual FasTC::Image<> *LoadImage();
+
+  // The image wraps the blocks in the file data, so the data must outlive
+  // the image returned by LoadImage.
+  virtual bool ImageWrapsRawData() const { return true; }
 };
 
 #endif // _IO_SRC_IMAGE_LOADER_ASTC_H_
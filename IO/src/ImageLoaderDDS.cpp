@@ -0,0 +1,193 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "ImageLoaderDDS.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "FasTC/Image.h"
+#include "FasTC/TexCompTypes.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
+
+#include "DDSDefines.h"
+
+// DDS files are always little endian.
+static uint32 Read32(const uint8 *data) {
+  return static_cast<uint32>(data[0]) | (static_cast<uint32>(data[1]) << 8) |
+    (static_cast<uint32>(data[2]) << 16) | (static_cast<uint32>(data[3]) << 24);
+}
+
+ImageLoaderDDS::ImageLoaderDDS(const uint8 *rawData, const int32 rawDataSz)
+  : ImageLoader(rawData, rawDataSz)
+  , m_bIsCompressed(false), m_Format(FasTC::kNumCompressionFormats)
+  , m_ImageData(NULL)
+{ }
+
+ImageLoaderDDS::~ImageLoaderDDS() { }
+
+FasTC::RGBA8Image *ImageLoaderDDS::LoadRGBA8Image() {
+  if(!ReadData()) {
+    return NULL;
+  }
+
+  if(!m_bIsCompressed) {
+    return new FasTC::RGBA8Image(m_Width, m_Height, m_ImageData);
+  }
+
+  CompressedImage ci(m_Width, m_Height, m_Format, m_ImageData,
+                     CompressedImage::eWrapData);
+
+  FasTC::RGBA8Image *img = new FasTC::RGBA8Image;
+  if(!ci.DecompressImage(img)) {
+    delete img;
+    return NULL;
+  }
+  return img;
+}
+
+FasTC::Image<> *ImageLoaderDDS::LoadImage() {
+  if(!ReadData()) {
+    return NULL;
+  }
+
+  if(!m_bIsCompressed) {
+    const uint32 *pixels = reinterpret_cast<const uint32 *>(m_ImageData);
+    return new FasTC::Image<>(m_Width, m_Height, pixels);
+  }
+
+  return new CompressedImage(m_Width, m_Height, m_Format, m_ImageData,
+                             CompressedImage::eWrapData);
+}
+
+bool ImageLoaderDDS::ReadData() {
+
+  uint32 headerSz = 4 + DDS_HEADER_SIZE;
+  if(m_NumRawDataBytes < headerSz || Read32(m_RawData) != DDS_MAGIC ||
+     Read32(m_RawData + 4) != DDS_HEADER_SIZE) {
+    fprintf(stderr, "DDS loader - not a DDS file\n");
+    return false;
+  }
+
+  const uint8 *hdr = m_RawData + 4;
+  const uint32 height = Read32(hdr + 8);
+  const uint32 width = Read32(hdr + 12);
+  const uint32 depth = Read32(hdr + 20);
+  const uint32 numLevels = std::max<uint32>(1, Read32(hdr + 24));
+  const uint8 *pf = hdr + 72;
+  const uint32 pfFlags = Read32(pf + 4);
+  const uint32 fourCC = Read32(pf + 8);
+  const uint32 caps2 = Read32(hdr + 108);
+
+  if(width == 0 || height == 0) {
+    fprintf(stderr, "DDS loader - 1D textures not supported\n");
+    return false;
+  }
+
+  if(depth > 1) {
+    fprintf(stderr, "DDS loader - 3D textures not supported\n");
+    return false;
+  }
+
+  uint32 numArrayElements = 1;
+  uint32 numFaces = (caps2 & DDSCAPS2_CUBEMAP)? 6 : 1;
+
+  m_bIsCompressed = true;
+  if((pfFlags & DDPF_FOURCC) && fourCC == DDS_FOURCC_DX10) {
+    headerSz += DDS_HEADER_DXT10_SIZE;
+    if(m_NumRawDataBytes < headerSz) {
+      fprintf(stderr, "DDS loader - file is truncated\n");
+      return false;
+    }
+
+    const uint8 *dx10 = hdr + DDS_HEADER_SIZE;
+    const uint32 dxgiFormat = Read32(dx10);
+    const uint32 dimension = Read32(dx10 + 4);
+    const uint32 miscFlag = Read32(dx10 + 8);
+    numArrayElements = std::max<uint32>(1, Read32(dx10 + 12));
+    numFaces = (miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)? 6 : 1;
+
+    if(dimension != DDS_DIMENSION_TEXTURE2D) {
+      fprintf(stderr, "DDS loader - only 2D textures are supported\n");
+      return false;
+    }
+
+    switch(dxgiFormat) {
+      case DXGI_FORMAT_BC1_UNORM:
+        m_Format = FasTC::eCompressionFormat_DXT1;
+        break;
+
+      case DXGI_FORMAT_BC3_UNORM:
+        m_Format = FasTC::eCompressionFormat_DXT5;
+        break;
+
+      case DXGI_FORMAT_BC7_UNORM:
+        m_Format = FasTC::eCompressionFormat_BPTC;
+        break;
+
+      case DXGI_FORMAT_R8G8B8A8_UNORM:
+        m_bIsCompressed = false;
+        break;
+
+      default:
+        fprintf(stderr, "DDS loader - DXGI format (%d) unsupported!\n", dxgiFormat);
+        return false;
+    }
+  } else if((pfFlags & DDPF_FOURCC) && fourCC == DDS_FOURCC_DXT1) {
+    m_Format = FasTC::eCompressionFormat_DXT1;
+  } else if((pfFlags & DDPF_FOURCC) && fourCC == DDS_FOURCC_DXT5) {
+    m_Format = FasTC::eCompressionFormat_DXT5;
+  } else if((pfFlags & DDPF_RGB) && (pfFlags & DDPF_ALPHAPIXELS) &&
+            Read32(pf + 12) == 32 &&
+            Read32(pf + 16) == 0x000000FF && Read32(pf + 20) == 0x0000FF00 &&
+            Read32(pf + 24) == 0x00FF0000 && Read32(pf + 28) == 0xFF000000) {
+    m_bIsCompressed = false;
+  } else {
+    fprintf(stderr, "DDS loader - pixel format unsupported!\n");
+    return false;
+  }
+
+  if(numLevels > GetMaxNumMipLevels(width, height)) {
+    fprintf(stderr, "DDS loader - too many mip levels (%d) for a %dx%d image\n",
+            numLevels, width, height);
+    return false;
+  }
+
+  m_Width = width;
+  m_Height = height;
+
+  // Make sure that every image in the file is there, even though only the
+  // first one is loaded.
+  uint64 chainSz = 0;
+  for(uint32 l = 0; l < numLevels; l++) {
+    const uint32 w = std::max<uint32>(1, width >> l);
+    const uint32 h = std::max<uint32>(1, height >> l);
+    chainSz += m_bIsCompressed?
+      CompressedImage::GetCompressedSize(w, h, m_Format) :
+      static_cast<uint64>(w) * h * 4;
+  }
+
+  const uint64 bytesLeft = m_NumRawDataBytes - headerSz;
+  if(chainSz * numFaces > bytesLeft / numArrayElements) {
+    fprintf(stderr, "DDS loader - file is truncated\n");
+    return false;
+  }
+
+  m_ImageData = m_RawData + headerSz;
+  return true;
+}
@@ -0,0 +1,48 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _IO_SRC_IMAGE_LOADER_DDS_H_
+#define _IO_SRC_IMAGE_LOADER_DDS_H_
+
+#include "FasTC/ImageLoader.h"
+#include "FasTC/CompressionFormat.h"
+
+// Loads the first image of a DDS file: the largest mip level of the first
+// array element and the first cube face. Files may use the DX10 extended
+// header or the legacy DXT1, DXT5 and 32-bit RGBA pixel formats. Compressed
+// images wrap the blocks in the file data instead of copying or decoding
+// them, so the data must outlive the image returned by LoadImage.
+class ImageLoaderDDS : public ImageLoader {
+ public:
+  ImageLoaderDDS(const uint8 *rawData, const int32 rawDataSz);
+  virtual ~ImageLoaderDDS();
+
+  virtual bool ReadData();
+
+  virtual FasTC::RGBA8Image *LoadRGBA8Image();
+  virtual FasTC::Image<> *LoadImage();
+
+  virtual bool ImageWrapsRawData() const { return m_bIsCompressed; }
+ private:
+  bool m_bIsCompressed;
+  FasTC::ECompressionFormat m_Format;
+
+  // Points into the raw file data at the pixels of the image.
+  const uint8 *m_ImageData;
+};
+
+#endif  // _IO_SRC_IMAGE_LOADER_DDS_H_
@@ -26,6 +26,7 @@
 #include "FasTC/Image.h"
 #include "FasTC/TexCompTypes.h"
 #include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
 #include "FasTC/ScopedAllocator.h"
 
 #include "GLDefines.h"
@@ -101,28 +102,47 @@ static const LittleEndianIntLoader gLEldr;
 
 ImageLoaderKTX::ImageLoaderKTX(const uint8 *rawData, const int32 rawDataSz)
   : ImageLoader(rawData, rawDataSz), m_Processor(NULL)
+  , m_bIsCompressed(false), m_Format(FasTC::kNumCompressionFormats)
+  , m_ImageData(NULL)
 { }
 
 ImageLoaderKTX::~ImageLoaderKTX() { }
 
-FasTC::Image<> *ImageLoaderKTX::LoadImage() {
+FasTC::RGBA8Image *ImageLoaderKTX::LoadRGBA8Image() {
+  if(!ReadData()) {
+    return NULL;
+  }
 
-  // Get rid of the pixel data if it exists...
-  if(m_PixelData) {
-    delete m_PixelData;
-    m_PixelData = NULL;
+  if(!m_bIsCompressed) {
+    return new FasTC::RGBA8Image(m_Width, m_Height, m_ImageData);
   }
 
+  // Decompress straight out of the file data.
+  CompressedImage ci(m_Width, m_Height, m_Format, m_ImageData,
+                     CompressedImage::eWrapData);
+
+  FasTC::RGBA8Image *img = new FasTC::RGBA8Image;
+  if(!ci.DecompressImage(img)) {
+    delete img;
+    return NULL;
+  }
+  return img;
+}
+
+FasTC::Image<> *ImageLoaderKTX::LoadImage() {
   if(!ReadData()) {
     return NULL;
   }
 
   if(!m_bIsCompressed) {
-    uint32 *pixels = reinterpret_cast<uint32 *>(m_PixelData);
+    const uint32 *pixels = reinterpret_cast<const uint32 *>(m_ImageData);
     return new FasTC::Image<>(m_Width, m_Height, pixels);
   }
 
-  return new CompressedImage(m_Width, m_Height, m_Format, m_PixelData);
+  // Only the header has been parsed. The blocks stay in the file data until
+  // something asks for the pixels.
+  return new CompressedImage(m_Width, m_Height, m_Format, m_ImageData,
+                             CompressedImage::eWrapData);
 }
 
 bool ImageLoaderKTX::ReadData() {
@@ -197,29 +217,20 @@ bool ImageLoaderKTX::ReadData() {
   // is here:
   // http://www.khronos.org/opengles/sdk/tools/KTX/file_format_spec
 
-  // Read image data...
-  if(numberOfMipmapLevels != 1) {
-    fprintf(stderr, "KTX loader - unsupported mipmap levels: %d\n", numberOfMipmapLevels);
-    return false;
-  }
-
+  // Read image data... Only the first image of the texture is loaded: the
+  // largest mip level of the first array element and the first cube face.
+  // It comes right after the first imageSize no matter how many of the
+  // others there are.
   LOAD(imageSize);
-  
-  if(numberOfArrayElements > 1) {
-    fprintf(stderr,
-            "KTX loader - unsupported number of array elements: %d\n",
-            numberOfArrayElements);
-    return false;
-  }
 
-  if(numberOfFaces != 1) {
-    fprintf(stderr,
-            "KTX loader - unsupported number of faces: %d\n"
-            "This likely means that we are trying to load a cube map.\n",
-            numberOfFaces);
+  if(numberOfFaces != 1 && numberOfFaces != 6) {
+    fprintf(stderr, "KTX loader - unsupported number of faces: %d\n", numberOfFaces);
     return false;
   }
 
+  const bool bSingleImage =
+    numberOfMipmapLevels <= 1 && numberOfArrayElements <= 1 && numberOfFaces == 1;
+
   if(pixelDepth != 0) {
     fprintf(stderr, "KTX loader - 3D textures not supported\n");
     return false;
@@ -249,6 +260,15 @@ bool ImageLoaderKTX::ReadData() {
         m_Format = FasTC::eCompressionFormat_PVRTC4;
         break;
 
+      case GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG:
+      case GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG:
+        m_Format = FasTC::eCompressionFormat_PVRTC2;
+        break;
+
+      case GL_ETC1_RGB8_OES:
+        m_Format = FasTC::eCompressionFormat_ETC1;
+        break;
+
       case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
         m_Format = FasTC::eCompressionFormat_DXT1;
         break;
@@ -318,15 +338,18 @@ bool ImageLoaderKTX::ReadData() {
         return false;
     }
 
-    uint32 dataSize = CompressedImage::GetCompressedSize(pixelWidth, pixelHeight, m_Format);
-    m_PixelData = new uint8[dataSize];
-    memcpy(m_PixelData, rdr.GetData(), dataSize);
-    rdr.Advance(dataSize);
+    uint64 dataSize = CompressedImage::GetCompressedSize(pixelWidth, pixelHeight, m_Format);
+    m_ImageData = rdr.GetData();
+    if(dataSize > uint64(m_NumRawDataBytes) || !rdr.Advance(static_cast<uint32>(dataSize))) {
+      fprintf(stderr, "KTX loader - file is truncated\n");
+      return false;
+    }
 
     m_bIsCompressed = true;
   } else {
 
-    if(glType != GL_BYTE) {
+    // Older versions of FasTC wrote GL_BYTE here, so accept that as well.
+    if(glType != GL_UNSIGNED_BYTE && glType != GL_BYTE) {
       fprintf(stderr, "KTX loader - unsupported OpenGL type: 0x%x\n", glType);
       return false;
     }
@@ -339,10 +362,14 @@ bool ImageLoaderKTX::ReadData() {
     // We should have RGBA8 data here so we can simply load it
     // as we normally would.
     uint32 pixelDataSz = m_Width * m_Height * 4;
-    m_PixelData = new uint8[pixelDataSz];
-    memcpy(m_PixelData, rdr.GetData(), pixelDataSz);
-    rdr.Advance(pixelDataSz);
+    m_ImageData = rdr.GetData();
+    if(!rdr.Advance(pixelDataSz)) {
+      fprintf(stderr, "KTX loader - file is truncated\n");
+      return false;
+    }
   }
-  return rdr.GetBytesLeft() == 0;
+
+  // If there's only one image, then it should be the rest of the file.
+  return !bSingleImage || rdr.GetBytesLeft() == 0;
 }
 
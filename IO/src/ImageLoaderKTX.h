@@ -34,12 +34,21 @@ class ImageLoaderKTX : public ImageLoader {
     m_Processor = proc;
   }
 
+  virtual FasTC::RGBA8Image *LoadRGBA8Image();
   virtual FasTC::Image<> *LoadImage();
+
+  // Compressed images wrap the blocks in the file data, so the data must
+  // outlive the image returned by LoadImage.
+  virtual bool ImageWrapsRawData() const { return m_bIsCompressed; }
  private:
   KTXKeyValueProcessor m_Processor;
   
   bool m_bIsCompressed;
   FasTC::ECompressionFormat m_Format;
+
+  // Points into the raw file data at the pixels of the image, which are
+  // never copied unless the caller needs an image that owns them.
+  const uint8 *m_ImageData;
 };
 
 #endif // _IO_SRC_IMAGE_LOADER_KTX_H_
@@ -0,0 +1,327 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "ImageLoaderKTX2.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+#include "FasTC/Image.h"
+#include "FasTC/TexCompTypes.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
+
+#include "VKDefines.h"
+
+// KTX2 files are always little endian.
+static uint64 ReadLE(const uint8 *data, uint32 nBytes) {
+  uint64 ret = 0;
+  for(uint32 i = nBytes; i-- > 0;) {
+    ret = (ret << 8) | data[i];
+  }
+  return ret;
+}
+
+static uint32 Read32(const uint8 *data) {
+  return static_cast<uint32>(ReadLE(data, 4));
+}
+
+static uint64 Read64(const uint8 *data) {
+  return ReadLE(data, 8);
+}
+
+// Returns the compression format with the given Vulkan format, or false if
+// FasTC doesn't support it.
+static bool GetCompressionFormat(uint32 vkFormat, FasTC::ECompressionFormat &fmt) {
+  switch(vkFormat) {
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_BPTC;
+      return true;
+
+    case VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG:
+      fmt = FasTC::eCompressionFormat_PVRTC2;
+      return true;
+
+    case VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG:
+      fmt = FasTC::eCompressionFormat_PVRTC4;
+      return true;
+
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_DXT1;
+      return true;
+
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_DXT5;
+      return true;
+
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ETC1;
+      return true;
+
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC4x4;
+      return true;
+
+    case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC5x4;
+      return true;
+
+    case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC5x5;
+      return true;
+
+    case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC6x5;
+      return true;
+
+    case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC6x6;
+      return true;
+
+    case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC8x5;
+      return true;
+
+    case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC8x6;
+      return true;
+
+    case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC8x8;
+      return true;
+
+    case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC10x5;
+      return true;
+
+    case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC10x6;
+      return true;
+
+    case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC10x8;
+      return true;
+
+    case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC10x10;
+      return true;
+
+    case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC12x10;
+      return true;
+
+    case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
+      fmt = FasTC::eCompressionFormat_ASTC12x12;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Inflates the first dstSz bytes of the zlib stream in src, and stops there
+// without touching the rest of it.
+static bool InflatePrefix(const uint8 *src, uint64 srcSz, uint8 *dst, uint64 dstSz) {
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if(inflateInit(&strm) != Z_OK) {
+    return false;
+  }
+
+  int ret = Z_OK;
+  while(ret == Z_OK && (dstSz > 0 || strm.avail_out > 0)) {
+    // zlib only takes 32-bit sizes at a time.
+    const uint64 kMaxChunk = 1 << 30;
+    if(strm.avail_in == 0 && srcSz > 0) {
+      strm.next_in = const_cast<Bytef *>(src);
+      strm.avail_in = static_cast<uInt>(std::min(srcSz, kMaxChunk));
+      src += strm.avail_in;
+      srcSz -= strm.avail_in;
+    }
+
+    if(strm.avail_out == 0) {
+      strm.next_out = dst;
+      strm.avail_out = static_cast<uInt>(std::min(dstSz, kMaxChunk));
+      dst += strm.avail_out;
+      dstSz -= strm.avail_out;
+    }
+
+    ret = inflate(&strm, Z_SYNC_FLUSH);
+  }
+
+  const bool bFilled = dstSz == 0 && strm.avail_out == 0 &&
+    (ret == Z_OK || ret == Z_STREAM_END);
+  inflateEnd(&strm);
+  return bFilled;
+}
+
+ImageLoaderKTX2::ImageLoaderKTX2(const uint8 *rawData, const int32 rawDataSz)
+  : ImageLoader(rawData, rawDataSz)
+  , m_bIsCompressed(false), m_bWrapsRawData(false)
+  , m_Format(FasTC::kNumCompressionFormats)
+  , m_ImageData(NULL)
+  , m_PixelDataSz(0)
+{ }
+
+ImageLoaderKTX2::~ImageLoaderKTX2() {
+  TCMemory::DeleteArray(GetPixelDataCategory(), m_PixelData, m_PixelDataSz);
+  m_PixelData = NULL;
+}
+
+FasTC::RGBA8Image *ImageLoaderKTX2::LoadRGBA8Image() {
+  if(!ReadData()) {
+    return NULL;
+  }
+
+  if(!m_bIsCompressed) {
+    return new FasTC::RGBA8Image(m_Width, m_Height, m_ImageData);
+  }
+
+  CompressedImage ci(m_Width, m_Height, m_Format, m_ImageData,
+                     CompressedImage::eWrapData);
+
+  FasTC::RGBA8Image *img = new FasTC::RGBA8Image;
+  if(!ci.DecompressImage(img)) {
+    delete img;
+    return NULL;
+  }
+  return img;
+}
+
+FasTC::Image<> *ImageLoaderKTX2::LoadImage() {
+  if(!ReadData()) {
+    return NULL;
+  }
+
+  if(!m_bIsCompressed) {
+    const uint32 *pixels = reinterpret_cast<const uint32 *>(m_ImageData);
+    return new FasTC::Image<>(m_Width, m_Height, pixels);
+  }
+
+  // Supercompressed levels were already inflated into m_PixelData, which is
+  // handed over to the image rather than copied.
+  if(m_ImageData == m_PixelData) {
+    uint8 *blocks = m_PixelData;
+    m_PixelData = NULL;
+    m_PixelDataSz = 0;
+    return new CompressedImage(m_Width, m_Height, m_Format, blocks,
+                               CompressedImage::eTakeOwnership);
+  }
+
+  m_bWrapsRawData = true;
+  return new CompressedImage(m_Width, m_Height, m_Format, m_ImageData,
+                             CompressedImage::eWrapData);
+}
+
+bool ImageLoaderKTX2::ReadData() {
+
+  static const uint8 kKTX2ID[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+  };
+
+  // The identifier, header, index, and the entry for the first level.
+  const uint32 kHeaderSz = 80 + 24;
+  if(m_NumRawDataBytes < kHeaderSz || memcmp(m_RawData, kKTX2ID, 12) != 0) {
+    fprintf(stderr, "KTX2 loader - not a KTX2 file\n");
+    return false;
+  }
+
+  const uint8 *hdr = m_RawData + 12;
+  const uint32 vkFormat = Read32(hdr);
+  const uint32 pixelWidth = Read32(hdr + 8);
+  const uint32 pixelHeight = Read32(hdr + 12);
+  const uint32 pixelDepth = Read32(hdr + 16);
+  const uint32 faceCount = Read32(hdr + 24);
+  const uint32 scheme = Read32(hdr + 32);
+
+  // The level index starts right after the header and index, and the first
+  // entry is always the base level.
+  const uint8 *levelIndex = m_RawData + 80;
+  const uint64 levelOffset = Read64(levelIndex);
+  const uint64 levelSz = Read64(levelIndex + 8);
+  const uint64 uncompressedLevelSz = Read64(levelIndex + 16);
+
+  if(pixelDepth != 0) {
+    fprintf(stderr, "KTX2 loader - 3D textures not supported\n");
+    return false;
+  }
+
+  if(pixelWidth == 0 || pixelHeight == 0) {
+    fprintf(stderr, "KTX2 loader - 1D textures not supported\n");
+    return false;
+  }
+
+  if(faceCount != 1 && faceCount != 6) {
+    fprintf(stderr, "KTX2 loader - unsupported number of faces: %d\n", faceCount);
+    return false;
+  }
+
+  m_Width = pixelWidth;
+  m_Height = pixelHeight;
+
+  uint64 imageSz = static_cast<uint64>(m_Width) * m_Height * 4;
+  if(vkFormat == VK_FORMAT_R8G8B8A8_UNORM) {
+    m_bIsCompressed = false;
+  } else if(GetCompressionFormat(vkFormat, m_Format)) {
+    m_bIsCompressed = true;
+    imageSz = CompressedImage::GetCompressedSize(m_Width, m_Height, m_Format);
+  } else {
+    fprintf(stderr, "KTX2 loader - texture format (%d) unsupported!\n", vkFormat);
+    return false;
+  }
+
+  if(levelOffset > m_NumRawDataBytes || levelSz > m_NumRawDataBytes - levelOffset) {
+    fprintf(stderr, "KTX2 loader - file is truncated\n");
+    return false;
+  }
+
+  const uint8 *levelData = m_RawData + levelOffset;
+  switch(scheme) {
+    case KTX_SS_NONE:
+      if(levelSz < imageSz) {
+        fprintf(stderr, "KTX2 loader - mip level is too small\n");
+        return false;
+      }
+      m_ImageData = levelData;
+      break;
+
+    case KTX_SS_ZLIB:
+      if(uncompressedLevelSz < imageSz) {
+        fprintf(stderr, "KTX2 loader - mip level is too small\n");
+        return false;
+      }
+
+      TCMemory::DeleteArray(GetPixelDataCategory(), m_PixelData, m_PixelDataSz);
+      m_PixelData = TCMemory::NewArray<uint8>(GetPixelDataCategory(), imageSz);
+      m_PixelDataSz = imageSz;
+      if(!InflatePrefix(levelData, levelSz, m_PixelData, imageSz)) {
+        fprintf(stderr, "KTX2 loader - unable to inflate mip level\n");
+        return false;
+      }
+      m_ImageData = m_PixelData;
+      break;
+
+    default:
+      fprintf(stderr, "KTX2 loader - unsupported supercompression scheme: %d\n", scheme);
+      return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,59 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _IO_SRC_IMAGE_LOADER_KTX2_H_
+#define _IO_SRC_IMAGE_LOADER_KTX2_H_
+
+#include "FasTC/ImageLoader.h"
+#include "FasTC/CompressionFormat.h"
+#include "FasTC/Memory.h"
+
+// Loads the first image of a KTX2 file: the largest mip level of the first
+// array element and the first cube face. Levels may be stored as is or zlib
+// supercompressed, in which case only the bytes of that image are inflated.
+class ImageLoaderKTX2 : public ImageLoader {
+ public:
+  ImageLoaderKTX2(const uint8 *rawData, const int32 rawDataSz);
+  virtual ~ImageLoaderKTX2();
+
+  virtual bool ReadData();
+
+  virtual FasTC::RGBA8Image *LoadRGBA8Image();
+  virtual FasTC::Image<> *LoadImage();
+
+  // Compressed levels that aren't supercompressed are wrapped in place, so
+  // the file data must outlive the image returned by LoadImage.
+  virtual bool ImageWrapsRawData() const { return m_bWrapsRawData; }
+ private:
+  bool m_bIsCompressed;
+  bool m_bWrapsRawData;
+  FasTC::ECompressionFormat m_Format;
+
+  // Points at the pixels of the image, either in the raw file data or, for
+  // supercompressed files, in m_PixelData after they've been inflated.
+  const uint8 *m_ImageData;
+
+  // The size of m_PixelData. Inflated compressed blocks are accounted for as
+  // compressed data since LoadImage hands them over to a CompressedImage.
+  uint64 m_PixelDataSz;
+  TCMemory::ECategory GetPixelDataCategory() const {
+    return m_bIsCompressed?
+      TCMemory::eCategory_CompressedData : TCMemory::eCategory_ImageLoading;
+  }
+};
+
+#endif  // _IO_SRC_IMAGE_LOADER_KTX2_H_
@@ -17,6 +17,8 @@
 
 #include "ImageLoaderPNG.h"
 
+#include "FasTC/RGBAImage.h"
+
 #include <algorithm>
 #include <cassert>
 #include <cstdio>
@@ -51,11 +53,26 @@ public:
 ImageLoaderPNG::ImageLoaderPNG(const unsigned char *rawData) 
   : ImageLoader(rawData)
   , m_StreamPosition(8) // We start at position 8 because of PNG header.
+  , m_PNG(NULL)
+  , m_PNGInfo(NULL)
+  , m_NumPasses(0)
 {
 }
 
-bool ImageLoaderPNG::ReadData() {
-  
+ImageLoaderPNG::~ImageLoaderPNG() {
+  DestroyReadStruct();
+}
+
+void ImageLoaderPNG::DestroyReadStruct() {
+  if(m_PNG) {
+    png_destroy_read_struct(&m_PNG, m_PNGInfo? &m_PNGInfo : NULL, NULL);
+    m_PNG = NULL;
+    m_PNGInfo = NULL;
+  }
+}
+
+bool ImageLoaderPNG::ReadHeader() {
+
   const int kNumSigBytesToRead = 8;
   uint8 pngSigBuf[kNumSigBytesToRead];
   memcpy(pngSigBuf, m_RawData, kNumSigBytesToRead);
@@ -66,196 +83,143 @@ bool ImageLoaderPNG::ReadData() {
     return false;
   }
 
-  png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-  if(!png_ptr) {
+  DestroyReadStruct();
+  m_StreamPosition = kNumSigBytesToRead;
+
+  m_PNG = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if(!m_PNG) {
     ReportError("Could not create read struct");
     return false;
   }
 
-  png_infop info_ptr = png_create_info_struct(png_ptr);
-  if(!info_ptr) {
+  m_PNGInfo = png_create_info_struct(m_PNG);
+  if(!m_PNGInfo) {
     ReportError("Could not create info struct");
-    png_destroy_read_struct(&png_ptr, NULL, NULL);
+    DestroyReadStruct();
     return false;
   }
 
   // Read from our buffer, not a file pointer...
-  png_set_read_fn(png_ptr, this, PNGStreamReader::ReadDataFromStream);
+  png_set_read_fn(m_PNG, this, PNGStreamReader::ReadDataFromStream);
 
   // Make sure to tell libpng how many bytes we've read...
-  png_set_sig_bytes(png_ptr, kNumSigBytesToRead);
+  png_set_sig_bytes(m_PNG, kNumSigBytesToRead);
 
-  png_read_info(png_ptr, info_ptr);
+  png_read_info(m_PNG, m_PNGInfo);
 
   int bitDepth = 0;
   int colorType = -1;
 
-  if( 1 != png_get_IHDR(png_ptr, info_ptr, 
+  if( 1 != png_get_IHDR(m_PNG, m_PNGInfo, 
     (png_uint_32 *)(&m_Width), (png_uint_32 *)(&m_Height), 
     &bitDepth, &colorType, 
     NULL, NULL, NULL) 
   ) {
     ReportError("Could not read PNG header");
-    png_destroy_read_struct(&png_ptr, NULL, NULL);
+    DestroyReadStruct();
     return false;
   }
 
-  if(bitDepth != 8) {
-    ReportError("Only 8-bit images currently supported.");
-    png_destroy_read_struct(&png_ptr, NULL, NULL);
-    return false;
+  // Have libpng expand every color type and bit depth to eight bit RGBA so
+  // that each row can be decoded directly into the destination image.
+  if(bitDepth == 16) {
+    png_set_strip_16(m_PNG);
   }
 
-  const int numPixels = m_Width * m_Height;
-  png_size_t bpr = png_get_rowbytes(png_ptr, info_ptr);
-  png_bytep rowData = new png_byte[bpr];
-
   switch(colorType) {
+    case PNG_COLOR_TYPE_PALETTE:
+      png_set_palette_to_rgb(m_PNG);
+      break;
+
+    case PNG_COLOR_TYPE_GRAY:
+    case PNG_COLOR_TYPE_GRAY_ALPHA:
+      if(bitDepth < 8) {
+        png_set_expand_gray_1_2_4_to_8(m_PNG);
+      }
+      png_set_gray_to_rgb(m_PNG);
+      break;
+
+    case PNG_COLOR_TYPE_RGB:
+    case PNG_COLOR_TYPE_RGB_ALPHA:
+      break;
+
     default:
       ReportError("PNG color type unsupported");
-      png_destroy_read_struct(&png_ptr, NULL, NULL);
-      delete [] rowData;
+      DestroyReadStruct();
       return false;
+  }
 
-    case PNG_COLOR_TYPE_PALETTE:
-    {
-      m_RedChannelPrecision = bitDepth;
-      m_RedData = new unsigned char[numPixels];
-      m_GreenChannelPrecision = bitDepth;
-      m_GreenData = new unsigned char[numPixels];
-      m_BlueChannelPrecision = bitDepth;
-      m_BlueData = new unsigned char[numPixels];
-
-      png_colorp palette;
-      int nPaletteEntries;
-      png_uint_32 ret = png_get_PLTE(png_ptr, info_ptr, &palette, &nPaletteEntries);
-      if(ret != PNG_INFO_PLTE) {
-        memset(m_BlueData, 0, numPixels);
-        memset(m_RedData, 0, numPixels);
-        memset(m_GreenData, 0, numPixels);
-        assert(!"Couldn't find PLTE chunk");
-        break;
-      }
+  // Opaque images get an alpha channel of 0xFF.
+  png_set_filler(m_PNG, 0xFF, PNG_FILLER_AFTER);
 
-      for(uint32 i = 0; i < m_Height; i++) {
-        png_read_row(png_ptr, rowData, NULL);
-        unsigned int rowOffset = i * m_Width;
-        for(uint32 j = 0; j < m_Width; j++) {
-          assert(rowData[j] < nPaletteEntries);
-          const png_color &c = palette[::std::min<unsigned char>(rowData[j], nPaletteEntries - 1)];
-          m_RedData[rowOffset + j] = c.red;
-          m_GreenData[rowOffset + j] = c.green;
-          m_BlueData[rowOffset + j] = c.blue;
-        }
-      }
-    }
-    break;
-
-    case PNG_COLOR_TYPE_GRAY: {
-      m_RedChannelPrecision = bitDepth;
-      m_RedData = new unsigned char[numPixels];
-      m_GreenChannelPrecision = bitDepth;
-      m_GreenData = new unsigned char[numPixels];
-      m_BlueChannelPrecision = bitDepth;
-      m_BlueData = new unsigned char[numPixels];
-
-      for(uint32 i = 0; i < m_Height; i++) {
-  
-        png_read_row(png_ptr, rowData, NULL);
-
-        unsigned int rowOffset = i * m_Width;
-  
-        unsigned int byteIdx = 0;
-        for(uint32 j = 0; j < m_Width; j++) {
-          m_RedData[rowOffset + j] = rowData[byteIdx];
-          m_GreenData[rowOffset + j] = rowData[byteIdx];
-          m_BlueData[rowOffset + j] = rowData[byteIdx];
-          byteIdx++;
-        }
-
-        assert(byteIdx == bpr);
-      }
-    }
-    break;
+  m_NumPasses = png_set_interlace_handling(m_PNG);
+  png_read_update_info(m_PNG, m_PNGInfo);
 
-    case PNG_COLOR_TYPE_RGB:
-      m_RedChannelPrecision = bitDepth;
-      m_RedData = new unsigned char[numPixels];
-      m_GreenChannelPrecision = bitDepth;
-      m_GreenData = new unsigned char[numPixels];
-      m_BlueChannelPrecision = bitDepth;
-      m_BlueData = new unsigned char[numPixels];
-
-      for(uint32 i = 0; i < m_Height; i++) {
-  
-        png_read_row(png_ptr, rowData, NULL);
-
-        unsigned int rowOffset = i * m_Width;
-  
-        unsigned int byteIdx = 0;
-        for(uint32 j = 0; j < m_Width; j++) {
-          m_RedData[rowOffset + j] = rowData[byteIdx++];
-          m_GreenData[rowOffset + j] = rowData[byteIdx++];
-          m_BlueData[rowOffset + j] = rowData[byteIdx++];
-        }
-
-        assert(byteIdx == bpr);
-      }
-    break;
+  if(png_get_rowbytes(m_PNG, m_PNGInfo) != m_Width * 4) {
+    ReportError("Unexpected row size after expanding to RGBA8");
+    DestroyReadStruct();
+    return false;
+  }
 
-    case PNG_COLOR_TYPE_RGB_ALPHA:
-      m_RedChannelPrecision = bitDepth;
-      m_RedData = new unsigned char[numPixels];
-      m_GreenChannelPrecision = bitDepth;
-      m_GreenData = new unsigned char[numPixels];
-      m_BlueChannelPrecision = bitDepth;
-      m_BlueData = new unsigned char[numPixels];
-      m_AlphaChannelPrecision = bitDepth;
-      m_AlphaData = new unsigned char[numPixels];
-
-      for(uint32 i = 0; i < m_Height; i++) {
-  
-        png_read_row(png_ptr, rowData, NULL);
-
-        unsigned int rowOffset = i * m_Width;
-  
-        unsigned int byteIdx = 0;
-        for(uint32 j = 0; j < m_Width; j++) {
-          m_RedData[rowOffset + j] = rowData[byteIdx++];
-          m_GreenData[rowOffset + j] = rowData[byteIdx++];
-          m_BlueData[rowOffset + j] = rowData[byteIdx++];
-          m_AlphaData[rowOffset + j] = rowData[byteIdx++];
-        }
-
-        assert(byteIdx == bpr);
-      }
-    break;
+  return true;
+}
 
-    case PNG_COLOR_TYPE_GRAY_ALPHA:
-      m_RedChannelPrecision = bitDepth;
-      m_RedData = new unsigned char[numPixels];
-      m_AlphaChannelPrecision = bitDepth;
-      m_AlphaData = new unsigned char[numPixels];
-
-      for(uint32 i = 0; i < m_Height; i++) {
-  
-        png_read_row(png_ptr, rowData, NULL);
-
-        unsigned int rowOffset = i * m_Width;
-  
-        unsigned int byteIdx = 0;
-        for(uint32 j = 0; j < m_Width; j++) {
-          m_RedData[rowOffset + j] = rowData[byteIdx++];
-          m_AlphaData[rowOffset + j] = rowData[byteIdx++];
-        }
-
-        assert(byteIdx == bpr);
-      }
-    break;
+void ImageLoaderPNG::ReadAllRows() {
+  delete m_RGBA8Data;
+  m_RGBA8Data = new FasTC::RGBA8Image(m_Width, m_Height);
+
+  for(int pass = 0; pass < m_NumPasses; pass++) {
+    for(uint32 j = 0; j < m_Height; j++) {
+      png_read_row(m_PNG, m_RGBA8Data->GetRow(j), NULL);
+    }
+  }
+}
+
+bool ImageLoaderPNG::ReadData() {
+  if(!ReadHeader()) {
+    return false;
   }
 
+  ReadAllRows();
+
   // Cleanup
-  delete [] rowData;
-  png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+  DestroyReadStruct();
+  return true;
+}
+
+bool ImageLoaderPNG::BeginReadingRows() {
+  if(!ReadHeader()) {
+    return false;
+  }
+
+  m_NextRow = 0;
+  if(m_NumPasses > 1) {
+    ReadAllRows();
+    DestroyReadStruct();
+  }
+
+  return true;
+}
+
+bool ImageLoaderPNG::ReadRows(uint8 *rows, uint32 nRows) {
+  // Interlaced images were already decoded in full.
+  if(m_RGBA8Data) {
+    return ImageLoader::ReadRows(rows, nRows);
+  }
+
+  if(!m_PNG || nRows > m_Height - m_NextRow) {
+    return false;
+  }
+
+  const uint32 rowSz = m_Width * 4;
+  for(uint32 j = 0; j < nRows; j++) {
+    png_read_row(m_PNG, rows + j * rowSz, NULL);
+  }
+
+  m_NextRow += nRows;
+  if(m_NextRow == m_Height) {
+    DestroyReadStruct();
+  }
+
   return true;
 }
@@ -20,16 +20,38 @@
 
 #include "FasTC/ImageLoader.h"
 
+// Forward declare libpng's types so that users don't need its headers.
+struct png_struct_def;
+struct png_info_def;
+
 class ImageLoaderPNG : public ImageLoader {
  public:
   ImageLoaderPNG(const unsigned char *rawData);
-  virtual ~ImageLoaderPNG() { }
+  virtual ~ImageLoaderPNG();
 
   virtual bool ReadData();
 
+  // Non-interlaced images are decoded one row at a time as ReadRows asks
+  // for them. Interlaced images don't have any finished rows until the last
+  // pass, so they are decoded in full by BeginReadingRows.
+  virtual bool BeginReadingRows();
+  virtual bool ReadRows(uint8 *rows, uint32 nRows);
+
 private:
   uint64 m_StreamPosition;
   friend class PNGStreamReader;
+
+  png_struct_def *m_PNG;
+  png_info_def *m_PNGInfo;
+  int m_NumPasses;
+
+  // Reads the header and sets up libpng to expand every row to RGBA8.
+  bool ReadHeader();
+
+  // Decodes every pass of the image into m_RGBA8Data.
+  void ReadAllRows();
+
+  void DestroyReadStruct();
 };
 
 #endif // _IMAGE_LOADER_H_
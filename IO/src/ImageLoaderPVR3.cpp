@@ -0,0 +1,246 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "ImageLoaderPVR3.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "FasTC/Image.h"
+#include "FasTC/TexCompTypes.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/RGBAImage.h"
+
+#include "PVRDefines.h"
+
+static uint32 Read32(const uint8 *data) {
+  return static_cast<uint32>(data[0]) | (static_cast<uint32>(data[1]) << 8) |
+    (static_cast<uint32>(data[2]) << 16) | (static_cast<uint32>(data[3]) << 24);
+}
+
+// Returns the compression format for the PVR pixel format, or false if
+// FasTC doesn't support it.
+static bool GetCompressionFormat(uint32 pvrFormat, FasTC::ECompressionFormat &fmt) {
+  switch(pvrFormat) {
+    case PVR3_BC7:
+      fmt = FasTC::eCompressionFormat_BPTC;
+      return true;
+
+    case PVR3_PVRTC_2BPP_RGB:
+    case PVR3_PVRTC_2BPP_RGBA:
+      fmt = FasTC::eCompressionFormat_PVRTC2;
+      return true;
+
+    case PVR3_PVRTC_4BPP_RGB:
+    case PVR3_PVRTC_4BPP_RGBA:
+      fmt = FasTC::eCompressionFormat_PVRTC4;
+      return true;
+
+    case PVR3_DXT1:
+      fmt = FasTC::eCompressionFormat_DXT1;
+      return true;
+
+    case PVR3_DXT5:
+      fmt = FasTC::eCompressionFormat_DXT5;
+      return true;
+
+    case PVR3_ETC1:
+      fmt = FasTC::eCompressionFormat_ETC1;
+      return true;
+
+    case PVR3_ASTC_4x4:
+      fmt = FasTC::eCompressionFormat_ASTC4x4;
+      return true;
+
+    case PVR3_ASTC_5x4:
+      fmt = FasTC::eCompressionFormat_ASTC5x4;
+      return true;
+
+    case PVR3_ASTC_5x5:
+      fmt = FasTC::eCompressionFormat_ASTC5x5;
+      return true;
+
+    case PVR3_ASTC_6x5:
+      fmt = FasTC::eCompressionFormat_ASTC6x5;
+      return true;
+
+    case PVR3_ASTC_6x6:
+      fmt = FasTC::eCompressionFormat_ASTC6x6;
+      return true;
+
+    case PVR3_ASTC_8x5:
+      fmt = FasTC::eCompressionFormat_ASTC8x5;
+      return true;
+
+    case PVR3_ASTC_8x6:
+      fmt = FasTC::eCompressionFormat_ASTC8x6;
+      return true;
+
+    case PVR3_ASTC_8x8:
+      fmt = FasTC::eCompressionFormat_ASTC8x8;
+      return true;
+
+    case PVR3_ASTC_10x5:
+      fmt = FasTC::eCompressionFormat_ASTC10x5;
+      return true;
+
+    case PVR3_ASTC_10x6:
+      fmt = FasTC::eCompressionFormat_ASTC10x6;
+      return true;
+
+    case PVR3_ASTC_10x8:
+      fmt = FasTC::eCompressionFormat_ASTC10x8;
+      return true;
+
+    case PVR3_ASTC_10x10:
+      fmt = FasTC::eCompressionFormat_ASTC10x10;
+      return true;
+
+    case PVR3_ASTC_12x10:
+      fmt = FasTC::eCompressionFormat_ASTC12x10;
+      return true;
+
+    case PVR3_ASTC_12x12:
+      fmt = FasTC::eCompressionFormat_ASTC12x12;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+ImageLoaderPVR3::ImageLoaderPVR3(const uint8 *rawData, const int32 rawDataSz)
+  : ImageLoader(rawData, rawDataSz)
+  , m_bIsCompressed(false), m_Format(FasTC::kNumCompressionFormats)
+  , m_ImageData(NULL)
+{ }
+
+ImageLoaderPVR3::~ImageLoaderPVR3() { }
+
+bool ImageLoaderPVR3::IsPVR3(const uint8 *rawData, const int32 rawDataSz) {
+  return rawDataSz >= PVR3_HEADER_SIZE && Read32(rawData) == PVR3_VERSION;
+}
+
+FasTC::RGBA8Image *ImageLoaderPVR3::LoadRGBA8Image() {
+  if(!ReadData()) {
+    return NULL;
+  }
+
+  if(!m_bIsCompressed) {
+    return new FasTC::RGBA8Image(m_Width, m_Height, m_ImageData);
+  }
+
+  CompressedImage ci(m_Width, m_Height, m_Format, m_ImageData,
+                     CompressedImage::eWrapData);
+
+  FasTC::RGBA8Image *img = new FasTC::RGBA8Image;
+  if(!ci.DecompressImage(img)) {
+    delete img;
+    return NULL;
+  }
+  return img;
+}
+
+FasTC::Image<> *ImageLoaderPVR3::LoadImage() {
+  if(!ReadData()) {
+    return NULL;
+  }
+
+  if(!m_bIsCompressed) {
+    const uint32 *pixels = reinterpret_cast<const uint32 *>(m_ImageData);
+    return new FasTC::Image<>(m_Width, m_Height, pixels);
+  }
+
+  return new CompressedImage(m_Width, m_Height, m_Format, m_ImageData,
+                             CompressedImage::eWrapData);
+}
+
+bool ImageLoaderPVR3::ReadData() {
+
+  if(!IsPVR3(m_RawData, m_NumRawDataBytes)) {
+    fprintf(stderr, "PVR loader - not a version 3 PVR file\n");
+    return false;
+  }
+
+  const uint32 formatLow = Read32(m_RawData + 8);
+  const uint32 formatHigh = Read32(m_RawData + 12);
+  const uint32 channelType = Read32(m_RawData + 20);
+  const uint32 height = Read32(m_RawData + 24);
+  const uint32 width = Read32(m_RawData + 28);
+  const uint32 depth = Read32(m_RawData + 32);
+  const uint32 numSurfaces = std::max<uint32>(1, Read32(m_RawData + 36));
+  const uint32 numFaces = std::max<uint32>(1, Read32(m_RawData + 40));
+  const uint32 numLevelsInFile = std::max<uint32>(1, Read32(m_RawData + 44));
+  const uint32 metaDataSz = Read32(m_RawData + 48);
+
+  if(width == 0 || height == 0) {
+    fprintf(stderr, "PVR loader - 1D textures not supported\n");
+    return false;
+  }
+
+  if(depth > 1) {
+    fprintf(stderr, "PVR loader - 3D textures not supported\n");
+    return false;
+  }
+
+  if(formatHigh == 0) {
+    if(!GetCompressionFormat(formatLow, m_Format)) {
+      fprintf(stderr, "PVR loader - pixel format (%d) unsupported!\n", formatLow);
+      return false;
+    }
+    m_bIsCompressed = true;
+  } else if(formatLow == PVR3_RGBA8_CHANNELS && formatHigh == PVR3_RGBA8_BITS &&
+            channelType == PVR3_CHANNEL_TYPE_UBYTE_NORM) {
+    m_bIsCompressed = false;
+  } else {
+    fprintf(stderr, "PVR loader - uncompressed pixel format unsupported!\n");
+    return false;
+  }
+
+  // Only the levels down to 1x1 matter, and shifting the size by 32 or
+  // more bits to find the size of any past those is undefined.
+  const uint32 numLevels = std::min(numLevelsInFile, GetMaxNumMipLevels(width, height));
+
+  m_Width = width;
+  m_Height = height;
+
+  const uint64 headerSz = static_cast<uint64>(PVR3_HEADER_SIZE) + metaDataSz;
+  if(headerSz > m_NumRawDataBytes) {
+    fprintf(stderr, "PVR loader - file is truncated\n");
+    return false;
+  }
+
+  // Make sure that every image in the file is there, even though only the
+  // first one is loaded.
+  uint64 levelsSz = 0;
+  for(uint32 l = 0; l < numLevels; l++) {
+    const uint32 w = std::max<uint32>(1, width >> l);
+    const uint32 h = std::max<uint32>(1, height >> l);
+    levelsSz += m_bIsCompressed?
+      CompressedImage::GetCompressedSize(w, h, m_Format) :
+      static_cast<uint64>(w) * h * 4;
+  }
+
+  const uint64 bytesLeft = m_NumRawDataBytes - headerSz;
+  if(levelsSz * numFaces > bytesLeft / numSurfaces) {
+    fprintf(stderr, "PVR loader - file is truncated\n");
+    return false;
+  }
+
+  m_ImageData = m_RawData + headerSz;
+  return true;
+}
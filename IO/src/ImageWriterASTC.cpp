@@ -0,0 +1,76 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "ImageWriterASTC.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "FasTC/Image.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/CompressionFormat.h"
+
+// The header stores these little endian, in three bytes each.
+static uint8 *WriteThreeWideInt(uint8 *dst, uint32 v) {
+  dst[0] = static_cast<uint8>(v);
+  dst[1] = static_cast<uint8>(v >> 8);
+  dst[2] = static_cast<uint8>(v >> 16);
+  return dst + 3;
+}
+
+ImageWriterASTC::ImageWriterASTC(FasTC::Image<> &im)
+  : ImageWriter(im.GetWidth(), im.GetHeight(), NULL)
+  , m_Image(im)
+{ }
+
+bool ImageWriterASTC::WriteImage() {
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(&m_Image);
+  if(!ci || ci->GetFormat() < FasTC::COMPRESSION_FORMAT_ASTC_BEGIN ||
+     ci->GetFormat() > FasTC::COMPRESSION_FORMAT_ASTC_END) {
+    fprintf(stderr, "ASTC writer - only ASTC compressed images can be written\n");
+    return false;
+  }
+
+  if(m_Width > 0xFFFFFF || m_Height > 0xFFFFFF) {
+    fprintf(stderr, "ASTC writer - image is too large\n");
+    return false;
+  }
+
+  uint32 blockDims[2];
+  FasTC::GetBlockDimensions(ci->GetFormat(), blockDims);
+
+  const uint64 kHeaderSz = 16;
+  const uint64 dataSz = ci->GetCompressedSize();
+
+  AllocateRawFileData(kHeaderSz + dataSz);
+
+  uint8 *dst = m_RawFileData;
+  const uint8 kMagic[4] = { 0x13, 0xAB, 0xA1, 0x5C };
+  memcpy(dst, kMagic, 4);
+  dst += 4;
+
+  *dst++ = static_cast<uint8>(blockDims[0]);
+  *dst++ = static_cast<uint8>(blockDims[1]);
+  *dst++ = 1;  // block depth
+
+  dst = WriteThreeWideInt(dst, m_Width);
+  dst = WriteThreeWideInt(dst, m_Height);
+  dst = WriteThreeWideInt(dst, 1);  // depth
+
+  memcpy(dst, ci->GetCompressedData(), dataSz);
+  return true;
+}
@@ -15,28 +15,23 @@
 // Please send all BUG REPORTS to <pavel@cs.unc.edu>.
 // <http://gamma.cs.unc.edu/FasTC/>
 
-#ifndef CORE_INCLUDE_THREADSAFESTREAMBUF_H_
-#define CORE_INCLUDE_THREADSAFESTREAMBUF_H_
+#ifndef _IO_SRC_IMAGE_WRITER_ASTC_H_
+#define _IO_SRC_IMAGE_WRITER_ASTC_H_
 
-// Forward Declarations
-class TCMutex;
+#include "FasTC/ImageWriter.h"
+#include "FasTC/ImageFwd.h"
 
-#include <streambuf>
-#include <iosfwd>
-
-class ThreadSafeStreambuf : public ::std::streambuf {
+// Writes the .astc files read by ImageLoaderASTC: a 16 byte header followed
+// by the blocks of a single ASTC compressed image.
+class ImageWriterASTC : public ImageWriter {
  public:
-  ThreadSafeStreambuf(std::ostream &sink);
-  virtual ~ThreadSafeStreambuf();
+  ImageWriterASTC(FasTC::Image<> &);
+  virtual ~ImageWriterASTC() { }
+
+  virtual bool WriteImage();
 
- protected:
-  virtual std::streamsize xsputn(const char_type *s, std::streamsize count);
  private:
-  // Not implemented -- not allowed...
-  ThreadSafeStreambuf(const ThreadSafeStreambuf &);
-  ThreadSafeStreambuf &operator=(const ThreadSafeStreambuf &);
-  std::ostream &m_Sink;
-  TCMutex *m_Mutex;
+  const FasTC::Image<> &m_Image;
 };
 
-#endif  // CORE_INCLUDE_THREADSAFESTREAMBUF_H_
+#endif  // _IO_SRC_IMAGE_WRITER_ASTC_H_
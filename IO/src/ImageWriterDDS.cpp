@@ -0,0 +1,157 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "ImageWriterDDS.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include "FasTC/Image.h"
+#include "FasTC/CompressedImage.h"
+
+#include "DDSDefines.h"
+
+// DDS files are always little endian.
+static uint8 *Write32(uint8 *dst, uint32 v) {
+  for(uint32 i = 0; i < 4; i++) {
+    dst[i] = static_cast<uint8>(v >> (8 * i));
+  }
+  return dst + 4;
+}
+
+// Returns the DXGI format that holds the image, or false if DDS can't.
+static bool GetDXGIFormat(const FasTC::Image<> &img, uint32 &dxgiFormat) {
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(&img);
+  if(!ci) {
+    dxgiFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+    return true;
+  }
+
+  switch(ci->GetFormat()) {
+    case FasTC::eCompressionFormat_DXT1:
+      dxgiFormat = DXGI_FORMAT_BC1_UNORM;
+      return true;
+
+    case FasTC::eCompressionFormat_DXT5:
+      dxgiFormat = DXGI_FORMAT_BC3_UNORM;
+      return true;
+
+    case FasTC::eCompressionFormat_BPTC:
+      dxgiFormat = DXGI_FORMAT_BC7_UNORM;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool ImageWriterDDS::WriteImage() {
+  if(!CheckImages("DDS")) {
+    return false;
+  }
+
+  uint32 dxgiFormat;
+  if(!GetDXGIFormat(*m_Images[0], dxgiFormat)) {
+    const CompressedImage *ci = dynamic_cast<const CompressedImage *>(m_Images[0]);
+    fprintf(stderr, "Unsupported DDS compressed format: %d\n", ci->GetFormat());
+    return false;
+  }
+
+  const bool bCompressed = dxgiFormat != DXGI_FORMAT_R8G8B8A8_UNORM;
+  const bool bCubeMap = m_NumFaces == 6;
+  const bool bMipMapped = m_NumLevels > 1;
+
+  const uint64 kHeaderSz = 4 + DDS_HEADER_SIZE + DDS_HEADER_DXT10_SIZE;
+  uint64 fileSz = kHeaderSz;
+  for(uint32 i = 0; i < m_Images.size(); i++) {
+    fileSz += GetImageDataSize(*m_Images[i]);
+  }
+
+  const uint64 topLevelSz = GetImageDataSize(*m_Images[0]);
+  if(topLevelSz > 0xFFFFFFFFULL) {
+    fprintf(stderr, "DDS writer - image is too large\n");
+    return false;
+  }
+
+  AllocateRawFileData(fileSz);
+
+  uint8 *dst = m_RawFileData;
+  dst = Write32(dst, DDS_MAGIC);
+
+  // DDS_HEADER
+  uint32 flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT;
+  flags |= bCompressed? DDSD_LINEARSIZE : DDSD_PITCH;
+  if(bMipMapped) {
+    flags |= DDSD_MIPMAPCOUNT;
+  }
+
+  uint32 caps = DDSCAPS_TEXTURE;
+  if(bMipMapped) {
+    caps |= DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+  }
+  if(bCubeMap || m_NumArrayElements > 0) {
+    caps |= DDSCAPS_COMPLEX;
+  }
+
+  dst = Write32(dst, DDS_HEADER_SIZE);
+  dst = Write32(dst, flags);
+  dst = Write32(dst, m_Height);
+  dst = Write32(dst, m_Width);
+  dst = Write32(dst, bCompressed? static_cast<uint32>(topLevelSz) : m_Width * 4);
+  dst = Write32(dst, 0);  // dwDepth
+  dst = Write32(dst, m_NumLevels);
+  memset(dst, 0, 11 * 4);  // dwReserved1
+  dst += 11 * 4;
+
+  // DDS_PIXELFORMAT: everything is described by the DX10 header.
+  dst = Write32(dst, DDS_PIXELFORMAT_SIZE);
+  dst = Write32(dst, DDPF_FOURCC);
+  dst = Write32(dst, DDS_FOURCC_DX10);
+  memset(dst, 0, 5 * 4);  // dwRGBBitCount and the bit masks
+  dst += 5 * 4;
+
+  dst = Write32(dst, caps);
+  dst = Write32(dst, bCubeMap? DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_ALLFACES : 0);
+  dst = Write32(dst, 0);  // dwCaps3
+  dst = Write32(dst, 0);  // dwCaps4
+  dst = Write32(dst, 0);  // dwReserved2
+
+  // DDS_HEADER_DXT10. For cube maps, the array size counts whole cubes.
+  dst = Write32(dst, dxgiFormat);
+  dst = Write32(dst, DDS_DIMENSION_TEXTURE2D);
+  dst = Write32(dst, bCubeMap? DDS_RESOURCE_MISC_TEXTURECUBE : 0);
+  dst = Write32(dst, std::max<uint32>(1, m_NumArrayElements));
+  dst = Write32(dst, 0);  // miscFlags2
+
+  assert(dst == m_RawFileData + kHeaderSz);
+
+  // The images are given by mip level first, but DDS stores the whole mip
+  // chain of each array element and face together.
+  const uint32 imagesPerLevel = GetImagesPerLevel();
+  for(uint32 i = 0; i < imagesPerLevel; i++) {
+    for(uint32 l = 0; l < m_NumLevels; l++) {
+      const FasTC::Image<> &img = *m_Images[l * imagesPerLevel + i];
+      CopyImageData(img, dst);
+      dst += GetImageDataSize(img);
+    }
+  }
+
+  assert(dst == m_RawFileData + m_RawFileDataSz);
+  return true;
+}
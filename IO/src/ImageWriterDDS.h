@@ -0,0 +1,42 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _IO_SRC_IMAGE_WRITER_DDS_H_
+#define _IO_SRC_IMAGE_WRITER_DDS_H_
+
+#include "ImageWriterTexture.h"
+
+// Writes DDS files with the DX10 extended header. BC1 (DXT1), BC3 (DXT5)
+// and BC7 (BPTC) blocks are written as is, and uncompressed images as
+// R8G8B8A8. Texture objects may have mip chains, arrays and cube maps.
+class ImageWriterDDS : public ImageWriterTexture {
+ public:
+  ImageWriterDDS(FasTC::Image<> &im) : ImageWriterTexture(im) { }
+
+  // Takes the same texture objects as ImageWriterKTX. DDS stores every mip
+  // chain together, so they are reordered when the file is written.
+  ImageWriterDDS(const FasTC::Image<> *const *images, uint32 numLevels,
+                 uint32 numArrayElements, uint32 numFaces)
+    : ImageWriterTexture(images, numLevels, numArrayElements, numFaces)
+  { }
+
+  virtual ~ImageWriterDDS() { }
+
+  virtual bool WriteImage();
+};
+
+#endif  // _IO_SRC_IMAGE_WRITER_DDS_H_
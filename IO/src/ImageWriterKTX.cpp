@@ -17,6 +17,8 @@
 
 #include "ImageWriterKTX.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
@@ -29,51 +31,169 @@
 #include "GLDefines.h"
 
 ImageWriterKTX::ImageWriterKTX(FasTC::Image<> &im)
-  : ImageWriter(im.GetWidth(), im.GetHeight(), NULL)
-  , m_Image(im)
+  : ImageWriterTexture(im)
 { }
 
+ImageWriterKTX::ImageWriterKTX(const FasTC::Image<> *const *images,
+                               uint32 numLevels, uint32 numArrayElements,
+                               uint32 numFaces)
+  : ImageWriterTexture(images, numLevels, numArrayElements, numFaces)
+{ }
+
+// Writes into a buffer that was allocated with exactly enough room for
+// everything that will be written to it.
 class ByteWriter {
  private:
-  uint8 *m_Base;
   uint8 *m_Head;
-  uint32 m_BytesWritten;
-  uint32 m_BufferSz;
+  const uint8 *const m_End;
  public:
-  ByteWriter(uint8 *dst, uint32 sz)
-  : m_Base(dst), m_Head(dst), m_BytesWritten(0), m_BufferSz(dst? sz : 0) { }
-
-  uint8 *GetBytes() const { return m_Base; }
-  uint32 GetBytesWritten() const { return m_BytesWritten; }
-
-  void Write(const void *src, const uint32 nBytes) {
-    while(m_BytesWritten + nBytes > m_BufferSz) {
-      m_BufferSz <<= 1;
-      uint8 *newBuffer = new uint8[m_BufferSz];
-      memcpy(newBuffer, m_Base, m_BytesWritten);
-      delete [] m_Base;
-      m_Base = newBuffer;
-      m_Head = m_Base + m_BytesWritten;
-    }
+  ByteWriter(uint8 *dst, uint64 sz) : m_Head(dst), m_End(dst + sz) { }
 
+  bool IsFull() const { return m_Head == m_End; }
+
+  void Write(const void *src, const uint64 nBytes) {
+    assert(nBytes <= static_cast<uint64>(m_End - m_Head));
     memcpy(m_Head, src, nBytes);
     m_Head += nBytes;
-    m_BytesWritten += nBytes;
   }
 
   void Write(const uint32 v) {
     Write(&v, 4);
   }
+
+  // Skips over nBytes and returns where they start, so that they can be
+  // filled in directly.
+  uint8 *Reserve(const uint64 nBytes) {
+    assert(nBytes <= static_cast<uint64>(m_End - m_Head));
+    uint8 *ret = m_Head;
+    m_Head += nBytes;
+    return ret;
+  }
+
+  void WritePadding(const uint64 nBytes) {
+    assert(nBytes <= static_cast<uint64>(m_End - m_Head));
+    memset(m_Head, 0, nBytes);
+    m_Head += nBytes;
+  }
 };
 
+// Returns the OpenGL internal format and base internal format for the
+// compression format, or false if there isn't one.
+static bool GetGLFormat(FasTC::ECompressionFormat fmt,
+                        uint32 &internalFormat, uint32 &baseFormat) {
+  baseFormat = GL_RGBA;
+  switch(fmt) {
+    case FasTC::eCompressionFormat_BPTC:
+      internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+      return true;
+
+    case FasTC::eCompressionFormat_PVRTC2:
+      internalFormat = GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG;
+      return true;
+
+    case FasTC::eCompressionFormat_PVRTC4:
+      internalFormat = GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG;
+      return true;
+
+    case FasTC::eCompressionFormat_DXT1:
+      internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+      baseFormat = GL_RGB;
+      return true;
+
+    case FasTC::eCompressionFormat_DXT5:
+      internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+      return true;
+
+    case FasTC::eCompressionFormat_ETC1:
+      internalFormat = GL_ETC1_RGB8_OES;
+      baseFormat = GL_RGB;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC4x4:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_4x4_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC5x4:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_5x4_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC5x5:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_5x5_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC6x5:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_6x5_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC6x6:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_6x6_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x5:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_8x5_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x6:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_8x6_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x8:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_8x8_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x5:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_10x5_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x6:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_10x6_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x8:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_10x8_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x10:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_10x10_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC12x10:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_12x10_KHR;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC12x12:
+      internalFormat = GL_COMPRESSED_RGBA_ASTC_12x12_KHR;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// KTX pads a few things out to a multiple of four bytes.
+static uint64 PaddingToFour(uint64 sz) {
+  return (4 - (sz & 3)) & 3;
+}
+
 bool ImageWriterKTX::WriteImage() {
-  ByteWriter wtr (m_RawFileData, m_RawFileDataSz);
+  if(!CheckImages("KTX")) {
+    return false;
+  }
 
-  const uint8 kIdentifier[12] = {
-    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
-  };
-  wtr.Write(kIdentifier, 12);
-  wtr.Write(0x04030201);
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(m_Images[0]);
+
+  uint32 glType = GL_UNSIGNED_BYTE;
+  uint32 glFormat = GL_RGBA;
+  uint32 glInternalFormat = GL_RGBA8;
+  uint32 glBaseFormat = GL_RGBA;
+  if(ci) {
+    glType = 0;
+    glFormat = 0;  // glFormat must be zero for compressed images...
+    if(!GetGLFormat(ci->GetFormat(), glInternalFormat, glBaseFormat)) {
+      fprintf(stderr, "Unsupported KTX compressed format: %d\n", ci->GetFormat());
+      return false;
+    }
+  }
 
   const char *orientationKey = "KTXorientation";
   uint32 oKeyLen = static_cast<uint32>(strlen(orientationKey));
@@ -85,77 +205,92 @@ bool ImageWriterKTX::WriteImage() {
   uint32 tkvSz = kvSz + 4; // total kv size
   tkvSz = (tkvSz + 3) & ~0x3; // 4-byte aligned
 
-  CompressedImage *ci = dynamic_cast<CompressedImage *>(&m_Image);
-  if(ci) {
-    wtr.Write(0);  // glType
-    wtr.Write(1);  // glTypeSize
-    wtr.Write(0);  // glFormat must be zero for compressed images...
-    switch(ci->GetFormat()) {
-    case FasTC::eCompressionFormat_BPTC:
-      wtr.Write(GL_COMPRESSED_RGBA_BPTC_UNORM);  // glInternalFormat
-      wtr.Write(GL_RGBA);  // glBaseFormat
-      break;
-
-    case FasTC::eCompressionFormat_PVRTC4:
-      wtr.Write(GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG);  // glInternalFormat
-      wtr.Write(GL_RGBA);  // glBaseFormat
-      break;
+  // Non-array cube maps pad every face and give the size of a single face
+  // for each level. Everything else gives the size of the whole level.
+  const bool bCubePadding = m_NumFaces == 6 && m_NumArrayElements == 0;
+  const uint32 imagesPerLevel = GetImagesPerLevel();
 
-    case FasTC::eCompressionFormat_DXT1:
-      wtr.Write(GL_COMPRESSED_RGB_S3TC_DXT1_EXT);  // glInternalFormat
-      wtr.Write(GL_RGB);  // glBaseFormat
-      break;
+  // Figure out exactly how big the file is going to be, so that it can be
+  // written into a single allocation.
+  const uint64 kHeaderSz = 64;
+  uint64 fileSz = kHeaderSz + tkvSz;
+  for(uint32 i = 0; i < m_Images.size(); i++) {
+    if(i % imagesPerLevel == 0) {
+      fileSz += 4;  // imageSize
+    }
 
-    case FasTC::eCompressionFormat_DXT5:
-      wtr.Write(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);  // glInternalFormat
-      wtr.Write(GL_RGBA);  // glBaseFormat
-      break;
+    const uint64 sz = GetImageDataSize(*m_Images[i]);
+    fileSz += sz + (bCubePadding? PaddingToFour(sz) : 0);
 
-    default:
-      fprintf(stderr, "Unsupported KTX compressed format: %d\n", ci->GetFormat());
-      m_RawFileData = wtr.GetBytes();
-      m_RawFileDataSz = wtr.GetBytesWritten();
-      return false;
+    if(i % imagesPerLevel == imagesPerLevel - 1) {
+      fileSz += PaddingToFour(fileSz);  // mipPadding
     }
-  } else {
-    wtr.Write(GL_BYTE);  // glType
-    wtr.Write(1);  // glTypeSize
-    wtr.Write(GL_RGBA);  // glFormat
-    wtr.Write(GL_RGBA8);  // glInternalFormat
-    wtr.Write(GL_RGBA);  // glBaseFormat
   }
 
+  AllocateRawFileData(fileSz);
+
+  ByteWriter wtr (m_RawFileData, m_RawFileDataSz);
+
+  const uint8 kIdentifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+  };
+  wtr.Write(kIdentifier, 12);
+  wtr.Write(0x04030201);
+
+  wtr.Write(glType);
+  wtr.Write(1);  // glTypeSize
+  wtr.Write(glFormat);
+  wtr.Write(glInternalFormat);
+  wtr.Write(glBaseFormat);
+
   wtr.Write(m_Width);  // pixelWidth
   wtr.Write(m_Height); // pixelHeight
   wtr.Write(0);        // pixelDepth
-  wtr.Write(0);        // numberOfArrayElements
-  wtr.Write(1);        // numberOfFaces
-  wtr.Write(1);        // numberOfMipmapLevels
+  wtr.Write(m_NumArrayElements);  // numberOfArrayElements
+  wtr.Write(m_NumFaces);          // numberOfFaces
+  wtr.Write(m_NumLevels);         // numberOfMipmapLevels
   wtr.Write(tkvSz);    // total key value size
   wtr.Write(kvSz);     // key value size
   wtr.Write(orientationKey, oKeyLen + 1); // key
   wtr.Write(orientationValue, oValLen + 1); // value
-  wtr.Write(orientationKey, tkvSz - kvSz - 4); // padding
-
-  if(ci &&
-     (ci->GetFormat() == FasTC::eCompressionFormat_BPTC ||
-      ci->GetFormat() == FasTC::eCompressionFormat_DXT5)) {
-    static const uint32 kImageSize = m_Width * m_Height;
-    wtr.Write(kImageSize); // imageSize
-    wtr.Write(ci->GetCompressedData(), kImageSize); // imagedata...
-  } else if(ci &&
-            (ci->GetFormat() == FasTC::eCompressionFormat_PVRTC4 ||
-             ci->GetFormat() == FasTC::eCompressionFormat_DXT1)) {
-    static const uint32 kImageSize = m_Width * m_Height >> 1;
-    wtr.Write(kImageSize); // imageSize
-    wtr.Write(ci->GetCompressedData(), kImageSize); // imagedata...
-  } else {
-    static const uint32 kImageSize = m_Width * m_Height * 4;
-    wtr.Write(kImageSize); // imageSize
-    wtr.Write(m_Image.GetPixels(), kImageSize); // imagedata...
+  wtr.WritePadding(tkvSz - kvSz - 4); // padding
+
+  uint64 bytesInLevel = 0;
+  for(uint32 i = 0; i < m_Images.size(); i++) {
+    const FasTC::Image<> &img = *m_Images[i];
+    const uint64 sz = GetImageDataSize(img);
+
+    if(i % imagesPerLevel == 0) {
+      uint64 imageSize = sz;
+      if(!bCubePadding) {
+        imageSize = 0;
+        for(uint32 j = 0; j < imagesPerLevel; j++) {
+          imageSize += GetImageDataSize(*m_Images[i + j]);
+        }
+      }
+
+      if(imageSize > 0xFFFFFFFFULL) {
+        fprintf(stderr, "KTX writer - mip level %d is too large\n", i / imagesPerLevel);
+        return false;
+      }
+
+      wtr.Write(static_cast<uint32>(imageSize));
+      bytesInLevel = 0;
+    }
+
+    CopyImageData(img, wtr.Reserve(sz));
+    bytesInLevel += sz;
+
+    if(bCubePadding) {
+      wtr.WritePadding(PaddingToFour(sz));
+      bytesInLevel += PaddingToFour(sz);
+    }
+
+    if(i % imagesPerLevel == imagesPerLevel - 1) {
+      wtr.WritePadding(PaddingToFour(bytesInLevel));
+    }
   }
 
-  m_RawFileData = wtr.GetBytes();
-  m_RawFileDataSz = wtr.GetBytesWritten();
+  assert(wtr.IsFull());
   return true;
 }
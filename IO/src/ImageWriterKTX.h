@@ -18,19 +18,20 @@
 #ifndef _IMAGE_WRITER_KTX_H_
 #define _IMAGE_WRITER_KTX_H_
 
-#include "FasTC/ImageWriter.h"
-#include "FasTC/ImageFwd.h"
+#include "ImageWriterTexture.h"
 
-// Forward Declare
-class ImageWriterKTX : public ImageWriter {
+class ImageWriterKTX : public ImageWriterTexture {
  public:
   ImageWriterKTX(FasTC::Image<> &);
+
+  // Writes a whole texture object, laid out as described in
+  // ImageWriterTexture.
+  ImageWriterKTX(const FasTC::Image<> *const *images, uint32 numLevels,
+                 uint32 numArrayElements, uint32 numFaces);
+
   virtual ~ImageWriterKTX() { }
 
   virtual bool WriteImage();
-
- private:
-  FasTC::Image<> &m_Image;
 };
 
 #endif // _IMAGE_LOADER_H_
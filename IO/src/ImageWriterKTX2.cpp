@@ -0,0 +1,437 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "ImageWriterKTX2.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+#include "FasTC/Image.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/CompressionFormat.h"
+#include "FasTC/Thread.h"
+
+#include "VKDefines.h"
+
+// Offline tools write these files once and they're downloaded many times,
+// so favor size over speed.
+static const int kZlibLevel = Z_BEST_COMPRESSION;
+
+// KTX2 files are always little endian.
+static uint8 *WriteLE(uint8 *dst, uint64 v, uint32 nBytes) {
+  for(uint32 i = 0; i < nBytes; i++) {
+    dst[i] = static_cast<uint8>(v >> (8 * i));
+  }
+  return dst + nBytes;
+}
+
+static uint8 *Write32(uint8 *dst, uint32 v) { return WriteLE(dst, v, 4); }
+static uint8 *Write64(uint8 *dst, uint64 v) { return WriteLE(dst, v, 8); }
+
+static uint8 *WriteKeyValue(uint8 *dst, const char *key, const char *value) {
+  const uint32 keyLen = static_cast<uint32>(strlen(key)) + 1;
+  const uint32 valueLen = static_cast<uint32>(strlen(value)) + 1;
+  dst = Write32(dst, keyLen + valueLen);
+  memcpy(dst, key, keyLen);
+  memcpy(dst + keyLen, value, valueLen);
+  dst += keyLen + valueLen;
+
+  const uint32 padding = (4 - ((keyLen + valueLen) & 3)) & 3;
+  memset(dst, 0, padding);
+  return dst + padding;
+}
+
+static uint32 GetKeyValueSize(const char *key, const char *value) {
+  const uint32 sz = static_cast<uint32>(strlen(key) + strlen(value)) + 2;
+  return 4 + ((sz + 3) & ~0x3);
+}
+
+// Returns the Vulkan format and data format descriptor color model for the
+// compression format, or false if there isn't one.
+static bool GetVkFormat(FasTC::ECompressionFormat fmt,
+                        uint32 &vkFormat, uint8 &colorModel) {
+  colorModel = KHR_DF_MODEL_ASTC;
+  switch(fmt) {
+    case FasTC::eCompressionFormat_BPTC:
+      vkFormat = VK_FORMAT_BC7_UNORM_BLOCK;
+      colorModel = KHR_DF_MODEL_BC7;
+      return true;
+
+    case FasTC::eCompressionFormat_PVRTC2:
+      vkFormat = VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG;
+      colorModel = KHR_DF_MODEL_PVRTC;
+      return true;
+
+    case FasTC::eCompressionFormat_PVRTC4:
+      vkFormat = VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG;
+      colorModel = KHR_DF_MODEL_PVRTC;
+      return true;
+
+    case FasTC::eCompressionFormat_DXT1:
+      vkFormat = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+      colorModel = KHR_DF_MODEL_BC1A;
+      return true;
+
+    case FasTC::eCompressionFormat_DXT5:
+      vkFormat = VK_FORMAT_BC3_UNORM_BLOCK;
+      colorModel = KHR_DF_MODEL_BC3;
+      return true;
+
+    case FasTC::eCompressionFormat_ETC1:
+      vkFormat = VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+      colorModel = KHR_DF_MODEL_ETC2;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC4x4:
+      vkFormat = VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC5x4:
+      vkFormat = VK_FORMAT_ASTC_5x4_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC5x5:
+      vkFormat = VK_FORMAT_ASTC_5x5_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC6x5:
+      vkFormat = VK_FORMAT_ASTC_6x5_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC6x6:
+      vkFormat = VK_FORMAT_ASTC_6x6_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x5:
+      vkFormat = VK_FORMAT_ASTC_8x5_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x6:
+      vkFormat = VK_FORMAT_ASTC_8x6_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x8:
+      vkFormat = VK_FORMAT_ASTC_8x8_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x5:
+      vkFormat = VK_FORMAT_ASTC_10x5_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x6:
+      vkFormat = VK_FORMAT_ASTC_10x6_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x8:
+      vkFormat = VK_FORMAT_ASTC_10x8_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x10:
+      vkFormat = VK_FORMAT_ASTC_10x10_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC12x10:
+      vkFormat = VK_FORMAT_ASTC_12x10_UNORM_BLOCK;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC12x12:
+      vkFormat = VK_FORMAT_ASTC_12x12_UNORM_BLOCK;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+struct DFDSample {
+  uint32 bitOffset;
+  uint32 bitLength;
+  uint32 channelType;
+  uint32 upper;
+};
+
+// Builds the basic data format descriptor for the format of img, with its
+// leading total size, and returns its Vulkan format and the size of its
+// blocks, or of its pixels if it isn't compressed.
+static bool BuildDFD(const FasTC::Image<> &img, bool bSupercompressed,
+                     uint32 &vkFormat, uint32 &blockBytes, std::vector<uint8> &dfd) {
+  uint8 colorModel = KHR_DF_MODEL_RGBSDA;
+  uint32 blockDims[2] = { 1, 1 };
+  blockBytes = 4;
+  DFDSample samples[4];
+  uint32 numSamples = 0;
+
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(&img);
+  if(ci) {
+    const FasTC::ECompressionFormat fmt = ci->GetFormat();
+    if(!GetVkFormat(fmt, vkFormat, colorModel)) {
+      fprintf(stderr, "Unsupported KTX2 compressed format: %d\n", fmt);
+      return false;
+    }
+
+    FasTC::GetBlockDimensions(fmt, blockDims);
+    blockBytes = FasTC::GetBlockSize(fmt);
+
+    // BC3 blocks are a BC4 style alpha block followed by a BC1 color block,
+    // and every other format has a single sample covering the whole block.
+    if(fmt == FasTC::eCompressionFormat_DXT5) {
+      const DFDSample alpha = { 0, 63, KHR_DF_CHANNEL_BC3_ALPHA, 0xFFFFFFFF };
+      const DFDSample color = { 64, 63, KHR_DF_CHANNEL_COMPRESSED_COLOR, 0xFFFFFFFF };
+      samples[numSamples++] = alpha;
+      samples[numSamples++] = color;
+    } else {
+      const uint32 channel = (colorModel == KHR_DF_MODEL_ETC2)?
+        KHR_DF_CHANNEL_ETC2_COLOR : KHR_DF_CHANNEL_COMPRESSED_COLOR;
+      const DFDSample color = { 0, blockBytes * 8 - 1, channel, 0xFFFFFFFF };
+      samples[numSamples++] = color;
+    }
+  } else {
+    vkFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    const uint32 channels[4] = {
+      KHR_DF_CHANNEL_RGBSDA_RED, KHR_DF_CHANNEL_RGBSDA_GREEN,
+      KHR_DF_CHANNEL_RGBSDA_BLUE, KHR_DF_CHANNEL_RGBSDA_ALPHA
+    };
+    for(uint32 i = 0; i < 4; i++) {
+      const DFDSample s = { 8 * i, 7, channels[i], 255 };
+      samples[numSamples++] = s;
+    }
+  }
+
+  const uint32 blockSz = 24 + 16 * numSamples;
+  dfd.resize(4 + blockSz);
+
+  uint8 *dst = &dfd[0];
+  dst = Write32(dst, 4 + blockSz);
+  dst = Write32(dst, (KHR_DF_KHR_DESCRIPTORTYPE_BASICFORMAT << 17) | KHR_DF_VENDORID_KHRONOS);
+  dst = Write32(dst, (blockSz << 16) | KHR_DF_VERSIONNUMBER_1_3);
+
+  *dst++ = colorModel;
+  *dst++ = KHR_DF_PRIMARIES_BT709;
+  *dst++ = KHR_DF_TRANSFER_LINEAR;
+  *dst++ = KHR_DF_FLAG_ALPHA_STRAIGHT;
+
+  // texelBlockDimension and bytesPlane. The size of a plane is unknown once
+  // the levels are supercompressed, and the spec wants it to be zero.
+  const uint8 dims[4] = {
+    static_cast<uint8>(blockDims[0] - 1), static_cast<uint8>(blockDims[1] - 1), 0, 0
+  };
+  memcpy(dst, dims, 4);
+  dst += 4;
+  memset(dst, 0, 8);
+  dst[0] = bSupercompressed? 0 : static_cast<uint8>(blockBytes);
+  dst += 8;
+
+  for(uint32 i = 0; i < numSamples; i++) {
+    const DFDSample &s = samples[i];
+    dst = Write32(dst, s.bitOffset | (s.bitLength << 16) | (s.channelType << 24));
+    dst = Write32(dst, 0);  // samplePosition
+    dst = Write32(dst, 0);  // sampleLower
+    dst = Write32(dst, s.upper);
+  }
+
+  assert(dst == &dfd[0] + dfd.size());
+  return true;
+}
+
+uint64 ImageWriterKTX2::GetLevelSize(uint32 level) const {
+  const uint32 imagesPerLevel = GetImagesPerLevel();
+  const uint32 first = level * imagesPerLevel;
+
+  uint64 sz = 0;
+  for(uint32 i = first; i < first + imagesPerLevel; i++) {
+    sz += GetImageDataSize(*m_Images[i]);
+  }
+  return sz;
+}
+
+void ImageWriterKTX2::CopyLevel(uint32 level, uint8 *dst) const {
+  const uint32 imagesPerLevel = GetImagesPerLevel();
+  const uint32 first = level * imagesPerLevel;
+  for(uint32 i = first; i < first + imagesPerLevel; i++) {
+    CopyImageData(*m_Images[i], dst);
+    dst += GetImageDataSize(*m_Images[i]);
+  }
+}
+
+bool ImageWriterKTX2::CompressLevel(uint32 level, std::vector<uint8> &out,
+                                    uint64 &rawSz) const {
+  rawSz = GetLevelSize(level);
+  if(static_cast<uint64>(static_cast<uLong>(rawSz)) != rawSz) {
+    fprintf(stderr, "KTX2 writer - mip level %d is too large\n", level);
+    return false;
+  }
+
+  std::vector<uint8> raw(static_cast<size_t>(rawSz));
+  CopyLevel(level, &raw[0]);
+
+  uLongf outSz = compressBound(static_cast<uLong>(rawSz));
+  out.resize(outSz);
+  if(compress2(&out[0], &outSz, &raw[0], static_cast<uLong>(rawSz), kZlibLevel) != Z_OK) {
+    fprintf(stderr, "KTX2 writer - unable to compress mip level %d\n", level);
+    return false;
+  }
+  out.resize(outSz);
+  return true;
+}
+
+// Deflates the mip levels on numThreads threads. Each mip level is a quarter
+// of the size of the one before it, so splitting them into contiguous ranges
+// would leave the thread that gets the first levels doing nearly all of the
+// work. Thread t takes levels t, t + numThreads, t + 2 * numThreads, ...
+class KTX2LevelCompressor : public TCRangeCallable {
+ public:
+  KTX2LevelCompressor(const ImageWriterKTX2 &writer, uint32 numThreads,
+                      std::vector<uint8> *levels, uint64 *rawSizes, uint8 *ok)
+    : TCRangeCallable()
+    , m_Writer(writer), m_NumThreads(numThreads)
+    , m_Levels(levels), m_RawSizes(rawSizes), m_OK(ok)
+  { }
+
+  virtual void operator()(uint32 begin, uint32 end) {
+    for(uint32 t = begin; t < end; t++) {
+      for(uint32 l = t; l < m_Writer.m_NumLevels; l += m_NumThreads) {
+        m_OK[l] = m_Writer.CompressLevel(l, m_Levels[l], m_RawSizes[l]);
+      }
+    }
+  }
+
+ private:
+  const ImageWriterKTX2 &m_Writer;
+  const uint32 m_NumThreads;
+  std::vector<uint8> *m_Levels;
+  uint64 *m_RawSizes;
+  uint8 *m_OK;
+};
+
+bool ImageWriterKTX2::WriteImage() {
+  if(!CheckImages("KTX2")) {
+    return false;
+  }
+
+  const bool bZlib = m_Settings.bZlibSupercompression;
+
+  uint32 vkFormat, blockBytes;
+  std::vector<uint8> dfd;
+  if(!BuildDFD(*m_Images[0], bZlib, vkFormat, blockBytes, dfd)) {
+    return false;
+  }
+
+  // The deflated levels, or nothing if they're stored as they are.
+  std::vector<std::vector<uint8> > levels(m_NumLevels);
+  std::vector<uint64> rawSizes(m_NumLevels);
+  std::vector<uint64> levelSizes(m_NumLevels);
+  if(bZlib) {
+    const uint32 numThreads = std::min(m_NumLevels, TCThread::NumHardwareThreads());
+    std::vector<uint8> ok(m_NumLevels);
+    KTX2LevelCompressor job(*this, numThreads, &levels[0], &rawSizes[0], &ok[0]);
+    TCParallelFor(numThreads, numThreads, job);
+
+    for(uint32 l = 0; l < m_NumLevels; l++) {
+      if(!ok[l]) {
+        return false;
+      }
+      levelSizes[l] = levels[l].size();
+    }
+  } else {
+    for(uint32 l = 0; l < m_NumLevels; l++) {
+      rawSizes[l] = levelSizes[l] = GetLevelSize(l);
+    }
+  }
+
+  const char *orientationKey = "KTXorientation";
+  const char *orientationValue = "rd";
+  const char *writerKey = "KTXwriter";
+  const char *writerValue = "FasTC";
+
+  const uint64 kHeaderSz = 80;
+  const uint64 levelIndexSz = 24 * static_cast<uint64>(m_NumLevels);
+  const uint32 dfdOffset = static_cast<uint32>(kHeaderSz + levelIndexSz);
+  const uint32 dfdSz = static_cast<uint32>(dfd.size());
+  const uint32 kvdOffset = dfdOffset + dfdSz;
+  const uint32 kvdSz = GetKeyValueSize(orientationKey, orientationValue) +
+                       GetKeyValueSize(writerKey, writerValue);
+
+  // The levels are stored from the smallest to the largest. Supercompressed
+  // levels don't need any alignment, and the others start on a multiple of
+  // the block size and of four bytes, which are both powers of two.
+  const uint64 alignment = bZlib? 1 : std::max<uint32>(blockBytes, 4);
+  std::vector<uint64> levelOffsets(m_NumLevels);
+  uint64 fileSz = kvdOffset + kvdSz;
+  for(uint32 l = m_NumLevels; l-- > 0;) {
+    fileSz = (fileSz + alignment - 1) & ~(alignment - 1);
+    levelOffsets[l] = fileSz;
+    fileSz += levelSizes[l];
+  }
+
+  AllocateRawFileData(fileSz);
+
+  const uint8 kIdentifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+  };
+  memcpy(m_RawFileData, kIdentifier, 12);
+
+  uint8 *dst = m_RawFileData + 12;
+  dst = Write32(dst, vkFormat);
+  dst = Write32(dst, 1);          // typeSize
+  dst = Write32(dst, m_Width);    // pixelWidth
+  dst = Write32(dst, m_Height);   // pixelHeight
+  dst = Write32(dst, 0);          // pixelDepth
+  dst = Write32(dst, m_NumArrayElements);  // layerCount
+  dst = Write32(dst, m_NumFaces);          // faceCount
+  dst = Write32(dst, m_NumLevels);         // levelCount
+  dst = Write32(dst, bZlib? KTX_SS_ZLIB : KTX_SS_NONE);  // supercompressionScheme
+
+  dst = Write32(dst, dfdOffset);
+  dst = Write32(dst, dfdSz);
+  dst = Write32(dst, kvdOffset);
+  dst = Write32(dst, kvdSz);
+  dst = Write64(dst, 0);  // sgdByteOffset
+  dst = Write64(dst, 0);  // sgdByteLength
+
+  for(uint32 l = 0; l < m_NumLevels; l++) {
+    dst = Write64(dst, levelOffsets[l]);
+    dst = Write64(dst, levelSizes[l]);
+    dst = Write64(dst, rawSizes[l]);
+  }
+
+  memcpy(dst, &dfd[0], dfdSz);
+  dst += dfdSz;
+
+  // Keys are sorted by their code points.
+  dst = WriteKeyValue(dst, orientationKey, orientationValue);
+  dst = WriteKeyValue(dst, writerKey, writerValue);
+
+  for(uint32 l = m_NumLevels; l-- > 0;) {
+    const uint8 *levelStart = m_RawFileData + levelOffsets[l];
+    memset(dst, 0, levelStart - dst);
+    dst = m_RawFileData + levelOffsets[l];
+
+    if(bZlib) {
+      memcpy(dst, &(levels[l][0]), levelSizes[l]);
+    } else {
+      CopyLevel(l, dst);
+    }
+    dst += levelSizes[l];
+  }
+
+  assert(dst == m_RawFileData + m_RawFileDataSz);
+  return true;
+}
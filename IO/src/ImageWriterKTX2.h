@@ -0,0 +1,62 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _IO_SRC_IMAGE_WRITER_KTX2_H_
+#define _IO_SRC_IMAGE_WRITER_KTX2_H_
+
+#include "ImageWriterKTX.h"
+
+#include "FasTC/ImageFile.h"
+
+// Writes KTX2 files. Unless the settings say otherwise, every mip level is
+// zlib supercompressed on its own, and the level index records where each
+// one starts along with its compressed and uncompressed lengths, so that a
+// runtime can seek to any level and inflate just that one. The levels are
+// compressed in parallel.
+class ImageWriterKTX2 : public ImageWriterKTX {
+  friend class KTX2LevelCompressor;
+ public:
+  ImageWriterKTX2(FasTC::Image<> &im, const SKTX2Settings &settings = SKTX2Settings())
+    : ImageWriterKTX(im), m_Settings(settings) { }
+
+  // Takes the same texture objects as ImageWriterKTX.
+  ImageWriterKTX2(const FasTC::Image<> *const *images, uint32 numLevels,
+                  uint32 numArrayElements, uint32 numFaces,
+                  const SKTX2Settings &settings = SKTX2Settings())
+    : ImageWriterKTX(images, numLevels, numArrayElements, numFaces)
+    , m_Settings(settings)
+  { }
+
+  virtual ~ImageWriterKTX2() { }
+
+  virtual bool WriteImage();
+
+ private:
+  // Gathers every image in the mip level and deflates them into out.
+  // rawSz receives the number of bytes before compression.
+  bool CompressLevel(uint32 level, std::vector<uint8> &out, uint64 &rawSz) const;
+
+  // The number of bytes in every image of the mip level.
+  uint64 GetLevelSize(uint32 level) const;
+
+  // Copies every image in the mip level into dst.
+  void CopyLevel(uint32 level, uint8 *dst) const;
+
+  const SKTX2Settings m_Settings;
+};
+
+#endif  // _IO_SRC_IMAGE_WRITER_KTX2_H_
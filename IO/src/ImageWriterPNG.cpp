@@ -17,14 +17,23 @@
 
 #include "ImageWriterPNG.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include <png.h>
 
+#ifdef ZLIB_FOUND
+#  include <zlib.h>
+#  include "FasTC/Thread.h"
+#endif
+
 #include "FasTC/Image.h"
 #include "FasTC/Pixel.h"
+#include "FasTC/Trace.h"
 
 class PNGStreamWriter {
 public:
@@ -41,12 +50,20 @@ public:
 
     ImageWriterPNG &writer = *(ImageWriterPNG *)(io_ptr);
 
-    while(writer.m_StreamPosition + byteCountToWrite > writer.m_RawFileDataSz) {
-      uint8 *newData = new uint8[writer.m_RawFileDataSz << 1];
-      memcpy(newData, writer.m_RawFileData, writer.m_RawFileDataSz);
-      writer.m_RawFileDataSz <<= 1;
-      delete [] writer.m_RawFileData;
+    uint64 newCapacity = writer.m_RawFileDataCapacity;
+    while(writer.m_StreamPosition + byteCountToWrite > newCapacity) {
+      newCapacity <<= 1;
+    }
+
+    if(newCapacity != writer.m_RawFileDataCapacity) {
+      uint8 *newData =
+        TCMemory::NewArray<uint8>(TCMemory::eCategory_ImageWriting, newCapacity);
+      memcpy(newData, writer.m_RawFileData, writer.m_StreamPosition);
+      TCMemory::DeleteArray(TCMemory::eCategory_ImageWriting,
+                            writer.m_RawFileData, writer.m_RawFileDataCapacity);
       writer.m_RawFileData = newData;
+      writer.m_RawFileDataCapacity = newCapacity;
+      writer.m_RawFileDataSz = newCapacity;
     }
 
     unsigned char *stream = &(writer.m_RawFileData[writer.m_StreamPosition]);
@@ -59,15 +76,41 @@ public:
 
 };
 
-ImageWriterPNG::ImageWriterPNG(FasTC::Image<> &im)
+ImageWriterPNG::ImageWriterPNG(FasTC::Image<> &im, const SPNGSettings &settings)
   : ImageWriter(im.GetWidth(), im.GetHeight(), im.GetPixels())
+  , m_Settings(settings)
   , m_StreamPosition(0)
 {
   im.ComputePixels();
   m_Pixels = im.GetPixels();
 }
 
+uint32 ImageWriterPNG::NumThreads() const {
+#ifdef ZLIB_FOUND
+  if (m_Settings.iNumThreads == 0) {
+    return TCThread::NumHardwareThreads();
+  }
+#endif
+  return static_cast<uint32>(std::max(m_Settings.iNumThreads, 1));
+}
+
+void ImageWriterPNG::PackRow(uint32 y, uint8 *row) const {
+  const FasTC::Pixel *pixels = m_Pixels + static_cast<uint64>(y) * m_Width;
+  for (uint32 x = 0; x < m_Width; ++x) {
+    reinterpret_cast<uint32 *>(row)[x] = pixels[x].Pack();
+  }
+}
+
 bool ImageWriterPNG::WriteImage() {
+#ifdef ZLIB_FOUND
+  if (NumThreads() > 1) {
+    return WriteImageParallel();
+  }
+#endif
+  return WriteImageLibPNG();
+}
+
+bool ImageWriterPNG::WriteImageLibPNG() {
 
   png_structp png_ptr = NULL;
   png_infop info_ptr = NULL;
@@ -96,6 +139,20 @@ bool ImageWriterPNG::WriteImage() {
                 PNG_INTERLACE_NONE,
                 PNG_COMPRESSION_TYPE_DEFAULT,
                 PNG_FILTER_TYPE_DEFAULT);
+
+  if (m_Settings.iZLibLevel >= 0) {
+    png_set_compression_level (png_ptr, m_Settings.iZLibLevel);
+  }
+
+  switch (m_Settings.filter) {
+    case ePNGFilter_None: png_set_filter (png_ptr, 0, PNG_FILTER_NONE); break;
+    case ePNGFilter_Sub: png_set_filter (png_ptr, 0, PNG_FILTER_SUB); break;
+    case ePNGFilter_Up: png_set_filter (png_ptr, 0, PNG_FILTER_UP); break;
+    case ePNGFilter_Average: png_set_filter (png_ptr, 0, PNG_FILTER_AVG); break;
+    case ePNGFilter_Paeth: png_set_filter (png_ptr, 0, PNG_FILTER_PAETH); break;
+    case ePNGFilter_Adaptive: png_set_filter (png_ptr, 0, PNG_ALL_FILTERS); break;
+    default: break;
+  }
     
   /* Initialize rows of PNG. */
   row_pointers = (png_byte **)png_malloc (png_ptr, m_Height * sizeof (png_byte *));
@@ -103,10 +160,7 @@ bool ImageWriterPNG::WriteImage() {
     png_byte *row = (png_byte *)png_malloc (png_ptr, sizeof (uint8) * m_Width * pixel_size);
 
     row_pointers[y] = row;
-
-    for (uint32 x = 0; x < m_Width; ++x) {
-      reinterpret_cast<uint32 *>(row)[x] = m_Pixels[y * m_Width + x].Pack();
-    }
+    PackRow(y, row);
   }
     
   png_set_write_fn(png_ptr, this, PNGStreamWriter::WriteDataToStream, PNGStreamWriter::FlushStream);
@@ -123,3 +177,357 @@ bool ImageWriterPNG::WriteImage() {
   m_RawFileDataSz = m_StreamPosition;
   return true;
 }
+
+#ifdef ZLIB_FOUND
+
+// The PNG filter types, as they appear in the byte that precedes each row.
+enum {
+  kFilterNone = 0,
+  kFilterSub = 1,
+  kFilterUp = 2,
+  kFilterAverage = 3,
+  kFilterPaeth = 4,
+  kNumFilters = 5
+};
+
+static inline uint8 PaethPredictor(int a, int b, int c) {
+  const int p = a + b - c;
+  const int pa = abs(p - a);
+  const int pb = abs(p - b);
+  const int pc = abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return static_cast<uint8>(a);
+  } else if (pb <= pc) {
+    return static_cast<uint8>(b);
+  }
+  return static_cast<uint8>(c);
+}
+
+// Filters one row of RGBA8 pixels into out, which has room for the filter
+// type byte followed by the row. prev is the unfiltered row above, or NULL
+// for the first row of the image.
+static void FilterRow(uint32 filter, const uint8 *row, const uint8 *prev,
+                      uint64 rowSz, uint8 *out) {
+  const uint32 bpp = 4;
+  out[0] = static_cast<uint8>(filter);
+  out++;
+
+  for (uint64 i = 0; i < rowSz; i++) {
+    const int a = (i >= bpp)? row[i - bpp] : 0;
+    const int b = prev? prev[i] : 0;
+    const int c = (prev && i >= bpp)? prev[i - bpp] : 0;
+
+    int pred = 0;
+    switch (filter) {
+      case kFilterSub: pred = a; break;
+      case kFilterUp: pred = b; break;
+      case kFilterAverage: pred = (a + b) >> 1; break;
+      case kFilterPaeth: pred = PaethPredictor(a, b, c); break;
+      default: break;
+    }
+    out[i] = static_cast<uint8>(row[i] - pred);
+  }
+}
+
+// The same heuristic that libpng uses to pick a filter for each row: the one
+// whose output, read as signed bytes, has the smallest sum of magnitudes.
+static uint64 FilteredRowCost(const uint8 *out, uint64 rowSz) {
+  uint64 cost = 0;
+  for (uint64 i = 1; i <= rowSz; i++) {
+    cost += abs(static_cast<int>(static_cast<signed char>(out[i])));
+  }
+  return cost;
+}
+
+// Filters and deflates stripes of rows, each into its own raw deflate stream
+// that ends on a byte boundary so that the streams can be concatenated.
+class PNGStripeJob : public TCRangeCallable {
+ public:
+  PNGStripeJob(const ImageWriterPNG &writer, uint32 rowsPerStripe,
+               uint8 *filtered)
+    : TCRangeCallable()
+    , m_Writer(writer)
+    , m_RowsPerStripe(rowsPerStripe)
+    , m_Filtered(filtered)
+    , m_bDeflate(false)
+    , m_Deflated(NULL), m_Adler(NULL), m_OK(NULL)
+  { }
+
+  // Switches the job from filtering to deflating the filtered stripes.
+  void SetDeflating(std::vector<uint8> *deflated, uLong *adler, uint8 *ok) {
+    m_bDeflate = true;
+    m_Deflated = deflated;
+    m_Adler = adler;
+    m_OK = ok;
+  }
+
+  virtual void operator()(uint32 begin, uint32 end) {
+    for (uint32 s = begin; s < end; s++) {
+      if (m_bDeflate) {
+        m_OK[s] = DeflateStripe(s);
+      } else {
+        FilterStripe(s);
+      }
+    }
+  }
+
+ private:
+  const ImageWriterPNG &m_Writer;
+  const uint32 m_RowsPerStripe;
+  uint8 *const m_Filtered;
+
+  bool m_bDeflate;
+  std::vector<uint8> *m_Deflated;
+  uLong *m_Adler;
+  uint8 *m_OK;
+
+  uint64 RowSize() const { return static_cast<uint64>(m_Writer.m_Width) * 4; }
+  uint32 NumStripes() const {
+    return (m_Writer.m_Height + m_RowsPerStripe - 1) / m_RowsPerStripe;
+  }
+
+  void StripeRows(uint32 s, uint32 &first, uint32 &end) const {
+    first = s * m_RowsPerStripe;
+    end = std::min(first + m_RowsPerStripe, m_Writer.m_Height);
+  }
+
+  void FilterStripe(uint32 s) {
+    FASTC_TRACE_ZONE("PNG Filter Stripe");
+    const uint64 rowSz = RowSize();
+    uint32 first, end;
+    StripeRows(s, first, end);
+
+    std::vector<uint8> rows(2 * rowSz);
+    uint8 *row = &rows[0];
+    uint8 *prev = &rows[rowSz];
+    if (first > 0) {
+      m_Writer.PackRow(first - 1, prev);
+    }
+
+    std::vector<uint8> candidate;
+    if (m_Writer.m_Settings.filter == ePNGFilter_Default ||
+        m_Writer.m_Settings.filter == ePNGFilter_Adaptive) {
+      candidate.resize(rowSz + 1);
+    }
+
+    for (uint32 y = first; y < end; y++) {
+      m_Writer.PackRow(y, row);
+      const uint8 *above = (y > 0)? prev : NULL;
+      uint8 *out = m_Filtered + static_cast<uint64>(y) * (rowSz + 1);
+
+      switch (m_Writer.m_Settings.filter) {
+        case ePNGFilter_None: FilterRow(kFilterNone, row, above, rowSz, out); break;
+        case ePNGFilter_Sub: FilterRow(kFilterSub, row, above, rowSz, out); break;
+        case ePNGFilter_Up: FilterRow(kFilterUp, row, above, rowSz, out); break;
+        case ePNGFilter_Average: FilterRow(kFilterAverage, row, above, rowSz, out); break;
+        case ePNGFilter_Paeth: FilterRow(kFilterPaeth, row, above, rowSz, out); break;
+
+        default: {
+          FilterRow(kFilterNone, row, above, rowSz, out);
+          uint64 bestCost = FilteredRowCost(out, rowSz);
+          for (uint32 f = kFilterSub; f < kNumFilters; f++) {
+            FilterRow(f, row, above, rowSz, &candidate[0]);
+            const uint64 cost = FilteredRowCost(&candidate[0], rowSz);
+            if (cost < bestCost) {
+              bestCost = cost;
+              memcpy(out, &candidate[0], rowSz + 1);
+            }
+          }
+        }
+        break;
+      }
+
+      std::swap(row, prev);
+    }
+  }
+
+  bool DeflateStripe(uint32 s) {
+    FASTC_TRACE_ZONE("PNG Deflate Stripe");
+    const uint64 filteredRowSz = RowSize() + 1;
+    uint32 first, end;
+    StripeRows(s, first, end);
+
+    const uint8 *src = m_Filtered + static_cast<uint64>(first) * filteredRowSz;
+    const uint64 srcSz = static_cast<uint64>(end - first) * filteredRowSz;
+    const bool bLast = s == NumStripes() - 1;
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, m_Writer.m_Settings.iZLibLevel, Z_DEFLATED, -15,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      return false;
+    }
+
+    // Prime the window with the end of the previous stripe so that matches
+    // can reach across the seam, as they would in a serial stream.
+    if (first > 0) {
+      const uint64 dictSz = std::min<uint64>(32768, src - m_Filtered);
+      deflateSetDictionary(&strm, src - dictSz, static_cast<uInt>(dictSz));
+    }
+
+    std::vector<uint8> &out = m_Deflated[s];
+    out.resize(deflateBound(&strm, static_cast<uLong>(srcSz)) + 16);
+
+    strm.next_in = const_cast<Bytef *>(src);
+    strm.avail_in = static_cast<uInt>(srcSz);
+
+    // Every stripe but the last ends with an empty stored block, which
+    // leaves the stream on a byte boundary without marking it as finished.
+    const int flush = bLast? Z_FINISH : Z_SYNC_FLUSH;
+    int ret = Z_OK;
+    uint64 outSz = 0;
+    do {
+      if (outSz == out.size()) {
+        out.resize(out.size() * 2);
+      }
+      strm.next_out = &out[outSz];
+      strm.avail_out = static_cast<uInt>(out.size() - outSz);
+      ret = deflate(&strm, flush);
+      outSz = out.size() - strm.avail_out;
+    } while (ret == Z_OK && (bLast || strm.avail_out == 0));
+
+    deflateEnd(&strm);
+    out.resize(outSz);
+
+    m_Adler[s] = adler32(adler32(0, NULL, 0), src, static_cast<uInt>(srcSz));
+    return bLast? ret == Z_STREAM_END : ret == Z_OK || ret == Z_BUF_ERROR;
+  }
+};
+
+static uint8 *WriteBE32(uint8 *dst, uint32 v) {
+  dst[0] = static_cast<uint8>(v >> 24);
+  dst[1] = static_cast<uint8>(v >> 16);
+  dst[2] = static_cast<uint8>(v >> 8);
+  dst[3] = static_cast<uint8>(v);
+  return dst + 4;
+}
+
+// Writes the chunk length and type and returns where the chunk data goes.
+static uint8 *BeginChunk(uint8 *dst, const char *type, uint32 dataSz) {
+  dst = WriteBE32(dst, dataSz);
+  memcpy(dst, type, 4);
+  return dst + 4;
+}
+
+// Appends the CRC of the chunk that starts at chunk, whose data ends at end.
+static uint8 *EndChunk(uint8 *chunk, uint8 *end) {
+  const uLong crc = crc32(crc32(0, NULL, 0), chunk + 4,
+                          static_cast<uInt>(end - chunk - 4));
+  return WriteBE32(end, static_cast<uint32>(crc));
+}
+
+bool ImageWriterPNG::WriteImageParallel() {
+  if (m_Width == 0 || m_Height == 0) {
+    fprintf(stderr, "PNG writer - cannot write an empty image.\n");
+    return false;
+  }
+
+  const uint64 filteredRowSz = static_cast<uint64>(m_Width) * 4 + 1;
+  const uint32 numThreads = NumThreads();
+
+  // Give every thread a few stripes to balance the load, but keep them big
+  // enough that the sync points don't hurt compression, and small enough
+  // that a stripe fits in a single IDAT chunk.
+  const uint64 kMinStripeSz = 128 * 1024;
+  const uint64 kMaxStripeSz = 256 * 1024 * 1024;
+  uint64 rowsPerStripe = (m_Height + numThreads * 4 - 1) / (numThreads * 4);
+  rowsPerStripe = std::max(rowsPerStripe, (kMinStripeSz + filteredRowSz - 1) / filteredRowSz);
+  rowsPerStripe = std::min(rowsPerStripe, std::max<uint64>(1, kMaxStripeSz / filteredRowSz));
+  rowsPerStripe = std::min<uint64>(rowsPerStripe, m_Height);
+  const uint32 numStripes = static_cast<uint32>((m_Height + rowsPerStripe - 1) / rowsPerStripe);
+
+  std::vector<uint8> filtered(filteredRowSz * m_Height);
+  PNGStripeJob job(*this, static_cast<uint32>(rowsPerStripe), &filtered[0]);
+  TCParallelFor(numStripes, numThreads, job);
+
+  std::vector<std::vector<uint8> > deflated(numStripes);
+  std::vector<uLong> adler(numStripes);
+  std::vector<uint8> ok(numStripes);
+  job.SetDeflating(&deflated[0], &adler[0], &ok[0]);
+  TCParallelFor(numStripes, numThreads, job);
+
+  uLong streamAdler = adler32(0, NULL, 0);
+  for (uint32 s = 0; s < numStripes; s++) {
+    if (!ok[s]) {
+      fprintf(stderr, "PNG writer - unable to deflate image data.\n");
+      return false;
+    }
+
+    const uint64 stripeSz = std::min<uint64>(rowsPerStripe, m_Height - s * rowsPerStripe) * filteredRowSz;
+    streamAdler = adler32_combine(streamAdler, adler[s], static_cast<z_off_t>(stripeSz));
+  }
+
+  // The zlib header, with the compression level hint that zlib would use.
+  const int level = m_Settings.iZLibLevel;
+  uint32 levelHint = 2;
+  if (level == 0 || level == 1) {
+    levelHint = 0;
+  } else if (level >= 2 && level <= 5) {
+    levelHint = 1;
+  } else if (level >= 7) {
+    levelHint = 3;
+  }
+  const uint32 cmf = 0x78;
+  uint32 flg = levelHint << 6;
+  flg += 31 - ((cmf << 8) + flg) % 31;
+
+  // Each stripe goes in its own IDAT chunk. The first one starts with the
+  // zlib header and the last one ends with the checksum.
+  const uint64 kChunkOverhead = 12;
+  const uint64 kSignatureSz = 8;
+  const uint64 kIHDRSz = 13;
+  uint64 fileSz = kSignatureSz + kChunkOverhead + kIHDRSz + kChunkOverhead + 2 + 4;
+  for (uint32 s = 0; s < numStripes; s++) {
+    fileSz += kChunkOverhead + deflated[s].size();
+  }
+
+  AllocateRawFileData(fileSz);
+
+  static const uint8 kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  uint8 *dst = m_RawFileData;
+  memcpy(dst, kSignature, kSignatureSz);
+  dst += kSignatureSz;
+
+  uint8 *chunk = dst;
+  dst = BeginChunk(dst, "IHDR", static_cast<uint32>(kIHDRSz));
+  dst = WriteBE32(dst, m_Width);
+  dst = WriteBE32(dst, m_Height);
+  *dst++ = 8;  // Bit depth
+  *dst++ = 6;  // Color type: RGBA
+  *dst++ = 0;  // Compression method: deflate
+  *dst++ = 0;  // Filter method: adaptive
+  *dst++ = 0;  // No interlacing
+  dst = EndChunk(chunk, dst);
+
+  for (uint32 s = 0; s < numStripes; s++) {
+    const bool bFirst = s == 0;
+    const bool bLast = s == numStripes - 1;
+    const uint64 dataSz = deflated[s].size() + (bFirst? 2 : 0) + (bLast? 4 : 0);
+
+    chunk = dst;
+    dst = BeginChunk(dst, "IDAT", static_cast<uint32>(dataSz));
+    if (bFirst) {
+      *dst++ = static_cast<uint8>(cmf);
+      *dst++ = static_cast<uint8>(flg);
+    }
+
+    if (!deflated[s].empty()) {
+      memcpy(dst, &deflated[s][0], deflated[s].size());
+      dst += deflated[s].size();
+    }
+
+    if (bLast) {
+      dst = WriteBE32(dst, static_cast<uint32>(streamAdler));
+    }
+    dst = EndChunk(chunk, dst);
+  }
+
+  chunk = dst;
+  dst = BeginChunk(dst, "IEND", 0);
+  dst = EndChunk(chunk, dst);
+
+  assert(dst == m_RawFileData + m_RawFileDataSz);
+  return true;
+}
+
+#endif  // ZLIB_FOUND
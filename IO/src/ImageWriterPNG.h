@@ -20,17 +20,33 @@
 
 #include "FasTC/ImageWriter.h"
 #include "FasTC/ImageFwd.h"
+#include "FasTC/ImageFile.h"
 
 // Forward Declare
 class ImageWriterPNG : public ImageWriter {
  public:
-  ImageWriterPNG(FasTC::Image<> &);
+  ImageWriterPNG(FasTC::Image<> &, const SPNGSettings &settings = SPNGSettings());
   virtual ~ImageWriterPNG() { }
 
   virtual bool WriteImage();
  private:
+  const SPNGSettings m_Settings;
   uint32 m_StreamPosition;
   friend class PNGStreamWriter;
+  friend class PNGStripeJob;
+
+  // The number of threads to write with, after resolving the default.
+  uint32 NumThreads() const;
+
+  // Packs row y of the image into tightly packed RGBA8 bytes.
+  void PackRow(uint32 y, uint8 *row) const;
+
+  // Writes the image through libpng on the calling thread.
+  bool WriteImageLibPNG();
+
+  // Writes the image by filtering and deflating stripes of rows on
+  // m_Settings.iNumThreads threads and then assembling the chunks by hand.
+  bool WriteImageParallel();
 };
 
 #endif // _IMAGE_LOADER_H_
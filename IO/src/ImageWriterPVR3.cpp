@@ -0,0 +1,173 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "ImageWriterPVR3.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include "FasTC/Image.h"
+#include "FasTC/CompressedImage.h"
+
+#include "PVRDefines.h"
+
+// PVR files are written little endian.
+static uint8 *Write32(uint8 *dst, uint32 v) {
+  for(uint32 i = 0; i < 4; i++) {
+    dst[i] = static_cast<uint8>(v >> (8 * i));
+  }
+  return dst + 4;
+}
+
+// Returns the PVR pixel format of the compression format, or false if
+// there isn't one.
+static bool GetPVRFormat(FasTC::ECompressionFormat fmt, uint32 &pvrFormat) {
+  switch(fmt) {
+    case FasTC::eCompressionFormat_BPTC:
+      pvrFormat = PVR3_BC7;
+      return true;
+
+    case FasTC::eCompressionFormat_PVRTC2:
+      pvrFormat = PVR3_PVRTC_2BPP_RGBA;
+      return true;
+
+    case FasTC::eCompressionFormat_PVRTC4:
+      pvrFormat = PVR3_PVRTC_4BPP_RGBA;
+      return true;
+
+    case FasTC::eCompressionFormat_DXT1:
+      pvrFormat = PVR3_DXT1;
+      return true;
+
+    case FasTC::eCompressionFormat_DXT5:
+      pvrFormat = PVR3_DXT5;
+      return true;
+
+    case FasTC::eCompressionFormat_ETC1:
+      pvrFormat = PVR3_ETC1;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC4x4:
+      pvrFormat = PVR3_ASTC_4x4;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC5x4:
+      pvrFormat = PVR3_ASTC_5x4;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC5x5:
+      pvrFormat = PVR3_ASTC_5x5;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC6x5:
+      pvrFormat = PVR3_ASTC_6x5;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC6x6:
+      pvrFormat = PVR3_ASTC_6x6;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x5:
+      pvrFormat = PVR3_ASTC_8x5;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x6:
+      pvrFormat = PVR3_ASTC_8x6;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC8x8:
+      pvrFormat = PVR3_ASTC_8x8;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x5:
+      pvrFormat = PVR3_ASTC_10x5;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x6:
+      pvrFormat = PVR3_ASTC_10x6;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x8:
+      pvrFormat = PVR3_ASTC_10x8;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC10x10:
+      pvrFormat = PVR3_ASTC_10x10;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC12x10:
+      pvrFormat = PVR3_ASTC_12x10;
+      return true;
+
+    case FasTC::eCompressionFormat_ASTC12x12:
+      pvrFormat = PVR3_ASTC_12x12;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool ImageWriterPVR3::WriteImage() {
+  if(!CheckImages("PVR")) {
+    return false;
+  }
+
+  uint32 formatLow = PVR3_RGBA8_CHANNELS;
+  uint32 formatHigh = PVR3_RGBA8_BITS;
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(m_Images[0]);
+  if(ci) {
+    formatHigh = 0;
+    if(!GetPVRFormat(ci->GetFormat(), formatLow)) {
+      fprintf(stderr, "Unsupported PVR compressed format: %d\n", ci->GetFormat());
+      return false;
+    }
+  }
+
+  uint64 fileSz = PVR3_HEADER_SIZE;
+  for(uint32 i = 0; i < m_Images.size(); i++) {
+    fileSz += GetImageDataSize(*m_Images[i]);
+  }
+
+  AllocateRawFileData(fileSz);
+
+  uint8 *dst = m_RawFileData;
+  dst = Write32(dst, PVR3_VERSION);
+  dst = Write32(dst, 0);  // flags
+  dst = Write32(dst, formatLow);
+  dst = Write32(dst, formatHigh);
+  dst = Write32(dst, PVR3_COLOR_SPACE_LINEAR);
+  dst = Write32(dst, PVR3_CHANNEL_TYPE_UBYTE_NORM);
+  dst = Write32(dst, m_Height);
+  dst = Write32(dst, m_Width);
+  dst = Write32(dst, 1);  // depth
+  dst = Write32(dst, std::max<uint32>(1, m_NumArrayElements));  // surfaces
+  dst = Write32(dst, m_NumFaces);
+  dst = Write32(dst, m_NumLevels);
+  dst = Write32(dst, 0);  // metadata size
+
+  assert(dst == m_RawFileData + PVR3_HEADER_SIZE);
+
+  for(uint32 i = 0; i < m_Images.size(); i++) {
+    CopyImageData(*m_Images[i], dst);
+    dst += GetImageDataSize(*m_Images[i]);
+  }
+
+  assert(dst == m_RawFileData + m_RawFileDataSz);
+  return true;
+}
@@ -0,0 +1,122 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "ImageWriterTexture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "FasTC/Image.h"
+#include "FasTC/Pixel.h"
+
+#include "FasTC/CompressedImage.h"
+
+ImageWriterTexture::ImageWriterTexture(const FasTC::Image<> &im)
+  : ImageWriter(im.GetWidth(), im.GetHeight(), NULL)
+  , m_Images(1, &im)
+  , m_NumLevels(1)
+  , m_NumArrayElements(0)
+  , m_NumFaces(1)
+{ }
+
+ImageWriterTexture::ImageWriterTexture(const FasTC::Image<> *const *images,
+                                       uint32 numLevels, uint32 numArrayElements,
+                                       uint32 numFaces)
+  : ImageWriter(images[0]->GetWidth(), images[0]->GetHeight(), NULL)
+  , m_Images(images, images + numLevels * std::max<uint32>(1, numArrayElements) * numFaces)
+  , m_NumLevels(numLevels)
+  , m_NumArrayElements(numArrayElements)
+  , m_NumFaces(numFaces)
+{ }
+
+uint64 ImageWriterTexture::GetImageDataSize(const FasTC::Image<> &img) {
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(&img);
+  if(ci) {
+    return ci->GetCompressedSize();
+  }
+  return static_cast<uint64>(img.GetWidth()) * img.GetHeight() * 4;
+}
+
+void ImageWriterTexture::CopyImageData(const FasTC::Image<> &img, uint8 *dst) {
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(&img);
+  if(ci) {
+    memcpy(dst, ci->GetCompressedData(), ci->GetCompressedSize());
+    return;
+  }
+
+  const FasTC::Pixel *pixels = img.GetPixels();
+  for(uint32 p = 0; p < img.GetWidth() * img.GetHeight(); p++) {
+    const uint32 packed = pixels[p].Pack();
+    memcpy(dst + 4 * p, &packed, 4);
+  }
+}
+
+bool ImageWriterTexture::CheckImages(const char *containerName) const {
+  if(m_NumLevels == 0 || (m_NumFaces != 1 && m_NumFaces != 6)) {
+    fprintf(stderr, "%s writer - invalid number of mip levels or faces\n", containerName);
+    return false;
+  }
+
+  // Every level past the last 1x1 one would also be 1x1, and shifting the
+  // size by 32 or more bits to find its size is undefined.
+  uint32 maxNumLevels = 1;
+  for(uint32 dim = std::max(m_Width, m_Height); dim > 1; dim >>= 1) {
+    maxNumLevels++;
+  }
+
+  if(m_NumLevels > maxNumLevels) {
+    fprintf(stderr, "%s writer - too many mip levels (%d) for a %dx%d image\n",
+            containerName, m_NumLevels, m_Width, m_Height);
+    return false;
+  }
+
+  if(m_NumFaces == 6 && m_Width != m_Height) {
+    fprintf(stderr, "%s writer - cube map faces must be square\n", containerName);
+    return false;
+  }
+
+  const CompressedImage *first = dynamic_cast<const CompressedImage *>(m_Images[0]);
+
+  const uint32 imagesPerLevel = GetImagesPerLevel();
+  for(uint32 i = 0; i < m_Images.size(); i++) {
+    const FasTC::Image<> *img = m_Images[i];
+    const CompressedImage *ci = dynamic_cast<const CompressedImage *>(img);
+
+    if((ci == NULL) != (first == NULL) ||
+       (ci && ci->GetFormat() != first->GetFormat())) {
+      fprintf(stderr, "%s writer - every image must have the same format\n", containerName);
+      return false;
+    }
+
+    // Compressed images may have been padded out to whole blocks, so only
+    // check that they have the right number of blocks.
+    const uint32 level = i / imagesPerLevel;
+    const uint32 w = std::max<uint32>(1, m_Width >> level);
+    const uint32 h = std::max<uint32>(1, m_Height >> level);
+    const bool bSizeOK = ci?
+      ci->GetCompressedSize() == CompressedImage::GetCompressedSize(w, h, ci->GetFormat()) :
+      (img->GetWidth() == w && img->GetHeight() == h);
+
+    if(!bSizeOK) {
+      fprintf(stderr, "%s writer - image %d has the wrong size for mip level %d\n", containerName, i, level);
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,62 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _IO_SRC_IMAGE_WRITER_TEXTURE_H_
+#define _IO_SRC_IMAGE_WRITER_TEXTURE_H_
+
+#include "FasTC/ImageWriter.h"
+#include "FasTC/ImageFwd.h"
+
+#include <vector>
+
+// The base of writers for container formats that can hold a whole texture
+// object rather than a single image.
+class ImageWriterTexture : public ImageWriter {
+ protected:
+  ImageWriterTexture(const FasTC::Image<> &);
+
+  // images holds one image for every mip level, array element and cube
+  // face, ordered by mip level, then array element, then face. Each mip
+  // level is half the size of the one before it. numArrayElements is zero
+  // for textures that aren't arrays, and numFaces is six for cube maps. The
+  // images must either all be uncompressed or all be compressed with the
+  // same format, and they must outlive the writer.
+  ImageWriterTexture(const FasTC::Image<> *const *images, uint32 numLevels,
+                     uint32 numArrayElements, uint32 numFaces);
+
+  std::vector<const FasTC::Image<> *> m_Images;
+  const uint32 m_NumLevels;
+  const uint32 m_NumArrayElements;
+  const uint32 m_NumFaces;
+
+  uint32 GetImagesPerLevel() const {
+    return static_cast<uint32>(m_Images.size()) / m_NumLevels;
+  }
+
+  // Makes sure that the images form a valid texture object. Errors are
+  // reported on behalf of the named container format.
+  bool CheckImages(const char *containerName) const;
+
+  // The number of bytes that the image takes up in a file.
+  static uint64 GetImageDataSize(const FasTC::Image<> &img);
+
+  // Copies the image as it is stored in a file: the compressed blocks, or
+  // tightly packed RGBA8 pixels. dst must hold GetImageDataSize(img) bytes.
+  static void CopyImageData(const FasTC::Image<> &img, uint8 *dst);
+};
+
+#endif  // _IO_SRC_IMAGE_WRITER_TEXTURE_H_
@@ -0,0 +1,90 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/MappedFile.h"
+
+#include <cstdio>
+
+#include "FasTC/FileStream.h"
+#include "FasTC/Memory.h"
+
+MappedFile::MappedFile(const CHAR *filename, EReadMode mode)
+  : m_Data(NULL)
+  , m_Size(0)
+  , m_bMapped(false)
+  , m_Buffer(NULL)
+{
+  if(eReadMode_Mapped == mode && Map(filename)) {
+    m_bMapped = true;
+    return;
+  }
+
+  ReadBuffered(filename);
+}
+
+MappedFile::~MappedFile() {
+  if(m_bMapped) {
+    Unmap();
+  }
+
+  if(m_Buffer) {
+    TCMemory::DeleteArray(TCMemory::eCategory_ImageLoading, m_Buffer, m_Size);
+    m_Buffer = NULL;
+  }
+}
+
+bool MappedFile::ReadBuffered(const CHAR *filename) {
+  FileStream fstr (filename, eFileMode_ReadBinary);
+  if(fstr.Tell() < 0) {
+    fprintf(stderr, "Error opening file for reading: %s\n", filename);
+    return false;
+  }
+
+  // Figure out the filesize.
+  fstr.Seek(0, FileStream::eSeekPosition_End);
+  const int32 fileSize = fstr.Tell();
+  if(fileSize <= 0) {
+    fprintf(stderr, "Error reading file: %s is empty\n", filename);
+    return false;
+  }
+
+  // Return stream to beginning of file
+  fstr.Seek(0, FileStream::eSeekPosition_Beginning);
+
+  uint8 *buffer =
+    TCMemory::NewArray<uint8>(TCMemory::eCategory_ImageLoading, fileSize);
+
+  // Read all of the data
+  uint32 totalBytesRead = 0;
+  int32 bytesRead;
+  while(totalBytesRead < uint32(fileSize) &&
+        (bytesRead = fstr.Read(buffer + totalBytesRead,
+                               uint32(fileSize) - totalBytesRead)) > 0) {
+    totalBytesRead += bytesRead;
+  }
+
+  if(totalBytesRead != uint32(fileSize)) {
+    fprintf(stderr, "Error reading file: %s\n", filename);
+    TCMemory::DeleteArray(TCMemory::eCategory_ImageLoading, buffer, fileSize);
+    return false;
+  }
+
+  m_Buffer = buffer;
+  m_Data = buffer;
+  m_Size = fileSize;
+  return true;
+}
@@ -0,0 +1,59 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "FasTC/MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile::Map(const CHAR *filename) {
+  const int fd = open(filename, O_RDONLY);
+  if(fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+  void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // The mapping keeps its own reference to the file.
+  close(fd);
+
+  if(MAP_FAILED == addr) {
+    return false;
+  }
+
+  // Loaders read the file front to back, so let the kernel read ahead.
+  posix_madvise(addr, size, POSIX_MADV_SEQUENTIAL);
+
+  m_Data = static_cast<const uint8 *>(addr);
+  m_Size = static_cast<uint64>(size);
+  return true;
+}
+
+void MappedFile::Unmap() {
+  munmap(const_cast<uint8 *>(m_Data), static_cast<size_t>(m_Size));
+  m_Data = NULL;
+  m_Size = 0;
+}
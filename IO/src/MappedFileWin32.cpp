@@ -15,33 +15,13 @@
 // Please send all BUG REPORTS to <pavel@cs.unc.edu>.
 // <http://gamma.cs.unc.edu/FasTC/>
 
-#include "FasTC/ThreadSafeStreambuf.h"
+#include "FasTC/MappedFile.h"
 
-#include <cstdlib>
-#include <cstdio>
-#include <cstring>
-#include <iostream>
-#include <sstream>
-#include <string>
+// Files are not memory mapped on Windows yet, so MappedFile always falls
+// back to reading the whole file into memory.
 
-#include "Thread.h"
-
-ThreadSafeStreambuf::ThreadSafeStreambuf(std::ostream &sink)
-  : ::std::streambuf()
-  , m_Sink(sink)
-  , m_Mutex(new TCMutex)
-{ }
-
-ThreadSafeStreambuf::~ThreadSafeStreambuf() {
-  if(m_Mutex) {
-    delete m_Mutex;
-  }
+bool MappedFile::Map(const CHAR *) {
+  return false;
 }
 
-::std::streamsize ThreadSafeStreambuf::xsputn(const char_type *s,
-                                              ::std::streamsize count) {
-  // Lock it.
-  TCLock lock(*m_Mutex);
-  ::std::streambuf *sinkStream = m_Sink.rdbuf();
-  return sinkStream->sputn(s, count);
-}
+void MappedFile::Unmap() { }
@@ -0,0 +1,61 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _IO_SRC_PVR_DEFINES_H_
+#define _IO_SRC_PVR_DEFINES_H_
+
+// The parts of version 3 of the PowerVR texture container that FasTC reads
+// and writes. Files start with a 52 byte header, followed by metadata and
+// then the images, ordered by mip level, then surface, then face.
+
+#define PVR3_VERSION                 0x03525650  // "PVR\3"
+#define PVR3_HEADER_SIZE             52
+
+// The low 32 bits of the pixel format. The high 32 bits are zero for these
+// compressed formats. Otherwise, the low bits hold the channel names and
+// the high bits the number of bits in each channel.
+#define PVR3_PVRTC_2BPP_RGB          0
+#define PVR3_PVRTC_2BPP_RGBA         1
+#define PVR3_PVRTC_4BPP_RGB          2
+#define PVR3_PVRTC_4BPP_RGBA         3
+#define PVR3_ETC1                    6
+#define PVR3_DXT1                    7
+#define PVR3_DXT5                    11
+#define PVR3_BC7                     15
+#define PVR3_ASTC_4x4                27
+#define PVR3_ASTC_5x4                28
+#define PVR3_ASTC_5x5                29
+#define PVR3_ASTC_6x5                30
+#define PVR3_ASTC_6x6                31
+#define PVR3_ASTC_8x5                32
+#define PVR3_ASTC_8x6                33
+#define PVR3_ASTC_8x8                34
+#define PVR3_ASTC_10x5               35
+#define PVR3_ASTC_10x6               36
+#define PVR3_ASTC_10x8               37
+#define PVR3_ASTC_10x10              38
+#define PVR3_ASTC_12x10              39
+#define PVR3_ASTC_12x12              40
+
+// Eight bits each of red, green, blue and alpha, in that order.
+#define PVR3_RGBA8_CHANNELS          0x61626772  // "rgba"
+#define PVR3_RGBA8_BITS              0x08080808
+
+#define PVR3_COLOR_SPACE_LINEAR      0
+#define PVR3_CHANNEL_TYPE_UBYTE_NORM 0
+
+#endif  // _IO_SRC_PVR_DEFINES_H_
@@ -0,0 +1,108 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef _IO_SRC_VK_DEFINES_H_
+#define _IO_SRC_VK_DEFINES_H_
+
+// KTX2 files identify their formats by their Vulkan enums, and describe them
+// with a Khronos data format descriptor. Only the values for the formats that
+// FasTC supports are listed here.
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Vulkan formats
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VK_VERSION_1_0
+
+#define VK_FORMAT_UNDEFINED                   0
+#define VK_FORMAT_R8G8B8A8_UNORM              37
+
+#define VK_FORMAT_BC1_RGB_UNORM_BLOCK         131
+#define VK_FORMAT_BC3_UNORM_BLOCK             137
+#define VK_FORMAT_BC7_UNORM_BLOCK             145
+
+// ETC1 data is also valid ETC2 RGB data, and there is no separate format
+// for it.
+#define VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK     147
+
+#define VK_FORMAT_ASTC_4x4_UNORM_BLOCK        157
+#define VK_FORMAT_ASTC_5x4_UNORM_BLOCK        159
+#define VK_FORMAT_ASTC_5x5_UNORM_BLOCK        161
+#define VK_FORMAT_ASTC_6x5_UNORM_BLOCK        163
+#define VK_FORMAT_ASTC_6x6_UNORM_BLOCK        165
+#define VK_FORMAT_ASTC_8x5_UNORM_BLOCK        167
+#define VK_FORMAT_ASTC_8x6_UNORM_BLOCK        169
+#define VK_FORMAT_ASTC_8x8_UNORM_BLOCK        171
+#define VK_FORMAT_ASTC_10x5_UNORM_BLOCK       173
+#define VK_FORMAT_ASTC_10x6_UNORM_BLOCK       175
+#define VK_FORMAT_ASTC_10x8_UNORM_BLOCK       177
+#define VK_FORMAT_ASTC_10x10_UNORM_BLOCK      179
+#define VK_FORMAT_ASTC_12x10_UNORM_BLOCK      181
+#define VK_FORMAT_ASTC_12x12_UNORM_BLOCK      183
+
+#define VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG 1000054000
+#define VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG 1000054001
+
+#endif  // VK_VERSION_1_0
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Data format descriptors
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define KHR_DF_VENDORID_KHRONOS               0
+#define KHR_DF_KHR_DESCRIPTORTYPE_BASICFORMAT 0
+#define KHR_DF_VERSIONNUMBER_1_3              2
+
+#define KHR_DF_MODEL_RGBSDA                   1
+#define KHR_DF_MODEL_BC1A                     128
+#define KHR_DF_MODEL_BC3                      130
+#define KHR_DF_MODEL_BC7                      134
+#define KHR_DF_MODEL_ETC2                     161
+#define KHR_DF_MODEL_ASTC                     162
+#define KHR_DF_MODEL_PVRTC                    164
+
+#define KHR_DF_PRIMARIES_BT709                1
+#define KHR_DF_TRANSFER_LINEAR                1
+#define KHR_DF_FLAG_ALPHA_STRAIGHT            0
+
+#define KHR_DF_CHANNEL_RGBSDA_RED             0
+#define KHR_DF_CHANNEL_RGBSDA_GREEN           1
+#define KHR_DF_CHANNEL_RGBSDA_BLUE            2
+#define KHR_DF_CHANNEL_RGBSDA_ALPHA           15
+
+// Every block compressed model calls its color channel zero, except ETC2,
+// where zero is red and the combined color channel is two.
+#define KHR_DF_CHANNEL_COMPRESSED_COLOR       0
+#define KHR_DF_CHANNEL_BC3_ALPHA              15
+#define KHR_DF_CHANNEL_ETC2_COLOR             2
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// KTX2 supercompression schemes
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define KTX_SS_NONE                           0
+#define KTX_SS_BASIS_LZ                       1
+#define KTX_SS_ZSTD                           2
+#define KTX_SS_ZLIB                           3
+
+#endif  // _IO_SRC_VK_DEFINES_H_
@@ -0,0 +1,62 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "Utils.h"
+
+#include "FasTC/ImageFile.h"
+
+static const char *kTestFilename = "Test_IO_ASTC.astc";
+
+TEST(ASTC, RoundTripsBlocks) {
+  // Neither size is a multiple of any of the block sizes, so the last
+  // row and column of blocks are partial.
+  const uint32 w = 37;
+  const uint32 h = 23;
+
+  for(int f = FasTC::COMPRESSION_FORMAT_ASTC_BEGIN; f <= FasTC::COMPRESSION_FORMAT_ASTC_END; f++) {
+    const FasTC::ECompressionFormat fmt = static_cast<FasTC::ECompressionFormat>(f);
+    std::vector<uint8> blocks = MakeBlocks(w, h, fmt);
+    CompressedImage img(w, h, fmt, &blocks[0]);
+
+    ImageFile out(kTestFilename, eFileFormat_ASTC, img);
+    ASSERT_TRUE(out.Write());
+
+    // The file is the 16 byte header followed by the blocks.
+    std::vector<uint8> data = ReadFile(kTestFilename);
+    EXPECT_EQ(blocks.size() + 16, data.size());
+
+    ImageFile in(kTestFilename, eFileFormat_ASTC);
+    ASSERT_TRUE(in.Load());
+    ASSERT_EQ(w, in.GetImage()->GetWidth());
+    ASSERT_EQ(h, in.GetImage()->GetHeight());
+    ExpectSameBlocks(blocks, fmt, in.GetImage());
+    remove(kTestFilename);
+  }
+}
+
+TEST(ASTC, WriterRejectsOtherFormats) {
+  FasTC::Image<> pixels = MakeImage(8, 8);
+  ImageFile pixelFile(kTestFilename, eFileFormat_ASTC, pixels);
+  EXPECT_FALSE(pixelFile.Write());
+
+  const FasTC::ECompressionFormat fmt = FasTC::eCompressionFormat_DXT1;
+  std::vector<uint8> blocks = MakeBlocks(8, 8, fmt);
+  CompressedImage img(8, 8, fmt, &blocks[0]);
+  ImageFile blockFile(kTestFilename, eFileFormat_ASTC, img);
+  EXPECT_FALSE(blockFile.Write());
+  remove(kTestFilename);
+}
@@ -0,0 +1,109 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "Utils.h"
+
+#include "FasTC/ImageFile.h"
+
+static const char *kTestFilename = "Test_IO_DDS.dds";
+
+// The magic number comes before the header.
+static const uint32 kMipMapCountOffset = 4 + 24;
+
+static void WriteDDS(const FasTC::Image<> *const *levels, uint32 numLevels) {
+  ImageFile file(kTestFilename, eFileFormat_DDS, levels, numLevels, 0, 1);
+  ASSERT_TRUE(file.Write());
+}
+
+TEST(DDS, RoundTripsPixels) {
+  FasTC::Image<> level0 = MakeImage(16, 12);
+  FasTC::Image<> level1 = MakeImage(8, 6);
+  FasTC::Image<> level2 = MakeImage(4, 3);
+  const FasTC::Image<> *levels[3] = { &level0, &level1, &level2 };
+  WriteDDS(levels, 3);
+
+  std::vector<uint8> data = ReadFile(kTestFilename);
+  ASSERT_GT(data.size(), kMipMapCountOffset + 4);
+  EXPECT_EQ(3U, ReadLE(data, kMipMapCountOffset, 4));
+
+  ImageFile file(kTestFilename, eFileFormat_DDS);
+  ASSERT_TRUE(file.Load());
+  ASSERT_TRUE(file.GetImage() != NULL);
+  ExpectSamePixels(level0, *file.GetImage());
+  remove(kTestFilename);
+}
+
+TEST(DDS, RoundTripsBlocks) {
+  const FasTC::ECompressionFormat formats[] = {
+    FasTC::eCompressionFormat_DXT1,
+    FasTC::eCompressionFormat_DXT5,
+    FasTC::eCompressionFormat_BPTC
+  };
+
+  for(size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+    const FasTC::ECompressionFormat fmt = formats[f];
+    std::vector<uint8> blocks0 = MakeBlocks(16, 8, fmt);
+    std::vector<uint8> blocks1 = MakeBlocks(8, 4, fmt);
+    std::vector<uint8> blocks2 = MakeBlocks(4, 2, fmt);
+    CompressedImage level0(16, 8, fmt, &blocks0[0]);
+    CompressedImage level1(8, 4, fmt, &blocks1[0]);
+    CompressedImage level2(4, 2, fmt, &blocks2[0]);
+    const FasTC::Image<> *levels[3] = { &level0, &level1, &level2 };
+    WriteDDS(levels, 3);
+
+    ImageFile file(kTestFilename, eFileFormat_DDS);
+    ASSERT_TRUE(file.Load());
+    ExpectSameBlocks(blocks0, fmt, file.GetImage());
+    remove(kTestFilename);
+  }
+}
+
+TEST(DDS, WriterRejectsTooManyLevels) {
+  // A 4x4 image only has three mip levels.
+  FasTC::Image<> level0 = MakeImage(4, 4);
+  FasTC::Image<> level1 = MakeImage(2, 2);
+  FasTC::Image<> level2 = MakeImage(1, 1);
+  const FasTC::Image<> *levels[4] = { &level0, &level1, &level2, &level2 };
+
+  ImageFile file(kTestFilename, eFileFormat_DDS, levels, 4, 0, 1);
+  EXPECT_FALSE(file.Write());
+  remove(kTestFilename);
+}
+
+TEST(DDS, LoaderRejectsTooManyLevels) {
+  FasTC::Image<> level0 = MakeImage(4, 4);
+  FasTC::Image<> level1 = MakeImage(2, 2);
+  FasTC::Image<> level2 = MakeImage(1, 1);
+  const FasTC::Image<> *levels[3] = { &level0, &level1, &level2 };
+  WriteDDS(levels, 3);
+
+  // Claim more levels than the image can have, and leave enough data in the
+  // file for them so that it isn't rejected for being truncated.
+  const uint32 levelCounts[] = { 4, 32, 40, 0xFFFFFFFF };
+  for(size_t i = 0; i < sizeof(levelCounts) / sizeof(levelCounts[0]); i++) {
+    std::vector<uint8> data = ReadFile(kTestFilename);
+    ASSERT_GT(data.size(), kMipMapCountOffset + 4);
+    WriteLE(data, kMipMapCountOffset, levelCounts[i], 4);
+    data.resize(data.size() + 256);
+    ASSERT_TRUE(WriteFile("Test_IO_DDS_Bad.dds", data));
+
+    ImageFile file("Test_IO_DDS_Bad.dds", eFileFormat_DDS);
+    EXPECT_FALSE(file.Load()) << levelCounts[i] << " mip levels";
+    remove("Test_IO_DDS_Bad.dds");
+  }
+  remove(kTestFilename);
+}
@@ -0,0 +1,115 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "Utils.h"
+
+#include "FasTC/ImageFile.h"
+
+static const char *kTestFilename = "Test_IO_KTX2.ktx2";
+
+// The offsets of the fields of the KTX2 header that the tests look at.
+static const uint32 kSupercompressionOffset = 44;
+static const uint32 kDFDOffsetOffset = 48;
+static const uint32 kLevelIndexOffset = 80;
+
+// Writes the mip chain to the test file and reads the file back.
+static std::vector<uint8> WriteKTX2(const FasTC::Image<> *const *levels,
+                                    uint32 numLevels, bool bZlib) {
+  ImageFile file(kTestFilename, eFileFormat_KTX2, levels, numLevels, 0, 1);
+  SKTX2Settings settings;
+  settings.bZlibSupercompression = bZlib;
+  file.SetKTX2Settings(settings);
+  EXPECT_TRUE(file.Write());
+  return ReadFile(kTestFilename);
+}
+
+// Checks the fields of the file that depend on the supercompression scheme.
+static void CheckLayout(const std::vector<uint8> &data, uint32 numLevels,
+                        bool bZlib, uint32 blockBytes) {
+  ASSERT_GE(data.size(), kLevelIndexOffset + 24 * numLevels);
+  EXPECT_EQ(bZlib? 3U : 0U, ReadLE(data, kSupercompressionOffset, 4));
+
+  // bytesPlane0 follows the dfdTotalSize and four words of the block.
+  const uint64 dfdOffset = ReadLE(data, kDFDOffsetOffset, 4);
+  ASSERT_LT(dfdOffset + 20, data.size());
+  EXPECT_EQ(bZlib? 0U : blockBytes, data[static_cast<size_t>(dfdOffset + 20)]);
+
+  for(uint32 l = 0; l < numLevels; l++) {
+    const uint64 entry = kLevelIndexOffset + 24 * l;
+    const uint64 offset = ReadLE(data, entry, 8);
+    const uint64 sz = ReadLE(data, entry + 8, 8);
+    const uint64 rawSz = ReadLE(data, entry + 16, 8);
+    EXPECT_LE(offset + sz, data.size());
+
+    if(!bZlib) {
+      EXPECT_EQ(rawSz, sz);
+      EXPECT_EQ(0U, offset % blockBytes);
+      EXPECT_EQ(0U, offset % 4);
+    }
+  }
+}
+
+static void TestRGBA8RoundTrip(bool bZlib) {
+  FasTC::Image<> level0 = MakeImage(16, 12);
+  FasTC::Image<> level1 = MakeImage(8, 6);
+  FasTC::Image<> level2 = MakeImage(4, 3);
+  const FasTC::Image<> *levels[3] = { &level0, &level1, &level2 };
+
+  std::vector<uint8> data = WriteKTX2(levels, 3, bZlib);
+  CheckLayout(data, 3, bZlib, 4);
+
+  ImageFile file(kTestFilename, eFileFormat_KTX2);
+  ASSERT_TRUE(file.Load());
+  ASSERT_TRUE(file.GetImage() != NULL);
+  ExpectSamePixels(level0, *file.GetImage());
+  remove(kTestFilename);
+}
+
+static void TestCompressedRoundTrip(bool bZlib) {
+  const FasTC::ECompressionFormat fmt = FasTC::eCompressionFormat_DXT1;
+  std::vector<uint8> blocks0 = MakeBlocks(16, 16, fmt);
+  std::vector<uint8> blocks1 = MakeBlocks(8, 8, fmt);
+  std::vector<uint8> blocks2 = MakeBlocks(4, 4, fmt);
+  CompressedImage level0(16, 16, fmt, &blocks0[0]);
+  CompressedImage level1(8, 8, fmt, &blocks1[0]);
+  CompressedImage level2(4, 4, fmt, &blocks2[0]);
+  const FasTC::Image<> *levels[3] = { &level0, &level1, &level2 };
+
+  std::vector<uint8> data = WriteKTX2(levels, 3, bZlib);
+  CheckLayout(data, 3, bZlib, 8);
+
+  ImageFile file(kTestFilename, eFileFormat_KTX2);
+  ASSERT_TRUE(file.Load());
+  ExpectSameBlocks(blocks0, fmt, file.GetImage());
+  remove(kTestFilename);
+}
+
+TEST(KTX2, RoundTripsUncompressedLevels) {
+  TestRGBA8RoundTrip(false);
+}
+
+TEST(KTX2, RoundTripsZlibLevels) {
+  TestRGBA8RoundTrip(true);
+}
+
+TEST(KTX2, RoundTripsUncompressedBlocks) {
+  TestCompressedRoundTrip(false);
+}
+
+TEST(KTX2, RoundTripsZlibBlocks) {
+  TestCompressedRoundTrip(true);
+}
@@ -0,0 +1,97 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#include "Utils.h"
+
+#include "FasTC/ImageFile.h"
+
+static const char *kTestFilename = "Test_IO_PVR3.pvr";
+
+static const uint32 kMipMapCountOffset = 44;
+
+static void WritePVR(const FasTC::Image<> *const *levels, uint32 numLevels) {
+  ImageFile file(kTestFilename, eFileFormat_PVR, levels, numLevels, 0, 1);
+  ASSERT_TRUE(file.Write());
+}
+
+TEST(PVR3, RoundTripsPixels) {
+  FasTC::Image<> level0 = MakeImage(16, 12);
+  FasTC::Image<> level1 = MakeImage(8, 6);
+  FasTC::Image<> level2 = MakeImage(4, 3);
+  const FasTC::Image<> *levels[3] = { &level0, &level1, &level2 };
+  WritePVR(levels, 3);
+
+  std::vector<uint8> data = ReadFile(kTestFilename);
+  ASSERT_GT(data.size(), kMipMapCountOffset + 4);
+  EXPECT_EQ(3U, ReadLE(data, kMipMapCountOffset, 4));
+
+  ImageFile file(kTestFilename, eFileFormat_PVR);
+  ASSERT_TRUE(file.Load());
+  ASSERT_TRUE(file.GetImage() != NULL);
+  ExpectSamePixels(level0, *file.GetImage());
+  remove(kTestFilename);
+}
+
+TEST(PVR3, RoundTripsBlocks) {
+  const FasTC::ECompressionFormat formats[] = {
+    FasTC::eCompressionFormat_DXT1,
+    FasTC::eCompressionFormat_DXT5,
+    FasTC::eCompressionFormat_ETC1,
+    FasTC::eCompressionFormat_BPTC,
+    FasTC::eCompressionFormat_PVRTC4,
+    FasTC::eCompressionFormat_ASTC6x5
+  };
+
+  for(size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+    const FasTC::ECompressionFormat fmt = formats[f];
+    std::vector<uint8> blocks0 = MakeBlocks(16, 16, fmt);
+    std::vector<uint8> blocks1 = MakeBlocks(8, 8, fmt);
+    std::vector<uint8> blocks2 = MakeBlocks(4, 4, fmt);
+    CompressedImage level0(16, 16, fmt, &blocks0[0]);
+    CompressedImage level1(8, 8, fmt, &blocks1[0]);
+    CompressedImage level2(4, 4, fmt, &blocks2[0]);
+    const FasTC::Image<> *levels[3] = { &level0, &level1, &level2 };
+    WritePVR(levels, 3);
+
+    ImageFile file(kTestFilename, eFileFormat_PVR);
+    ASSERT_TRUE(file.Load());
+    ExpectSameBlocks(blocks0, fmt, file.GetImage());
+    remove(kTestFilename);
+  }
+}
+
+TEST(PVR3, LoaderIgnoresLevelsPastOneByOne) {
+  FasTC::Image<> level0 = MakeImage(4, 4);
+  FasTC::Image<> level1 = MakeImage(2, 2);
+  FasTC::Image<> level2 = MakeImage(1, 1);
+  const FasTC::Image<> *levels[3] = { &level0, &level1, &level2 };
+  WritePVR(levels, 3);
+
+  const uint32 levelCounts[] = { 4, 32, 40, 0xFFFFFFFF };
+  for(size_t i = 0; i < sizeof(levelCounts) / sizeof(levelCounts[0]); i++) {
+    std::vector<uint8> data = ReadFile(kTestFilename);
+    ASSERT_GT(data.size(), kMipMapCountOffset + 4);
+    WriteLE(data, kMipMapCountOffset, levelCounts[i], 4);
+    ASSERT_TRUE(WriteFile("Test_IO_PVR3_Long.pvr", data));
+
+    ImageFile file("Test_IO_PVR3_Long.pvr", eFileFormat_PVR);
+    ASSERT_TRUE(file.Load()) << levelCounts[i] << " mip levels";
+    ExpectSamePixels(level0, *file.GetImage());
+    remove("Test_IO_PVR3_Long.pvr");
+  }
+  remove(kTestFilename);
+}
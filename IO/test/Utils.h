@@ -0,0 +1,115 @@
+// Copyright 2016 The University of North Carolina at Chapel Hill
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Please send all BUG REPORTS to <pavel@cs.unc.edu>.
+// <http://gamma.cs.unc.edu/FasTC/>
+
+#ifndef IO_TEST_UTILS_H_
+#define IO_TEST_UTILS_H_
+
+#include "gtest/gtest.h"
+#include "FasTC/CompressedImage.h"
+#include "FasTC/Image.h"
+#include "FasTC/Pixel.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// An image with a different color in every pixel.
+inline FasTC::Image<> MakeImage(uint32 w, uint32 h) {
+  FasTC::Image<> img(w, h);
+  for(uint32 j = 0; j < h; j++) {
+    for(uint32 i = 0; i < w; i++) {
+      img(i, j) = FasTC::Pixel(static_cast<uint8>(255 - ((i + j) & 0x3F)),
+                               static_cast<uint8>(i * 13),
+                               static_cast<uint8>(j * 7),
+                               static_cast<uint8>((i * j) & 0xFF));
+    }
+  }
+  return img;
+}
+
+// Arbitrary compressed blocks for a w x h image. The writers never decode
+// them, so they don't need to make sense.
+inline std::vector<uint8> MakeBlocks(uint32 w, uint32 h, FasTC::ECompressionFormat fmt) {
+  std::vector<uint8> blocks(static_cast<size_t>(CompressedImage::GetCompressedSize(w, h, fmt)));
+  for(size_t i = 0; i < blocks.size(); i++) {
+    blocks[i] = static_cast<uint8>((i * 37) ^ (i >> 3));
+  }
+  return blocks;
+}
+
+inline std::vector<uint8> ReadFile(const char *filename) {
+  std::vector<uint8> data;
+  FILE *f = fopen(filename, "rb");
+  if(!f) {
+    return data;
+  }
+
+  uint8 buf[4096];
+  size_t n;
+  while((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    data.insert(data.end(), buf, buf + n);
+  }
+  fclose(f);
+  return data;
+}
+
+inline bool WriteFile(const char *filename, const std::vector<uint8> &data) {
+  FILE *f = fopen(filename, "wb");
+  if(!f) {
+    return false;
+  }
+
+  const bool bOK = fwrite(&data[0], 1, data.size(), f) == data.size();
+  fclose(f);
+  return bOK;
+}
+
+// Texture containers are little endian.
+inline uint64 ReadLE(const std::vector<uint8> &data, uint64 offset, uint32 nBytes) {
+  uint64 v = 0;
+  for(uint32 i = 0; i < nBytes; i++) {
+    v |= static_cast<uint64>(data[static_cast<size_t>(offset + i)]) << (8 * i);
+  }
+  return v;
+}
+
+inline void WriteLE(std::vector<uint8> &data, uint64 offset, uint64 v, uint32 nBytes) {
+  for(uint32 i = 0; i < nBytes; i++) {
+    data[static_cast<size_t>(offset + i)] = static_cast<uint8>(v >> (8 * i));
+  }
+}
+
+inline void ExpectSamePixels(const FasTC::Image<> &expected, const FasTC::Image<> &actual) {
+  ASSERT_EQ(expected.GetWidth(), actual.GetWidth());
+  ASSERT_EQ(expected.GetHeight(), actual.GetHeight());
+  for(uint32 j = 0; j < expected.GetHeight(); j++) {
+    for(uint32 i = 0; i < expected.GetWidth(); i++) {
+      EXPECT_EQ(expected(i, j).Pack(), actual(i, j).Pack());
+    }
+  }
+}
+
+inline void ExpectSameBlocks(const std::vector<uint8> &expected,
+                             FasTC::ECompressionFormat fmt, const FasTC::Image<> *actual) {
+  const CompressedImage *ci = dynamic_cast<const CompressedImage *>(actual);
+  ASSERT_TRUE(ci != NULL);
+  EXPECT_EQ(fmt, ci->GetFormat());
+  ASSERT_EQ(expected.size(), ci->GetCompressedSize());
+  EXPECT_EQ(0, memcmp(&expected[0], ci->GetCompressedData(), expected.size()));
+}
+
+#endif  // IO_TEST_UTILS_H_
@@ -18,6 +18,7 @@
 #ifndef PVRTCENCODER_INCLUDE_PVRTCCOMPRESSOR_H_
 #define PVRTCENCODER_INCLUDE_PVRTCCOMPRESSOR_H_
 
+#include "FasTC/BlockStats.h"
 #include "FasTC/CompressionJob.h"
 #include "FasTC/PVRTCDefines.h"
 
@@ -44,6 +45,13 @@ namespace PVRTCC {
   void Compress(const FasTC::CompressionJob &,
                 const EWrapMode wrapMode = eWrapMode_Wrap);
 
+  // The same as Compress, but also decompresses the result and adds a record
+  // with the modulation mode and error of each block to stats. The records
+  // are in row major order rather than the order the blocks are stored in.
+  void CompressWithStats(const FasTC::CompressionJob &,
+                         FasTC::BlockStatList *stats,
+                         const EWrapMode wrapMode = eWrapMode_Wrap);
+
 #ifdef PVRTEXLIB_FOUND
   void CompressPVRLib(const FasTC::CompressionJob &,
                       bool bTwoBitMode = false,
@@ -26,6 +26,8 @@
 
 #include "FasTC/Pixel.h"
 #include "FasTC/Color.h"
+#include "FasTC/Memory.h"
+#include "FasTC/Trace.h"
 
 #ifndef NDEBUG
 #  include "PVRTCImage.h"
@@ -859,6 +861,8 @@ namespace PVRTCC {
 #endif
 
   void Compress(const FasTC::CompressionJob &cj, EWrapMode wrapMode) {
+    FASTC_TRACE_ZONE("PVRTC Compress");
+
     const uint32 width = cj.Width();
     const uint32 height = cj.Height();
 
@@ -874,13 +878,18 @@ namespace PVRTCC {
     assert(cj.XStart() == 0 && cj.YStart() == 0);
     assert(cj.XEnd() == cj.Width() && cj.YEnd() == cj.Width());
 
+    const uint64 labelsSz = static_cast<uint64>(width) * height * sizeof(CompressionLabel);
     CompressionLabel *labels =
       (CompressionLabel *)calloc(width * height, sizeof(CompressionLabel));
+    TCMemory::RecordAllocation(TCMemory::eCategory_Compressor, labelsSz);
 
     Indexer idxr(width, height, wrapMode);
 
     // First traverse forward...
-    LabelImageForward(labels, cj.InBuf(), idxr);
+    {
+      FASTC_TRACE_ZONE("PVRTC Label Forward");
+      LabelImageForward(labels, cj.InBuf(), idxr);
+    }
 
 #ifndef NDEBUG
     gDbgPixels = reinterpret_cast<const uint32 *>(cj.InBuf());
@@ -902,7 +911,10 @@ namespace PVRTCC {
 #endif
 
     // Then traverse backward...
-    LabelImageBackward(labels, idxr);
+    {
+      FASTC_TRACE_ZONE("PVRTC Label Backward");
+      LabelImageBackward(labels, idxr);
+    }
 
 #ifndef NDEBUG
     DebugOutputLabels("Backward-", labels, width, height);
@@ -933,12 +945,56 @@ namespace PVRTCC {
 #endif
 
     // Then combine everything...
-    GenerateLowHighImages(labels, cj.InBuf(), cj.OutBuf(), idxr);
+    {
+      FASTC_TRACE_ZONE("PVRTC Low High Images");
+      GenerateLowHighImages(labels, cj.InBuf(), cj.OutBuf(), idxr);
+    }
 
     // Then compute modulation values
-    GenerateModulationValues(cj.OutBuf(), cj.InBuf(), idxr);
+    {
+      FASTC_TRACE_ZONE("PVRTC Modulation");
+      GenerateModulationValues(cj.OutBuf(), cj.InBuf(), idxr);
+    }
 
     // Cleanup
     free(labels);
+    TCMemory::RecordFree(TCMemory::eCategory_Compressor, labelsSz);
+  }
+
+  void CompressWithStats(const FasTC::CompressionJob &cj,
+                         FasTC::BlockStatList *stats, EWrapMode wrapMode) {
+    Compress(cj, wrapMode);
+    if(!stats) {
+      return;
+    }
+
+    // Every pixel depends on the neighboring blocks, so the error of a block
+    // can only be measured once the whole image has been compressed.
+    const uint32 width = cj.Width();
+    const uint32 height = cj.Height();
+    std::vector<uint32> decoded(width * height);
+    FasTC::DecompressionJob dcj(cj.Format(), cj.OutBuf(),
+                                reinterpret_cast<uint8 *>(&decoded[0]),
+                                width, height);
+    Decompress(dcj, wrapMode);
+
+    const uint32 *inPixels = reinterpret_cast<const uint32 *>(cj.InBuf());
+    uint32 original[16];
+    uint32 result[16];
+    for(uint32 j = 0; j < height / 4; j++) {
+      for(uint32 i = 0; i < width / 4; i++) {
+        for(uint32 y = 0; y < 4; y++) {
+          const uint32 offset = (j*4 + y)*width + i*4;
+          memcpy(original + y*4, inPixels + offset, 4 * sizeof(uint32));
+          memcpy(result + y*4, &decoded[offset], 4 * sizeof(uint32));
+        }
+
+        FasTC::BlockStat stat(cj.Format(), j * (width / 4) + i);
+        Block b(cj.OutBuf() + GetBlockIndex(i, j) * kBlockSize);
+        stat.m_Mode = b.GetModeBit()? 1 : 0;
+        stat.m_Error = FasTC::BlockStat::SquaredError(original, result, true);
+        stats->Add(stat);
+      }
+    }
   }
 }  // namespace PVRTCC
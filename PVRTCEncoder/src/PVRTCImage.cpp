@@ -27,6 +27,7 @@
 #include <cstdio>
 #include <cmath>
 
+#include "FasTC/Memory.h"
 #include "FasTC/Pixel.h"
 using FasTC::Pixel;
 
@@ -102,7 +103,8 @@ void Image::BilinearUpscale(uint32 xtimes, uint32 ytimes,
   const uint32 yscale = 1 << ytimes;
   const uint32 yoffset = yscale >> 1;
 
-  FasTC::Pixel *upscaledPixels = new FasTC::Pixel[newWidth * newHeight];
+  FasTC::Pixel *upscaledPixels = TCMemory::NewArray<FasTC::Pixel>(
+    TCMemory::eCategory_Image, newWidth * newHeight);
 
   assert(m_FractionalPixels);
   delete [] m_FractionalPixels;
@@ -205,7 +207,8 @@ void Image::AverageDownscale(uint32 xtimes, uint32 ytimes) {
   const uint32 newWidth = w >> xtimes;
   const uint32 newHeight = h >> ytimes;
 
-  Pixel *downscaledPixels = new Pixel[newWidth * newHeight];
+  Pixel *downscaledPixels = TCMemory::NewArray<Pixel>(
+    TCMemory::eCategory_Image, newWidth * newHeight);
 
   uint8 bitDepth[4];
   GetPixel(0, 0).GetBitDepth(bitDepth);
@@ -242,7 +245,8 @@ void Image::ContentAwareDownscale(uint32 xtimes, uint32 ytimes,
   const uint32 newWidth = w >> xtimes;
   const uint32 newHeight = h >> ytimes;
 
-  FasTC::Pixel *downscaledPixels = new FasTC::Pixel[newWidth * newHeight];
+  FasTC::Pixel *downscaledPixels = TCMemory::NewArray<FasTC::Pixel>(
+    TCMemory::eCategory_Image, newWidth * newHeight);
   const uint32 numDownscaledPixels = newWidth * newHeight;
 
   uint8 bitDepth[4];
@@ -253,7 +257,7 @@ void Image::ContentAwareDownscale(uint32 xtimes, uint32 ytimes,
   }
 
   // Allocate memory
-  float *imgData = new float[19 * w * h];
+  float *imgData = TCMemory::NewArray<float>(TCMemory::eCategory_Compressor, 19 * w * h);
   float *I = imgData;
   float *Ix[5] = {
     imgData + (w * h),
@@ -362,7 +366,7 @@ void Image::ContentAwareDownscale(uint32 xtimes, uint32 ytimes,
   }
 
   SetImageData(newWidth, newHeight, downscaledPixels);
-  delete [] imgData;
+  TCMemory::DeleteArray(TCMemory::eCategory_Compressor, imgData, 19 * w * h);
 }
 
 void Image::ComputeHessianEigenvalues(::std::vector<float> &eigOne, 